@@ -0,0 +1,310 @@
+/**
+ * Benchmarks of C++ code that uses the Bdd and Mtbdd classes of sylvan_obj.hpp, and of
+ * the typed MTBDDs of sylvan_mtbdd_ops.hpp.
+ *
+ * The operations are small and almost always found in the operation cache, so the
+ * time is dominated by the C++ wrappers: creating and destroying temporaries,
+ * protecting and unprotecting their roots, and copying objects into containers.
+ * Only mtbdd_plus and typed_plus clear the cache, to compare the apply kernels.
+ * The results are written as JSON, in the same format as bench_micro.
+ */
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+#include <vector>
+
+#include <sylvan.h>
+#include <sylvan_obj.hpp>
+#include <sylvan_mtbdd_ops.hpp>
+
+#ifndef SYLVAN_BENCH_VERSION
+#define SYLVAN_BENCH_VERSION "unknown"
+#endif
+
+using namespace sylvan;
+
+/* Configuration */
+static size_t iterations = 1000000; // iterations per benchmark
+static int repeat = 5;              // number of repetitions of every benchmark
+static char *filter = NULL;         // only run benchmarks whose name contains this string
+static char *output = NULL;         // write JSON here (default: stdout)
+
+static FILE *json;
+static int json_first = 1;
+
+/* Variables and the sink for the results, so nothing is optimized away */
+static const uint32_t nvars = 16;
+static std::vector<Bdd> *vars;
+static size_t sink = 0;
+
+static uint64_t
+now(void)
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Write one result, like report() in bench_micro.c.
+ */
+static void
+report(const char *name, size_t ops, std::vector<uint64_t> &times)
+{
+    std::sort(times.begin(), times.end());
+    uint64_t best = times[0], median = times[times.size()/2];
+    double mops = best == 0 ? 0.0 : (double)ops * 1000.0 / best;
+
+    fprintf(json, "%s\n{\"name\":\"%s\",\"workers\":%u,\"params\":{},\"ops\":%zu,\"best_ns\":%" PRIu64 ",\"median_ns\":%" PRIu64 ",\"mops\":%.3f}",
+            json_first ? "" : ",", name, lace_workers(), ops, best, median, mops);
+    json_first = 0;
+
+    fprintf(stderr, "%-16s w=%-3u %10.3f Mops/s  (best %.3f ms, median %.3f ms)\n",
+            name, lace_workers(), mops, best / 1e6, median / 1e6);
+}
+
+static int
+selected(const char *name)
+{
+    return filter == NULL || strstr(name, filter) != NULL;
+}
+
+static void
+run(const char *name, size_t ops, void (*body)(void))
+{
+    if (!selected(name)) return;
+    std::vector<uint64_t> times;
+    for (int r=0; r<repeat; r++) {
+        uint64_t t = now();
+        body();
+        times.push_back(now() - t);
+    }
+    report(name, ops, times);
+}
+
+/**
+ * bdd_expr: expressions with several operators, which create a temporary per operator.
+ */
+static void
+bdd_expr(void)
+{
+    const std::vector<Bdd> &v = *vars;
+    for (size_t i=0; i<iterations; i++) {
+        const size_t k = i % (nvars - 4);
+        Bdd r = (v[k] & v[k+1] & v[k+2]) | (v[k+3] ^ v[k+4]) | (v[k] - v[k+2]);
+        sink += r.GetBDD() & 1;
+    }
+}
+
+/**
+ * mtbdd_expr: the same for Mtbdd arithmetic.
+ */
+static void
+mtbdd_expr(void)
+{
+    const Mtbdd one = Mtbdd::doubleTerminal(1.0), two = Mtbdd::doubleTerminal(2.0);
+    std::vector<Mtbdd> v;
+    for (uint32_t i=0; i<nvars; i++) v.push_back(Mtbdd((*vars)[i]) * two + one);
+    for (size_t i=0; i<iterations; i++) {
+        const size_t k = i % (nvars - 3);
+        Mtbdd r = v[k] + v[k+1] * v[k+2] - v[k+3] + one;
+        sink += r.GetMTBDD() & 1;
+    }
+}
+
+/**
+ * vector_grow: push_back into a vector that is not reserved, so its elements are
+ * moved (or copied) whenever it grows.
+ */
+static void
+vector_grow(void)
+{
+    const std::vector<Bdd> &v = *vars;
+    for (size_t i=0; i<iterations; i+=100) {
+        std::vector<Bdd> bdds;
+        for (size_t j=0; j<100; j++) bdds.push_back(v[j % nvars]);
+        sink += bdds.size();
+    }
+}
+
+static Bdd __attribute__((noinline))
+make_and(const Bdd &a, const Bdd &b)
+{
+    Bdd r = a & b;
+    return r;
+}
+
+static std::vector<Bdd> __attribute__((noinline))
+make_list(size_t k)
+{
+    std::vector<Bdd> result;
+    result.push_back(make_and((*vars)[k], (*vars)[k+1]));
+    result.push_back(make_and((*vars)[k+1], (*vars)[k+2]));
+    return result;
+}
+
+/**
+ * return_value: objects returned by value and assigned to existing objects.
+ */
+static void
+return_value(void)
+{
+    Bdd r;
+    for (size_t i=0; i<iterations; i++) {
+        const size_t k = i % (nvars - 2);
+        std::vector<Bdd> list = make_list(k);
+        r = std::move(list[0]);
+        sink += r.GetBDD() & 1;
+    }
+}
+
+/**
+ * Two MTBDDs of doubles over all variables, with a leaf for every assignment, and their sum.
+ */
+static std::vector<Mtbdd> *operands;
+
+static void
+make_operands(void)
+{
+    operands = new std::vector<Mtbdd>();
+    for (int k=0; k<2; k++) {
+        Mtbdd r = Mtbdd::doubleTerminal(0.0);
+        for (uint32_t i=0; i<nvars; i++) {
+            Mtbdd w = Mtbdd::doubleTerminal((double)(1 << i) + k * 0.5);
+            r = r + Mtbdd((*vars)[i]) * w;
+        }
+        operands->push_back(r);
+    }
+    // the sum already exists, so the benchmarks do not measure creating new nodes
+    operands->push_back((*operands)[0] + (*operands)[1]);
+}
+
+/**
+ * mtbdd_plus: mtbdd_plus of the two MTBDDs, computed from scratch (the cache is cleared),
+ * which calls the mtbdd_op_plus callback for every pair of nodes.
+ * The number of operations is the number of nodes of the result.
+ */
+static void
+mtbdd_plus_op(void)
+{
+    sylvan_clear_cache();
+    sink += mtbdd_plus((*operands)[0].GetMTBDD(), (*operands)[1].GetMTBDD()) & 1;
+}
+
+/**
+ * typed_plus: the same with the compiled kernel of mt::Mtbdd<double>.
+ */
+static void
+typed_plus(void)
+{
+    const mt::Mtbdd<double> a((*operands)[0]), b((*operands)[1]);
+    sylvan_clear_cache();
+    sink += (a + b).GetMTBDD() & 1;
+}
+
+static void
+print_usage(void)
+{
+    printf("Usage: bench_cxx [--iterations=<n>] [--repeat=<n>] [--filter=<name>] [--output=<file>]\n");
+    printf("                 [--quick] [--help]\n");
+}
+
+static void
+parse_args(int argc, char **argv)
+{
+    static const struct option longopts[] = {
+        {"iterations", required_argument, NULL, 'i'},
+        {"repeat", required_argument, NULL, 1},
+        {"filter", required_argument, NULL, 2},
+        {"output", required_argument, NULL, 'o'},
+        {"quick", no_argument, NULL, 3},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+    int key = 0;
+    int long_index = 0;
+    while ((key = getopt_long(argc, argv, "i:o:h", longopts, &long_index)) != -1) {
+        switch (key) {
+            case 'i':
+                iterations = (size_t)atol(optarg);
+                break;
+            case 1:
+                repeat = atoi(optarg);
+                break;
+            case 2:
+                filter = optarg;
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            case 3:
+                iterations = 10000;
+                repeat = 1;
+                break;
+            case 'h':
+                print_usage();
+                exit(0);
+            default:
+                print_usage();
+                exit(1);
+        }
+    }
+    if (iterations < 1000 || repeat < 1) {
+        fprintf(stderr, "Invalid number of iterations or repetitions!\n");
+        exit(1);
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    parse_args(argc, argv);
+
+    json = stdout;
+    if (output != NULL) {
+        json = fopen(output, "w");
+        if (json == NULL) {
+            fprintf(stderr, "Cannot open file '%s'!\n", output);
+            exit(1);
+        }
+    }
+
+    // The C++ classes are used from the main thread, as most applications do
+    lace_start(1, 0);
+    sylvan_set_sizes(1LL<<20, 1LL<<20, 1LL<<20, 1LL<<20);
+    sylvan_init_package();
+    sylvan_init_mtbdd();
+
+    fprintf(json, "{\"benchmark\":\"sylvan_cxx\",\"version\":\"%s\",\"iterations\":%zu,\"repeat\":%d,\"results\":[",
+            SYLVAN_BENCH_VERSION, iterations, repeat);
+
+    vars = new std::vector<Bdd>();
+    for (uint32_t i=0; i<nvars; i++) vars->push_back(Bdd::bddVar(i));
+
+    run("bdd_expr", iterations, bdd_expr);
+    run("mtbdd_expr", iterations, mtbdd_expr);
+    run("vector_grow", iterations, vector_grow);
+    run("return_value", iterations, return_value);
+
+    make_operands();
+    const size_t nodes = mtbdd_nodecount((*operands)[2].GetMTBDD());
+    run("mtbdd_plus", nodes, mtbdd_plus_op);
+    run("typed_plus", nodes, typed_plus);
+    delete operands;
+
+    delete vars;
+
+    fprintf(json, "\n]}\n");
+    if (json != stdout) fclose(json);
+    if (sink == 42) fprintf(stderr, "\n");
+
+    sylvan_quit();
+    lace_stop();
+    return 0;
+}
@@ -0,0 +1,205 @@
+#!/usr/bin/env python3
+#
+# Copyright 2011-2016 Formal Methods and Tools, University of Twente
+# Copyright 2016-2017 Tom van Dijk, Johannes Kepler University Linz
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+Model checking benchmarks with scaling curves.
+
+Runs the bddmc and lddmc examples on the bundled models (models/*.bdd and models/*.ldd) for
+every strategy, worker count and sequential cut-off, collects the summary that the examples
+write with --summary=<file>, and writes all runs and the speedup curves as JSON and CSV.
+The speedup of a run is relative to the run with the smallest worker count (normally 1)
+of the same model, strategy and cut-off.
+
+Only the Python standard library is used.
+"""
+
+import argparse
+import csv
+import json
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+STRATEGIES = ["bfs", "par", "sat", "chaining"]
+TOOLS = {".bdd": "bddmc", ".ldd": "lddmc"}
+QUICK_MODELS = ["bakery.4.bdd", "bakery.4.ldd"]
+FIELDS = ["tool", "model", "strategy", "cutoff", "workers", "status", "time", "total_time",
+          "states", "nodes", "peak_nodes", "gc_count", "gc_time", "cache_hitrate", "peak_rss",
+          "speedup", "efficiency"]
+
+
+def default_workers():
+    """1, 2, 4, ... up to the number of cores (and the number of cores itself)."""
+    n = os.cpu_count() or 1
+    result = []
+    w = 1
+    while w < n:
+        result.append(w)
+        w *= 2
+    result.append(n)
+    return result
+
+
+def int_list(s):
+    return [int(x) for x in s.split(",") if x != ""]
+
+
+def parse_args():
+    here = os.path.dirname(os.path.abspath(__file__))
+    p = argparse.ArgumentParser(description="Run the model checking benchmarks.")
+    p.add_argument("--bin-dir", required=True, help="directory with the bddmc and lddmc executables")
+    p.add_argument("--models", default=os.path.join(here, "..", "models"),
+                   help="directory with the models, or a comma-separated list of model files")
+    p.add_argument("--filter", default=None, help="only models whose name matches this regular expression")
+    p.add_argument("--strategies", default=",".join(STRATEGIES), help="comma-separated (default: all)")
+    p.add_argument("--workers", type=int_list, default=None, help="comma-separated (default: 1,2,4,...,cores)")
+    p.add_argument("--cutoffs", type=int_list, default=[-1],
+                   help="comma-separated sequential cut-offs, -1 for none (default: -1)")
+    p.add_argument("--repeat", type=int, default=1, help="runs per configuration, the fastest is kept")
+    p.add_argument("--timeout", type=float, default=600, help="timeout per run in seconds")
+    p.add_argument("--json", default="bench_mc.json", help="output file for JSON")
+    p.add_argument("--csv", default="bench_mc.csv", help="output file for CSV")
+    p.add_argument("--quick", action="store_true", help="only the smallest models, to check that everything works")
+    args = p.parse_args()
+    args.strategies = [s for s in args.strategies.split(",") if s != ""]
+    for s in args.strategies:
+        if s not in STRATEGIES:
+            p.error("unknown strategy '%s'" % s)
+    if args.workers is None:
+        args.workers = [1, 2] if args.quick else default_workers()
+    return args
+
+
+def find_models(args):
+    if os.path.isdir(args.models):
+        names = sorted(os.listdir(args.models))
+        if args.quick:
+            names = [n for n in names if n in QUICK_MODELS]
+        models = [os.path.join(args.models, n) for n in names]
+    else:
+        models = [m for m in args.models.split(",") if m != ""]
+    models = [m for m in models if os.path.splitext(m)[1] in TOOLS]
+    if args.filter is not None:
+        models = [m for m in models if re.search(args.filter, os.path.basename(m))]
+    return models
+
+
+def run_one(args, tool, model, strategy, workers, cutoff):
+    """Run the tool once and return its summary, or a dict with the failure status."""
+    exe = os.path.join(args.bin_dir, tool)
+    fd, summary = tempfile.mkstemp(suffix=".json")
+    os.close(fd)
+    cmd = [exe, "--workers=%d" % workers, "--strategy=%s" % strategy, "--summary=%s" % summary]
+    if cutoff >= 0:
+        cmd.append("--cutoff=%d" % cutoff)
+    cmd.append(model)
+    try:
+        proc = subprocess.run(cmd, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, timeout=args.timeout)
+        if proc.returncode != 0:
+            sys.stderr.write(proc.stderr.decode(errors="replace"))
+            return {"status": "error (%d)" % proc.returncode}
+        with open(summary) as f:
+            result = json.loads(f.readline())
+        result["status"] = "ok"
+        return result
+    except subprocess.TimeoutExpired:
+        return {"status": "timeout"}
+    except (OSError, ValueError) as e:
+        sys.stderr.write("%s: %s\n" % (" ".join(cmd), e))
+        return {"status": "error"}
+    finally:
+        os.unlink(summary)
+
+
+def add_speedups(runs):
+    """Add the speedup and efficiency relative to the smallest worker count of each curve."""
+    curves = {}
+    for r in runs:
+        curves.setdefault((r["tool"], r["model"], r["strategy"], r["cutoff"]), []).append(r)
+    result = []
+    for key, points in curves.items():
+        points.sort(key=lambda r: r["workers"])
+        base = points[0]
+        for r in points:
+            if r["status"] == "ok" and base["status"] == "ok" and r["time"] > 0:
+                r["speedup"] = base["time"] / r["time"]
+                r["efficiency"] = r["speedup"] * base["workers"] / r["workers"]
+            else:
+                r["speedup"] = None
+                r["efficiency"] = None
+        result.append({"tool": key[0], "model": key[1], "strategy": key[2], "cutoff": key[3],
+                       "workers": [r["workers"] for r in points],
+                       "time": [r.get("time") for r in points],
+                       "speedup": [r["speedup"] for r in points]})
+    return result
+
+
+def main():
+    args = parse_args()
+    models = find_models(args)
+    if not models:
+        sys.exit("No models found in '%s'!" % args.models)
+
+    runs = []
+    for model in models:
+        tool = TOOLS[os.path.splitext(model)[1]]
+        name = os.path.basename(model)
+        for strategy in args.strategies:
+            for cutoff in args.cutoffs:
+                for workers in args.workers:
+                    best = None
+                    for _ in range(args.repeat):
+                        r = run_one(args, tool, model, strategy, workers, cutoff)
+                        if r["status"] != "ok":
+                            best = r
+                            break
+                        if best is None or r["time"] < best["time"]:
+                            best = r
+                    # the requested worker count; the summary has the number Lace actually started
+                    best.update({"tool": tool, "model": name, "strategy": strategy,
+                                 "cutoff": cutoff, "workers": workers})
+                    runs.append(best)
+                    if best["status"] == "ok":
+                        print("%-24s %-8s cutoff=%-3d workers=%-3d %10.3f s  %12.0f states  peak %d nodes" %
+                              (name, strategy, cutoff, workers, best["time"], best["states"], best["peak_nodes"]))
+                    else:
+                        print("%-24s %-8s cutoff=%-3d workers=%-3d %s" %
+                              (name, strategy, cutoff, workers, best["status"]))
+                    sys.stdout.flush()
+
+    curves = add_speedups(runs)
+
+    with open(args.json, "w") as f:
+        json.dump({"benchmark": "sylvan_mc", "cpu_count": os.cpu_count(), "repeat": args.repeat,
+                   "runs": runs, "curves": curves}, f, indent=1)
+        f.write("\n")
+
+    with open(args.csv, "w", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=FIELDS, extrasaction="ignore")
+        writer.writeheader()
+        for r in runs:
+            writer.writerow(r)
+
+    print("Wrote %s and %s" % (args.json, args.csv))
+    if any(r["status"] != "ok" for r in runs):
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
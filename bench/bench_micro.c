@@ -0,0 +1,619 @@
+/**
+ * Microbenchmarks of the unique table, the operation cache, garbage collection,
+ * the reference tables and submitting operations from other threads.
+ *
+ * Every benchmark is run for every worker count, with a fresh Sylvan instance per
+ * configuration, and repeated a number of times. The keys are generated from a fixed
+ * seed, so runs are reproducible. The results are written as JSON (one object with
+ * an array of results), which makes it easy to compare releases.
+ */
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sylvan_int.h>
+
+#ifndef SYLVAN_BENCH_VERSION
+#define SYLVAN_BENCH_VERSION "unknown"
+#endif
+
+/* Configuration */
+static int table_log = 22;      // log2 of the number of buckets of the nodes table
+static int cache_log = 22;      // log2 of the number of buckets of the operation cache
+static int repeat = 3;          // number of repetitions of every benchmark
+static char *filter = NULL;     // only run benchmarks whose name contains this string
+static char *output = NULL;     // write JSON here (default: stdout)
+static unsigned int worker_counts[64];
+static int n_worker_counts = 0;
+
+static FILE *json;
+static int json_first = 1;
+
+/**
+ * Deterministic pseudo-random numbers from an index (splitmix64).
+ */
+static inline uint64_t
+mix(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+/**
+ * Run body(from, to, ctx) in parallel over [from, to).
+ */
+typedef void (*bench_body_t)(size_t, size_t, void*);
+
+#define BENCH_GRAIN 4096
+
+VOID_TASK_4(bench_par, bench_body_t, body, void*, ctx, size_t, from, size_t, to)
+{
+    if (to - from > BENCH_GRAIN) {
+        size_t mid = from + (to - from) / 2;
+        SPAWN(bench_par, body, ctx, mid, to);
+        CALL(bench_par, body, ctx, from, mid);
+        SYNC(bench_par);
+    } else {
+        body(from, to, ctx);
+    }
+}
+
+static uint64_t
+bench_run(bench_body_t body, void *ctx, size_t count)
+{
+    uint64_t t = getabstime();
+    RUN(bench_par, body, ctx, 0, count);
+    return getabstime() - t;
+}
+
+static void
+start_sylvan(void)
+{
+    sylvan_set_sizes(1ULL<<table_log, 1ULL<<table_log, 1ULL<<cache_log, 1ULL<<cache_log);
+    sylvan_init_package();
+    sylvan_init_mtbdd();
+}
+
+static int
+cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+/**
+ * Write one result. <params> is a JSON fragment with the parameters of the benchmark;
+ * <extra> is an optional JSON fragment with additional measurements.
+ */
+static void
+report(const char *name, const char *params, size_t ops, uint64_t *times, const char *extra)
+{
+    qsort(times, repeat, sizeof(uint64_t), cmp_u64);
+    uint64_t best = times[0], median = times[repeat/2];
+    double mops = best == 0 ? 0.0 : (double)ops * 1000.0 / best;
+
+    fprintf(json, "%s\n{\"name\":\"%s\",\"workers\":%u,\"params\":{%s},\"ops\":%zu,\"best_ns\":%" PRIu64 ",\"median_ns\":%" PRIu64 ",\"mops\":%.3f",
+            json_first ? "" : ",", name, lace_workers(), params, ops, best, median, mops);
+    if (extra != NULL) fprintf(json, ",%s", extra);
+    fprintf(json, "}");
+    json_first = 0;
+
+    fprintf(stderr, "%-16s %-40s w=%-3u %10.3f Mops/s  (best %.3f ms, median %.3f ms)\n",
+            name, params, lace_workers(), mops, best / 1e6, median / 1e6);
+}
+
+static int
+selected(const char *name)
+{
+    return filter == NULL || strstr(name, filter) != NULL;
+}
+
+/**
+ * llmsset_lookup: fill the table to a load factor, then do lookups with a fraction of hits.
+ * The misses insert new nodes, so their number is kept small relative to the table.
+ */
+typedef struct lookup_ctx
+{
+    size_t filled;      // number of keys in the table
+    int hit_pct;        // percentage of lookups that find an existing key
+    _Atomic(size_t) failed;
+} lookup_ctx_t;
+
+static inline void
+lookup_key(uint64_t i, uint64_t *a, uint64_t *b)
+{
+    *a = mix(i) & 0x000000ffffffffffULL;
+    *b = i;
+}
+
+static void
+lookup_fill(size_t from, size_t to, void *_ctx)
+{
+    lookup_ctx_t *ctx = (lookup_ctx_t*)_ctx;
+    for (size_t i=from; i<to; i++) {
+        uint64_t a, b;
+        int created;
+        lookup_key(i, &a, &b);
+        if (llmsset_lookup(nodes, a, b, &created) == 0) ctx->failed++;
+    }
+}
+
+static void
+lookup_body(size_t from, size_t to, void *_ctx)
+{
+    lookup_ctx_t *ctx = (lookup_ctx_t*)_ctx;
+    for (size_t i=from; i<to; i++) {
+        uint64_t r = mix(i ^ 0x5555555555555555ULL);
+        // hits use a random existing key; misses use a fresh key beyond the filled range
+        uint64_t key = (int)(r % 100) < ctx->hit_pct ? (r >> 8) % ctx->filled : ctx->filled + i;
+        uint64_t a, b;
+        int created;
+        lookup_key(key, &a, &b);
+        if (llmsset_lookup(nodes, a, b, &created) == 0) ctx->failed++;
+    }
+}
+
+static void
+bench_lookup(void)
+{
+    if (!selected("llmsset_lookup")) return;
+
+    const int loads[] = {25, 50, 75};
+    const int hits[] = {100, 90, 50};
+    size_t size = 1ULL << table_log;
+    size_t ops = size / 16;
+
+    for (int l=0; l<3; l++) {
+        for (int h=0; h<3; h++) {
+            lookup_ctx_t ctx = { size * loads[l] / 100, hits[h], 0 };
+            uint64_t times[repeat];
+            for (int r=0; r<repeat; r++) {
+                ctx.failed = 0;
+                start_sylvan();
+                bench_run(lookup_fill, &ctx, ctx.filled);
+                times[r] = bench_run(lookup_body, &ctx, ops);
+                sylvan_quit();
+            }
+            char params[128], extra[64];
+            snprintf(params, sizeof(params), "\"load_pct\":%d,\"hit_pct\":%d", loads[l], hits[h]);
+            snprintf(extra, sizeof(extra), "\"failed\":%zu", (size_t)ctx.failed);
+            report("llmsset_lookup", params, ops, times, extra);
+        }
+    }
+}
+
+/**
+ * claim_data_bucket: all workers insert new nodes into an empty table, so they all claim
+ * regions of data buckets at the same time. The telemetry counters of the unique table
+ * show how often workers competed for regions.
+ */
+static void
+bench_claim(void)
+{
+    if (!selected("claim_data_bucket")) return;
+
+    size_t size = 1ULL << table_log;
+    size_t ops = size / 2;
+    lookup_ctx_t ctx = { 0, 0, 0 };
+    uint64_t times[repeat];
+    sylvan_stats_t before, after;
+
+    for (int r=0; r<repeat; r++) {
+        start_sylvan();
+        sylvan_stats_enable();
+        sylvan_stats_snapshot(&before);
+        times[r] = bench_run(lookup_fill, &ctx, ops);
+        sylvan_stats_snapshot(&after);
+        sylvan_stats_diff(&after, &after, &before);
+        sylvan_stats_disable();
+        sylvan_quit();
+    }
+
+    // the counters of the last repetition
+    char extra[256];
+    snprintf(extra, sizeof(extra), "\"region_switch\":%" PRIu64 ",\"region_cas_failed\":%" PRIu64 ",\"cas_failed\":%" PRIu64 ",\"full_scan\":%" PRIu64,
+             after.counters[LLMSSET_REGION_SWITCH], after.counters[LLMSSET_REGION_CAS_FAILED],
+             after.counters[LLMSSET_CAS_FAILED], after.counters[LLMSSET_FULL_SCAN]);
+    report("claim_data_bucket", "\"load_pct\":50", ops, times, extra);
+}
+
+/**
+ * cache_get/cache_put and cache_get6/cache_put6 on random keys.
+ * The gets look up the keys that were put, so most of them hit.
+ */
+static void
+cache_put_body(size_t from, size_t to, void *ctx)
+{
+    for (size_t i=from; i<to; i++) {
+        uint64_t k = mix(i);
+        cache_put(k & 0x000fffffffffffffULL, i, k >> 20, i);
+    }
+    (void)ctx;
+}
+
+static void
+cache_get_body(size_t from, size_t to, void *ctx)
+{
+    _Atomic(size_t) *found = (_Atomic(size_t)*)ctx;
+    size_t local = 0;
+    for (size_t i=from; i<to; i++) {
+        uint64_t k = mix(i), res;
+        if (cache_get(k & 0x000fffffffffffffULL, i, k >> 20, &res)) local++;
+    }
+    *found += local;
+}
+
+static void
+cache_put6_body(size_t from, size_t to, void *ctx)
+{
+    for (size_t i=from; i<to; i++) {
+        uint64_t k = mix(i);
+        cache_put6(k & 0x000fffffffffffffULL, i, k >> 20, i+1, i+2, i+3, i, k);
+    }
+    (void)ctx;
+}
+
+static void
+cache_get6_body(size_t from, size_t to, void *ctx)
+{
+    _Atomic(size_t) *found = (_Atomic(size_t)*)ctx;
+    size_t local = 0;
+    for (size_t i=from; i<to; i++) {
+        uint64_t k = mix(i), res1, res2;
+        if (cache_get6(k & 0x000fffffffffffffULL, i, k >> 20, i+1, i+2, i+3, &res1, &res2)) local++;
+    }
+    *found += local;
+}
+
+static void
+bench_cache(void)
+{
+    size_t ops = (1ULL << cache_log) / 4;
+    struct { const char *put, *get; bench_body_t put_body, get_body; size_t ops; } kinds[] = {
+        { "cache_put", "cache_get", cache_put_body, cache_get_body, ops },
+        { "cache_put6", "cache_get6", cache_put6_body, cache_get6_body, ops / 2 },
+    };
+
+    for (int k=0; k<2; k++) {
+        if (!selected(kinds[k].put) && !selected(kinds[k].get)) continue;
+        uint64_t put_times[repeat], get_times[repeat];
+        _Atomic(size_t) found = 0;
+        for (int r=0; r<repeat; r++) {
+            start_sylvan();
+            found = 0;
+            // the first pass touches the pages of the cache, the second one is measured
+            bench_run(kinds[k].put_body, NULL, kinds[k].ops);
+            put_times[r] = bench_run(kinds[k].put_body, NULL, kinds[k].ops);
+            get_times[r] = bench_run(kinds[k].get_body, (void*)&found, kinds[k].ops);
+            sylvan_quit();
+        }
+        char extra[64];
+        snprintf(extra, sizeof(extra), "\"hits\":%zu", (size_t)found);
+        if (selected(kinds[k].put)) report(kinds[k].put, "", kinds[k].ops, put_times, NULL);
+        if (selected(kinds[k].get)) report(kinds[k].get, "", kinds[k].ops, get_times, extra);
+    }
+}
+
+/**
+ * Garbage collection with a given fraction of the nodes surviving.
+ * Creates chains of 32 nodes ending in a unique leaf, and references some of the chains.
+ */
+#define GC_CHAIN 32
+
+VOID_TASK_3(gc_build, MTBDD*, roots, size_t, from, size_t, to)
+{
+    if (to - from > 256) {
+        size_t mid = from + (to - from) / 2;
+        SPAWN(gc_build, roots, mid, to);
+        CALL(gc_build, roots, from, mid);
+        SYNC(gc_build);
+        return;
+    }
+    for (size_t i=from; i<to; i++) {
+        MTBDD dd = mtbdd_int64((int64_t)i);
+        for (int v=GC_CHAIN-1; v>=0; v--) dd = mtbdd_makenode(v, dd, mtbdd_false);
+        roots[i] = dd;
+    }
+}
+
+static void
+bench_gc(void)
+{
+    if (!selected("sylvan_gc")) return;
+
+    const int survive[] = {0, 10, 50, 90};
+    // fill half of the table, so no garbage collection happens while building
+    size_t chains = (1ULL << table_log) / 2 / (GC_CHAIN + 1);
+    MTBDD *roots = (MTBDD*)malloc(sizeof(MTBDD) * chains);
+
+    for (int s=0; s<4; s++) {
+        uint64_t times[repeat];
+        sylvan_gc_info_t info;
+        for (int r=0; r<repeat; r++) {
+            start_sylvan();
+            RUN(gc_build, roots, 0, chains);
+            for (size_t i=0; i<chains; i++) {
+                if ((int)(mix(i) % 100) < survive[s]) mtbdd_ref(roots[i]);
+            }
+            uint64_t t = getabstime();
+            sylvan_gc();
+            times[r] = getabstime() - t;
+            sylvan_gc_get_info(&info);
+            sylvan_quit();
+        }
+        // the phases of the last repetition
+        char params[64], extra[256];
+        snprintf(params, sizeof(params), "\"survive_pct\":%d", survive[s]);
+        snprintf(extra, sizeof(extra), "\"nodes_before\":%zu,\"nodes_after\":%zu,\"clear_ns\":%" PRIu64 ",\"mark_ns\":%" PRIu64 ",\"rehash_ns\":%" PRIu64,
+                 info.nodes_before, info.nodes_after, info.time_clear_data, info.time_mark, info.time_rehash);
+        report("sylvan_gc", params, info.nodes_before, times, extra);
+    }
+
+    free(roots);
+}
+
+/**
+ * refs_up/refs_down (via mtbdd_ref/mtbdd_deref) and protect_up/protect_down
+ * (via mtbdd_protect/mtbdd_unprotect) on distinct keys.
+ * No nodes are created, so garbage collection never looks at the fake references.
+ */
+static void
+refs_body(size_t from, size_t to, void *ctx)
+{
+    for (size_t i=from; i<to; i++) mtbdd_ref((MTBDD)(2 + i));
+    for (size_t i=from; i<to; i++) mtbdd_deref((MTBDD)(2 + i));
+    (void)ctx;
+}
+
+static void
+protect_body(size_t from, size_t to, void *ctx)
+{
+    MTBDD *slots = (MTBDD*)ctx;
+    for (size_t i=from; i<to; i++) mtbdd_protect(slots + i);
+    for (size_t i=from; i<to; i++) mtbdd_unprotect(slots + i);
+}
+
+/**
+ * Scoped objects (like C++ temporaries): protected and unprotected in LIFO order, 4 at a time.
+ */
+static void
+protect_scoped_body(size_t from, size_t to, void *ctx)
+{
+    MTBDD *slots = (MTBDD*)ctx;
+    for (size_t i=from; i+4<=to; i+=4) {
+        for (size_t j=0; j<4; j++) mtbdd_protect(slots + i + j);
+        for (size_t j=4; j-- > 0;) mtbdd_unprotect(slots + i + j);
+    }
+}
+
+static void
+bench_refs(void)
+{
+    if (!selected("refs_up") && !selected("protect_up") && !selected("protect_scoped")) return;
+
+    size_t ops = 1ULL << (table_log - 4);
+    MTBDD *slots = (MTBDD*)calloc(ops, sizeof(MTBDD));
+    uint64_t refs_times[repeat], protect_times[repeat], scoped_times[repeat];
+
+    for (int r=0; r<repeat; r++) {
+        start_sylvan();
+        refs_times[r] = bench_run(refs_body, NULL, ops);
+        protect_times[r] = bench_run(protect_body, slots, ops);
+        scoped_times[r] = bench_run(protect_scoped_body, slots, ops);
+        sylvan_quit();
+    }
+
+    // every key is added and removed once
+    if (selected("refs_up")) report("refs_up", "", 2 * ops, refs_times, NULL);
+    if (selected("protect_up")) report("protect_up", "", 2 * ops, protect_times, NULL);
+    if (selected("protect_scoped")) report("protect_scoped", "", 2 * ops, scoped_times, NULL);
+    free(slots);
+}
+
+/**
+ * Many small queries from threads that are not Lace workers: every thread either calls
+ * sylvan_and (one round trip to the workers per query) or submits windows of queries
+ * with sylvan_submit and waits for them.
+ */
+#define SUBMIT_THREADS 4
+#define SUBMIT_POOL 64
+#define SUBMIT_WINDOW 256
+
+typedef struct submit_ctx
+{
+    MTBDD *pool;        // small BDDs, referenced
+    size_t queries;     // per thread
+    int submit;         // use sylvan_submit instead of sylvan_and
+    int thread;
+} submit_ctx_t;
+
+static void*
+submit_client(void *_ctx)
+{
+    submit_ctx_t *ctx = (submit_ctx_t*)_ctx;
+    sylvan_future_t *futures[SUBMIT_WINDOW];
+    size_t base = (size_t)ctx->thread * ctx->queries;
+    for (size_t i=0; i<ctx->queries; i+=SUBMIT_WINDOW) {
+        size_t n = ctx->queries - i < SUBMIT_WINDOW ? ctx->queries - i : SUBMIT_WINDOW;
+        for (size_t j=0; j<n; j++) {
+            uint64_t k = mix(base + i + j);
+            BDD a = ctx->pool[k % SUBMIT_POOL], b = ctx->pool[(k >> 32) % SUBMIT_POOL];
+            if (ctx->submit) {
+                sylvan_op_t op = sylvan_op_make(SYLVAN_OP_AND, a, b, sylvan_false);
+                futures[j] = sylvan_submit(&op);
+            } else {
+                sylvan_and(a, b);
+            }
+        }
+        if (ctx->submit) {
+            for (size_t j=0; j<n; j++) {
+                sylvan_future_wait(futures[j]);
+                sylvan_future_free(futures[j]);
+            }
+        }
+    }
+    return NULL;
+}
+
+static uint64_t
+submit_run(MTBDD *pool, size_t queries, int submit)
+{
+    pthread_t threads[SUBMIT_THREADS];
+    submit_ctx_t ctx[SUBMIT_THREADS];
+    uint64_t t = getabstime();
+    for (int i=0; i<SUBMIT_THREADS; i++) {
+        ctx[i] = (submit_ctx_t){pool, queries, submit, i};
+        pthread_create(&threads[i], NULL, submit_client, &ctx[i]);
+    }
+    for (int i=0; i<SUBMIT_THREADS; i++) pthread_join(threads[i], NULL);
+    return getabstime() - t;
+}
+
+static void
+bench_submit(void)
+{
+    if (!selected("run_small") && !selected("submit_small")) return;
+
+    size_t queries = 1ULL << (table_log - 8);
+    MTBDD pool[SUBMIT_POOL];
+    uint64_t run_times[repeat], submit_times[repeat];
+
+    for (int r=0; r<repeat; r++) {
+        start_sylvan();
+        // conjunctions of 8 literals over 32 variables
+        for (int i=0; i<SUBMIT_POOL; i++) {
+            BDD dd = sylvan_true;
+            for (int j=0; j<8; j++) {
+                uint64_t k = mix((uint64_t)i * 8 + j);
+                BDD lit = sylvan_ithvar(k % 32);
+                dd = sylvan_and(dd, (k >> 32) & 1 ? lit : sylvan_not(lit));
+            }
+            pool[i] = sylvan_ref(dd);
+        }
+        run_times[r] = submit_run(pool, queries, 0);
+        sylvan_clear_cache();
+        submit_times[r] = submit_run(pool, queries, 1);
+        sylvan_quit();
+    }
+
+    char params[64];
+    snprintf(params, sizeof(params), "\"threads\":%d", SUBMIT_THREADS);
+    if (selected("run_small")) report("run_small", params, SUBMIT_THREADS * queries, run_times, NULL);
+    if (selected("submit_small")) report("submit_small", params, SUBMIT_THREADS * queries, submit_times, NULL);
+}
+
+static void
+print_usage(void)
+{
+    printf("Usage: bench_micro [--workers=<n,n,...>] [--table=<log2>] [--cache=<log2>] [--repeat=<n>]\n");
+    printf("                   [--filter=<name>] [--output=<file>] [--quick] [--help]\n");
+}
+
+static void
+parse_workers(char *arg)
+{
+    n_worker_counts = 0;
+    for (char *tok = strtok(arg, ","); tok != NULL && n_worker_counts < 64; tok = strtok(NULL, ",")) {
+        worker_counts[n_worker_counts++] = (unsigned int)atoi(tok);
+    }
+}
+
+static void
+parse_args(int argc, char **argv)
+{
+    static const struct option longopts[] = {
+        {.name = "workers", .val = 'w', .has_arg = required_argument},
+        {.name = "table", .val = 1, .has_arg = required_argument},
+        {.name = "cache", .val = 2, .has_arg = required_argument},
+        {.name = "repeat", .val = 3, .has_arg = required_argument},
+        {.name = "filter", .val = 4, .has_arg = required_argument},
+        {.name = "output", .val = 'o', .has_arg = required_argument},
+        {.name = "quick", .val = 5, .has_arg = no_argument},
+        {.name = "help", .val = 'h', .has_arg = no_argument},
+        {},
+    };
+    int key = 0;
+    int long_index = 0;
+    while ((key = getopt_long(argc, argv, "w:o:h", longopts, &long_index)) != -1) {
+        switch (key) {
+            case 'w':
+                parse_workers(optarg);
+                break;
+            case 1:
+                table_log = atoi(optarg);
+                break;
+            case 2:
+                cache_log = atoi(optarg);
+                break;
+            case 3:
+                repeat = atoi(optarg);
+                break;
+            case 4:
+                filter = optarg;
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            case 5:
+                table_log = 18;
+                cache_log = 18;
+                repeat = 1;
+                break;
+            case 'h':
+                print_usage();
+                exit(0);
+            default:
+                print_usage();
+                exit(1);
+        }
+    }
+    if (table_log < 16 || table_log > 40 || cache_log < 16 || cache_log > 40 || repeat < 1) {
+        fprintf(stderr, "Invalid table size, cache size or number of repetitions!\n");
+        exit(1);
+    }
+    if (n_worker_counts == 0) {
+        // 1, 2, 4, ... up to the number of cores
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        for (unsigned int w=1; w<(unsigned int)cores && n_worker_counts < 63; w*=2) worker_counts[n_worker_counts++] = w;
+        worker_counts[n_worker_counts++] = cores > 0 ? (unsigned int)cores : 1;
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    parse_args(argc, argv);
+
+    json = stdout;
+    if (output != NULL) {
+        json = fopen(output, "w");
+        if (json == NULL) {
+            fprintf(stderr, "Cannot open file '%s'!\n", output);
+            exit(1);
+        }
+    }
+
+    fprintf(json, "{\"benchmark\":\"sylvan_micro\",\"version\":\"%s\",\"table_log\":%d,\"cache_log\":%d,\"repeat\":%d,\"results\":[",
+            SYLVAN_BENCH_VERSION, table_log, cache_log, repeat);
+
+    for (int w=0; w<n_worker_counts; w++) {
+        lace_start(worker_counts[w], 0);
+        bench_lookup();
+        bench_claim();
+        bench_cache();
+        bench_gc();
+        bench_refs();
+        bench_submit();
+        lace_stop();
+    }
+
+    fprintf(json, "\n]}\n");
+    if (json != stdout) fclose(json);
+    return 0;
+}
@@ -0,0 +1,197 @@
+/**
+ * Replays a recording of Sylvan calls (see sylvan_record.h), for example made with the
+ * --record option of the bddmc and lddmc examples, and reports the time of every operation.
+ *
+ * The calls are replayed one by one, in the order in which they were recorded, so a recording
+ * of an application can be used to compare builds of Sylvan without the application.
+ * The time per operation is reported next to the time it took when it was recorded.
+ */
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sylvan.h>
+
+#ifndef SYLVAN_BENCH_VERSION
+#define SYLVAN_BENCH_VERSION "unknown"
+#endif
+
+/* Configuration */
+static int workers = 0;             // number of workers (0 = autodetect)
+static size_t memory = 0;           // memory for the nodes table and the operation cache (MB, 0 = as recorded)
+static int replay_gc = 1;           // perform garbage collection where it happened while recording
+static int profile_ops = 0;         // profile nodes created per operation
+static char *calls_filename = NULL; // write the time of every call (CSV) to this file
+static char *output = NULL;         // write the summary (JSON) to this file
+static char *recording = NULL;
+
+/* Totals per operation */
+static struct
+{
+    uint64_t calls;
+    uint64_t time;
+    uint64_t recorded_time;
+    uint64_t max_time;
+} totals[SYLVAN_RECORD_OP_COUNT];
+
+static FILE *calls_file = NULL;
+
+static void
+replayed(int op, uint64_t index, uint64_t time, uint64_t recorded_time, void *context)
+{
+    totals[op].calls++;
+    totals[op].time += time;
+    totals[op].recorded_time += recorded_time;
+    if (time > totals[op].max_time) totals[op].max_time = time;
+    if (calls_file != NULL) {
+        fprintf(calls_file, "%" PRIu64 ",%s,%" PRIu64 ",%" PRIu64 "\n", index, sylvan_record_op_name(op), time, recorded_time);
+    }
+    (void)context;
+}
+
+static void
+print_usage(void)
+{
+    printf("Usage: bench_replay [--workers=<n>] [--memory=<MB>] [--no-gc] [--profile]\n");
+    printf("                    [--calls=<file>] [--output=<file>] [--help] <recording>\n");
+}
+
+static void
+parse_args(int argc, char **argv)
+{
+    static const struct option longopts[] = {
+        {.name = "workers", .val = 'w', .has_arg = required_argument},
+        {.name = "memory", .val = 1, .has_arg = required_argument},
+        {.name = "no-gc", .val = 2, .has_arg = no_argument},
+        {.name = "profile", .val = 3, .has_arg = no_argument},
+        {.name = "calls", .val = 4, .has_arg = required_argument},
+        {.name = "output", .val = 'o', .has_arg = required_argument},
+        {.name = "help", .val = 'h', .has_arg = no_argument},
+        {},
+    };
+    int key = 0;
+    int long_index = 0;
+    while ((key = getopt_long(argc, argv, "w:o:h", longopts, &long_index)) != -1) {
+        switch (key) {
+            case 'w':
+                workers = atoi(optarg);
+                break;
+            case 1:
+                memory = (size_t)atol(optarg);
+                break;
+            case 2:
+                replay_gc = 0;
+                break;
+            case 3:
+                profile_ops = 1;
+                break;
+            case 4:
+                calls_filename = optarg;
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            case 'h':
+                print_usage();
+                exit(0);
+            default:
+                print_usage();
+                exit(1);
+        }
+    }
+    if (optind >= argc) {
+        print_usage();
+        exit(1);
+    }
+    recording = argv[optind];
+}
+
+static void
+write_json(FILE *out, int64_t calls)
+{
+    uint64_t time = 0, recorded_time = 0;
+    for (int op=0; op<SYLVAN_RECORD_OP_COUNT; op++) {
+        time += totals[op].time;
+        recorded_time += totals[op].recorded_time;
+    }
+    fprintf(out, "{\"benchmark\":\"sylvan_replay\",\"version\":\"%s\",\"recording\":\"%s\",\"workers\":%u,\"gc\":%d",
+            SYLVAN_BENCH_VERSION, recording, lace_workers(), replay_gc);
+    fprintf(out, ",\"calls\":%" PRId64 ",\"time\":%" PRIu64 ",\"recorded_time\":%" PRIu64 ",\"operations\":[", calls, time, recorded_time);
+    int first = 1;
+    for (int op=0; op<SYLVAN_RECORD_OP_COUNT; op++) {
+        if (totals[op].calls == 0) continue;
+        fprintf(out, "%s\n{\"name\":\"%s\",\"calls\":%" PRIu64 ",\"time\":%" PRIu64 ",\"recorded_time\":%" PRIu64 ",\"max_time\":%" PRIu64 "}",
+                first ? "" : ",", sylvan_record_op_name(op), totals[op].calls, totals[op].time, totals[op].recorded_time, totals[op].max_time);
+        first = 0;
+    }
+    fprintf(out, "\n]}\n");
+}
+
+int
+main(int argc, char **argv)
+{
+    parse_args(argc, argv);
+
+    FILE *in = fopen(recording, "rb");
+    if (in == NULL) {
+        fprintf(stderr, "Cannot open file '%s'!\n", recording);
+        exit(1);
+    }
+    if (calls_filename != NULL) {
+        calls_file = fopen(calls_filename, "w");
+        if (calls_file == NULL) {
+            fprintf(stderr, "Cannot open file '%s'!\n", calls_filename);
+            exit(1);
+        }
+        fprintf(calls_file, "index,operation,time,recorded_time\n");
+    }
+
+    size_t table_size, table_max, cache_size, cache_max;
+    if (sylvan_replay_sizes(in, &table_size, &table_max, &cache_size, &cache_max) != 0) {
+        fprintf(stderr, "Invalid recording '%s'!\n", recording);
+        exit(1);
+    }
+
+    lace_start(workers, 0);
+    if (memory != 0) sylvan_set_limits(memory << 20, 1, 6);
+    else sylvan_set_sizes(table_size, table_max, cache_size, cache_max);
+    sylvan_init_package();
+    sylvan_init_mtbdd();
+    sylvan_init_ldd();
+    if (profile_ops) sylvan_profile_enable();
+
+    int64_t calls = sylvan_replay(in, replay_gc, replayed, NULL);
+    fclose(in);
+    if (calls_file != NULL) fclose(calls_file);
+    if (calls < 0) {
+        fprintf(stderr, "Invalid recording '%s'!\n", recording);
+        exit(1);
+    }
+
+    printf("Replayed %" PRId64 " calls of '%s' with %u workers.\n", calls, recording, lace_workers());
+    printf("%-22s %10s %12s %12s %8s\n", "operation", "calls", "time (s)", "recorded (s)", "ratio");
+    for (int op=0; op<SYLVAN_RECORD_OP_COUNT; op++) {
+        if (totals[op].calls == 0) continue;
+        double t = (double)totals[op].time / 1e9, r = (double)totals[op].recorded_time / 1e9;
+        printf("%-22s %10" PRIu64 " %12.6f %12.6f %8.3f\n", sylvan_record_op_name(op), totals[op].calls, t, r, r > 0 ? t / r : 0.0);
+    }
+
+    if (profile_ops) sylvan_profile_report(stdout);
+
+    if (output != NULL) {
+        FILE *f = fopen(output, "w");
+        if (f == NULL) {
+            fprintf(stderr, "Cannot open file '%s'!\n", output);
+            exit(1);
+        }
+        write_json(f, calls);
+        fclose(f);
+    }
+
+    sylvan_quit();
+    lace_stop();
+    return 0;
+}
@@ -16,8 +16,14 @@ static int report_levels = 0; // report states at end of every level
 static int report_table = 0; // report table size at end of every level
 static int report_nodes = 0; // report number of nodes of BDDs
 static int strategy = 2; // 0 = BFS, 1 = PAR, 2 = SAT, 3 = CHAINING
-static int check_deadlocks = 0; // set to 1 to check for deadlocks on-the-fly (only bfs/par)
-static int merge_relations = 0; // merge relations to 1 relation
+static int check_deadlocks = 0; // set to 1 to check for deadlocks
+static size_t cluster_nodes = 0; // merge relations up to this many nodes (SIZE_MAX = merge all, 0 = none)
+static int collect_stats = 0; // collect Sylvan statistics
+static char* trace_filename = NULL; // write a trace of the operations to this file
+static int profile_ops = 0; // profile nodes created per operation
+static char* summary_filename = NULL; // write a summary of the run (JSON) to this file
+static char* record_filename = NULL; // record the operations to this file (see sylvan_record.h)
+static int seq_cutoff = -1; // number of bottom levels computed sequentially (-1 = none)
 static int print_transition_matrix = 0; // print transition relation matrix
 static int workers = 0; // autodetect
 static char* model_filename = NULL; // filename of model
@@ -28,7 +34,7 @@ print_usage()
     printf("Usage: bddmc [-h] [-s <bfs|par|sat|chaining>] [-w <workers>]\n");
     printf("        [--strategy=<bfs|par|sat|chaining>] [--workers=<workers>]\n");
     printf("        [--count-nodes] [--count-states] [--count-table] [--deadlocks]\n");
-    printf("        [--merge-relations] [--print-matrix] [--help] [--usage] <model>\n");
+    printf("        [--merge-relations] [--cluster=<nodes>] [--print-matrix] [--cutoff=<levels>] [--stats] [--trace=<file>] [--profile] [--summary=<file>] [--record=<file>] [--help] [--usage] <model>\n");
 }
 
 static void
@@ -43,7 +49,14 @@ print_help()
     printf("      --count-table          Report table usage at each level\n");
     printf("      --deadlocks            Check for deadlocks\n");
     printf("      --merge-relations      Merge transition relations into one transition relation\n");
+    printf("      --cluster=<nodes>      Merge consecutive transition relations up to <nodes> nodes\n");
     printf("      --print-matrix         Print transition matrix\n");
+    printf("      --cutoff=<levels>      Compute the bottom <levels> levels without spawning\n");
+    printf("      --stats                Collect and report Sylvan statistics\n");
+    printf("      --trace=<file>         Write a trace of operations and gc (Chrome trace format)\n");
+    printf("      --profile              Report nodes created and time per operation\n");
+    printf("      --summary=<file>       Write a summary of the run as one line of JSON\n");
+    printf("      --record=<file>        Record the operations, for bench_replay\n");
     printf("  -h, --help                 Give this help list\n");
     printf("      --usage                Give a short usage message\n");
 }
@@ -60,6 +73,13 @@ parse_args(int argc, char **argv)
         {.name = "count-table", .val = 2, .has_arg = no_argument},
         {.name = "merge-relations", .val = 6, .has_arg = no_argument},
         {.name = "print-matrix", .val = 4, .has_arg = no_argument},
+        {.name = "cutoff", .val = 7, .has_arg = required_argument},
+        {.name = "stats", .val = 8, .has_arg = no_argument},
+        {.name = "trace", .val = 9, .has_arg = required_argument},
+        {.name = "profile", .val = 10, .has_arg = no_argument},
+        {.name = "summary", .val = 11, .has_arg = required_argument},
+        {.name = "record", .val = 12, .has_arg = required_argument},
+        {.name = "cluster", .val = 13, .has_arg = required_argument},
         {.name = "help", .val = 'h', .has_arg = no_argument},
         {.name = "usage", .val = 99, .has_arg = no_argument},
         {},
@@ -97,7 +117,28 @@ parse_args(int argc, char **argv)
                 report_nodes = 1;
                 break;
             case 6:
-                merge_relations = 1;
+                cluster_nodes = SIZE_MAX;
+                break;
+            case 7:
+                seq_cutoff = atoi(optarg);
+                break;
+            case 8:
+                collect_stats = 1;
+                break;
+            case 9:
+                trace_filename = optarg;
+                break;
+            case 10:
+                profile_ops = 1;
+                break;
+            case 11:
+                summary_filename = optarg;
+                break;
+            case 12:
+                record_filename = optarg;
+                break;
+            case 13:
+                cluster_nodes = (size_t)strtoull(optarg, NULL, 10);
                 break;
             case 99:
                 print_usage();
@@ -329,410 +370,30 @@ VOID_TASK_2(print_example, BDD, example, BDDSET, variables)
 }
 
 /**
- * Implementation of (parallel) saturation
- * (assumes relations are ordered on first variable)
- */
-TASK_2(BDD, go_sat, BDD, set, int, idx)
-{
-    /* Terminal cases */
-    if (set == sylvan_false) return sylvan_false;
-    if (idx == next_count) return set;
-
-    /* Consult the cache */
-    BDD result;
-    const BDD _set = set;
-    if (cache_get3(200LL<<40, _set, idx, 0, &result)) return result;
-    mtbdd_refs_pushptr(&_set);
-
-    /**
-     * Possible improvement: cache more things (like intermediate results?)
-     *   and chain-apply more of the current level before going deeper?
-     */
-
-    /* Check if the relation should be applied */
-    const uint32_t var = sylvan_var(next[idx]->variables);
-    if (set == sylvan_true || var <= sylvan_var(set)) {
-        /* Count the number of relations starting here */
-        int count = idx+1;
-        while (count < next_count && var == sylvan_var(next[count]->variables)) count++;
-        count -= idx;
-        /*
-         * Compute until fixpoint:
-         * - SAT deeper
-         * - chain-apply all current level once
-         */
-        BDD prev = sylvan_false;
-        BDD step = sylvan_false;
-        mtbdd_refs_pushptr(&set);
-        mtbdd_refs_pushptr(&prev);
-        mtbdd_refs_pushptr(&step);
-        while (prev != set) {
-            prev = set;
-            // SAT deeper
-            set = CALL(go_sat, set, idx+count);
-            // chain-apply all current level once
-            for (int i=0;i<count;i++) {
-                step = sylvan_relnext(set, next[idx+i]->bdd, next[idx+i]->variables);
-                set = sylvan_or(set, step);
-                step = sylvan_false; // unset, for gc
-            }
-        }
-        mtbdd_refs_popptr(3);
-        result = set;
-    } else {
-        /* Recursive computation */
-        mtbdd_refs_spawn(SPAWN(go_sat, sylvan_low(set), idx));
-        BDD high = mtbdd_refs_push(CALL(go_sat, sylvan_high(set), idx));
-        BDD low = mtbdd_refs_sync(SYNC(go_sat));
-        mtbdd_refs_pop(1);
-        result = sylvan_makenode(sylvan_var(set), low, high);
-    }
-
-    /* Store in cache */
-    cache_put3(200LL<<40, _set, idx, 0, result);
-    mtbdd_refs_popptr(1);
-    return result;
-}
-
-/**
- * Wrapper for the Saturation strategy
- */
-VOID_TASK_1(sat, set_t, set)
-{
-    set->bdd = CALL(go_sat, set->bdd, 0);
-}
-
-/**
- * Implement parallel strategy (that performs the relnext operations in parallel)
- * This function does one level...
- */
-TASK_5(BDD, go_par, BDD, cur, BDD, visited, size_t, from, size_t, len, BDD*, deadlocks)
-{
-    if (len == 1) {
-        // Calculate NEW successors (not in visited)
-        BDD succ = sylvan_relnext(cur, next[from]->bdd, next[from]->variables);
-        bdd_refs_push(succ);
-        if (deadlocks) {
-            // check which BDDs in deadlocks do not have a successor in this relation
-            BDD anc = sylvan_relprev(next[from]->bdd, succ, next[from]->variables);
-            bdd_refs_push(anc);
-            *deadlocks = sylvan_diff(*deadlocks, anc);
-            bdd_refs_pop(1);
-        }
-        BDD result = sylvan_diff(succ, visited);
-        bdd_refs_pop(1);
-        return result;
-    } else {
-        BDD deadlocks_left;
-        BDD deadlocks_right;
-        if (deadlocks) {
-            deadlocks_left = *deadlocks;
-            deadlocks_right = *deadlocks;
-            sylvan_protect(&deadlocks_left);
-            sylvan_protect(&deadlocks_right);
-        }
-
-        // Recursively calculate left+right
-        bdd_refs_spawn(SPAWN(go_par, cur, visited, from, (len+1)/2, deadlocks ? &deadlocks_left: NULL));
-        BDD right = bdd_refs_push(CALL(go_par, cur, visited, from+(len+1)/2, len/2, deadlocks ? &deadlocks_right : NULL));
-        BDD left = bdd_refs_push(bdd_refs_sync(SYNC(go_par)));
-
-        // Merge results of left+right
-        BDD result = sylvan_or(left, right);
-        bdd_refs_pop(2);
-
-        if (deadlocks) {
-            bdd_refs_push(result);
-            *deadlocks = sylvan_and(deadlocks_left, deadlocks_right);
-            sylvan_unprotect(&deadlocks_left);
-            sylvan_unprotect(&deadlocks_right);
-            bdd_refs_pop(1);
-        }
-
-        return result;
-    }
-}
-
-/**
- * Implementation of the PAR strategy
- */
-VOID_TASK_1(par, set_t, set)
-{
-    BDD visited = set->bdd;
-    BDD next_level = visited;
-    BDD cur_level = sylvan_false;
-    BDD deadlocks = sylvan_false;
-
-    sylvan_protect(&visited);
-    sylvan_protect(&next_level);
-    sylvan_protect(&cur_level);
-    sylvan_protect(&deadlocks);
-
-    int iteration = 1;
-    do {
-        // calculate successors in parallel
-        cur_level = next_level;
-        deadlocks = cur_level;
-
-        next_level = CALL(go_par, cur_level, visited, 0, next_count, check_deadlocks ? &deadlocks : NULL);
-
-        if (check_deadlocks && deadlocks != sylvan_false) {
-            INFO("Found %0.0f deadlock states... ", sylvan_satcount(deadlocks, set->variables));
-            if (deadlocks != sylvan_false) {
-                printf("example: ");
-                print_example(deadlocks, set->variables);
-                check_deadlocks = 0;
-            }
-            printf("\n");
-        }
-
-        // visited = visited + new
-        visited = sylvan_or(visited, next_level);
-
-        if (report_table && report_levels) {
-            size_t filled, total;
-            sylvan_table_usage(&filled, &total);
-            INFO("Level %d done, %0.0f states explored, table: %0.1f%% full (%zu nodes)\n",
-                iteration, sylvan_satcount(visited, set->variables),
-                100.0*(double)filled/total, filled);
-        } else if (report_table) {
-            size_t filled, total;
-            sylvan_table_usage(&filled, &total);
-            INFO("Level %d done, table: %0.1f%% full (%zu nodes)\n",
-                iteration,
-                100.0*(double)filled/total, filled);
-        } else if (report_levels) {
-            INFO("Level %d done, %0.0f states explored\n", iteration, sylvan_satcount(visited, set->variables));
-        } else {
-            INFO("Level %d done\n", iteration);
-        }
-        iteration++;
-    } while (next_level != sylvan_false);
-
-    set->bdd = visited;
-
-    sylvan_unprotect(&visited);
-    sylvan_unprotect(&next_level);
-    sylvan_unprotect(&cur_level);
-    sylvan_unprotect(&deadlocks);
-}
-
-/**
- * Implement sequential strategy (that performs the relnext operations one by one)
- * This function does one level...
+ * Report a level of the reachability algorithm (BFS, PAR and CHAINING)
  */
-TASK_5(BDD, go_bfs, BDD, cur, BDD, visited, size_t, from, size_t, len, BDD*, deadlocks)
+TASK_4(int, report_level, int, iteration, BDD, visited, BDD, fresh, void*, context)
 {
-    if (len == 1) {
-        // Calculate NEW successors (not in visited)
-        BDD succ = sylvan_relnext(cur, next[from]->bdd, next[from]->variables);
-        bdd_refs_push(succ);
-        if (deadlocks) {
-            // check which BDDs in deadlocks do not have a successor in this relation
-            BDD anc = sylvan_relprev(next[from]->bdd, succ, next[from]->variables);
-            bdd_refs_push(anc);
-            *deadlocks = sylvan_diff(*deadlocks, anc);
-            bdd_refs_pop(1);
-        }
-        BDD result = sylvan_diff(succ, visited);
-        bdd_refs_pop(1);
-        return result;
+    set_t set = (set_t)context;
+    if (report_table && report_levels) {
+        size_t filled, total;
+        sylvan_table_usage(&filled, &total);
+        INFO("Level %d done, %0.0f states explored, table: %0.1f%% full (%zu nodes)\n",
+            iteration, sylvan_satcount(visited, set->variables),
+            100.0*(double)filled/total, filled);
+    } else if (report_table) {
+        size_t filled, total;
+        sylvan_table_usage(&filled, &total);
+        INFO("Level %d done, table: %0.1f%% full (%zu nodes)\n",
+            iteration,
+            100.0*(double)filled/total, filled);
+    } else if (report_levels) {
+        INFO("Level %d done, %0.0f states explored\n", iteration, sylvan_satcount(visited, set->variables));
     } else {
-        BDD deadlocks_left;
-        BDD deadlocks_right;
-        if (deadlocks) {
-            deadlocks_left = *deadlocks;
-            deadlocks_right = *deadlocks;
-            sylvan_protect(&deadlocks_left);
-            sylvan_protect(&deadlocks_right);
-        }
-
-        // Recursively calculate left+right
-        BDD left = CALL(go_bfs, cur, visited, from, (len+1)/2, deadlocks ? &deadlocks_left : NULL);
-        bdd_refs_push(left);
-        BDD right = CALL(go_bfs, cur, visited, from+(len+1)/2, len/2, deadlocks ? &deadlocks_right : NULL);
-        bdd_refs_push(right);
-
-        // Merge results of left+right
-        BDD result = sylvan_or(left, right);
-        bdd_refs_pop(2);
-
-        if (deadlocks) {
-            bdd_refs_push(result);
-            *deadlocks = sylvan_and(deadlocks_left, deadlocks_right);
-            sylvan_unprotect(&deadlocks_left);
-            sylvan_unprotect(&deadlocks_right);
-            bdd_refs_pop(1);
-        }
-
-        return result;
+        INFO("Level %d done\n", iteration);
     }
-}
-
-/**
- * Implementation of the BFS strategy
- */
-VOID_TASK_1(bfs, set_t, set)
-{
-    BDD visited = set->bdd;
-    BDD next_level = visited;
-    BDD cur_level = sylvan_false;
-    BDD deadlocks = sylvan_false;
-
-    sylvan_protect(&visited);
-    sylvan_protect(&next_level);
-    sylvan_protect(&cur_level);
-    sylvan_protect(&deadlocks);
-
-    int iteration = 1;
-    do {
-        // calculate successors in parallel
-        cur_level = next_level;
-        deadlocks = cur_level;
-
-        next_level = CALL(go_bfs, cur_level, visited, 0, next_count, check_deadlocks ? &deadlocks : NULL);
-
-        if (check_deadlocks && deadlocks != sylvan_false) {
-            INFO("Found %0.0f deadlock states... ", sylvan_satcount(deadlocks, set->variables));
-            if (deadlocks != sylvan_false) {
-                printf("example: ");
-                print_example(deadlocks, set->variables);
-                check_deadlocks = 0;
-            }
-            printf("\n");
-        }
-
-        // visited = visited + new
-        visited = sylvan_or(visited, next_level);
-
-        if (report_table && report_levels) {
-            size_t filled, total;
-            sylvan_table_usage(&filled, &total);
-            INFO("Level %d done, %0.0f states explored, table: %0.1f%% full (%zu nodes)\n",
-                iteration, sylvan_satcount(visited, set->variables),
-                100.0*(double)filled/total, filled);
-        } else if (report_table) {
-            size_t filled, total;
-            sylvan_table_usage(&filled, &total);
-            INFO("Level %d done, table: %0.1f%% full (%zu nodes)\n",
-                iteration,
-                100.0*(double)filled/total, filled);
-        } else if (report_levels) {
-            INFO("Level %d done, %0.0f states explored\n", iteration, sylvan_satcount(visited, set->variables));
-        } else {
-            INFO("Level %d done\n", iteration);
-        }
-        iteration++;
-    } while (next_level != sylvan_false);
-
-    set->bdd = visited;
-
-    sylvan_unprotect(&visited);
-    sylvan_unprotect(&next_level);
-    sylvan_unprotect(&cur_level);
-    sylvan_unprotect(&deadlocks);
-}
-
-/**
- * Implementation of the Chaining strategy (does not support deadlock detection)
- */
-VOID_TASK_1(chaining, set_t, set)
-{
-    BDD visited = set->bdd;
-    BDD next_level = visited;
-    BDD succ = sylvan_false;
-
-    bdd_refs_pushptr(&visited);
-    bdd_refs_pushptr(&next_level);
-    bdd_refs_pushptr(&succ);
-
-    int iteration = 1;
-    do {
-        // calculate successors in parallel
-        for (int i=0; i<next_count; i++) {
-            succ = sylvan_relnext(next_level, next[i]->bdd, next[i]->variables);
-            next_level = sylvan_or(next_level, succ);
-            succ = sylvan_false; // reset, for gc
-        }
-
-        // new = new - visited
-        // visited = visited + new
-        next_level = sylvan_diff(next_level, visited);
-        visited = sylvan_or(visited, next_level);
-
-        if (report_table && report_levels) {
-            size_t filled, total;
-            sylvan_table_usage(&filled, &total);
-            INFO("Level %d done, %0.0f states explored, table: %0.1f%% full (%zu nodes)\n",
-                iteration, sylvan_satcount(visited, set->variables),
-                100.0*(double)filled/total, filled);
-        } else if (report_table) {
-            size_t filled, total;
-            sylvan_table_usage(&filled, &total);
-            INFO("Level %d done, table: %0.1f%% full (%zu nodes)\n",
-                iteration,
-                100.0*(double)filled/total, filled);
-        } else if (report_levels) {
-            INFO("Level %d done, %0.0f states explored\n", iteration, sylvan_satcount(visited, set->variables));
-        } else {
-            INFO("Level %d done\n", iteration);
-        }
-        iteration++;
-    } while (next_level != sylvan_false);
-
-    set->bdd = visited;
-    bdd_refs_popptr(3);
-}
-
-/**
- * Extend a transition relation to a larger domain (using s=s')
- */
-#define extend_relation(rel, vars) RUN(extend_relation, rel, vars)
-TASK_2(BDD, extend_relation, MTBDD, relation, MTBDD, variables)
-{
-    /* first determine which state BDD variables are in rel */
-    int has[totalbits];
-    for (int i=0; i<totalbits; i++) has[i] = 0;
-    MTBDD s = variables;
-    while (!sylvan_set_isempty(s)) {
-        uint32_t v = sylvan_set_first(s);
-        if (v/2 >= (unsigned)totalbits) break; // action labels
-        has[v/2] = 1;
-        s = sylvan_set_next(s);
-    }
-
-    /* create "s=s'" for all variables not in rel */
-    BDD eq = sylvan_true;
-    for (int i=totalbits-1; i>=0; i--) {
-        if (has[i]) continue;
-        BDD low = sylvan_makenode(2*i+1, eq, sylvan_false);
-        bdd_refs_push(low);
-        BDD high = sylvan_makenode(2*i+1, sylvan_false, eq);
-        bdd_refs_pop(1);
-        eq = sylvan_makenode(2*i, low, high);
-    }
-
-    bdd_refs_push(eq);
-    BDD result = sylvan_and(relation, eq);
-    bdd_refs_pop(1);
-
-    return result;
-}
-
-/**
- * Compute \BigUnion ( sets[i] )
- */
-#define big_union(first, count) RUN(big_union, first, count)
-TASK_2(BDD, big_union, int, first, int, count)
-{
-    if (count == 1) return next[first]->bdd;
-
-    bdd_refs_spawn(SPAWN(big_union, first, count/2));
-    BDD right = bdd_refs_push(CALL(big_union, first+count/2, count-count/2));
-    BDD left = bdd_refs_push(bdd_refs_sync(SYNC(big_union)));
-    BDD result = sylvan_or(left, right);
-    bdd_refs_pop(2);
-    return result;
+    (void)fresh;
+    return 0;
 }
 
 /**
@@ -759,6 +420,12 @@ print_matrix_row(rel_t rel)
     }
 }
 
+/* Results of the run (for --summary) */
+static double reach_time = 0; // time of the reachability algorithm
+static double reach_states = 0; // number of reachable states
+static size_t reach_nodes = 0; // number of nodes of the set of reachable states
+static size_t peak_nodes = 0; // largest number of nodes in the nodes table
+
 VOID_TASK_0(gc_start)
 {
     char buf[32];
@@ -771,6 +438,10 @@ VOID_TASK_0(gc_end)
     char buf[32];
     to_h(getCurrentRSS(), buf);
     INFO("(GC) Garbage collection done.       (rss: %s)\n", buf);
+
+    sylvan_gc_info_t info;
+    sylvan_gc_get_info(&info);
+    if (info.nodes_before > peak_nodes) peak_nodes = info.nodes_before;
 }
 
 void
@@ -839,6 +510,13 @@ VOID_TASK_0(run)
     INFO("Read file '%s'\n", model_filename);
     INFO("%d integers per state, %d bits per state, %d transition groups\n", vectorsize, totalbits, next_count);
 
+    /* if requested, set the sequential cut-off relative to the bottom level */
+    if (seq_cutoff >= 0) {
+        int level = 2*totalbits - seq_cutoff;
+        sylvan_set_seqcutoff(level < 0 ? 0 : level);
+        INFO("Computing the bottom %d levels sequentially\n", seq_cutoff);
+    }
+
     /* if requested, print the transition matrix */
     if (print_transition_matrix) {
         for (int i=0; i<next_count; i++) {
@@ -848,31 +526,28 @@ VOID_TASK_0(run)
         }
     }
 
-    /* merge all relations to one big transition relation if requested */
-    if (merge_relations) {
-        BDD newvars = sylvan_set_empty();
-        bdd_refs_pushptr(&newvars);
-        for (int i=totalbits-1; i>=0; i--) {
-            newvars = sylvan_set_add(newvars, i*2+1);
-            newvars = sylvan_set_add(newvars, i*2);
-        }
+    /* merge the transition relations (up to the given size) if requested */
+    if (cluster_nodes != 0 && next_count > 1) {
+        if (cluster_nodes == SIZE_MAX) INFO("Taking union of all transition relations.\n");
+        else INFO("Merging transition relations up to %zu nodes.\n", cluster_nodes);
 
-        INFO("Extending transition relations to full domain.\n");
+        BDD *rels = (BDD*)malloc(sizeof(BDD) * next_count);
+        BDDSET *vars = (BDDSET*)malloc(sizeof(BDDSET) * next_count);
+        if (rels == NULL || vars == NULL) Abort("Cannot allocate memory!\n");
         for (int i=0; i<next_count; i++) {
-            next[i]->bdd = extend_relation(next[i]->bdd, next[i]->variables);
-            next[i]->variables = newvars;
+            rels[i] = next[i]->bdd;
+            vars[i] = next[i]->variables;
         }
-
-        bdd_refs_popptr(1);
-
-        INFO("Taking union of all transition relations.\n");
-        next[0]->bdd = big_union(0, next_count);
-
-        for (int i=1; i<next_count; i++) {
-            next[i]->bdd = sylvan_false;
-            next[i]->variables = sylvan_true;
+        int count = (int)sylvan_cluster_union(rels, vars, next_count, cluster_nodes);
+        for (int i=0; i<next_count; i++) {
+            next[i]->bdd = i < count ? rels[i] : sylvan_false;
+            next[i]->variables = i < count ? vars[i] : sylvan_true;
         }
-        next_count = 1;
+        next_count = count;
+        free(rels);
+        free(vars);
+
+        INFO("%d transition groups after merging\n", next_count);
     }
 
     if (report_nodes) {
@@ -885,39 +560,88 @@ VOID_TASK_0(run)
 
     print_memory_usage();
 
-    if (strategy == 0) {
-        double t1 = wctime();
-        RUN(bfs, states);
-        double t2 = wctime();
-        INFO("BFS Time: %f\n", t2-t1);
-    } else if (strategy == 1) {
-        double t1 = wctime();
-        RUN(par, states);
-        double t2 = wctime();
-        INFO("PAR Time: %f\n", t2-t1);
-    } else if (strategy == 2) {
-        double t1 = wctime();
-        RUN(sat, states);
-        double t2 = wctime();
-        INFO("SAT Time: %f\n", t2-t1);
-    } else if (strategy == 3) {
-        double t1 = wctime();
-        RUN(chaining, states);
-        double t2 = wctime();
-        INFO("CHAINING Time: %f\n", t2-t1);
-    } else {
-        Abort("Invalid strategy set?!\n");
+    /* the transition relations as partitions for sylvan_reach */
+    BDD *rels = (BDD*)malloc(sizeof(BDD) * (next_count == 0 ? 1 : next_count));
+    BDDSET *vars = (BDDSET*)malloc(sizeof(BDDSET) * (next_count == 0 ? 1 : next_count));
+    if (rels == NULL || vars == NULL) Abort("Cannot allocate memory!\n");
+    for (int i=0; i<next_count; i++) {
+        rels[i] = next[i]->bdd;
+        vars[i] = next[i]->variables;
+    }
+
+    static const char* names[] = {"BFS", "PAR", "SAT", "CHAINING"};
+    if (strategy < 0 || strategy > 3) Abort("Invalid strategy set?!\n");
+    sylvan_reach_opts_t opts = sylvan_reach_opts_make((sylvan_reach_strategy_t)strategy);
+    opts.check_deadlocks = check_deadlocks;
+    if (strategy != 2) {
+        // saturation has no levels to report
+        opts.level_cb = report_level_CALL;
+        opts.context = states;
+    }
+
+    double t1 = wctime();
+    states->bdd = sylvan_reach(states->bdd, rels, vars, next_count, &opts);
+    double t2 = wctime();
+    INFO("%s Time: %f\n", names[strategy], t2-t1);
+    reach_time = t2-t1;
+    free(rels);
+    free(vars);
+
+    if (check_deadlocks) {
+        bdd_refs_push(opts.deadlocks);
+        if (opts.deadlocks != sylvan_false) {
+            INFO("Found %0.0f deadlock states... ", sylvan_satcount(opts.deadlocks, states->variables));
+            printf("example: ");
+            print_example(opts.deadlocks, states->variables);
+            printf("\n");
+        }
+        bdd_refs_pop(1);
     }
 
     // Now we just have states
-    INFO("Final states: %0.0f states\n", sylvan_satcount(states->bdd, states->variables));
+    reach_states = sylvan_satcount(states->bdd, states->variables);
+    INFO("Final states: %0.0f states\n", reach_states);
+    if (report_nodes || summary_filename != NULL) reach_nodes = sylvan_nodecount(states->bdd);
     if (report_nodes) {
-        INFO("Final states: %zu BDD nodes\n", sylvan_nodecount(states->bdd));
+        INFO("Final states: %zu BDD nodes\n", reach_nodes);
     }
 
     set_free(states);
 }
 
+/**
+ * Write a summary of the run as one line of JSON, e.g. for bench/bench_mc.py
+ */
+static void
+write_summary(const char *filename)
+{
+    static const char* strategies[] = {"bfs", "par", "sat", "chaining"};
+
+    FILE *f = fopen(filename, "w");
+    if (f == NULL) {
+        fprintf(stderr, "Cannot open file '%s'!\n", filename);
+        return;
+    }
+
+    size_t filled, total;
+    sylvan_table_usage(&filled, &total);
+    if (filled > peak_nodes) peak_nodes = filled;
+
+    sylvan_stats_t stats;
+    sylvan_stats_snapshot(&stats);
+    sylvan_gc_info_t info;
+    sylvan_gc_get_info(&info);
+
+    fprintf(f, "{\"tool\":\"bddmc\",\"model\":\"%s\",\"strategy\":\"%s\"", model_filename, strategies[strategy]);
+    fprintf(f, ",\"workers\":%u,\"cutoff\":%d", lace_workers(), seq_cutoff);
+    fprintf(f, ",\"time\":%f,\"total_time\":%f", reach_time, wctime()-t_start);
+    fprintf(f, ",\"states\":%0.0f,\"nodes\":%zu,\"peak_nodes\":%zu", reach_states, reach_nodes, peak_nodes);
+    fprintf(f, ",\"gc_count\":%"PRIu64",\"gc_time\":%f", info.count, (double)stats.timers[SYLVAN_GC]/1e9);
+    fprintf(f, ",\"cache_hitrate\":%f", sylvan_stats_hitrate(&stats, SYLVAN_STATS_ALL_OPS));
+    fprintf(f, ",\"peak_rss\":%zu}\n", getPeakRSS());
+    fclose(f);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -955,15 +679,45 @@ main(int argc, char **argv)
     sylvan_set_limits(max, 1, 6);
     sylvan_init_package();
     sylvan_init_bdd();
+    if (collect_stats || summary_filename != NULL) sylvan_stats_enable();
+    if (trace_filename != NULL) sylvan_trace_enable(1<<20);
+    if (profile_ops) sylvan_profile_enable();
     sylvan_gc_hook_pregc(gc_start_CALL);
     sylvan_gc_hook_postgc(gc_end_CALL);
 
+    FILE *record_file = NULL;
+    if (record_filename != NULL) {
+        record_file = fopen(record_filename, "wb");
+        if (record_file == NULL) Abort("Cannot open file '%s'!\n", record_filename);
+        sylvan_record_start(record_file);
+    }
+
     RUN(run);
 
+    if (record_file != NULL) {
+        sylvan_record_stop();
+        fclose(record_file);
+    }
+
     print_memory_usage();
 
     sylvan_stats_report(stdout);
 
+    if (profile_ops) sylvan_profile_report(stdout);
+
+    if (summary_filename != NULL) write_summary(summary_filename);
+
+    if (trace_filename != NULL) {
+        sylvan_trace_disable();
+        FILE *f = fopen(trace_filename, "w");
+        if (f == NULL) {
+            fprintf(stderr, "Cannot open file '%s'!\n", trace_filename);
+        } else {
+            sylvan_trace_write(f);
+            fclose(f);
+        }
+    }
+
     sylvan_quit();
     lace_stop();
 }
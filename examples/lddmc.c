@@ -17,6 +17,12 @@ static int report_nodes = 0; // report number of nodes of LDDs
 static int strategy = 2; // 0 = BFS, 1 = PAR, 2 = SAT, 3 = CHAINING
 static int check_deadlocks = 0; // set to 1 to check for deadlocks on-the-fly
 static int print_transition_matrix = 0; // print transition relation matrix
+static int collect_stats = 0; // collect Sylvan statistics
+static char* trace_filename = NULL; // write a trace of the operations to this file
+static int profile_ops = 0; // profile nodes created per operation
+static char* summary_filename = NULL; // write a summary of the run (JSON) to this file
+static char* record_filename = NULL; // record the operations to this file (see sylvan_record.h)
+static int seq_cutoff = -1; // number of bottom levels computed sequentially (-1 = none)
 static int workers = 0; // autodetect
 static char* model_filename = NULL; // filename of model
 static char* out_filename = NULL; // filename of output
@@ -27,7 +33,7 @@ print_usage()
     printf("Usage: lddmc [-h] [-s <bfs|par|sat|chaining>] [-w <workers>]\n");
     printf("            [--strategy=<bfs|par|sat|chaining>] [--workers=<workers>]\n");
     printf("            [--count-nodes] [--count-states] [--count-table] [--deadlocks]\n");
-    printf("            [--print-matrix] [--help] [--usage] <model> [<output-bdd>]\n");
+    printf("            [--print-matrix] [--cutoff=<levels>] [--stats] [--trace=<file>] [--profile] [--summary=<file>] [--record=<file>] [--help] [--usage] <model> [<output-bdd>]\n");
 }
 
 static void
@@ -42,6 +48,12 @@ print_help()
     printf("      --count-table          Report table usage at each level\n");
     printf("      --deadlocks            Check for deadlocks\n");
     printf("      --print-matrix         Print transition matrix\n");
+    printf("      --cutoff=<levels>      Compute the bottom <levels> levels without spawning\n");
+    printf("      --stats                Collect and report Sylvan statistics\n");
+    printf("      --trace=<file>         Write a trace of operations and gc (Chrome trace format)\n");
+    printf("      --profile              Report nodes created and time per operation\n");
+    printf("      --summary=<file>       Write a summary of the run as one line of JSON\n");
+    printf("      --record=<file>        Record the operations, for bench_replay\n");
     printf("  -h, --help                 Give this help list\n");
     printf("      --usage                Give a short usage message\n");
 }
@@ -57,6 +69,12 @@ parse_args(int argc, char **argv)
         {.name = "count-states", .val = 1, .has_arg = no_argument},
         {.name = "count-table", .val = 2, .has_arg = no_argument},
         {.name = "print-matrix", .val = 4, .has_arg = no_argument},
+        {.name = "cutoff", .val = 7, .has_arg = required_argument},
+        {.name = "stats", .val = 8, .has_arg = no_argument},
+        {.name = "trace", .val = 9, .has_arg = required_argument},
+        {.name = "profile", .val = 10, .has_arg = no_argument},
+        {.name = "summary", .val = 11, .has_arg = required_argument},
+        {.name = "record", .val = 12, .has_arg = required_argument},
         {.name = "help", .val = 'h', .has_arg = no_argument},
         {.name = "usage", .val = 99, .has_arg = no_argument},
         {},
@@ -93,6 +111,24 @@ parse_args(int argc, char **argv)
             case 5:
                 report_nodes = 1;
                 break;
+            case 7:
+                seq_cutoff = atoi(optarg);
+                break;
+            case 8:
+                collect_stats = 1;
+                break;
+            case 9:
+                trace_filename = optarg;
+                break;
+            case 10:
+                profile_ops = 1;
+                break;
+            case 11:
+                summary_filename = optarg;
+                break;
+            case 12:
+                record_filename = optarg;
+                break;
             case 99:
                 print_usage();
                 exit(0);
@@ -701,6 +737,12 @@ VOID_TASK_1(chaining, set_t, set)
     lddmc_refs_popptr(3);
 }
 
+/* Results of the run (for --summary) */
+static double reach_time = 0; // time of the reachability algorithm
+static double reach_states = 0; // number of reachable states
+static size_t reach_nodes = 0; // number of nodes of the set of reachable states
+static size_t peak_nodes = 0; // largest number of nodes in the nodes table
+
 VOID_TASK_0(gc_start)
 {
     char buf[32];
@@ -713,6 +755,10 @@ VOID_TASK_0(gc_end)
     char buf[32];
     to_h(getCurrentRSS(), buf);
     INFO("(GC) Garbage collection done.       (rss: %s)\n", buf);
+
+    sylvan_gc_info_t info;
+    sylvan_gc_get_info(&info);
+    if (info.nodes_before > peak_nodes) peak_nodes = info.nodes_before;
 }
 
 void
@@ -778,6 +824,13 @@ TASK_0(int, run)
     INFO("Read file '%s'\n", model_filename);
     INFO("%d integers per state, %d transition groups\n", vector_size, next_count);
 
+    /* if requested, set the sequential cut-off relative to the bottom level */
+    if (seq_cutoff >= 0) {
+        int level = vector_size - seq_cutoff;
+        sylvan_set_seqcutoff(level < 0 ? 0 : level);
+        INFO("Computing the bottom %d levels sequentially\n", seq_cutoff);
+    }
+
     if (print_transition_matrix) {
         for (int i=0; i<next_count; i++) {
             INFO("");
@@ -793,29 +846,35 @@ TASK_0(int, run)
         RUN(bfs, states);
         double t2 = wctime();
         INFO("BFS Time: %f\n", t2-t1);
+        reach_time = t2-t1;
     } else if (strategy == 1) {
         double t1 = wctime();
         RUN(par, states);
         double t2 = wctime();
         INFO("PAR Time: %f\n", t2-t1);
+        reach_time = t2-t1;
     } else if (strategy == 2) {
         double t1 = wctime();
         RUN(sat, states);
         double t2 = wctime();
         INFO("SAT Time: %f\n", t2-t1);
+        reach_time = t2-t1;
     } else if (strategy == 3) {
         double t1 = wctime();
         RUN(chaining, states);
         double t2 = wctime();
         INFO("CHAINING Time: %f\n", t2-t1);
+        reach_time = t2-t1;
     } else {
         Abort("Invalid strategy set?!\n");
     }
 
     // Now we just have states
-    INFO("Final states: %0.0f states\n", lddmc_satcount_cached(states->dd));
+    reach_states = lddmc_satcount_cached(states->dd);
+    INFO("Final states: %0.0f states\n", reach_states);
+    if (report_nodes || summary_filename != NULL) reach_nodes = lddmc_nodecount(states->dd);
     if (report_nodes) {
-        INFO("Final states: %zu MDD nodes\n", lddmc_nodecount(states->dd));
+        INFO("Final states: %zu MDD nodes\n", reach_nodes);
     }
 
     if (out_filename != NULL) {
@@ -853,6 +912,39 @@ TASK_0(int, run)
     return 0;
 }
 
+/**
+ * Write a summary of the run as one line of JSON, e.g. for bench/bench_mc.py
+ */
+static void
+write_summary(const char *filename)
+{
+    static const char* strategies[] = {"bfs", "par", "sat", "chaining"};
+
+    FILE *f = fopen(filename, "w");
+    if (f == NULL) {
+        fprintf(stderr, "Cannot open file '%s'!\n", filename);
+        return;
+    }
+
+    size_t filled, total;
+    sylvan_table_usage(&filled, &total);
+    if (filled > peak_nodes) peak_nodes = filled;
+
+    sylvan_stats_t stats;
+    sylvan_stats_snapshot(&stats);
+    sylvan_gc_info_t info;
+    sylvan_gc_get_info(&info);
+
+    fprintf(f, "{\"tool\":\"lddmc\",\"model\":\"%s\",\"strategy\":\"%s\"", model_filename, strategies[strategy]);
+    fprintf(f, ",\"workers\":%u,\"cutoff\":%d", lace_workers(), seq_cutoff);
+    fprintf(f, ",\"time\":%f,\"total_time\":%f", reach_time, wctime()-t_start);
+    fprintf(f, ",\"states\":%0.0f,\"nodes\":%zu,\"peak_nodes\":%zu", reach_states, reach_nodes, peak_nodes);
+    fprintf(f, ",\"gc_count\":%"PRIu64",\"gc_time\":%f", info.count, (double)stats.timers[SYLVAN_GC]/1e9);
+    fprintf(f, ",\"cache_hitrate\":%f", sylvan_stats_hitrate(&stats, SYLVAN_STATS_ALL_OPS));
+    fprintf(f, ",\"peak_rss\":%zu}\n", getPeakRSS());
+    fclose(f);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -891,14 +983,44 @@ main(int argc, char **argv)
     sylvan_set_limits(max, 1, 16);
     sylvan_init_package();
     sylvan_init_ldd();
+    if (collect_stats || summary_filename != NULL) sylvan_stats_enable();
+    if (trace_filename != NULL) sylvan_trace_enable(1<<20);
+    if (profile_ops) sylvan_profile_enable();
     sylvan_gc_hook_pregc(gc_start_CALL);
     sylvan_gc_hook_postgc(gc_end_CALL);
 
+    FILE *record_file = NULL;
+    if (record_filename != NULL) {
+        record_file = fopen(record_filename, "wb");
+        if (record_file == NULL) Abort("Cannot open file '%s'!\n", record_filename);
+        sylvan_record_start(record_file);
+    }
+
     RUN(run);
 
+    if (record_file != NULL) {
+        sylvan_record_stop();
+        fclose(record_file);
+    }
+
     print_memory_usage();
     sylvan_stats_report(stdout);
 
+    if (profile_ops) sylvan_profile_report(stdout);
+
+    if (summary_filename != NULL) write_summary(summary_filename);
+
+    if (trace_filename != NULL) {
+        sylvan_trace_disable();
+        FILE *f = fopen(trace_filename, "w");
+        if (f == NULL) {
+            fprintf(stderr, "Cannot open file '%s'!\n", trace_filename);
+        } else {
+            sylvan_trace_write(f);
+            fclose(f);
+        }
+    }
+
     sylvan_quit();
     lace_stop();
 }
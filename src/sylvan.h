@@ -30,13 +30,11 @@
 #include <unistd.h>
 #include <pthread.h>
 
-#if SYLVAN_STATS
 #ifdef __MACH__
 #include <mach/mach_time.h>
 #else
 #include <time.h>
 #endif
-#endif
 
 /**
  * Sylvan header files outside the namespace
@@ -55,11 +53,18 @@ namespace sylvan {
 
 #include <sylvan_common.h>
 #include <sylvan_stats.h>
+#include <sylvan_profile.h>
+#include <sylvan_trace.h>
+#include <sylvan_memory.h>
 #include <sylvan_mt.h>
 #include <sylvan_mtbdd.h>
 #include <sylvan_bdd.h>
 #include <sylvan_ldd.h>
 #include <sylvan_zdd.h>
+#include <sylvan_reach.h>
+#include <sylvan_reorder.h>
+#include <sylvan_record.h>
+#include <sylvan_submit.h>
 
 #ifdef __cplusplus
 }
@@ -37,6 +37,19 @@ sylvan_get_granularity()
     return granularity;
 }
 
+/**
+ * Prefetch the nodes and the cache bucket that the recursive call and(a,b) reads first.
+ */
+static inline void
+sylvan_and_prefetch(BDD a, BDD b)
+{
+    if (sylvan_isconst(a) || sylvan_isconst(b)) return;
+    MTBDD_PREFETCH(a);
+    MTBDD_PREFETCH(b);
+    if (BDD_STRIPMARK(a) > BDD_STRIPMARK(b)) cache_prefetch3(CACHE_BDD_AND, b, a, sylvan_false);
+    else cache_prefetch3(CACHE_BDD_AND, a, b, sylvan_false);
+}
+
 /**
  * Implementation of unary, binary and if-then-else operators.
  */
@@ -90,6 +103,10 @@ TASK_IMPL_3(BDD, sylvan_and, BDD, a, BDD, b, BDDVAR, prev_level)
         bHigh = node_high(b, nb);
     }
 
+    // Prefetch the nodes and cache buckets of the recursive calls
+    sylvan_and_prefetch(aHigh, bHigh);
+    sylvan_and_prefetch(aLow, bLow);
+
     // Recursive computation
     BDD low=sylvan_invalid, high=sylvan_invalid, result;
 
@@ -101,6 +118,9 @@ TASK_IMPL_3(BDD, sylvan_and, BDD, a, BDD, b, BDDVAR, prev_level)
         high = sylvan_false;
     } else if (bHigh == sylvan_true) {
         high = aHigh;
+    } else if (sylvan_seqcutoff_reached(level)) {
+        high = bdd_refs_push(CALL(sylvan_and, aHigh, bHigh, level));
+        n=2;
     } else {
         bdd_refs_spawn(SPAWN(sylvan_and, aHigh, bHigh, level));
         n=1;
@@ -116,10 +136,12 @@ TASK_IMPL_3(BDD, sylvan_and, BDD, a, BDD, b, BDDVAR, prev_level)
         low = CALL(sylvan_and, aLow, bLow, level);
     }
 
-    if (n) {
+    if (n == 1) {
         bdd_refs_push(low);
         high = bdd_refs_sync(SYNC(sylvan_and));
         bdd_refs_pop(1);
+    } else if (n == 2) {
+        bdd_refs_pop(1);
     }
 
     result = sylvan_makenode(level, low, high);
@@ -231,6 +253,169 @@ TASK_IMPL_3(char, sylvan_disjoint, BDD, a, BDD, b, BDDVAR, prev_level)
     return result;
 }
 
+/**
+ * Prepare the operands of a conjunction: drop true and duplicates, and sort them by node, so
+ * complementary operands are neighbours. Returns the new number of operands; if this is 0,
+ * the conjunction is the constant ops[0].
+ */
+static size_t
+sylvan_and_n_normalize(BDD *ops, size_t n)
+{
+    size_t k = 0;
+    for (size_t i=0; i<n; i++) {
+        BDD x = ops[i];
+        if (x == sylvan_true) continue;
+        if (x == sylvan_false) {
+            ops[0] = sylvan_false;
+            return 0;
+        }
+        // insertion sort
+        size_t j = k++;
+        while (j > 0 && (BDD_STRIPMARK(ops[j-1]) > BDD_STRIPMARK(x) || (BDD_STRIPMARK(ops[j-1]) == BDD_STRIPMARK(x) && ops[j-1] > x))) {
+            ops[j] = ops[j-1];
+            j--;
+        }
+        ops[j] = x;
+    }
+    size_t m = 0;
+    for (size_t i=0; i<k; i++) {
+        if (m > 0 && ops[m-1] == ops[i]) continue;
+        if (m > 0 && ops[m-1] == BDD_TOGGLEMARK(ops[i])) {
+            ops[0] = sylvan_false;
+            return 0;
+        }
+        ops[m++] = ops[i];
+    }
+    if (m == 0) ops[0] = sylvan_true;
+    return m;
+}
+
+/**
+ * The operands of a conjunction of the sorted <ops> (2 < n <= 6) are the key of a 2-bucket cache
+ * entry. Unused slots are 0, which is never an operand (false is normalized away).
+ */
+#define SYLVAN_AND_N_CACHED 6
+#define SYLVAN_AND_N_KEY(ops, n, i) ((i) < (n) ? (ops)[i] : 0)
+/* The conjunction of n >= 2 normalized operands, all in one recursive pass */
+TASK_3(BDD, sylvan_and_n_rec, const BDD*, ops, size_t, n, BDDVAR, prev_level)
+{
+    if (n == 2) return CALL(sylvan_and, ops[0], ops[1], prev_level);
+
+    if (n > SYLVAN_AND_N_CACHED) {
+        // too many operands for the cache key: conjoin the two halves, which are cached
+        size_t mid = n / 2;
+        bdd_refs_spawn(SPAWN(sylvan_and_n_rec, ops + mid, n - mid, prev_level));
+        BDD left = bdd_refs_push(CALL(sylvan_and_n_rec, ops, mid, prev_level));
+        BDD right = bdd_refs_push(bdd_refs_sync(SYNC(sylvan_and_n_rec)));
+        BDD result = CALL(sylvan_and, left, right, prev_level);
+        bdd_refs_pop(2);
+        return result;
+    }
+
+    sylvan_gc_test();
+
+    /* Count operation */
+    sylvan_stats_count(BDD_AND_N);
+
+    BDDVAR level = 0xffffffff;
+    for (size_t i=0; i<n; i++) {
+        BDDVAR v = bddnode_getvariable(MTBDD_GETNODE(ops[i]));
+        if (v < level) level = v;
+    }
+
+    int cachenow = granularity < 2 || prev_level == 0 ? 1 : prev_level / granularity != level / granularity;
+    if (cachenow) {
+        BDD result;
+        if (cache_get6(CACHE_BDD_AND_N | ops[0], ops[1], ops[2], SYLVAN_AND_N_KEY(ops, n, 3),
+                       SYLVAN_AND_N_KEY(ops, n, 4), SYLVAN_AND_N_KEY(ops, n, 5), &result, NULL)) {
+            sylvan_stats_count(BDD_AND_N_CACHED);
+            return result;
+        }
+    }
+
+    // Get cofactors
+    BDD lows[SYLVAN_AND_N_MAX], highs[SYLVAN_AND_N_MAX];
+    for (size_t i=0; i<n; i++) {
+        bddnode_t node = MTBDD_GETNODE(ops[i]);
+        if (bddnode_getvariable(node) == level) {
+            lows[i] = node_low(ops[i], node);
+            highs[i] = node_high(ops[i], node);
+        } else {
+            lows[i] = highs[i] = ops[i];
+        }
+    }
+    size_t nlow = sylvan_and_n_normalize(lows, n);
+    size_t nhigh = sylvan_and_n_normalize(highs, n);
+
+    // Recursive computation
+    BDD low=sylvan_invalid, high=sylvan_invalid, result;
+
+    int n_spawned=0;
+
+    if (nhigh <= 1) {
+        high = highs[0];
+    } else if (sylvan_seqcutoff_reached(level)) {
+        high = bdd_refs_push(CALL(sylvan_and_n_rec, highs, nhigh, level));
+        n_spawned=2;
+    } else {
+        bdd_refs_spawn(SPAWN(sylvan_and_n_rec, highs, nhigh, level));
+        n_spawned=1;
+    }
+
+    if (nlow <= 1) low = lows[0];
+    else low = CALL(sylvan_and_n_rec, lows, nlow, level);
+
+    if (n_spawned == 1) {
+        bdd_refs_push(low);
+        high = bdd_refs_sync(SYNC(sylvan_and_n_rec));
+        bdd_refs_pop(1);
+    } else if (n_spawned == 2) {
+        bdd_refs_pop(1);
+    }
+
+    result = sylvan_makenode(level, low, high);
+
+    if (cachenow) {
+        if (cache_put6(CACHE_BDD_AND_N | ops[0], ops[1], ops[2], SYLVAN_AND_N_KEY(ops, n, 3),
+                       SYLVAN_AND_N_KEY(ops, n, 4), SYLVAN_AND_N_KEY(ops, n, 5), result, 0)) {
+            sylvan_stats_count(BDD_AND_N_CACHEDPUT);
+        }
+    }
+
+    return result;
+}
+
+/* The conjunction of arr[0..n-1], or of their negations if <negate> is set */
+TASK_3(BDD, sylvan_and_n_go, const BDD*, arr, size_t, n, int, negate)
+{
+    if (n > SYLVAN_AND_N_MAX) {
+        // a balanced tree, of which the two halves are computed in parallel
+        size_t mid = n / 2;
+        bdd_refs_spawn(SPAWN(sylvan_and_n_go, arr + mid, n - mid, negate));
+        BDD left = bdd_refs_push(CALL(sylvan_and_n_go, arr, mid, negate));
+        BDD right = bdd_refs_push(bdd_refs_sync(SYNC(sylvan_and_n_go)));
+        BDD result = CALL(sylvan_and, left, right, 0);
+        bdd_refs_pop(2);
+        return result;
+    }
+
+    BDD ops[SYLVAN_AND_N_MAX];
+    for (size_t i=0; i<n; i++) ops[i] = negate ? sylvan_not(arr[i]) : arr[i];
+    n = sylvan_and_n_normalize(ops, n);
+    if (n <= 1) return ops[0];
+    return CALL(sylvan_and_n_rec, ops, n, 0);
+}
+
+TASK_IMPL_2(BDD, sylvan_and_n, const BDD*, arr, size_t, n)
+{
+    return CALL(sylvan_and_n_go, arr, n, 0);
+}
+
+TASK_IMPL_2(BDD, sylvan_or_n, const BDD*, arr, size_t, n)
+{
+    return sylvan_not(CALL(sylvan_and_n_go, arr, n, 1));
+}
+
 TASK_IMPL_3(BDD, sylvan_xor, BDD, a, BDD, b, BDDVAR, prev_level)
 {
     /* Terminal cases */
@@ -290,11 +475,17 @@ TASK_IMPL_3(BDD, sylvan_xor, BDD, a, BDD, b, BDDVAR, prev_level)
     // Recursive computation
     BDD low, high, result;
 
-    bdd_refs_spawn(SPAWN(sylvan_xor, aHigh, bHigh, level));
-    low = CALL(sylvan_xor, aLow, bLow, level);
-    bdd_refs_push(low);
-    high = bdd_refs_sync(SYNC(sylvan_xor));
-    bdd_refs_pop(1);
+    if (sylvan_seqcutoff_reached(level)) {
+        high = bdd_refs_push(CALL(sylvan_xor, aHigh, bHigh, level));
+        low = CALL(sylvan_xor, aLow, bLow, level);
+        bdd_refs_pop(1);
+    } else {
+        bdd_refs_spawn(SPAWN(sylvan_xor, aHigh, bHigh, level));
+        low = CALL(sylvan_xor, aLow, bLow, level);
+        bdd_refs_push(low);
+        high = bdd_refs_sync(SYNC(sylvan_xor));
+        bdd_refs_pop(1);
+    }
 
     result = sylvan_makenode(level, low, high);
 
@@ -415,6 +606,9 @@ TASK_IMPL_4(BDD, sylvan_ite, BDD, a, BDD, b, BDD, c, BDDVAR, prev_level)
         high = bHigh;
     } else if (aHigh == sylvan_false) {
         high = cHigh;
+    } else if (sylvan_seqcutoff_reached(level)) {
+        high = bdd_refs_push(CALL(sylvan_ite, aHigh, bHigh, cHigh, level));
+        n=2;
     } else {
         bdd_refs_spawn(SPAWN(sylvan_ite, aHigh, bHigh, cHigh, level));
         n=1;
@@ -428,10 +622,12 @@ TASK_IMPL_4(BDD, sylvan_ite, BDD, a, BDD, b, BDD, c, BDDVAR, prev_level)
         low = CALL(sylvan_ite, aLow, bLow, cLow, level);
     }
 
-    if (n) {
+    if (n == 1) {
         bdd_refs_push(low);
         high = bdd_refs_sync(SYNC(sylvan_ite));
         bdd_refs_pop(1);
+    } else if (n == 2) {
+        bdd_refs_pop(1);
     }
 
     result = sylvan_makenode(level, low, high);
@@ -691,11 +887,17 @@ TASK_IMPL_3(BDD, sylvan_exists, BDD, a, BDD, variables, BDDVAR, prev_level)
     } else {
         // level is not in variable set
         BDD low, high;
-        bdd_refs_spawn(SPAWN(sylvan_exists, aHigh, variables, level));
-        low = CALL(sylvan_exists, aLow, variables, level);
-        bdd_refs_push(low);
-        high = bdd_refs_sync(SYNC(sylvan_exists));
-        bdd_refs_pop(1);
+        if (sylvan_seqcutoff_reached(level)) {
+            high = bdd_refs_push(CALL(sylvan_exists, aHigh, variables, level));
+            low = CALL(sylvan_exists, aLow, variables, level);
+            bdd_refs_pop(1);
+        } else {
+            bdd_refs_spawn(SPAWN(sylvan_exists, aHigh, variables, level));
+            low = CALL(sylvan_exists, aLow, variables, level);
+            bdd_refs_push(low);
+            high = bdd_refs_sync(SYNC(sylvan_exists));
+            bdd_refs_pop(1);
+        }
         result = sylvan_makenode(level, low, high);
     }
 
@@ -873,6 +1075,12 @@ TASK_IMPL_4(BDD, sylvan_and_exists, BDD, a, BDD, b, BDDSET, v, BDDVAR, prev_leve
         bHigh = b;
     }
 
+    // Prefetch the nodes of the recursive calls
+    MTBDD_PREFETCH(aHigh);
+    MTBDD_PREFETCH(bHigh);
+    MTBDD_PREFETCH(aLow);
+    MTBDD_PREFETCH(bLow);
+
     if (level == vv) {
         // level is in variable set, perform abstraction
         BDD _v = node_high(v, nv);
@@ -906,11 +1114,18 @@ TASK_IMPL_4(BDD, sylvan_and_exists, BDD, a, BDD, b, BDDSET, v, BDDVAR, prev_leve
         }
     } else {
         // level is not in variable set
-        bdd_refs_spawn(SPAWN(sylvan_and_exists, aHigh, bHigh, v, level));
-        BDD low = CALL(sylvan_and_exists, aLow, bLow, v, level);
-        bdd_refs_push(low);
-        BDD high = bdd_refs_sync(SYNC(sylvan_and_exists));
-        bdd_refs_pop(1);
+        BDD low, high;
+        if (sylvan_seqcutoff_reached(level)) {
+            high = bdd_refs_push(CALL(sylvan_and_exists, aHigh, bHigh, v, level));
+            low = CALL(sylvan_and_exists, aLow, bLow, v, level);
+            bdd_refs_pop(1);
+        } else {
+            bdd_refs_spawn(SPAWN(sylvan_and_exists, aHigh, bHigh, v, level));
+            low = CALL(sylvan_and_exists, aLow, bLow, v, level);
+            bdd_refs_push(low);
+            high = bdd_refs_sync(SYNC(sylvan_and_exists));
+            bdd_refs_pop(1);
+        }
         result = sylvan_makenode(level, low, high);
     }
 
@@ -1500,6 +1715,289 @@ TASK_IMPL_4(BDD, sylvan_relprev, BDD, a, BDD, b, BDDSET, vars, BDDVAR, prev_leve
     return result;
 }
 
+/**
+ * Relation maps
+ */
+TASK_IMPL_3(BDDMAP, sylvan_relmap_fromarrays, const uint32_t*, svars, const uint32_t*, tvars, size_t, n)
+{
+    BDDMAP map = sylvan_map_empty();
+    bdd_refs_pushptr(&map);
+    for (size_t i=0; i<n; i++) {
+        if (svars[i] == tvars[i] || sylvan_map_contains(map, svars[i]) || sylvan_map_contains(map, tvars[i])) {
+            fprintf(stderr, "sylvan_relmap: variable %" PRIu32 " or %" PRIu32 " is in more than one pair!\n", svars[i], tvars[i]);
+            exit(1);
+        }
+        BDD x = bdd_refs_push(sylvan_ithvar(tvars[i]));
+        map = sylvan_map_add(map, svars[i], x);
+        bdd_refs_pop(1);
+        x = bdd_refs_push(sylvan_nithvar(svars[i]));
+        map = sylvan_map_add(map, tvars[i], x);
+        bdd_refs_pop(1);
+    }
+    bdd_refs_popptr(1);
+    return map;
+}
+
+TASK_IMPL_1(BDDMAP, sylvan_relmap_frommap, BDDMAP, map)
+{
+    size_t n = sylvan_map_count(map);
+    uint32_t *s = (uint32_t*)malloc(sizeof(uint32_t) * (n == 0 ? 1 : n));
+    uint32_t *t = (uint32_t*)malloc(sizeof(uint32_t) * (n == 0 ? 1 : n));
+    if (s == NULL || t == NULL) {
+        fprintf(stderr, "sylvan_relmap: Unable to allocate memory!\n");
+        exit(1);
+    }
+    for (size_t i=0; i<n; i++, map = sylvan_map_next(map)) {
+        BDD value = sylvan_map_value(map);
+        if (sylvan_isconst(value) || sylvan_low(value) != sylvan_false || sylvan_high(value) != sylvan_true) {
+            fprintf(stderr, "sylvan_relmap: variable %" PRIu32 " is not mapped to a variable!\n", sylvan_map_key(map));
+            exit(1);
+        }
+        s[i] = sylvan_map_key(map);
+        t[i] = sylvan_var(value);
+    }
+    BDDMAP result = CALL(sylvan_relmap_fromarrays, s, t, n);
+    free(s);
+    free(t);
+    return result;
+}
+
+/**
+ * The BDD "if <var> then <high> else <low>", also when <low> or <high> depend on variables
+ * before <var>, which happens when variables are renamed. The caller protects <low> and <high>.
+ */
+TASK_3(BDD, relmap_node, BDDVAR, var, BDD, low, BDD, high)
+{
+    if ((sylvan_isconst(low) || sylvan_var(low) > var) && (sylvan_isconst(high) || sylvan_var(high) > var)) {
+        return sylvan_makenode(var, low, high);
+    }
+    BDD x = bdd_refs_push(sylvan_ithvar(var));
+    BDD result = CALL(sylvan_ite, x, high, low, 0);
+    bdd_refs_pop(1);
+    return result;
+}
+
+TASK_IMPL_4(BDD, sylvan_relnext_map, BDD, a, BDD, b, BDDMAP, map, BDDVAR, prev_level)
+{
+    /* Terminals */
+    if (a == sylvan_true && b == sylvan_true) return sylvan_true;
+    if (a == sylvan_false) return sylvan_false;
+    if (b == sylvan_false) return sylvan_false;
+    if (sylvan_map_isempty(map)) return a;
+
+    /* Perhaps execute garbage collection */
+    sylvan_gc_test();
+
+    /* Count operation */
+    sylvan_stats_count(BDD_RELNEXT_MAP);
+
+    /* Determine top level */
+    bddnode_t na = sylvan_isconst(a) ? 0 : MTBDD_GETNODE(a);
+    bddnode_t nb = sylvan_isconst(b) ? 0 : MTBDD_GETNODE(b);
+
+    BDDVAR va = na ? bddnode_getvariable(na) : 0xffffffff;
+    BDDVAR vb = nb ? bddnode_getvariable(nb) : 0xffffffff;
+    BDDVAR level = va < vb ? va : vb;
+
+    /* Skip the pairs before the level */
+    while (sylvan_map_key(map) < level) {
+        map = sylvan_map_next(map);
+        if (sylvan_map_isempty(map)) return a;
+    }
+
+    /* Consult cache */
+    int cachenow = granularity < 2 || prev_level == 0 ? 1 : prev_level / granularity != level / granularity;
+    if (cachenow) {
+        BDD result;
+        if (cache_get3(CACHE_BDD_RELNEXT_MAP, a, b, map, &result)) {
+            sylvan_stats_count(BDD_RELNEXT_MAP_CACHED);
+            return result;
+        }
+    }
+
+    BDD a0, a1, b0, b1;
+    if (na && va == level) {
+        a0 = node_low(a, na);
+        a1 = node_high(a, na);
+    } else {
+        a0 = a1 = a;
+    }
+    if (nb && vb == level) {
+        b0 = node_low(b, nb);
+        b1 = node_high(b, nb);
+    } else {
+        b0 = b1 = b;
+    }
+
+    BDD result;
+
+    if (sylvan_map_key(map) == level && !BDD_HASMARK(sylvan_map_value(map))) {
+        /* A state variable: quantify */
+        BDDMAP _map = sylvan_map_next(map);
+        bdd_refs_spawn(SPAWN(sylvan_relnext_map, a0, b0, _map, level));
+        BDD r1 = bdd_refs_push(CALL(sylvan_relnext_map, a1, b1, _map, level));
+        BDD r0 = bdd_refs_push(bdd_refs_sync(SYNC(sylvan_relnext_map)));
+        result = sylvan_or(r0, r1);
+        bdd_refs_pop(2);
+    } else if (sylvan_map_key(map) == level) {
+        /* A next state variable: rename to the state variable */
+        BDDVAR s = sylvan_var(sylvan_map_value(map));
+        BDDMAP _map = sylvan_map_next(map);
+        bdd_refs_spawn(SPAWN(sylvan_relnext_map, a, b0, _map, level));
+        BDD r1 = bdd_refs_push(CALL(sylvan_relnext_map, a, b1, _map, level));
+        BDD r0 = bdd_refs_push(bdd_refs_sync(SYNC(sylvan_relnext_map)));
+        result = CALL(relmap_node, s, r0, r1);
+        bdd_refs_pop(2);
+    } else if (b0 != b1 && a0 == a1) {
+        /* Quantify "b" variables */
+        bdd_refs_spawn(SPAWN(sylvan_relnext_map, a, b0, map, level));
+        BDD r1 = bdd_refs_push(CALL(sylvan_relnext_map, a, b1, map, level));
+        BDD r0 = bdd_refs_push(bdd_refs_sync(SYNC(sylvan_relnext_map)));
+        result = sylvan_or(r0, r1);
+        bdd_refs_pop(2);
+    } else if (b0 != b1) {
+        /* Quantify "b" variables, but keep "a" variables */
+        bdd_refs_spawn(SPAWN(sylvan_relnext_map, a0, b0, map, level));
+        bdd_refs_spawn(SPAWN(sylvan_relnext_map, a0, b1, map, level));
+        bdd_refs_spawn(SPAWN(sylvan_relnext_map, a1, b0, map, level));
+        BDD r11 = bdd_refs_push(CALL(sylvan_relnext_map, a1, b1, map, level));
+        BDD r10 = bdd_refs_push(bdd_refs_sync(SYNC(sylvan_relnext_map)));
+        BDD r01 = bdd_refs_push(bdd_refs_sync(SYNC(sylvan_relnext_map)));
+        BDD r00 = bdd_refs_push(bdd_refs_sync(SYNC(sylvan_relnext_map)));
+        BDD r0 = bdd_refs_push(sylvan_or(r00, r01));
+        BDD r1 = bdd_refs_push(sylvan_or(r10, r11));
+        result = CALL(relmap_node, level, r0, r1);
+        bdd_refs_pop(6);
+    } else {
+        /* Keep "a" variables */
+        bdd_refs_spawn(SPAWN(sylvan_relnext_map, a0, b, map, level));
+        BDD r1 = bdd_refs_push(CALL(sylvan_relnext_map, a1, b, map, level));
+        BDD r0 = bdd_refs_push(bdd_refs_sync(SYNC(sylvan_relnext_map)));
+        result = CALL(relmap_node, level, r0, r1);
+        bdd_refs_pop(2);
+    }
+
+    if (cachenow) {
+        if (cache_put3(CACHE_BDD_RELNEXT_MAP, a, b, map, result)) sylvan_stats_count(BDD_RELNEXT_MAP_CACHEDPUT);
+    }
+
+    return result;
+}
+
+/**
+ * Implementation of sylvan_relprev_map, with the relation map twice: <map> for the variables of
+ * A and <bmap> for the variables of B, which are renamed.
+ */
+TASK_5(BDD, relprev_map, BDD, a, BDD, b, BDDMAP, map, BDDMAP, bmap, BDDVAR, prev_level)
+{
+    /* Terminals */
+    if (a == sylvan_true && b == sylvan_true) return sylvan_true;
+    if (a == sylvan_false) return sylvan_false;
+    if (b == sylvan_false) return sylvan_false;
+    if (sylvan_map_isempty(map)) return b;
+
+    /* Perhaps execute garbage collection */
+    sylvan_gc_test();
+
+    /* Count operation */
+    sylvan_stats_count(BDD_RELPREV_MAP);
+
+    /* Determine top level, with the state variables of B renamed */
+    bddnode_t na = sylvan_isconst(a) ? 0 : MTBDD_GETNODE(a);
+    bddnode_t nb = sylvan_isconst(b) ? 0 : MTBDD_GETNODE(b);
+
+    BDDVAR va = na ? bddnode_getvariable(na) : 0xffffffff;
+    BDDVAR vb = nb ? bddnode_getvariable(nb) : 0xffffffff;
+    if (nb) {
+        while (!sylvan_map_isempty(bmap) && sylvan_map_key(bmap) < vb) bmap = sylvan_map_next(bmap);
+        if (!sylvan_map_isempty(bmap) && sylvan_map_key(bmap) == vb && !BDD_HASMARK(sylvan_map_value(bmap))) {
+            vb = sylvan_var(sylvan_map_value(bmap));
+        }
+    }
+    BDDVAR level = va < vb ? va : vb;
+
+    /* Skip the pairs before the level */
+    while (sylvan_map_key(map) < level) {
+        map = sylvan_map_next(map);
+        if (sylvan_map_isempty(map)) return b;
+    }
+
+    /* Consult cache */
+    int cachenow = granularity < 2 || prev_level == 0 ? 1 : prev_level / granularity != level / granularity;
+    if (cachenow) {
+        BDD result;
+        if (cache_get4(CACHE_BDD_RELPREV_MAP, a, b, map, bmap, &result)) {
+            sylvan_stats_count(BDD_RELPREV_MAP_CACHED);
+            return result;
+        }
+    }
+
+    BDD a0, a1, b0, b1;
+    if (na && va == level) {
+        a0 = node_low(a, na);
+        a1 = node_high(a, na);
+    } else {
+        a0 = a1 = a;
+    }
+    if (nb && vb == level) {
+        b0 = node_low(b, nb);
+        b1 = node_high(b, nb);
+    } else {
+        b0 = b1 = b;
+    }
+
+    BDD result;
+
+    if (sylvan_map_key(map) == level && !BDD_HASMARK(sylvan_map_value(map))) {
+        /* A state variable of A: keep */
+        bdd_refs_spawn(SPAWN(relprev_map, a0, b, map, bmap, level));
+        BDD r1 = bdd_refs_push(CALL(relprev_map, a1, b, map, bmap, level));
+        BDD r0 = bdd_refs_sync(SYNC(relprev_map));
+        bdd_refs_pop(1);
+        result = sylvan_makenode(level, r0, r1);
+    } else if (sylvan_map_key(map) == level || a0 != a1) {
+        if (sylvan_map_key(map) != level && b0 != b1) {
+            /* Quantify "a" variables, but keep "b" variables */
+            bdd_refs_spawn(SPAWN(relprev_map, a0, b0, map, bmap, level));
+            bdd_refs_spawn(SPAWN(relprev_map, a1, b0, map, bmap, level));
+            bdd_refs_spawn(SPAWN(relprev_map, a0, b1, map, bmap, level));
+            BDD r11 = bdd_refs_push(CALL(relprev_map, a1, b1, map, bmap, level));
+            BDD r01 = bdd_refs_push(bdd_refs_sync(SYNC(relprev_map)));
+            BDD r10 = bdd_refs_push(bdd_refs_sync(SYNC(relprev_map)));
+            BDD r00 = bdd_refs_push(bdd_refs_sync(SYNC(relprev_map)));
+            BDD r0 = bdd_refs_push(sylvan_or(r00, r10));
+            BDD r1 = sylvan_or(r01, r11);
+            bdd_refs_pop(5);
+            result = sylvan_makenode(level, r0, r1);
+        } else {
+            /* A next state variable (matching the renamed variable of B) or a variable of A: quantify */
+            bdd_refs_spawn(SPAWN(relprev_map, a0, b0, map, bmap, level));
+            BDD r1 = bdd_refs_push(CALL(relprev_map, a1, b1, map, bmap, level));
+            BDD r0 = bdd_refs_push(bdd_refs_sync(SYNC(relprev_map)));
+            result = sylvan_or(r0, r1);
+            bdd_refs_pop(2);
+        }
+    } else {
+        /* Keep "b" variables */
+        bdd_refs_spawn(SPAWN(relprev_map, a, b0, map, bmap, level));
+        BDD r1 = bdd_refs_push(CALL(relprev_map, a, b1, map, bmap, level));
+        BDD r0 = bdd_refs_sync(SYNC(relprev_map));
+        bdd_refs_pop(1);
+        result = sylvan_makenode(level, r0, r1);
+    }
+
+    if (cachenow) {
+        if (cache_put4(CACHE_BDD_RELPREV_MAP, a, b, map, bmap, result)) sylvan_stats_count(BDD_RELPREV_MAP_CACHEDPUT);
+    }
+
+    return result;
+}
+
+TASK_IMPL_4(BDD, sylvan_relprev_map, BDD, a, BDD, b, BDDMAP, map, BDDVAR, prev_level)
+{
+    return CALL(relprev_map, a, b, map, map, prev_level);
+}
+
 /**
  * Computes the transitive closure by traversing the BDD recursively.
  * See Y. Matsunaga, P. C. McGeer, R. K. Brayton
@@ -1667,6 +2165,75 @@ TASK_IMPL_3(BDD, sylvan_compose, BDD, a, BDDMAP, map, BDDVAR, prev_level)
     return result;
 }
 
+TASK_IMPL_3(BDD, sylvan_rename, BDD, a, BDDMAP, map, BDDVAR, prev_level)
+{
+    /* Trivial cases */
+    if (a == sylvan_false || a == sylvan_true) return a;
+    if (sylvan_map_isempty(map)) return a;
+
+    /* Renaming commutes with negation */
+    const int negated = BDD_HASMARK(a) ? 1 : 0;
+    a = BDD_STRIPMARK(a);
+
+    /* Determine top level */
+    bddnode_t n = MTBDD_GETNODE(a);
+    BDDVAR level = bddnode_getvariable(n);
+
+    /* Skip map */
+    bddnode_t map_node = MTBDD_GETNODE(map);
+    BDDVAR map_var = bddnode_getvariable(map_node);
+    while (map_var < level) {
+        map = node_low(map, map_node);
+        if (sylvan_map_isempty(map)) return negated ? sylvan_not(a) : a;
+        map_node = MTBDD_GETNODE(map);
+        map_var = bddnode_getvariable(map_node);
+    }
+
+    /* Perhaps execute garbage collection */
+    sylvan_gc_test();
+
+    /* Count operation */
+    sylvan_stats_count(BDD_RENAME);
+
+    /* Consult cache */
+    BDD result;
+    int cachenow = granularity < 2 || prev_level == 0 ? 1 : prev_level / granularity != level / granularity;
+    if (cachenow) {
+        if (cache_get3(CACHE_BDD_RENAME, a, map, 0, &result)) {
+            sylvan_stats_count(BDD_RENAME_CACHED);
+            return negated ? sylvan_not(result) : result;
+        }
+    }
+
+    /* Recursively calculate low and high */
+    BDD low, high;
+    if (sylvan_seqcutoff_reached(level)) {
+        high = bdd_refs_push(CALL(sylvan_rename, node_high(a, n), map, level));
+        low = bdd_refs_push(CALL(sylvan_rename, node_low(a, n), map, level));
+    } else {
+        bdd_refs_spawn(SPAWN(sylvan_rename, node_low(a, n), map, level));
+        high = bdd_refs_push(CALL(sylvan_rename, node_high(a, n), map, level));
+        low = bdd_refs_push(bdd_refs_sync(SYNC(sylvan_rename)));
+    }
+
+    /* Calculate result: directly if the new variable is before the variables of low and high */
+    BDDVAR var = map_var == level ? sylvan_var(node_high(map, map_node)) : level;
+    if ((sylvan_isconst(low) || sylvan_var(low) > var) && (sylvan_isconst(high) || sylvan_var(high) > var)) {
+        result = sylvan_makenode(var, low, high);
+    } else {
+        BDD root = bdd_refs_push(sylvan_ithvar(var));
+        result = CALL(sylvan_ite, root, high, low, 0);
+        bdd_refs_pop(1);
+    }
+    bdd_refs_pop(2);
+
+    if (cachenow) {
+        if (cache_put3(CACHE_BDD_RENAME, a, map, 0, result)) sylvan_stats_count(BDD_RENAME_CACHEDPUT);
+    }
+
+    return negated ? sylvan_not(result) : result;
+}
+
 /**
  * Calculate the number of distinct paths to True.
  */
@@ -2164,6 +2731,16 @@ static avl_node_t *sylvan_ser_reversed_set = NULL;
 static size_t sylvan_ser_counter = 1;
 static size_t sylvan_ser_done = 0;
 
+// Number of entries in both sets, for the memory accounting
+static size_t sylvan_ser_entries = 0;
+
+static inline void
+sylvan_ser_account(size_t inserted)
+{
+    sylvan_ser_entries += inserted;
+    sylvan_memory_add(SYLVAN_MEM_SERIALIZE, inserted * (sizeof(avl_node_t) + sizeof(struct sylvan_ser)));
+}
+
 // Given a BDD, assign unique numbers to all nodes
 static size_t
 sylvan_serialize_assign_rec(BDD bdd)
@@ -2188,6 +2765,7 @@ sylvan_serialize_assign_rec(BDD bdd)
 
             // put a copy in the reversed table
             sylvan_ser_reversed_insert(&sylvan_ser_reversed_set, ss);
+            sylvan_ser_account(2);
         }
 
         return ss->assigned;
@@ -2209,6 +2787,8 @@ sylvan_serialize_reset()
     sylvan_ser_free(&sylvan_ser_reversed_set);
     sylvan_ser_counter = 1;
     sylvan_ser_done = 0;
+    sylvan_memory_sub(SYLVAN_MEM_SERIALIZE, sylvan_ser_entries * (sizeof(avl_node_t) + sizeof(struct sylvan_ser)));
+    sylvan_ser_entries = 0;
 }
 
 size_t
@@ -2314,8 +2894,8 @@ sylvan_serialize_fromfile(FILE *in)
         s.bdd = sylvan_makenode(bddnode_getvariable(&node), low, high);
         s.assigned = ++sylvan_ser_done; // starts at 0 but we want 1-based...
 
-        sylvan_ser_insert(&sylvan_ser_set, &s);
-        sylvan_ser_reversed_insert(&sylvan_ser_reversed_set, &s);
+        sylvan_ser_account(sylvan_ser_insert(&sylvan_ser_set, &s));
+        sylvan_ser_account(sylvan_ser_reversed_insert(&sylvan_ser_reversed_set, &s));
     }
 }
 
@@ -63,11 +63,11 @@ sylvan_not(BDD a)
 }
 
 TASK_DECL_4(BDD, sylvan_ite, BDD, BDD, BDD, BDDVAR);
-#define sylvan_ite(a,b,c) (RUN(sylvan_ite,a,b,c,0))
+#define sylvan_ite(a,b,c) SYLVAN_RECORD_RUN3(SYLVAN_RECORD_BDD_ITE, BDD, sylvan_ite, a,b,c,0)
 TASK_DECL_3(BDD, sylvan_and, BDD, BDD, BDDVAR);
-#define sylvan_and(a,b) (RUN(sylvan_and,a,b,0))
+#define sylvan_and(a,b) SYLVAN_RECORD_RUN2(SYLVAN_RECORD_BDD_AND, BDD, sylvan_and, a,b,0)
 TASK_DECL_3(BDD, sylvan_xor, BDD, BDD, BDDVAR);
-#define sylvan_xor(a,b) (RUN(sylvan_xor,a,b,0))
+#define sylvan_xor(a,b) SYLVAN_RECORD_RUN2(SYLVAN_RECORD_BDD_XOR, BDD, sylvan_xor, a,b,0)
 #define sylvan_equiv(a,b) sylvan_not(sylvan_xor(a,b))
 #define sylvan_or(a,b) sylvan_not(sylvan_and(sylvan_not(a),sylvan_not(b)))
 #define sylvan_nand(a,b) sylvan_not(sylvan_and(a,b))
@@ -82,6 +82,20 @@ TASK_DECL_3(char, sylvan_disjoint, BDD, BDD, BDDVAR);
 #define sylvan_disjoint(a,b) (RUN(sylvan_disjoint,a,b,0))
 #define sylvan_subset(a,b) (RUN(sylvan_disjoint,a,sylvan_not(b),0))
 
+/**
+ * Compute the conjunction (sylvan_and_n) or disjunction (sylvan_or_n) of the <n> BDDs in <arr>.
+ * Up to SYLVAN_AND_N_MAX operands are handled in one recursive pass over all operands, without
+ * building the intermediate results of pairwise sylvan_and calls. Constants and duplicates are
+ * dropped in every node. Where more than 6 operands remain, the two halves are conjoined, as
+ * the operation cache only holds up to 6 operands. More operands are split into a balanced tree, of which the parts are
+ * computed in parallel. The conjunction of 0 BDDs is true, the disjunction is false.
+ */
+#define SYLVAN_AND_N_MAX 32
+TASK_DECL_2(BDD, sylvan_and_n, const BDD*, size_t);
+#define sylvan_and_n(arr, n) (RUN(sylvan_and_n, arr, n))
+TASK_DECL_2(BDD, sylvan_or_n, const BDD*, size_t);
+#define sylvan_or_n(arr, n) (RUN(sylvan_or_n, arr, n))
+
 /* Create a BDD representing just <var> or the negation of <var> */
 static inline BDD
 sylvan_nithvar(uint32_t var)
@@ -93,7 +107,7 @@ sylvan_nithvar(uint32_t var)
  * Existential and universal quantification.
  */
 TASK_DECL_3(BDD, sylvan_exists, BDD, BDD, BDDVAR);
-#define sylvan_exists(a, vars) (RUN(sylvan_exists, a, vars, 0))
+#define sylvan_exists(a, vars) SYLVAN_RECORD_RUN2(SYLVAN_RECORD_BDD_EXISTS, BDD, sylvan_exists, a, vars, 0)
 #define sylvan_forall(a, vars) (sylvan_not(RUN(sylvan_exists, sylvan_not(a), vars, 0)))
 
 /**
@@ -106,7 +120,7 @@ TASK_DECL_2(BDD, sylvan_project, BDD, BDD);
  * Compute \exists <vars>: <a> \and <b>
  */
 TASK_DECL_4(BDD, sylvan_and_exists, BDD, BDD, BDDSET, BDDVAR);
-#define sylvan_and_exists(a,b,vars) RUN(sylvan_and_exists,a,b,vars,0)
+#define sylvan_and_exists(a,b,vars) SYLVAN_RECORD_RUN3(SYLVAN_RECORD_BDD_AND_EXISTS, BDD, sylvan_and_exists, a,b,vars,0)
 
 /**
  * Compute and_exists, but as a projection (only keep given variables)
@@ -127,7 +141,7 @@ TASK_DECL_3(BDD, sylvan_and_project, BDD, BDD, BDDSET);
  * or to take the 'previous' of a set               -->  S
  */
 TASK_DECL_4(BDD, sylvan_relprev, BDD, BDD, BDDSET, BDDVAR);
-#define sylvan_relprev(a,b,vars) RUN(sylvan_relprev,a,b,vars,0)
+#define sylvan_relprev(a,b,vars) SYLVAN_RECORD_RUN3(SYLVAN_RECORD_BDD_RELPREV, BDD, sylvan_relprev, a,b,vars,0)
 
 /**
  * Compute R(s) = \exists x: A(x) \and B(x,s)
@@ -141,7 +155,42 @@ TASK_DECL_4(BDD, sylvan_relprev, BDD, BDD, BDDSET, BDDVAR);
  * Use this function to take the 'next' of a set     S  -->
  */
 TASK_DECL_4(BDD, sylvan_relnext, BDD, BDD, BDDSET, BDDVAR);
-#define sylvan_relnext(a,b,vars) RUN(sylvan_relnext,a,b,vars,0)
+#define sylvan_relnext(a,b,vars) SYLVAN_RECORD_RUN3(SYLVAN_RECORD_BDD_RELNEXT, BDD, sylvan_relnext, a,b,vars,0)
+
+/**
+ * Relation maps, for relnext and relprev with state variables s and next state variables t that
+ * are not interleaved. A relation map is a BDDMAP that maps every s to sylvan_ithvar(t) and
+ * every t to sylvan_nithvar(s). The s and t variables must be different.
+ *
+ * sylvan_relmap_fromarrays creates the relation map of the <n> pairs s[i], t[i].
+ * sylvan_relmap_frommap creates the relation map of a BDDMAP from every s to sylvan_ithvar(t),
+ * i.e., of the map that renames the state variables to the next state variables.
+ */
+TASK_DECL_3(BDDMAP, sylvan_relmap_fromarrays, const uint32_t*, const uint32_t*, size_t);
+#define sylvan_relmap_fromarrays(s, t, n) RUN(sylvan_relmap_fromarrays, s, t, n)
+TASK_DECL_1(BDDMAP, sylvan_relmap_frommap, BDDMAP);
+#define sylvan_relmap_frommap(map) RUN(sylvan_relmap_frommap, map)
+
+/**
+ * Compute R(s) = \exists x: A(x) \and B(x,s), like sylvan_relnext, but with the pairs of state
+ * and next state variables of the relation map <map>. The next state variables are renamed
+ * during the computation, so the result is on the state variables.
+ * A must not depend on the next state variables.
+ * Other variables in A are kept, other variables in B are quantified.
+ */
+TASK_DECL_4(BDD, sylvan_relnext_map, BDD, BDD, BDDMAP, BDDVAR);
+#define sylvan_relnext_map(a,b,map) RUN(sylvan_relnext_map,a,b,map,0)
+
+/**
+ * Compute R(s) = \exists x: A(s,x) \and B(x), like sylvan_relprev, but with the pairs of state
+ * and next state variables of the relation map <map>. The state variables of B are renamed
+ * during the computation, which requires that renaming them keeps the order of the variables
+ * of B, e.g., when the pairs have the same order and B only depends on state variables.
+ * B must not depend on the next state variables.
+ * Other variables in A are quantified, other variables in B are kept.
+ */
+TASK_DECL_4(BDD, sylvan_relprev_map, BDD, BDD, BDDMAP, BDDVAR);
+#define sylvan_relprev_map(a,b,map) RUN(sylvan_relprev_map,a,b,map,0)
 
 /**
  * Computes the transitive closure by traversing the BDD recursively.
@@ -168,14 +217,14 @@ TASK_DECL_2(BDD, sylvan_closure, BDD, BDDVAR);
  *   - f@not(f) = 0
  */
 TASK_DECL_3(BDD, sylvan_constrain, BDD, BDD, BDDVAR);
-#define sylvan_constrain(f,c) (RUN(sylvan_constrain, f, c, 0))
+#define sylvan_constrain(f,c) SYLVAN_TRACE_RUN(BDD, sylvan_constrain, f, c, 0)
 
 /**
  * Compute restrict f@c, which uses a heuristic to try and minimize a BDD f with respect to a care function c
  * Similar to constrain, but avoids introducing variables from c into f.
  */
 TASK_DECL_3(BDD, sylvan_restrict, BDD, BDD, BDDVAR);
-#define sylvan_restrict(f,c) (RUN(sylvan_restrict, f, c, 0))
+#define sylvan_restrict(f,c) SYLVAN_TRACE_RUN(BDD, sylvan_restrict, f, c, 0)
 
 /**
  * Function composition.
@@ -183,7 +232,18 @@ TASK_DECL_3(BDD, sylvan_restrict, BDD, BDD, BDDVAR);
  * replace the node by the result of sylvan_ite(<value>, <low>, <high>).
  */
 TASK_DECL_3(BDD, sylvan_compose, BDD, BDDMAP, BDDVAR);
-#define sylvan_compose(f,m) (RUN(sylvan_compose, (f), (m), 0))
+#define sylvan_compose(f,m) SYLVAN_TRACE_RUN(BDD, sylvan_compose, (f), (m), 0)
+
+/**
+ * Variable renaming.
+ * For each node with variable <key> which has a <key,value> pair in <map>, where <value> is
+ * sylvan_ithvar(<var>), replace the variable of the node by <var>.
+ * Same result as sylvan_compose with this map, but the nodes are rebuilt directly (with
+ * sylvan_makenode) wherever the renaming keeps the order of the variables, e.g., when shifting
+ * all variables; only nodes where the order changes are combined with sylvan_ite.
+ */
+TASK_DECL_3(BDD, sylvan_rename, BDD, BDDMAP, BDDVAR);
+#define sylvan_rename(f,m) SYLVAN_TRACE_RUN(BDD, sylvan_rename, (f), (m), 0)
 
 /**
  * Calculate number of satisfying variable assignments.
@@ -191,7 +251,7 @@ TASK_DECL_3(BDD, sylvan_compose, BDD, BDDMAP, BDDVAR);
  */
 
 TASK_DECL_3(double, sylvan_satcount, BDD, BDDSET, BDDVAR);
-#define sylvan_satcount(bdd, variables) RUN(sylvan_satcount, bdd, variables, 0)
+#define sylvan_satcount(bdd, variables) SYLVAN_TRACE_RUN(double, sylvan_satcount, bdd, variables, 0)
 
 /**
  * Create a BDD cube representing the conjunction of variables in their positive or negative
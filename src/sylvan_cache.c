@@ -183,6 +183,25 @@ cache_get(uint64_t a, uint64_t b, uint64_t c, uint64_t *res)
     return atomic_load_explicit(s_bucket, memory_order_relaxed) == s ? 1 : 0;
 }
 
+void
+cache_prefetch(uint64_t a, uint64_t b, uint64_t c)
+{
+#if SYLVAN_PREFETCH
+    const uint64_t hash = cache_hash(a, b, c);
+#if CACHE_MASK
+    const size_t idx = hash & cache_mask;
+#else
+    const size_t idx = hash % cache_size;
+#endif
+    __builtin_prefetch(cache_status + idx);
+    __builtin_prefetch(cache_table + idx);
+#else
+    (void)a;
+    (void)b;
+    (void)c;
+#endif
+}
+
 int
 cache_put(uint64_t a, uint64_t b, uint64_t c, uint64_t res)
 {
@@ -286,6 +305,17 @@ cache_getused()
     return result;
 }
 
+size_t
+cache_getused_approx()
+{
+    size_t result = 0;
+    const size_t size = cache_size;
+    for (size_t i=0;i<size;i++) {
+        if (cache_status[i]) result++;
+    }
+    return result;
+}
+
 size_t
 cache_getmaxsize()
 {
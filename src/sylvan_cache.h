@@ -57,6 +57,12 @@ int cache_put(uint64_t a, uint64_t b, uint64_t c, uint64_t res);
 int cache_get6(uint64_t a, uint64_t b, uint64_t c, uint64_t d, uint64_t e, uint64_t f, uint64_t *res1, uint64_t *res2);
 int cache_put6(uint64_t a, uint64_t b, uint64_t c, uint64_t d, uint64_t e, uint64_t f, uint64_t res1, uint64_t res2);
 
+/**
+ * Prefetch the cache bucket (and its status) for key a,b,c, without reading it.
+ * Used by the recursive operations to hide the latency of the cache lookup of a subcall.
+ */
+void cache_prefetch(uint64_t a, uint64_t b, uint64_t c);
+
 /**
  * Helper function to get next 'operation id' (during initialization of modules)
  */
@@ -71,6 +77,15 @@ cache_get3(uint64_t opid, uint64_t dd, uint64_t d2, uint64_t d3, uint64_t *res)
     return cache_get(dd | opid, d2, d3, res);
 }
 
+/**
+ * dd must be MTBDD, d2/d3 can be anything
+ */
+static inline void __attribute__((unused))
+cache_prefetch3(uint64_t opid, uint64_t dd, uint64_t d2, uint64_t d3)
+{
+    cache_prefetch(dd | opid, d2, d3);
+}
+
 /**
  * dd/dd2/dd3/dd4 must be MTBDDs
  */
@@ -119,6 +134,11 @@ void cache_setsize(size_t size);
 
 size_t cache_getused(void);
 
+/**
+ * Count the used cache buckets while operations may be running (approximate).
+ */
+size_t cache_getused_approx(void);
+
 size_t cache_getsize(void);
 
 size_t cache_getmaxsize(void);
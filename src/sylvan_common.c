@@ -17,6 +17,8 @@
 
 #include <sylvan_int.h>
 
+#include <string.h> // for memset
+
 /**
  * Implementation of garbage collection
  */
@@ -56,6 +58,7 @@ typedef struct gc_hook_entry
 {
     struct gc_hook_entry *next;
     gc_hook_cb cb;
+    int id;
 } * gc_hook_entry_t;
 
 static gc_hook_entry_t mark_list;
@@ -81,13 +84,51 @@ sylvan_gc_hook_postgc(gc_hook_cb callback)
     postgc_list = e;
 }
 
+/**
+ * Timing information of garbage collection
+ */
+static sylvan_gc_info_t gc_info;
+static int mark_count = 0;
+
 void
-sylvan_gc_add_mark(gc_hook_cb callback)
+sylvan_gc_add_mark_named(gc_hook_cb callback, const char *name)
 {
     gc_hook_entry_t e = (gc_hook_entry_t)malloc(sizeof(struct gc_hook_entry));
     e->cb = callback;
+    e->id = mark_count++;
     e->next = mark_list;
     mark_list = e;
+    if (e->id < SYLVAN_GC_MAX_MARKS) {
+        gc_info.marks[e->id].name = name;
+        gc_info.marks[e->id].time = 0;
+        gc_info.marks[e->id].total = 0;
+        gc_info.mark_count = e->id + 1;
+    }
+}
+
+void
+sylvan_gc_add_mark(gc_hook_cb callback)
+{
+    sylvan_gc_add_mark_named(callback, NULL);
+}
+
+void
+sylvan_gc_get_info(sylvan_gc_info_t *info)
+{
+    *info = gc_info;
+}
+
+/**
+ * Record the time of a phase of garbage collection; returns the end time of the phase.
+ */
+static inline uint64_t
+gc_phase_done(size_t timer, uint64_t *target, uint64_t start)
+{
+    uint64_t now = getabstime();
+    *target = now - start;
+    sylvan_timer_add(timer, now - start);
+    if (sylvan_trace_active) sylvan_trace_record('X', sylvan_stats_timer_name(timer), start, now - start);
+    return now;
 }
 
 void
@@ -101,7 +142,9 @@ sylvan_gc_hook_main(gc_hook_cb callback)
  */
 VOID_TASK_IMPL_0(sylvan_clear_cache)
 {
-   cache_clear();
+    uint64_t t = sylvan_trace_now();
+    cache_clear();
+    sylvan_trace_complete("sylvan_clear_cache", t);
 }
 
 /**
@@ -113,28 +156,51 @@ VOID_TASK_IMPL_0(sylvan_clear_cache)
  */
 VOID_TASK_IMPL_0(sylvan_clear_and_mark)
 {
+    uint64_t t = getabstime();
+
     llmsset_clear_data(nodes);
+    t = gc_phase_done(SYLVAN_GC_CLEAR_DATA, &gc_info.time_clear_data, t);
 
+    uint64_t t_mark = t;
     for (gc_hook_entry_t e = mark_list; e != NULL; e = e->next) {
         WRAP(e->cb);
+        uint64_t now = getabstime();
+        if (e->id < SYLVAN_GC_MAX_MARKS) {
+            gc_info.marks[e->id].time = now - t;
+            gc_info.marks[e->id].total += now - t;
+            if (sylvan_trace_active && gc_info.marks[e->id].name != NULL) {
+                sylvan_trace_record('X', gc_info.marks[e->id].name, t, now - t);
+            }
+        }
+        t = now;
     }
+    t = gc_phase_done(SYLVAN_GC_MARK, &gc_info.time_mark, t_mark);
 
     llmsset_destroy_unmarked(nodes);
+    gc_phase_done(SYLVAN_GC_DESTROY, &gc_info.time_destroy, t);
 }
 
 /**
  * Clear the hash array of the nodes table and rehash all marked buckets.
+ * Returns the number of rehashed buckets, i.e., the nodes kept.
  */
-VOID_TASK_IMPL_0(sylvan_rehash_all)
+TASK_0(size_t, sylvan_rehash_kept)
 {
     // clear hash array
     llmsset_clear_hashes(nodes);
 
     // rehash marked nodes
-    if (llmsset_rehash(nodes) != 0) {
+    size_t kept;
+    if (llmsset_rehash_count(nodes, &kept) != 0) {
         fprintf(stderr, "sylvan_gc_rehash error: not all nodes could be rehashed!\n");
         exit(1);
     }
+    return kept;
+}
+
+VOID_TASK_IMPL_0(sylvan_rehash_all)
+{
+    CALL(sylvan_rehash_kept);
 }
 
 /**
@@ -212,15 +278,24 @@ VOID_TASK_IMPL_0(sylvan_gc_normal_resize)
 /**
  * Actual implementation of garbage collection
  */
-VOID_TASK_0(sylvan_gc_go)
+VOID_TASK_IMPL_0(sylvan_gc_go)
 {
     sylvan_stats_count(SYLVAN_GC_COUNT);
-    sylvan_timer_start(SYLVAN_GC);
+    const uint64_t t_start = getabstime();
+
+    gc_info.count++;
+    // counting the filled buckets is a scan of the entire table, only done for the statistics
+    gc_info.nodes_before = sylvan_stats_active ? llmsset_count_marked(nodes) : 0;
+    gc_info.nodes_after = 0;
+    gc_info.time_clear_cache = gc_info.time_clear_data = gc_info.time_mark = 0;
+    gc_info.time_destroy = gc_info.time_resize = gc_info.time_rehash = 0;
+    gc_info.time_postgc = gc_info.time_total = 0;
 
     // call pre gc hooks
     for (gc_hook_entry_t e = pregc_list; e != NULL; e = e->next) {
         WRAP(e->cb);
     }
+    uint64_t t = gc_phase_done(SYLVAN_GC_HOOKS, &gc_info.time_pregc, t_start);
 
     /*
      * This simply clears the cache.
@@ -228,20 +303,35 @@ VOID_TASK_0(sylvan_gc_go)
      * where part of the cache is cleared and part is marked
      */
     CALL(sylvan_clear_cache);
+    t = gc_phase_done(SYLVAN_GC_CLEAR_CACHE, &gc_info.time_clear_cache, t);
 
     CALL(sylvan_clear_and_mark);
+    t = getabstime();
 
     // call hooks for resizing and all that
     WRAP(main_hook);
+    t = gc_phase_done(SYLVAN_GC_RESIZE, &gc_info.time_resize, t);
 
-    CALL(sylvan_rehash_all);
+    gc_info.nodes_after = CALL(sylvan_rehash_kept);
+    t = gc_phase_done(SYLVAN_GC_REHASH, &gc_info.time_rehash, t);
 
     // call post gc hooks
     for (gc_hook_entry_t e = postgc_list; e != NULL; e = e->next) {
         WRAP(e->cb);
     }
-
-    sylvan_timer_stop(SYLVAN_GC);
+    gc_phase_done(SYLVAN_GC_HOOKS, &gc_info.time_postgc, t);
+
+    // the entire pause, also in the histogram
+    gc_phase_done(SYLVAN_GC, &gc_info.time_total, t_start);
+    uint64_t us = gc_info.time_total / 1000;
+    int bucket = us == 0 ? 0 : 63 - __builtin_clzll(us);
+    if (bucket >= SYLVAN_GC_HISTOGRAM_SIZE) bucket = SYLVAN_GC_HISTOGRAM_SIZE - 1;
+    gc_info.histogram[bucket]++;
+
+    // the table sizes (which may have changed) and the number of nodes, for the trace
+    sylvan_trace_counter("nodes_table_size", llmsset_get_size(nodes));
+    sylvan_trace_counter("cache_size", cache_getsize());
+    sylvan_trace_counter("nodes", gc_info.nodes_after);
 }
 
 /**
@@ -262,6 +352,30 @@ VOID_TASK_IMPL_0(sylvan_gc)
     }
 }
 
+VOID_TASK_2(sylvan_gc_exclusive_go, sylvan_exclusive_cb, cb, void*, context)
+{
+    WRAP(cb, context);
+}
+
+TASK_IMPL_2(int, sylvan_gc_exclusive, sylvan_exclusive_cb, cb, void*, context)
+{
+    if (!gc_enabled) return 0;
+    for (;;) {
+        int zero = 0;
+        if (atomic_compare_exchange_strong(&gc, &zero, 1)) {
+            NEWFRAME(sylvan_gc_exclusive_go, cb, context);
+            gc = 0;
+            return 1;
+        }
+        /* help with the garbage collection that is running, then try again */
+        while (atomic_load_explicit(&gc, memory_order_relaxed) != 0 &&
+               atomic_load_explicit(&lace_newframe.t, memory_order_relaxed) == 0) {}
+        if (atomic_load_explicit(&lace_newframe.t, memory_order_relaxed) != 0) {
+            lace_yield(__lace_worker, __lace_dq_head);
+        }
+    }
+}
+
 /**
  * The unique table
  */
@@ -423,9 +537,12 @@ sylvan_quit()
         mark_list = e->next;
         free(e);
     }
+    mark_count = 0;
+    memset(&gc_info, 0, sizeof(gc_info));
 
     cache_free();
     llmsset_free(nodes);
+    nodes = NULL;
 }
 
 /**
@@ -439,3 +556,20 @@ VOID_TASK_IMPL_2(sylvan_table_usage, size_t*, filled, size_t*, total)
 }
 
 
+
+/**
+ * Sequential cut-off level; by default, operations always spawn
+ */
+uint32_t sylvan_seqcutoff = 0xffffffff;
+
+void
+sylvan_set_seqcutoff(uint32_t level)
+{
+    sylvan_seqcutoff = level;
+}
+
+uint32_t
+sylvan_get_seqcutoff()
+{
+    return sylvan_seqcutoff;
+}
@@ -91,6 +91,22 @@ void sylvan_register_quit(quit_cb cb);
 VOID_TASK_DECL_2(sylvan_table_usage, size_t*, size_t*);
 #define sylvan_table_usage(filled, total) (RUN(sylvan_table_usage, filled, total))
 
+/**
+ * Set the sequential cut-off level for the parallel operations.
+ *
+ * Recursive operations spawn one of their two subproblems as a Lace task at every node.
+ * Near the bottom of the decision diagram the subproblems are so small that the cost of
+ * spawning, synchronizing and maintaining the refs stacks dominates the actual work.
+ * Subproblems whose top variable is at or below the cut-off level are computed by plain
+ * sequential recursion instead. For LDDs the level is the depth relative to the root of
+ * the operation.
+ *
+ * For example, with 100 variables, a cut-off of 90 computes the bottom 10 levels sequentially.
+ * The default value is 0xffffffff, i.e., always spawn.
+ */
+void sylvan_set_seqcutoff(uint32_t level);
+uint32_t sylvan_get_seqcutoff(void);
+
 /**
  * GARBAGE COLLECTION
  *
@@ -168,6 +184,22 @@ VOID_TASK_DECL_0(sylvan_clear_and_mark);
 VOID_TASK_DECL_0(sylvan_rehash_all);
 #define sylvan_rehash_all() RUN(sylvan_rehash_all)
 
+/**
+ * Perform garbage collection (all steps above) without starting a new frame.
+ * Only call this from a task started with sylvan_gc_exclusive.
+ */
+VOID_TASK_DECL_0(sylvan_gc_go);
+
+/**
+ * Run the task <cb> with <context> in a new frame, like garbage collection: no operations run
+ * while <cb> executes, and it is not executed concurrently with garbage collection. The task
+ * may use all workers, and may call sylvan_gc_go.
+ * Returns 0 (and does not run <cb>) if garbage collection is disabled, 1 otherwise.
+ */
+LACE_TYPEDEF_CB(void, sylvan_exclusive_cb, void*);
+TASK_DECL_2(int, sylvan_gc_exclusive, sylvan_exclusive_cb, void*);
+#define sylvan_gc_exclusive(cb, context) RUN(sylvan_gc_exclusive, cb, context)
+
 /**
  * Callback type
  */
@@ -201,6 +233,52 @@ void sylvan_gc_hook_main(gc_hook_cb callback);
  */
 void sylvan_gc_add_mark(gc_hook_cb mark_cb);
 
+/**
+ * Add a marking mechanism with a name, which identifies the callback in sylvan_gc_get_info.
+ */
+void sylvan_gc_add_mark_named(gc_hook_cb mark_cb, const char *name);
+
+/**
+ * Information on garbage collection, for example to find out where a long pause went.
+ *
+ * The per-gc fields describe the current garbage collection when read from a pre or post gc
+ * hook (only nodes_before is known in a pre gc hook; time_postgc and time_total are only
+ * known afterwards), otherwise the last garbage collection. Times are in ns.
+ * The same phases are also accumulated in the statistics timers (SYLVAN_GC_CLEAR_DATA, ...)
+ * while statistics are enabled. Counting nodes_before costs a scan of the nodes table, so it
+ * is only counted while statistics are enabled (otherwise it is 0).
+ */
+#define SYLVAN_GC_MAX_MARKS 16
+#define SYLVAN_GC_HISTOGRAM_SIZE 32
+
+typedef struct sylvan_gc_info
+{
+    uint64_t count;                 // number of garbage collections so far
+    size_t nodes_before;            // filled buckets of the nodes table before garbage collection
+    size_t nodes_after;             // nodes kept by garbage collection
+    uint64_t time_pregc;            // pre gc hooks
+    uint64_t time_clear_cache;      // clearing the operation cache
+    uint64_t time_clear_data;       // clearing the data part of the nodes table
+    uint64_t time_mark;             // all marking callbacks
+    uint64_t time_destroy;          // destroying unmarked custom leaves
+    uint64_t time_resize;           // the main gc hook (resizing)
+    uint64_t time_rehash;           // clearing the hashes and rehashing the kept nodes
+    uint64_t time_postgc;           // post gc hooks
+    uint64_t time_total;            // the entire pause
+    int mark_count;                 // number of marking callbacks in <marks>
+    struct {
+        const char *name;           // name given to sylvan_gc_add_mark_named, or NULL
+        uint64_t time;              // time of this callback in the current or last gc
+        uint64_t total;             // time of this callback in all gcs
+    } marks[SYLVAN_GC_MAX_MARKS];   // in order of registration (only the first SYLVAN_GC_MAX_MARKS)
+    uint64_t histogram[SYLVAN_GC_HISTOGRAM_SIZE]; // bucket i counts pauses of [2^i, 2^(i+1)) us
+} sylvan_gc_info_t;
+
+/**
+ * Obtain a copy of the garbage collection information.
+ */
+void sylvan_gc_get_info(sylvan_gc_info_t *info);
+
 /**
  * One of the hooks for resizing behavior.
  * Default if SYLVAN_AGGRESSIVE_RESIZE is set.
@@ -19,7 +19,7 @@
 #define SYLVAN_SIZE_FIBONACCI 0
 #endif
 
-/* Enable/disable counters and timers */
+/* Default state of counters and timers (can be switched at runtime with sylvan_stats_enable) */
 #ifndef SYLVAN_STATS
 #define SYLVAN_STATS 0
 #endif
@@ -29,6 +29,11 @@
 #define SYLVAN_USE_MMAP 0
 #endif
 
+/* Enable/disable software prefetching of nodes and cache buckets in recursive operations */
+#ifndef SYLVAN_PREFETCH
+#define SYLVAN_PREFETCH 1
+#endif
+
 /* Aggressive or conservative resizing strategy */
 #ifndef SYLVAN_AGGRESSIVE_RESIZE
 #define SYLVAN_AGGRESSIVE_RESIZE 1
@@ -98,6 +98,14 @@ gmp_destroy(uint64_t val)
     free((void*)val);
 }
 
+static size_t
+gmp_size(uint64_t val)
+{
+    /* The struct made by gmp_create and the limbs of its numerator and denominator */
+    mpq_ptr x = (mpq_ptr)val;
+    return sizeof(__mpq_struct) + sizeof(mp_limb_t) * (mpq_numref(x)->_mp_alloc + mpq_denref(x)->_mp_alloc);
+}
+
 static char*
 gmp_to_str(int comp, uint64_t val, char *buf, size_t buflen)
 {
@@ -158,6 +166,7 @@ gmp_init()
     sylvan_mt_set_to_str(gmp_type, gmp_to_str);
     sylvan_mt_set_write_binary(gmp_type, gmp_write_binary);
     sylvan_mt_set_read_binary(gmp_type, gmp_read_binary);
+    sylvan_mt_set_size(gmp_type, gmp_size);
 }
 
 /**
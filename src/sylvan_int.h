@@ -46,6 +46,13 @@ extern "C" {
  */
 extern llmsset_t nodes;
 
+/**
+ * Sequential cut-off level (see sylvan_set_seqcutoff)
+ * Operations use sylvan_seqcutoff_reached(level) to decide whether to spawn.
+ */
+extern uint32_t sylvan_seqcutoff;
+#define sylvan_seqcutoff_reached(level) ((uint32_t)(level) >= sylvan_seqcutoff)
+
 /**
  * Macros for all operation identifiers for the operation cache
  */
@@ -69,6 +76,11 @@ static const uint64_t CACHE_BDD_ISBDD               = (14LL<<40);
 static const uint64_t CACHE_BDD_SUPPORT             = (15LL<<40);
 static const uint64_t CACHE_BDD_PATHCOUNT           = (16LL<<40);
 static const uint64_t CACHE_BDD_DISJOINT            = (17LL<<40);
+static const uint64_t CACHE_BDD_AND_N               = (18LL<<40);
+static const uint64_t CACHE_BDD_REACH_SAT           = (19LL<<40);
+static const uint64_t CACHE_BDD_RELNEXT_MAP         = (31LL<<40);
+static const uint64_t CACHE_BDD_RELPREV_MAP         = (32LL<<40);
+static const uint64_t CACHE_BDD_RENAME              = (33LL<<40);
 
 // MDD operations
 static const uint64_t CACHE_MDD_RELPROD             = (20LL<<40);
@@ -101,6 +113,7 @@ static const uint64_t CACHE_MTBDD_LESS              = (53LL<<40);
 static const uint64_t CACHE_MTBDD_GEQ               = (54LL<<40);
 static const uint64_t CACHE_MTBDD_GREATER           = (55LL<<40);
 static const uint64_t CACHE_MTBDD_EVAL_COMPOSE      = (56LL<<40);
+static const uint64_t CACHE_MTBDD_RENAME            = (57LL<<40);
 
 // ZDD operations
 static const uint64_t CACHE_ZDD_FROM_MTBDD          = (80LL<<40);
@@ -118,6 +131,12 @@ static const uint64_t CACHE_ZDD_PROJECT             = (91LL<<40);
 static const uint64_t CACHE_ZDD_ISOP                = (92LL<<40);
 static const uint64_t CACHE_ZDD_COVER_TO_BDD        = (93LL<<40);
 
+/**
+ * Called by the modules whose nodes dynamic variable reordering cannot handle (LDDs, ZDDs).
+ * Afterwards, sylvan_reorder and sylvan_varswap refuse to reorder, until sylvan_quit.
+ */
+void sylvan_reorder_unsupported(const char *module);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -65,9 +65,21 @@ lddmc_deref(MDD a)
     refs_down(&lddmc_refs, a);
 }
 
+/* Apply the deferred reference updates of all workers (in a new frame, so no worker updates them) */
+VOID_TASK_0(lddmc_refs_flush_go)
+{
+    refs_flush(&lddmc_refs);
+}
+
+VOID_TASK_0(lddmc_refs_flush)
+{
+    NEWFRAME(lddmc_refs_flush_go);
+}
+
 size_t
 lddmc_count_refs()
 {
+    RUN(lddmc_refs_flush);
     return refs_count(&lddmc_refs);
 }
 
@@ -80,12 +92,14 @@ lddmc_protect(MDD *a)
         lddmc_protected_created = 1;
     }
     protect_up(&lddmc_protected, (size_t)a);
+    if (sylvan_record_active) sylvan_record_protect(a, 1, 1);
 }
 
 void
 lddmc_unprotect(MDD *a)
 {
     if (lddmc_protected.refs_table != NULL) protect_down(&lddmc_protected, (size_t)a);
+    if (sylvan_record_active) sylvan_record_protect(a, 1, 0);
 }
 
 size_t
@@ -97,7 +111,9 @@ lddmc_count_protected(void)
 /* Called during garbage collection */
 VOID_TASK_0(lddmc_gc_mark_external_refs)
 {
+    // apply the deferred updates of all workers, then
     // iterate through refs hash table, mark all found
+    refs_flush(&lddmc_refs);
     size_t count=0;
     uint64_t *it = refs_iter(&lddmc_refs, 0, lddmc_refs.refs_size);
     while (it != NULL) {
@@ -214,6 +230,7 @@ lddmc_refs_init_key(void)
     s->rend = s->rbegin + 1024;
     s->scur = s->sbegin = (lddmc_refs_task_t)malloc(sizeof(struct lddmc_refs_task) * 1024);
     s->send = s->sbegin + 1024;
+    sylvan_memory_add(SYLVAN_MEM_REFS_STACKS, sizeof(struct lddmc_refs_internal) + (sizeof(MDD*) + sizeof(MDD) + sizeof(struct lddmc_refs_task)) * 1024);
     SET_THREAD_LOCAL(lddmc_refs_key, s);
 }
 
@@ -221,6 +238,10 @@ VOID_TASK_0(lddmc_refs_free)
 {
     LOCALIZE_THREAD_LOCAL(lddmc_refs_key, lddmc_refs_internal_t);
     if (lddmc_refs_key != NULL) {
+        sylvan_memory_sub(SYLVAN_MEM_REFS_STACKS, sizeof(struct lddmc_refs_internal)
+                + sizeof(MDD*) * (lddmc_refs_key->pend - lddmc_refs_key->pbegin)
+                + sizeof(MDD) * (lddmc_refs_key->rend - lddmc_refs_key->rbegin)
+                + sizeof(struct lddmc_refs_task) * (lddmc_refs_key->send - lddmc_refs_key->sbegin));
         free(lddmc_refs_key->pbegin);
         free(lddmc_refs_key->rbegin);
         free(lddmc_refs_key->sbegin);
@@ -238,7 +259,7 @@ VOID_TASK_0(lddmc_refs_init)
 {
     INIT_THREAD_LOCAL(lddmc_refs_key);
     TOGETHER(lddmc_refs_init_task);
-    sylvan_gc_add_mark(lddmc_refs_mark_CALL);
+    sylvan_gc_add_mark_named(lddmc_refs_mark_CALL, "lddmc_refs_mark");
 }
 
 void
@@ -246,6 +267,7 @@ lddmc_refs_ptrs_up(lddmc_refs_internal_t lddmc_refs_key)
 {
     size_t size = lddmc_refs_key->pend - lddmc_refs_key->pbegin;
     lddmc_refs_key->pbegin = (const MDD**)realloc(lddmc_refs_key->pbegin, sizeof(MDD*) * size * 2);
+    sylvan_memory_add(SYLVAN_MEM_REFS_STACKS, sizeof(MDD*) * size);
     lddmc_refs_key->pcur = lddmc_refs_key->pbegin + size;
     lddmc_refs_key->pend = lddmc_refs_key->pbegin + (size * 2);
 }
@@ -255,6 +277,7 @@ lddmc_refs_refs_up(lddmc_refs_internal_t lddmc_refs_key, MDD res)
 {
     long size = lddmc_refs_key->rend - lddmc_refs_key->rbegin;
     lddmc_refs_key->rbegin = (MDD*)realloc(lddmc_refs_key->rbegin, sizeof(MDD) * size * 2);
+    sylvan_memory_add(SYLVAN_MEM_REFS_STACKS, sizeof(MDD) * size);
     lddmc_refs_key->rcur = lddmc_refs_key->rbegin + size;
     lddmc_refs_key->rend = lddmc_refs_key->rbegin + (size * 2);
     return res;
@@ -265,6 +288,7 @@ lddmc_refs_tasks_up(lddmc_refs_internal_t lddmc_refs_key)
 {
     long size = lddmc_refs_key->send - lddmc_refs_key->sbegin;
     lddmc_refs_key->sbegin = (lddmc_refs_task_t)realloc(lddmc_refs_key->sbegin, sizeof(struct lddmc_refs_task) * size * 2);
+    sylvan_memory_add(SYLVAN_MEM_REFS_STACKS, sizeof(struct lddmc_refs_task) * size);
     lddmc_refs_key->scur = lddmc_refs_key->sbegin + size;
     lddmc_refs_key->send = lddmc_refs_key->sbegin + (size * 2);
 }
@@ -342,11 +366,13 @@ void
 sylvan_init_ldd(void)
 {
     sylvan_register_quit(lddmc_quit);
-    sylvan_gc_add_mark(lddmc_gc_mark_external_refs_CALL);
-    sylvan_gc_add_mark(lddmc_gc_mark_protected_CALL);
-    sylvan_gc_add_mark(lddmc_gc_mark_serialize_CALL);
+    sylvan_reorder_unsupported("LDDs");
+    sylvan_gc_add_mark_named(lddmc_gc_mark_external_refs_CALL, "lddmc_gc_mark_external_refs");
+    sylvan_gc_add_mark_named(lddmc_gc_mark_protected_CALL, "lddmc_gc_mark_protected");
+    sylvan_gc_add_mark_named(lddmc_gc_mark_serialize_CALL, "lddmc_gc_mark_serialize");
 
     refs_create(&lddmc_refs, 1024);
+    refs_defer(&lddmc_refs, lace_workers());
     if (!lddmc_protected_created) {
         protect_create(&lddmc_protected, 4096);
         lddmc_protected_created = 1;
@@ -512,7 +538,24 @@ match_ldds(MDD *one, MDD *two)
     return 1;
 }
 
-TASK_IMPL_2(MDD, lddmc_union, MDD, a, MDD, b)
+/**
+ * Prefetch the nodes and the cache bucket that the recursive call union(a,b) reads first.
+ */
+static inline void
+lddmc_union_prefetch(MDD a, MDD b)
+{
+    if (a == b || a <= lddmc_true || b <= lddmc_true) return;
+    LDD_PREFETCH(a);
+    LDD_PREFETCH(b);
+    if (a < b) cache_prefetch3(CACHE_MDD_UNION, b, a, 0);
+    else cache_prefetch3(CACHE_MDD_UNION, a, b, 0);
+}
+
+/**
+ * Implementation of union, with <depth> the distance to the root of the operation.
+ * When the sequential cut-off is reached, compute the <down> result without spawning.
+ */
+TASK_3(MDD, lddmc_union_rec, MDD, a, MDD, b, uint32_t, depth)
 {
     /* Terminal cases */
     if (a == b) return a;
@@ -544,32 +587,52 @@ TASK_IMPL_2(MDD, lddmc_union, MDD, a, MDD, b)
     const uint32_t na_value = mddnode_getvalue(na);
     const uint32_t nb_value = mddnode_getvalue(nb);
 
+    /* Prefetch the nodes and cache buckets of the recursive calls */
+    if ((na_copy && nb_copy) || (!na_copy && !nb_copy && na_value == nb_value)) {
+        lddmc_union_prefetch(mddnode_getdown(na), mddnode_getdown(nb));
+        lddmc_union_prefetch(mddnode_getright(na), mddnode_getright(nb));
+    }
+
     /* Perform recursive calculation */
     if (na_copy && nb_copy) {
-        lddmc_refs_spawn(SPAWN(lddmc_union, mddnode_getdown(na), mddnode_getdown(nb)));
-        MDD right = CALL(lddmc_union, mddnode_getright(na), mddnode_getright(nb));
-        lddmc_refs_push(right);
-        MDD down = lddmc_refs_sync(SYNC(lddmc_union));
-        lddmc_refs_pop(1);
+        MDD down, right;
+        if (sylvan_seqcutoff_reached(depth)) {
+            down = lddmc_refs_push(CALL(lddmc_union_rec, mddnode_getdown(na), mddnode_getdown(nb), depth+1));
+            right = CALL(lddmc_union_rec, mddnode_getright(na), mddnode_getright(nb), depth);
+            lddmc_refs_pop(1);
+        } else {
+            lddmc_refs_spawn(SPAWN(lddmc_union_rec, mddnode_getdown(na), mddnode_getdown(nb), depth+1));
+            right = CALL(lddmc_union_rec, mddnode_getright(na), mddnode_getright(nb), depth);
+            lddmc_refs_push(right);
+            down = lddmc_refs_sync(SYNC(lddmc_union_rec));
+            lddmc_refs_pop(1);
+        }
         result = lddmc_make_copynode(down, right);
     } else if (na_copy) {
-        MDD right = CALL(lddmc_union, mddnode_getright(na), b);
+        MDD right = CALL(lddmc_union_rec, mddnode_getright(na), b, depth);
         result = lddmc_make_copynode(mddnode_getdown(na), right);
     } else if (nb_copy) {
-        MDD right = CALL(lddmc_union, a, mddnode_getright(nb));
+        MDD right = CALL(lddmc_union_rec, a, mddnode_getright(nb), depth);
         result = lddmc_make_copynode(mddnode_getdown(nb), right);
     } else if (na_value < nb_value) {
-        MDD right = CALL(lddmc_union, mddnode_getright(na), b);
+        MDD right = CALL(lddmc_union_rec, mddnode_getright(na), b, depth);
         result = lddmc_makenode(na_value, mddnode_getdown(na), right);
     } else if (na_value == nb_value) {
-        lddmc_refs_spawn(SPAWN(lddmc_union, mddnode_getdown(na), mddnode_getdown(nb)));
-        MDD right = CALL(lddmc_union, mddnode_getright(na), mddnode_getright(nb));
-        lddmc_refs_push(right);
-        MDD down = lddmc_refs_sync(SYNC(lddmc_union));
-        lddmc_refs_pop(1);
+        MDD down, right;
+        if (sylvan_seqcutoff_reached(depth)) {
+            down = lddmc_refs_push(CALL(lddmc_union_rec, mddnode_getdown(na), mddnode_getdown(nb), depth+1));
+            right = CALL(lddmc_union_rec, mddnode_getright(na), mddnode_getright(nb), depth);
+            lddmc_refs_pop(1);
+        } else {
+            lddmc_refs_spawn(SPAWN(lddmc_union_rec, mddnode_getdown(na), mddnode_getdown(nb), depth+1));
+            right = CALL(lddmc_union_rec, mddnode_getright(na), mddnode_getright(nb), depth);
+            lddmc_refs_push(right);
+            down = lddmc_refs_sync(SYNC(lddmc_union_rec));
+            lddmc_refs_pop(1);
+        }
         result = lddmc_makenode(na_value, down, right);
     } else /* na_value > nb_value */ {
-        MDD right = CALL(lddmc_union, a, mddnode_getright(nb));
+        MDD right = CALL(lddmc_union_rec, a, mddnode_getright(nb), depth);
         result = lddmc_makenode(nb_value, mddnode_getdown(nb), right);
     }
 
@@ -579,6 +642,11 @@ TASK_IMPL_2(MDD, lddmc_union, MDD, a, MDD, b)
     return result;
 }
 
+TASK_IMPL_2(MDD, lddmc_union, MDD, a, MDD, b)
+{
+    return CALL(lddmc_union_rec, a, b, 0);
+}
+
 TASK_IMPL_2(MDD, lddmc_minus, MDD, a, MDD, b)
 {
     /* Terminal cases */
@@ -1934,35 +2002,34 @@ lddmc_nodecount_levels(MDD mdd, size_t *variables)
 
 /**
  * Count number of nodes in MDD
+ * Nodes are claimed in an external visited set, so the nodes themselves are not modified.
+ * The right chain is followed iteratively (it can be long), spawning a task for each down edge.
  */
 
-static size_t
-lddmc_nodecount_mark(MDD mdd)
-{
-    if (mdd <= lddmc_true) return 0;
-    mddnode_t n = LDD_GETNODE(mdd);
-    if (mddnode_getmark(n)) return 0;
-    mddnode_setmark(n, 1);
-    return 1 + lddmc_nodecount_mark(mddnode_getdown(n)) + lddmc_nodecount_mark(mddnode_getright(n));
-}
-
-static void
-lddmc_nodecount_unmark(MDD mdd)
+TASK_2(size_t, lddmc_nodecount_par, MDD, mdd, llmsset_visited_t, visited)
 {
-    if (mdd <= lddmc_true) return;
-    mddnode_t n = LDD_GETNODE(mdd);
-    if (mddnode_getmark(n)) {
-        mddnode_setmark(n, 0);
-        lddmc_nodecount_unmark(mddnode_getright(n));
-        lddmc_nodecount_unmark(mddnode_getdown(n));
+    size_t result = 0;
+    int count = 0;
+    while (mdd > lddmc_true) {
+        if (!llmsset_visited_add(visited, mdd)) break;
+        result++;
+        mddnode_t n = LDD_GETNODE(mdd);
+        MDD down = mddnode_getdown(n);
+        if (down > lddmc_true) {
+            SPAWN(lddmc_nodecount_par, down, visited);
+            count++;
+        }
+        mdd = mddnode_getright(n);
     }
+    while (count--) result += SYNC(lddmc_nodecount_par);
+    return result;
 }
 
-size_t
-lddmc_nodecount(MDD mdd)
+TASK_IMPL_1(size_t, lddmc_nodecount, MDD, mdd)
 {
-    size_t result = lddmc_nodecount_mark(mdd);
-    lddmc_nodecount_unmark(mdd);
+    llmsset_visited_t visited = llmsset_visited_create(nodes);
+    size_t result = CALL(lddmc_nodecount_par, mdd, visited);
+    llmsset_visited_free(visited);
     return result;
 }
 
@@ -2462,6 +2529,16 @@ static avl_node_t *lddmc_ser_reversed_set = NULL;
 static size_t lddmc_ser_counter = 2;
 static size_t lddmc_ser_done = 0;
 
+// Number of entries in both sets, for the memory accounting
+static size_t lddmc_ser_entries = 0;
+
+static inline void
+lddmc_ser_account(size_t inserted)
+{
+    lddmc_ser_entries += inserted;
+    sylvan_memory_add(SYLVAN_MEM_SERIALIZE, inserted * (sizeof(avl_node_t) + sizeof(struct lddmc_ser)));
+}
+
 // Given a MDD, assign unique numbers to all nodes
 static size_t
 lddmc_serialize_assign_rec(MDD mdd)
@@ -2487,6 +2564,7 @@ lddmc_serialize_assign_rec(MDD mdd)
 
         // put a copy in the reversed table
         lddmc_ser_reversed_insert(&lddmc_ser_reversed_set, ss);
+        lddmc_ser_account(2);
     }
 
     return ss->assigned;
@@ -2505,6 +2583,8 @@ lddmc_serialize_reset()
     lddmc_ser_free(&lddmc_ser_reversed_set);
     lddmc_ser_counter = 2;
     lddmc_ser_done = 0;
+    sylvan_memory_sub(SYLVAN_MEM_SERIALIZE, lddmc_ser_entries * (sizeof(avl_node_t) + sizeof(struct lddmc_ser)));
+    lddmc_ser_entries = 0;
 }
 
 size_t
@@ -2620,8 +2700,8 @@ lddmc_serialize_fromfile(FILE *in)
         s.assigned = lddmc_ser_done+2; // starts at 0 but we want 2-based...
         lddmc_ser_done++;
 
-        lddmc_ser_insert(&lddmc_ser_set, &s);
-        lddmc_ser_reversed_insert(&lddmc_ser_reversed_set, &s);
+        lddmc_ser_account(lddmc_ser_insert(&lddmc_ser_set, &s));
+        lddmc_ser_account(lddmc_ser_reversed_insert(&lddmc_ser_reversed_set, &s));
     }
 }
 
@@ -103,19 +103,19 @@ size_t lddmc_test_ismdd(MDD mdd);
 
 /* Operations for model checking */
 TASK_DECL_2(MDD, lddmc_union, MDD, MDD);
-#define lddmc_union(a, b) RUN(lddmc_union, a, b)
+#define lddmc_union(a, b) SYLVAN_RECORD_RUN2(SYLVAN_RECORD_LDD_UNION, MDD, lddmc_union, a, b)
 
 TASK_DECL_2(MDD, lddmc_minus, MDD, MDD);
-#define lddmc_minus(a, b) RUN(lddmc_minus, a, b)
+#define lddmc_minus(a, b) SYLVAN_RECORD_RUN2(SYLVAN_RECORD_LDD_MINUS, MDD, lddmc_minus, a, b)
 
 TASK_DECL_3(MDD, lddmc_zip, MDD, MDD, MDD*);
 #define lddmc_zip(a, b, res) RUN(lddmc_zip, a, b, res)
 
 TASK_DECL_2(MDD, lddmc_intersect, MDD, MDD);
-#define lddmc_intersect(a, b) RUN(lddmc_intersect, a, b)
+#define lddmc_intersect(a, b) SYLVAN_RECORD_RUN2(SYLVAN_RECORD_LDD_INTERSECT, MDD, lddmc_intersect, a, b)
 
 TASK_DECL_3(MDD, lddmc_match, MDD, MDD, MDD);
-#define lddmc_match(a, b, proj) RUN(lddmc_match, a, b, proj)
+#define lddmc_match(a, b, proj) SYLVAN_TRACE_RUN(MDD, lddmc_match, a, b, proj)
 
 MDD lddmc_union_cube(MDD a, uint32_t* values, size_t count);
 int lddmc_member_cube(MDD a, uint32_t* values, size_t count);
@@ -126,10 +126,10 @@ int lddmc_member_cube_copy(MDD a, uint32_t* values, int* copy, size_t count);
 MDD lddmc_cube_copy(uint32_t* values, int* copy, size_t count);
 
 TASK_DECL_3(MDD, lddmc_relprod, MDD, MDD, MDD);
-#define lddmc_relprod(a, b, proj) RUN(lddmc_relprod, a, b, proj)
+#define lddmc_relprod(a, b, proj) SYLVAN_RECORD_RUN3(SYLVAN_RECORD_LDD_RELPROD, MDD, lddmc_relprod, a, b, proj)
 
 TASK_DECL_4(MDD, lddmc_relprod_union, MDD, MDD, MDD, MDD);
-#define lddmc_relprod_union(a, b, meta, un) RUN(lddmc_relprod_union, a, b, meta, un)
+#define lddmc_relprod_union(a, b, meta, un) SYLVAN_RECORD_RUN4(SYLVAN_RECORD_LDD_RELPROD_UNION, MDD, lddmc_relprod_union, a, b, meta, un)
 
 /**
  * Calculate all predecessors to a in uni according to rel[proj]
@@ -137,17 +137,17 @@ TASK_DECL_4(MDD, lddmc_relprod_union, MDD, MDD, MDD, MDD);
  * i.e. 0 (not in rel), 1 (read+write), 2 (read), 3 (write), -1 (end; rest=0)
  */
 TASK_DECL_4(MDD, lddmc_relprev, MDD, MDD, MDD, MDD);
-#define lddmc_relprev(a, rel, proj, uni) RUN(lddmc_relprev, a, rel, proj, uni)
+#define lddmc_relprev(a, rel, proj, uni) SYLVAN_TRACE_RUN(MDD, lddmc_relprev, a, rel, proj, uni)
 
 // so: proj: -2 (end; quantify rest), -1 (end; keep rest), 0 (quantify), 1 (keep)
 TASK_DECL_2(MDD, lddmc_project, MDD, MDD);
-#define lddmc_project(mdd, proj) RUN(lddmc_project, mdd, proj)
+#define lddmc_project(mdd, proj) SYLVAN_TRACE_RUN(MDD, lddmc_project, mdd, proj)
 
 TASK_DECL_3(MDD, lddmc_project_minus, MDD, MDD, MDD);
-#define lddmc_project_minus(mdd, proj, avoid) RUN(lddmc_project_minus, mdd, proj, avoid)
+#define lddmc_project_minus(mdd, proj, avoid) SYLVAN_TRACE_RUN(MDD, lddmc_project_minus, mdd, proj, avoid)
 
 TASK_DECL_4(MDD, lddmc_join, MDD, MDD, MDD, MDD);
-#define lddmc_join(a, b, a_proj, b_proj) RUN(lddmc_join, a, b, a_proj, b_proj)
+#define lddmc_join(a, b, a_proj, b_proj) SYLVAN_TRACE_RUN(MDD, lddmc_join, a, b, a_proj, b_proj)
 
 /* Write a DOT representation */
 void lddmc_printdot(MDD mdd);
@@ -176,7 +176,7 @@ TASK_DECL_1(lddmc_satcount_double_t, lddmc_satcount_cached, MDD);
 #define lddmc_satcount_cached(mdd) RUN(lddmc_satcount_cached, mdd)
 
 TASK_DECL_1(long double, lddmc_satcount, MDD);
-#define lddmc_satcount(mdd) RUN(lddmc_satcount, mdd)
+#define lddmc_satcount(mdd) SYLVAN_TRACE_RUN(double, lddmc_satcount, mdd)
 
 /**
  * A callback for enumerating functions like sat_all_par, collect and match
@@ -225,7 +225,13 @@ VOID_TASK_DECL_4(lddmc_visit_par, MDD, lddmc_visit_callbacks_t*, size_t, void*);
 VOID_TASK_DECL_4(lddmc_visit_seq, MDD, lddmc_visit_callbacks_t*, size_t, void*);
 #define lddmc_visit_seq(mdd, cbs, ctx_size, context) RUN(lddmc_visit_seq, mdd, cbs, ctx_size, context);
 
-size_t lddmc_nodecount(MDD mdd);
+/**
+ * Count the number of nodes in the MDD.
+ * Counting is done in parallel and does not modify the nodes, so it is safe while other operations run.
+ */
+TASK_DECL_1(size_t, lddmc_nodecount, MDD);
+#define lddmc_nodecount(mdd) RUN(lddmc_nodecount, mdd)
+
 void lddmc_nodecount_levels(MDD mdd, size_t *variables);
 
 /**
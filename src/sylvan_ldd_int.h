@@ -40,6 +40,12 @@ LDD_GETNODE(MDD mdd)
     return ((mddnode_t)llmsset_index_to_ptr(nodes, mdd));
 }
 
+static inline void __attribute__((unused))
+LDD_PREFETCH(MDD mdd)
+{
+    llmsset_prefetch(nodes, mdd);
+}
+
 static inline uint32_t __attribute__((unused))
 mddnode_getvalue(mddnode_t n)
 {
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2011-2016 Formal Methods and Tools, University of Twente
+ * Copyright 2016-2017 Tom van Dijk, Johannes Kepler University Linz
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sylvan_int.h>
+
+#include <inttypes.h>
+
+_Atomic(size_t) sylvan_memory_allocated[SYLVAN_MEM_COUNTER];
+
+static const char* sylvan_memory_names[SYLVAN_MEM_COUNTER] = {
+    [SYLVAN_MEM_NODES] = "nodes",
+    [SYLVAN_MEM_CACHE] = "cache",
+    [SYLVAN_MEM_REFS] = "refs",
+    [SYLVAN_MEM_REFS_STACKS] = "refs_stacks",
+    [SYLVAN_MEM_SKIPLIST] = "skiplist",
+    [SYLVAN_MEM_SERIALIZE] = "serialize",
+    [SYLVAN_MEM_LEAVES] = "leaves",
+    [SYLVAN_MEM_INSTRUMENTATION] = "instrumentation",
+};
+
+void
+sylvan_memory_add(int subsystem, size_t bytes)
+{
+    atomic_fetch_add_explicit(&sylvan_memory_allocated[subsystem], bytes, memory_order_relaxed);
+}
+
+void
+sylvan_memory_sub(int subsystem, size_t bytes)
+{
+    atomic_fetch_sub_explicit(&sylvan_memory_allocated[subsystem], bytes, memory_order_relaxed);
+}
+
+const char*
+sylvan_memory_name(int subsystem)
+{
+    if (subsystem < 0 || subsystem >= SYLVAN_MEM_COUNTER) return NULL;
+    return sylvan_memory_names[subsystem];
+}
+
+/**
+ * Bytes per bucket of the nodes table: 8 for the hash table, 16 for the data,
+ * and 2 bits (bitmap2 and bitmapc) plus 1 bit per 512 buckets (bitmap1) of bitmaps.
+ */
+static size_t
+nodes_bytes(size_t buckets)
+{
+    return buckets * 24 + buckets / 4 + buckets / 4096;
+}
+
+void
+sylvan_memory_usage(sylvan_memory_t *target)
+{
+    for (int i=0; i<SYLVAN_MEM_COUNTER; i++) {
+        size_t bytes = atomic_load_explicit(&sylvan_memory_allocated[i], memory_order_relaxed);
+        target->committed[i] = target->reserved[i] = bytes;
+    }
+
+    if (nodes != NULL) {
+        target->committed[SYLVAN_MEM_NODES] = nodes_bytes(llmsset_get_size(nodes));
+        target->reserved[SYLVAN_MEM_NODES] = nodes_bytes(llmsset_get_max_size(nodes));
+        // cache buckets are 32 bytes of data and a 4-byte status field
+        target->committed[SYLVAN_MEM_CACHE] = 36 * cache_getsize();
+        target->reserved[SYLVAN_MEM_CACHE] = 36 * cache_getmaxsize();
+    }
+
+    target->committed_total = target->reserved_total = 0;
+    for (int i=0; i<SYLVAN_MEM_COUNTER; i++) {
+        target->committed_total += target->committed[i];
+        target->reserved_total += target->reserved[i];
+    }
+}
+
+static char*
+to_h(double size, char *buf)
+{
+    const char* units[] = {"B", "KB", "MB", "GB", "TB", "PB", "EB", "ZB", "YB"};
+    int i = 0;
+    for (;size>1024;size/=1024) i++;
+    sprintf(buf, "%.*f %s", i, size, units[i]);
+    return buf;
+}
+
+void
+sylvan_memory_report(FILE *target)
+{
+    sylvan_memory_t mem;
+    sylvan_memory_usage(&mem);
+
+    char buf[32], buf2[32];
+    fprintf(target, "Sylvan memory usage\n");
+    fprintf(target, "%-20s %16s %16s\n", "", "committed", "reserved");
+    for (int i=0; i<SYLVAN_MEM_COUNTER; i++) {
+        fprintf(target, "%-20s %16s %16s\n", sylvan_memory_names[i], to_h(mem.committed[i], buf), to_h(mem.reserved[i], buf2));
+    }
+    fprintf(target, "%-20s %16s %16s\n", "total", to_h(mem.committed_total, buf), to_h(mem.reserved_total, buf2));
+
+    uint32_t types = sylvan_mt_type_count();
+    for (uint32_t t=0; t<types; t++) {
+        size_t leaves, bytes;
+        if (sylvan_mt_get_memory(t, &leaves, &bytes)) {
+            fprintf(target, "Leaf type %-10" PRIu32 " %'16zu leaves %s\n", t, leaves, to_h(bytes, buf));
+        }
+    }
+}
+
+void
+sylvan_memory_write_json(FILE *target)
+{
+    sylvan_memory_t mem;
+    sylvan_memory_usage(&mem);
+
+    fprintf(target, "{");
+    for (int i=0; i<SYLVAN_MEM_COUNTER; i++) {
+        fprintf(target, "\"%s\":{\"committed\":%zu,\"reserved\":%zu},", sylvan_memory_names[i], mem.committed[i], mem.reserved[i]);
+    }
+    fprintf(target, "\"total\":{\"committed\":%zu,\"reserved\":%zu},\"leaf_types\":[", mem.committed_total, mem.reserved_total);
+    int first = 1;
+    uint32_t types = sylvan_mt_type_count();
+    for (uint32_t t=0; t<types; t++) {
+        size_t leaves, bytes;
+        if (sylvan_mt_get_memory(t, &leaves, &bytes)) {
+            fprintf(target, "%s{\"type\":%" PRIu32 ",\"leaves\":%zu,\"bytes\":%zu}", first ? "" : ",", t, leaves, bytes);
+            first = 0;
+        }
+    }
+    fprintf(target, "]}\n");
+}
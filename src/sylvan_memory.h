@@ -0,0 +1,89 @@
+/*
+ * Copyright 2011-2016 Formal Methods and Tools, University of Twente
+ * Copyright 2016-2017 Tom van Dijk, Johannes Kepler University Linz
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Do not include this file directly. Instead, include sylvan.h */
+
+#ifndef SYLVAN_MEMORY_H
+#define SYLVAN_MEMORY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * Memory accounting.
+ *
+ * Sylvan keeps track of the memory used by each of its subsystems.
+ * The "reserved" bytes are the virtual address space that is allocated; the "committed" bytes
+ * are the part that is actually in use. The nodes table and the operation cache reserve their
+ * maximum size up front, but only use their current size. For the other subsystems, the
+ * reserved and committed bytes are the same.
+ *
+ * The payloads of custom leaves (e.g. GMP rationals) are only counted for leaf types that
+ * register a size callback with sylvan_mt_set_size.
+ */
+typedef enum sylvan_memory_subsystem {
+    SYLVAN_MEM_NODES,           // the nodes table (including its bitmaps)
+    SYLVAN_MEM_CACHE,           // the operation cache
+    SYLVAN_MEM_REFS,            // the tables of external references and protected pointers
+    SYLVAN_MEM_REFS_STACKS,     // the per-worker stacks of internal references
+    SYLVAN_MEM_SKIPLIST,        // the skiplists used for writing decision diagrams
+    SYLVAN_MEM_SERIALIZE,       // the sets of sylvan_serialize_* and lddmc_serialize_*
+    SYLVAN_MEM_LEAVES,          // the payloads of custom leaves
+    SYLVAN_MEM_INSTRUMENTATION, // the statistics and the trace buffers
+    SYLVAN_MEM_COUNTER,         // number of subsystems
+} sylvan_memory_subsystem_t;
+
+typedef struct sylvan_memory
+{
+    size_t committed[SYLVAN_MEM_COUNTER];
+    size_t reserved[SYLVAN_MEM_COUNTER];
+    size_t committed_total;
+    size_t reserved_total;
+} sylvan_memory_t;
+
+/**
+ * Obtain the current memory usage of all subsystems. This is cheap and may be called at any time.
+ */
+void sylvan_memory_usage(sylvan_memory_t *target);
+
+/**
+ * Obtain the name of a subsystem, e.g. "nodes" for SYLVAN_MEM_NODES.
+ */
+const char *sylvan_memory_name(int subsystem);
+
+/**
+ * Write a human-readable report of the memory usage, including every tracked leaf type.
+ */
+void sylvan_memory_report(FILE *target);
+
+/**
+ * Write the memory usage as a JSON object.
+ */
+void sylvan_memory_write_json(FILE *target);
+
+/**
+ * Internal: account for memory allocated or freed by a subsystem.
+ */
+void sylvan_memory_add(int subsystem, size_t bytes);
+void sylvan_memory_sub(int subsystem, size_t bytes);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif
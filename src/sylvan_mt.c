@@ -33,6 +33,9 @@ typedef struct
     sylvan_mt_to_str_cb to_str_cb;
     sylvan_mt_write_binary_cb write_binary_cb;
     sylvan_mt_read_binary_cb read_binary_cb;
+    sylvan_mt_size_cb size_cb;
+    _Atomic(size_t) leaves;     // only counted with a size callback
+    _Atomic(size_t) bytes;
 } customleaf_t;
 
 static customleaf_t *cl_registry;
@@ -60,6 +63,12 @@ _sylvan_create_cb(uint64_t *a, uint64_t *b)
 {
     customleaf_t *c = sylvan_mt_from_node(*a, *b);
     if (c->create_cb != NULL) c->create_cb(b);
+    if (c->size_cb != NULL) {
+        size_t bytes = c->size_cb(*b);
+        atomic_fetch_add_explicit(&c->leaves, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&c->bytes, bytes, memory_order_relaxed);
+        sylvan_memory_add(SYLVAN_MEM_LEAVES, bytes);
+    }
 }
 
 static void
@@ -67,6 +76,12 @@ _sylvan_destroy_cb(uint64_t a, uint64_t b)
 {
     // for leaf
     customleaf_t *c = sylvan_mt_from_node(a, b);
+    if (c->size_cb != NULL) {
+        size_t bytes = c->size_cb(b);
+        atomic_fetch_sub_explicit(&c->leaves, 1, memory_order_relaxed);
+        atomic_fetch_sub_explicit(&c->bytes, bytes, memory_order_relaxed);
+        sylvan_memory_sub(SYLVAN_MEM_LEAVES, bytes);
+    }
     if (c->destroy_cb != NULL) c->destroy_cb(b);
 }
 
@@ -141,6 +156,12 @@ void sylvan_mt_set_read_binary(uint32_t type, sylvan_mt_read_binary_cb read_bina
     c->read_binary_cb = read_binary_cb;
 }
 
+void sylvan_mt_set_size(uint32_t type, sylvan_mt_size_cb size_cb)
+{
+    customleaf_t *c = cl_registry + type;
+    c->size_cb = size_cb;
+}
+
 /**
  * Initialize and quit functions
  */
@@ -153,6 +174,9 @@ sylvan_mt_quit(void)
     if (mt_initialized == 0) return;
     mt_initialized = 0;
 
+    for (size_t i=0; i<cl_registry_count; i++) {
+        sylvan_memory_sub(SYLVAN_MEM_LEAVES, cl_registry[i].bytes);
+    }
     free(cl_registry);
     cl_registry = NULL;
     cl_registry_count = 0;
@@ -259,3 +283,19 @@ sylvan_mt_read_binary(uint32_t type, uint64_t *value, FILE *in)
     if (c->read_binary_cb != NULL) return c->read_binary_cb(in, value);
     else return 0;
 }
+
+uint32_t
+sylvan_mt_type_count()
+{
+    return (uint32_t)cl_registry_count;
+}
+
+int
+sylvan_mt_get_memory(uint32_t type, size_t *leaves, size_t *bytes)
+{
+    assert(type < cl_registry_count);
+    customleaf_t *c = cl_registry + type;
+    *leaves = atomic_load_explicit(&c->leaves, memory_order_relaxed);
+    *bytes = atomic_load_explicit(&c->bytes, memory_order_relaxed);
+    return c->size_cb != NULL ? 1 : 0;
+}
@@ -74,6 +74,7 @@ typedef void (*sylvan_mt_destroy_cb)(uint64_t);
 typedef char* (*sylvan_mt_to_str_cb)(int, uint64_t, char*, size_t);
 typedef int (*sylvan_mt_write_binary_cb)(FILE*, uint64_t);
 typedef int (*sylvan_mt_read_binary_cb)(FILE*, uint64_t*);
+typedef size_t (*sylvan_mt_size_cb)(uint64_t);
 
 /**
  * Initialize the multi-terminal subsystem
@@ -96,6 +97,13 @@ void sylvan_mt_set_to_str(uint32_t type, sylvan_mt_to_str_cb to_str_cb);
 void sylvan_mt_set_write_binary(uint32_t type, sylvan_mt_write_binary_cb write_binary_cb);
 void sylvan_mt_set_read_binary(uint32_t type, sylvan_mt_read_binary_cb read_binary_cb);
 
+/**
+ * Set the callback that returns the number of bytes allocated for the payload of a leaf of <type>
+ * (i.e., by its create callback). Leaves of types with a size callback are counted by the
+ * memory accounting (see sylvan_memory_report).
+ */
+void sylvan_mt_set_size(uint32_t type, sylvan_mt_size_cb size_cb);
+
 /**
  * Returns 1 if the given type implements hash, or 0 otherwise.
  * (used when inserting into the unique table)
@@ -123,6 +131,17 @@ int sylvan_mt_write_binary(uint32_t type, uint64_t value, FILE *out);
  */
 int sylvan_mt_read_binary(uint32_t type, uint64_t *value, FILE *in);
 
+/**
+ * Get the number of registered leaf types (including the three built-in types).
+ */
+uint32_t sylvan_mt_type_count(void);
+
+/**
+ * Get the number of leaves of <type> in the nodes table and the bytes allocated for their payloads.
+ * Returns 0 if <type> has no size callback; then nothing is counted.
+ */
+int sylvan_mt_get_memory(uint32_t type, size_t *leaves, size_t *bytes);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -124,39 +124,271 @@ mtbdd_deref(MDD a)
     refs_down(&mtbdd_refs, MTBDD_STRIPMARK(a));
 }
 
+/* Apply the deferred reference updates of all workers (in a new frame, so no worker updates them) */
+VOID_TASK_0(mtbdd_refs_flush_go)
+{
+    refs_flush(&mtbdd_refs);
+}
+
+VOID_TASK_0(mtbdd_refs_flush)
+{
+    NEWFRAME(mtbdd_refs_flush_go);
+}
+
 size_t
 mtbdd_count_refs()
 {
+    RUN(mtbdd_refs_flush);
     return refs_count(&mtbdd_refs);
 }
 
-void
-mtbdd_protect(MTBDD *a)
+/**
+ * Root segments: every thread registers protected pointers in its own segment, a small stack
+ * that is searched from the top. Scoped objects, such as C++ temporaries, are protected and
+ * unprotected in (almost) LIFO order without touching the shared mtbdd_protected table.
+ * When a segment is full, its oldest half escapes to mtbdd_protected.
+ * The owner and garbage collection take the (uncontended) lock of the segment.
+ */
+#define MTBDD_ROOTS_SIZE 256
+#define MTBDD_ROOTS_WINDOW 16
+
+typedef struct mtbdd_roots
+{
+    pthread_mutex_t lock;
+    size_t count;                       // used slots; removed slots below the top are NULL
+    struct mtbdd_roots *next;           // the segments of all threads
+    MTBDD *slots[MTBDD_ROOTS_SIZE];
+} mtbdd_roots_t;
+
+static __thread mtbdd_roots_t *mtbdd_roots_local = NULL;
+static mtbdd_roots_t *mtbdd_roots_all = NULL;
+static pthread_mutex_t mtbdd_roots_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t mtbdd_roots_key;
+static pthread_once_t mtbdd_roots_once = PTHREAD_ONCE_INIT;
+
+static void
+mtbdd_protected_create(void)
 {
     if (!mtbdd_protected_created) {
         // In C++, sometimes mtbdd_protect is called before Sylvan is initialized. Just create a table.
         protect_create(&mtbdd_protected, 4096);
         mtbdd_protected_created = 1;
     }
-    protect_up(&mtbdd_protected, (size_t)a);
+}
+
+/* When a thread exits, its remaining roots escape to mtbdd_protected */
+static void
+mtbdd_roots_exit(void *arg)
+{
+    mtbdd_roots_t *seg = (mtbdd_roots_t*)arg;
+    pthread_mutex_lock(&mtbdd_roots_lock);
+    for (mtbdd_roots_t **p = &mtbdd_roots_all; *p != NULL; p = &(*p)->next) {
+        if (*p == seg) {
+            *p = seg->next;
+            break;
+        }
+    }
+    pthread_mutex_lock(&seg->lock);
+    for (size_t i=0; i<seg->count; i++) {
+        if (seg->slots[i] != NULL) {
+            mtbdd_protected_create();
+            protect_up(&mtbdd_protected, (size_t)seg->slots[i]);
+        }
+    }
+    pthread_mutex_unlock(&seg->lock);
+    pthread_mutex_unlock(&mtbdd_roots_lock);
+    pthread_mutex_destroy(&seg->lock);
+    free(seg);
+    sylvan_memory_sub(SYLVAN_MEM_REFS, sizeof(mtbdd_roots_t));
+}
+
+static void
+mtbdd_roots_init_key(void)
+{
+    pthread_key_create(&mtbdd_roots_key, mtbdd_roots_exit);
+}
+
+static mtbdd_roots_t*
+mtbdd_roots_get(void)
+{
+    mtbdd_roots_t *seg = mtbdd_roots_local;
+    if (seg != NULL) return seg;
+    seg = (mtbdd_roots_t*)malloc(sizeof(mtbdd_roots_t));
+    if (seg == NULL) {
+        fprintf(stderr, "mtbdd_protect: Unable to allocate memory!\n");
+        exit(1);
+    }
+    sylvan_memory_add(SYLVAN_MEM_REFS, sizeof(mtbdd_roots_t));
+    pthread_mutex_init(&seg->lock, NULL);
+    seg->count = 0;
+    pthread_once(&mtbdd_roots_once, mtbdd_roots_init_key);
+    pthread_setspecific(mtbdd_roots_key, seg);
+    pthread_mutex_lock(&mtbdd_roots_lock);
+    seg->next = mtbdd_roots_all;
+    mtbdd_roots_all = seg;
+    pthread_mutex_unlock(&mtbdd_roots_lock);
+    mtbdd_roots_local = seg;
+    return seg;
+}
+
+/* Remove <a> from the top <window> slots of <seg> (with its lock taken), returns 1 if found */
+static inline int
+mtbdd_roots_remove(mtbdd_roots_t *seg, MTBDD *a, size_t window)
+{
+    const size_t bottom = seg->count > window ? seg->count - window : 0;
+    for (size_t i=seg->count; i-- > bottom;) {
+        if (seg->slots[i] == a) {
+            seg->slots[i] = NULL;
+            while (seg->count > 0 && seg->slots[seg->count-1] == NULL) seg->count--;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Remove <a> from the segment of another thread, returns 1 if found */
+static int
+mtbdd_roots_remove_other(mtbdd_roots_t *local, MTBDD *a)
+{
+    int found = 0;
+    pthread_mutex_lock(&mtbdd_roots_lock);
+    for (mtbdd_roots_t *seg = mtbdd_roots_all; seg != NULL && !found; seg = seg->next) {
+        if (seg == local) continue;
+        pthread_mutex_lock(&seg->lock);
+        found = mtbdd_roots_remove(seg, a, MTBDD_ROOTS_SIZE);
+        pthread_mutex_unlock(&seg->lock);
+    }
+    pthread_mutex_unlock(&mtbdd_roots_lock);
+    return found;
+}
+
+void
+mtbdd_protect(MTBDD *a)
+{
+    mtbdd_roots_t *seg = mtbdd_roots_get();
+    pthread_mutex_lock(&seg->lock);
+    if (seg->count == MTBDD_ROOTS_SIZE) {
+        // full: the oldest half escapes to the shared table
+        const size_t half = MTBDD_ROOTS_SIZE / 2;
+        size_t n = 0;
+        for (size_t i=0; i<half; i++) {
+            if (seg->slots[i] != NULL) {
+                mtbdd_protected_create();
+                protect_up(&mtbdd_protected, (size_t)seg->slots[i]);
+            }
+        }
+        for (size_t i=half; i<MTBDD_ROOTS_SIZE; i++) {
+            if (seg->slots[i] != NULL) seg->slots[n++] = seg->slots[i];
+        }
+        seg->count = n;
+    }
+    seg->slots[seg->count++] = a;
+    pthread_mutex_unlock(&seg->lock);
+    if (sylvan_record_active) sylvan_record_protect(a, 0, 1);
 }
 
 void
 mtbdd_unprotect(MTBDD *a)
 {
-    if (mtbdd_protected.refs_table != NULL) protect_down(&mtbdd_protected, (size_t)a);
+    // most objects are scoped and found near the top of the segment; objects that are not
+    // are usually found in the table (escaped), before searching the rest of the segment
+    mtbdd_roots_t *seg = mtbdd_roots_get();
+    pthread_mutex_lock(&seg->lock);
+    int found = mtbdd_roots_remove(seg, a, MTBDD_ROOTS_WINDOW);
+    pthread_mutex_unlock(&seg->lock);
+    if (found) {
+        // done
+    } else if (mtbdd_protected.refs_table != NULL && protect_remove(&mtbdd_protected, (size_t)a)) {
+        // escaped
+    } else {
+        pthread_mutex_lock(&seg->lock);
+        found = mtbdd_roots_remove(seg, a, MTBDD_ROOTS_SIZE);
+        pthread_mutex_unlock(&seg->lock);
+        // protected by another thread; check the table again in case the other thread
+        // moved it to the table meanwhile
+        if (!found && !mtbdd_roots_remove_other(seg, a) && mtbdd_protected.refs_table != NULL) {
+            protect_remove(&mtbdd_protected, (size_t)a);
+        }
+    }
+    if (sylvan_record_active) sylvan_record_protect(a, 0, 0);
+}
+
+/* Replace <from> by <to> in the segment, returns 1 if found */
+static int
+mtbdd_roots_replace(mtbdd_roots_t *seg, MTBDD *from, MTBDD *to, size_t window)
+{
+    const size_t bottom = seg->count > window ? seg->count - window : 0;
+    for (size_t i=seg->count; i-- > bottom;) {
+        if (seg->slots[i] == from) {
+            seg->slots[i] = to;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void
+mtbdd_protect_move(MTBDD *from, MTBDD *to)
+{
+    // <to> takes the place of <from>, searched in the same order as by mtbdd_unprotect
+    mtbdd_roots_t *seg = mtbdd_roots_get();
+    pthread_mutex_lock(&seg->lock);
+    int found = mtbdd_roots_replace(seg, from, to, MTBDD_ROOTS_WINDOW);
+    pthread_mutex_unlock(&seg->lock);
+    if (found) {
+        // done
+    } else if (mtbdd_protected.refs_table != NULL && protect_remove(&mtbdd_protected, (size_t)from)) {
+        protect_up(&mtbdd_protected, (size_t)to);
+    } else {
+        pthread_mutex_lock(&seg->lock);
+        found = mtbdd_roots_replace(seg, from, to, MTBDD_ROOTS_SIZE);
+        pthread_mutex_unlock(&seg->lock);
+        if (!found) {
+            // protected by another thread
+            mtbdd_protect(to);
+            mtbdd_unprotect(from);
+            return;
+        }
+    }
+    if (sylvan_record_active) {
+        sylvan_record_protect(to, 0, 1);
+        sylvan_record_protect(from, 0, 0);
+    }
 }
 
 size_t
 mtbdd_count_protected()
 {
-    return protect_count(&mtbdd_protected);
+    size_t count = mtbdd_protected.refs_table != NULL ? protect_count(&mtbdd_protected) : 0;
+    pthread_mutex_lock(&mtbdd_roots_lock);
+    for (mtbdd_roots_t *seg = mtbdd_roots_all; seg != NULL; seg = seg->next) {
+        pthread_mutex_lock(&seg->lock);
+        for (size_t i=0; i<seg->count; i++) count += seg->slots[i] != NULL;
+        pthread_mutex_unlock(&seg->lock);
+    }
+    pthread_mutex_unlock(&mtbdd_roots_lock);
+    return count;
+}
+
+/* Forget all roots in the segments (when Sylvan quits, like mtbdd_protected) */
+static void
+mtbdd_roots_clear(void)
+{
+    pthread_mutex_lock(&mtbdd_roots_lock);
+    for (mtbdd_roots_t *seg = mtbdd_roots_all; seg != NULL; seg = seg->next) {
+        pthread_mutex_lock(&seg->lock);
+        seg->count = 0;
+        pthread_mutex_unlock(&seg->lock);
+    }
+    pthread_mutex_unlock(&mtbdd_roots_lock);
 }
 
 /* Called during garbage collection */
 VOID_TASK_0(mtbdd_gc_mark_external_refs)
 {
+    // apply the deferred updates of all workers, then
     // iterate through refs hash table, mark all found
+    refs_flush(&mtbdd_refs);
     size_t count=0;
     uint64_t *it = refs_iter(&mtbdd_refs, 0, mtbdd_refs.refs_size);
     while (it != NULL) {
@@ -178,9 +410,23 @@ VOID_TASK_0(mtbdd_gc_mark_protected)
         SPAWN(mtbdd_gc_mark_rec, *to_mark);
         count++;
     }
+    // and the root segments of all threads, which stay locked until marked
+    pthread_mutex_lock(&mtbdd_roots_lock);
+    for (mtbdd_roots_t *seg = mtbdd_roots_all; seg != NULL; seg = seg->next) {
+        pthread_mutex_lock(&seg->lock);
+        for (size_t i=0; i<seg->count; i++) {
+            if (seg->slots[i] == NULL) continue;
+            SPAWN(mtbdd_gc_mark_rec, *seg->slots[i]);
+            count++;
+        }
+    }
     while (count--) {
         SYNC(mtbdd_gc_mark_rec);
     }
+    for (mtbdd_roots_t *seg = mtbdd_roots_all; seg != NULL; seg = seg->next) {
+        pthread_mutex_unlock(&seg->lock);
+    }
+    pthread_mutex_unlock(&mtbdd_roots_lock);
 }
 
 /* Infrastructure for internal markings */
@@ -273,6 +519,7 @@ mtbdd_refs_init_key(void)
     s->rend = s->rbegin + 1024;
     s->scur = s->sbegin = (mtbdd_refs_task_t)malloc(sizeof(struct mtbdd_refs_task) * 1024);
     s->send = s->sbegin + 1024;
+    sylvan_memory_add(SYLVAN_MEM_REFS_STACKS, sizeof(struct mtbdd_refs_internal) + (sizeof(MTBDD*) + sizeof(MTBDD) + sizeof(struct mtbdd_refs_task)) * 1024);
     SET_THREAD_LOCAL(mtbdd_refs_key, s);
 }
 
@@ -280,6 +527,10 @@ VOID_TASK_0(mtbdd_refs_free)
 {
     LOCALIZE_THREAD_LOCAL(mtbdd_refs_key, mtbdd_refs_internal_t);
     if (mtbdd_refs_key != NULL) {
+        sylvan_memory_sub(SYLVAN_MEM_REFS_STACKS, sizeof(struct mtbdd_refs_internal)
+                + sizeof(MTBDD*) * (mtbdd_refs_key->pend - mtbdd_refs_key->pbegin)
+                + sizeof(MTBDD) * (mtbdd_refs_key->rend - mtbdd_refs_key->rbegin)
+                + sizeof(struct mtbdd_refs_task) * (mtbdd_refs_key->send - mtbdd_refs_key->sbegin));
         free(mtbdd_refs_key->pbegin);
         free(mtbdd_refs_key->rbegin);
         free(mtbdd_refs_key->sbegin);
@@ -297,7 +548,7 @@ VOID_TASK_0(mtbdd_refs_init)
 {
     INIT_THREAD_LOCAL(mtbdd_refs_key);
     TOGETHER(mtbdd_refs_init_task);
-    sylvan_gc_add_mark(mtbdd_refs_mark_CALL);
+    sylvan_gc_add_mark_named(mtbdd_refs_mark_CALL, "mtbdd_refs_mark");
 }
 
 void
@@ -306,6 +557,7 @@ mtbdd_refs_ptrs_up(mtbdd_refs_internal_t mtbdd_refs_key)
     size_t cur = mtbdd_refs_key->pcur - mtbdd_refs_key->pbegin;
     size_t size = mtbdd_refs_key->pend - mtbdd_refs_key->pbegin;
     mtbdd_refs_key->pbegin = (const MTBDD**)realloc(mtbdd_refs_key->pbegin, sizeof(MTBDD*) * size * 2);
+    sylvan_memory_add(SYLVAN_MEM_REFS_STACKS, sizeof(MTBDD*) * size);
     mtbdd_refs_key->pcur = mtbdd_refs_key->pbegin + cur;
     mtbdd_refs_key->pend = mtbdd_refs_key->pbegin + (size * 2);
 }
@@ -315,6 +567,7 @@ mtbdd_refs_refs_up(mtbdd_refs_internal_t mtbdd_refs_key, MTBDD res)
 {
     long size = mtbdd_refs_key->rend - mtbdd_refs_key->rbegin;
     mtbdd_refs_key->rbegin = (MTBDD*)realloc(mtbdd_refs_key->rbegin, sizeof(MTBDD) * size * 2);
+    sylvan_memory_add(SYLVAN_MEM_REFS_STACKS, sizeof(MTBDD) * size);
     mtbdd_refs_key->rcur = mtbdd_refs_key->rbegin + size;
     mtbdd_refs_key->rend = mtbdd_refs_key->rbegin + (size * 2);
     return res;
@@ -325,6 +578,7 @@ mtbdd_refs_tasks_up(mtbdd_refs_internal_t mtbdd_refs_key)
 {
     long size = mtbdd_refs_key->send - mtbdd_refs_key->sbegin;
     mtbdd_refs_key->sbegin = (mtbdd_refs_task_t)realloc(mtbdd_refs_key->sbegin, sizeof(struct mtbdd_refs_task) * size * 2);
+    sylvan_memory_add(SYLVAN_MEM_REFS_STACKS, sizeof(struct mtbdd_refs_task) * size);
     mtbdd_refs_key->scur = mtbdd_refs_key->sbegin + size;
     mtbdd_refs_key->send = mtbdd_refs_key->sbegin + (size * 2);
 }
@@ -395,6 +649,7 @@ mtbdd_quit(void)
         protect_free(&mtbdd_protected);
         mtbdd_protected_created = 0;
     }
+    mtbdd_roots_clear();
 
     mtbdd_initialized = 0;
 }
@@ -408,14 +663,12 @@ sylvan_init_mtbdd(void)
     mtbdd_initialized = 1;
 
     sylvan_register_quit(mtbdd_quit);
-    sylvan_gc_add_mark(mtbdd_gc_mark_external_refs_CALL);
-    sylvan_gc_add_mark(mtbdd_gc_mark_protected_CALL);
+    sylvan_gc_add_mark_named(mtbdd_gc_mark_external_refs_CALL, "mtbdd_gc_mark_external_refs");
+    sylvan_gc_add_mark_named(mtbdd_gc_mark_protected_CALL, "mtbdd_gc_mark_protected");
 
     refs_create(&mtbdd_refs, 1024);
-    if (!mtbdd_protected_created) {
-        protect_create(&mtbdd_protected, 4096);
-        mtbdd_protected_created = 1;
-    }
+    refs_defer(&mtbdd_refs, lace_workers());
+    mtbdd_protected_create();
 
     RUN(mtbdd_refs_init);
 }
@@ -722,6 +975,29 @@ TASK_IMPL_4(MTBDD, mtbdd_union_cube, MTBDD, mtbdd, MTBDD, vars, uint8_t*, cube,
     }
 }
 
+TASK_IMPL_3(MTBDD, mtbdd_kernel, mtbdd_kernel_cb, k, MTBDD, a, MTBDD, b)
+{
+    return WRAP(k, a, b);
+}
+
+uint64_t
+mtbdd_kernel_opid(void)
+{
+    return cache_next_opid();
+}
+
+int
+mtbdd_kernel_cache_get(uint64_t opid, MTBDD a, MTBDD b, MTBDD *result)
+{
+    return cache_get3(opid, a, b, 0, result);
+}
+
+int
+mtbdd_kernel_cache_put(uint64_t opid, MTBDD a, MTBDD b, MTBDD result)
+{
+    return cache_put3(opid, a, b, 0, result);
+}
+
 /**
  * Apply a binary operation <op> to <a> and <b>.
  */
@@ -782,11 +1058,26 @@ TASK_IMPL_3(MTBDD, mtbdd_apply, MTBDD, a, MTBDD, b, mtbdd_apply_op, op)
         bhigh = b;
     }
 
+    /* Prefetch the nodes and cache buckets of the recursive calls */
+    MTBDD_PREFETCH(ahigh);
+    MTBDD_PREFETCH(bhigh);
+    MTBDD_PREFETCH(alow);
+    MTBDD_PREFETCH(blow);
+    cache_prefetch3(CACHE_MTBDD_APPLY, ahigh, bhigh, (size_t)op);
+    cache_prefetch3(CACHE_MTBDD_APPLY, alow, blow, (size_t)op);
+
     /* Recursive */
-    mtbdd_refs_spawn(SPAWN(mtbdd_apply, ahigh, bhigh, op));
-    MTBDD low = mtbdd_refs_push(CALL(mtbdd_apply, alow, blow, op));
-    MTBDD high = mtbdd_refs_sync(SYNC(mtbdd_apply));
-    mtbdd_refs_pop(1);
+    MTBDD low, high;
+    if (sylvan_seqcutoff_reached(v)) {
+        high = mtbdd_refs_push(CALL(mtbdd_apply, ahigh, bhigh, op));
+        low = CALL(mtbdd_apply, alow, blow, op);
+        mtbdd_refs_pop(1);
+    } else {
+        mtbdd_refs_spawn(SPAWN(mtbdd_apply, ahigh, bhigh, op));
+        low = mtbdd_refs_push(CALL(mtbdd_apply, alow, blow, op));
+        high = mtbdd_refs_sync(SYNC(mtbdd_apply));
+        mtbdd_refs_pop(1);
+    }
     result = mtbdd_makenode(v, low, high);
 
     /* Store in cache */
@@ -857,10 +1148,17 @@ TASK_IMPL_5(MTBDD, mtbdd_applyp, MTBDD, a, MTBDD, b, size_t, p, mtbdd_applyp_op,
     }
 
     /* Recursive */
-    mtbdd_refs_spawn(SPAWN(mtbdd_applyp, ahigh, bhigh, p, op, opid));
-    MTBDD low = mtbdd_refs_push(CALL(mtbdd_applyp, alow, blow, p, op, opid));
-    MTBDD high = mtbdd_refs_sync(SYNC(mtbdd_applyp));
-    mtbdd_refs_pop(1);
+    MTBDD low, high;
+    if (sylvan_seqcutoff_reached(v)) {
+        high = mtbdd_refs_push(CALL(mtbdd_applyp, ahigh, bhigh, p, op, opid));
+        low = CALL(mtbdd_applyp, alow, blow, p, op, opid);
+        mtbdd_refs_pop(1);
+    } else {
+        mtbdd_refs_spawn(SPAWN(mtbdd_applyp, ahigh, bhigh, p, op, opid));
+        low = mtbdd_refs_push(CALL(mtbdd_applyp, alow, blow, p, op, opid));
+        high = mtbdd_refs_sync(SYNC(mtbdd_applyp));
+        mtbdd_refs_pop(1);
+    }
     result = mtbdd_makenode(v, low, high);
 
     /* Store in cache */
@@ -906,10 +1204,17 @@ TASK_IMPL_3(MTBDD, mtbdd_uapply, MTBDD, dd, mtbdd_uapply_op, op, size_t, param)
     MTBDD ddhigh = node_gethigh(dd, ndd);
 
     /* Recursive */
-    mtbdd_refs_spawn(SPAWN(mtbdd_uapply, ddhigh, op, param));
-    MTBDD low = mtbdd_refs_push(CALL(mtbdd_uapply, ddlow, op, param));
-    MTBDD high = mtbdd_refs_sync(SYNC(mtbdd_uapply));
-    mtbdd_refs_pop(1);
+    MTBDD low, high;
+    if (sylvan_seqcutoff_reached(mtbddnode_getvariable(ndd))) {
+        high = mtbdd_refs_push(CALL(mtbdd_uapply, ddhigh, op, param));
+        low = CALL(mtbdd_uapply, ddlow, op, param);
+        mtbdd_refs_pop(1);
+    } else {
+        mtbdd_refs_spawn(SPAWN(mtbdd_uapply, ddhigh, op, param));
+        low = mtbdd_refs_push(CALL(mtbdd_uapply, ddlow, op, param));
+        high = mtbdd_refs_sync(SYNC(mtbdd_uapply));
+        mtbdd_refs_pop(1);
+    }
     result = mtbdd_makenode(mtbddnode_getvariable(ndd), low, high);
 
     /* Store in cache */
@@ -1492,11 +1797,28 @@ TASK_IMPL_3(MTBDD, mtbdd_ite, MTBDD, f, MTBDD, g, MTBDD, h)
     hlow = (!lh && vh == v) ? node_getlow(h, nh) : h;
     hhigh = (!lh && vh == v) ? node_gethigh(h, nh) : h;
 
+    /* Prefetch the nodes and cache buckets of the recursive calls */
+    MTBDD_PREFETCH(fhigh);
+    MTBDD_PREFETCH(ghigh);
+    MTBDD_PREFETCH(hhigh);
+    MTBDD_PREFETCH(flow);
+    MTBDD_PREFETCH(glow);
+    MTBDD_PREFETCH(hlow);
+    cache_prefetch3(CACHE_MTBDD_ITE, fhigh, ghigh, hhigh);
+    cache_prefetch3(CACHE_MTBDD_ITE, flow, glow, hlow);
+
     /* Recursive calls */
-    mtbdd_refs_spawn(SPAWN(mtbdd_ite, fhigh, ghigh, hhigh));
-    MTBDD low = mtbdd_refs_push(CALL(mtbdd_ite, flow, glow, hlow));
-    MTBDD high = mtbdd_refs_sync(SYNC(mtbdd_ite));
-    mtbdd_refs_pop(1);
+    MTBDD low, high;
+    if (sylvan_seqcutoff_reached(v)) {
+        high = mtbdd_refs_push(CALL(mtbdd_ite, fhigh, ghigh, hhigh));
+        low = CALL(mtbdd_ite, flow, glow, hlow);
+        mtbdd_refs_pop(1);
+    } else {
+        mtbdd_refs_spawn(SPAWN(mtbdd_ite, fhigh, ghigh, hhigh));
+        low = mtbdd_refs_push(CALL(mtbdd_ite, flow, glow, hlow));
+        high = mtbdd_refs_sync(SYNC(mtbdd_ite));
+        mtbdd_refs_pop(1);
+    }
     result = mtbdd_makenode(v, low, high);
 
     /* Store in cache */
@@ -2365,6 +2687,64 @@ TASK_IMPL_2(MTBDD, mtbdd_compose, MTBDD, a, MTBDDMAP, map)
     return result;
 }
 
+TASK_IMPL_2(MTBDD, mtbdd_rename, MTBDD, a, MTBDDMAP, map)
+{
+    /* Terminal case */
+    if (mtbdd_isleaf(a) || mtbdd_map_isempty(map)) return a;
+
+    /* Determine top level */
+    mtbddnode_t n = MTBDD_GETNODE(a);
+    uint32_t v = mtbddnode_getvariable(n);
+
+    /* Find in map */
+    while (mtbdd_map_key(map) < v) {
+        map = mtbdd_map_next(map);
+        if (mtbdd_map_isempty(map)) return a;
+    }
+
+    /* Perhaps execute garbage collection */
+    sylvan_gc_test();
+
+    /* Count operation */
+    sylvan_stats_count(MTBDD_RENAME);
+
+    /* Check cache */
+    MTBDD result;
+    if (cache_get3(CACHE_MTBDD_RENAME, a, map, 0, &result)) {
+        sylvan_stats_count(MTBDD_RENAME_CACHED);
+        return result;
+    }
+
+    /* Recursive calls */
+    MTBDD low, high;
+    if (sylvan_seqcutoff_reached(v)) {
+        high = mtbdd_refs_push(CALL(mtbdd_rename, node_gethigh(a, n), map));
+        low = mtbdd_refs_push(CALL(mtbdd_rename, node_getlow(a, n), map));
+    } else {
+        mtbdd_refs_spawn(SPAWN(mtbdd_rename, node_getlow(a, n), map));
+        high = mtbdd_refs_push(CALL(mtbdd_rename, node_gethigh(a, n), map));
+        low = mtbdd_refs_push(mtbdd_refs_sync(SYNC(mtbdd_rename)));
+    }
+
+    /* Calculate result: directly if the new variable is before the variables of low and high */
+    uint32_t var = mtbdd_map_key(map) == v ? mtbdd_getvar(mtbdd_map_value(map)) : v;
+    if ((mtbdd_isleaf(low) || mtbdd_getvar(low) > var) && (mtbdd_isleaf(high) || mtbdd_getvar(high) > var)) {
+        result = mtbdd_makenode(var, low, high);
+    } else {
+        MTBDD r = mtbdd_refs_push(mtbdd_makenode(var, mtbdd_false, mtbdd_true));
+        result = CALL(mtbdd_ite, r, high, low);
+        mtbdd_refs_pop(1);
+    }
+    mtbdd_refs_pop(2);
+
+    /* Store in cache */
+    if (cache_put3(CACHE_MTBDD_RENAME, a, map, 0, result)) {
+        sylvan_stats_count(MTBDD_RENAME_CACHEDPUT);
+    }
+
+    return result;
+}
+
 /**
  * Compute minimum leaf in the MTBDD (for Integer, Double, Rational MTBDDs)
  */
@@ -2859,49 +3239,51 @@ mtbdd_unmark_rec(MTBDD mtbdd)
 
 /**
  * Count number of leaves in MTBDD
+ * Nodes are claimed in an external visited set, so the nodes themselves are not modified.
  */
 
-static size_t
-mtbdd_leafcount_mark(MTBDD mtbdd)
+TASK_2(size_t, mtbdd_leafcount_par, MTBDD, mtbdd, llmsset_visited_t, visited)
 {
     if (mtbdd == mtbdd_true) return 0; // do not count true/false leaf
     if (mtbdd == mtbdd_false) return 0; // do not count true/false leaf
+    if (!llmsset_visited_add(visited, mtbdd & 0x000000ffffffffff)) return 0;
     mtbddnode_t n = MTBDD_GETNODE(mtbdd);
-    if (mtbddnode_getmark(n)) return 0;
-    mtbddnode_setmark(n, 1);
     if (mtbddnode_isleaf(n)) return 1; // count leaf as 1
-    return mtbdd_leafcount_mark(mtbddnode_getlow(n)) + mtbdd_leafcount_mark(mtbddnode_gethigh(n));
+    SPAWN(mtbdd_leafcount_par, mtbddnode_getlow(n), visited);
+    size_t result = CALL(mtbdd_leafcount_par, mtbddnode_gethigh(n), visited);
+    return result + SYNC(mtbdd_leafcount_par);
 }
 
-size_t
-mtbdd_leafcount_more(const MTBDD *mtbdds, size_t count)
+TASK_IMPL_2(size_t, mtbdd_leafcount_more, const MTBDD*, mtbdds, size_t, count)
 {
+    llmsset_visited_t visited = llmsset_visited_create(nodes);
     size_t result = 0, i;
-    for (i=0; i<count; i++) result += mtbdd_leafcount_mark(mtbdds[i]);
-    for (i=0; i<count; i++) mtbdd_unmark_rec(mtbdds[i]);
+    for (i=0; i<count; i++) result += CALL(mtbdd_leafcount_par, mtbdds[i], visited);
+    llmsset_visited_free(visited);
     return result;
 }
 
 /**
  * Count number of nodes in MTBDD
+ * Nodes are claimed in an external visited set, so the nodes themselves are not modified.
  */
 
-static size_t
-mtbdd_nodecount_mark(MTBDD mtbdd)
+TASK_2(size_t, mtbdd_nodecount_par, MTBDD, mtbdd, llmsset_visited_t, visited)
 {
+    if (!llmsset_visited_add(visited, mtbdd & 0x000000ffffffffff)) return 0;
+    if (mtbdd_isleaf(mtbdd)) return 1; // count leaf as 1
     mtbddnode_t n = MTBDD_GETNODE(mtbdd);
-    if (mtbddnode_getmark(n)) return 0;
-    mtbddnode_setmark(n, 1);
-    if (mtbddnode_isleaf(n)) return 1; // count leaf as 1
-    return 1 + mtbdd_nodecount_mark(mtbddnode_getlow(n)) + mtbdd_nodecount_mark(mtbddnode_gethigh(n));
+    SPAWN(mtbdd_nodecount_par, mtbddnode_getlow(n), visited);
+    size_t result = CALL(mtbdd_nodecount_par, mtbddnode_gethigh(n), visited);
+    return 1 + result + SYNC(mtbdd_nodecount_par);
 }
 
-size_t
-mtbdd_nodecount_more(const MTBDD *mtbdds, size_t count)
+TASK_IMPL_2(size_t, mtbdd_nodecount_more, const MTBDD*, mtbdds, size_t, count)
 {
+    llmsset_visited_t visited = llmsset_visited_create(nodes);
     size_t result = 0, i;
-    for (i=0; i<count; i++) result += mtbdd_nodecount_mark(mtbdds[i]);
-    for (i=0; i<count; i++) mtbdd_unmark_rec(mtbdds[i]);
+    for (i=0; i<count; i++) result += CALL(mtbdd_nodecount_par, mtbdds[i], visited);
+    llmsset_visited_free(visited);
     return result;
 }
 
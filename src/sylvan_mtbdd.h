@@ -84,6 +84,7 @@ static const MTBDD sylvan_invalid    = 0xffffffffffffffffLL;
 #define sylvan_count_refs       mtbdd_count_refs
 #define sylvan_protect          mtbdd_protect
 #define sylvan_unprotect        mtbdd_unprotect
+#define sylvan_protect_move     mtbdd_protect_move
 #define sylvan_count_protected  mtbdd_count_protected
 #define sylvan_gc_mark_rec      mtbdd_gc_mark_rec
 #define sylvan_ithvar           mtbdd_ithvar
@@ -370,18 +371,22 @@ TASK_DECL_4(BDD, mtbdd_union_cube, MTBDD, MTBDD, uint8_t*, MTBDD);
  * Count the number of satisfying assignments (minterms) leading to a non-false leaf
  */
 TASK_DECL_2(double, mtbdd_satcount, MTBDD, size_t);
-#define mtbdd_satcount(dd, nvars) RUN(mtbdd_satcount, dd, nvars)
+#define mtbdd_satcount(dd, nvars) SYLVAN_TRACE_RUN(double, mtbdd_satcount, dd, nvars)
 
 /**
  * Count the number of MTBDD leaves (excluding mtbdd_false and mtbdd_true) in the given <count> MTBDDs
+ * Counting is done in parallel and does not modify the nodes, so it is safe while other operations run.
  */
-size_t mtbdd_leafcount_more(const MTBDD *mtbdds, size_t count);
+TASK_DECL_2(size_t, mtbdd_leafcount_more, const MTBDD*, size_t);
+#define mtbdd_leafcount_more(mtbdds, count) RUN(mtbdd_leafcount_more, mtbdds, count)
 #define mtbdd_leafcount(dd) mtbdd_leafcount_more(&dd, 1)
 
 /**
  * Count the number of MTBDD nodes and terminals (excluding mtbdd_false and mtbdd_true) in the given <count> MTBDDs
+ * Counting is done in parallel and does not modify the nodes, so it is safe while other operations run.
  */
-size_t mtbdd_nodecount_more(const MTBDD *mtbdds, size_t count);
+TASK_DECL_2(size_t, mtbdd_nodecount_more, const MTBDD*, size_t);
+#define mtbdd_nodecount_more(mtbdds, count) RUN(mtbdd_nodecount_more, mtbdds, count)
 
 static inline size_t
 mtbdd_nodecount(const MTBDD dd) {
@@ -404,7 +409,7 @@ LACE_TYPEDEF_CB(MTBDD, mtbdd_uapply_op, MTBDD, size_t);
  * Callback <op> is consulted before the cache, thus the application to terminals is not cached.
  */
 TASK_DECL_3(MTBDD, mtbdd_apply, MTBDD, MTBDD, mtbdd_apply_op);
-#define mtbdd_apply(a, b, op) RUN(mtbdd_apply, a, b, op)
+#define mtbdd_apply(a, b, op) SYLVAN_RECORD_RUN2(sylvan_record_apply_op(op), MTBDD, mtbdd_apply, a, b, op)
 
 /**
  * Apply a binary operation <op> with id <opid> to <a> and <b> with parameter <p>
@@ -418,7 +423,23 @@ TASK_DECL_5(MTBDD, mtbdd_applyp, MTBDD, MTBDD, size_t, mtbdd_applyp_op, uint64_t
  * Callback <op> is consulted after the cache, thus the application to a terminal is cached.
  */
 TASK_DECL_3(MTBDD, mtbdd_uapply, MTBDD, mtbdd_uapply_op, size_t);
-#define mtbdd_uapply(dd, op, param) RUN(mtbdd_uapply, dd, op, param)
+#define mtbdd_uapply(dd, op, param) SYLVAN_TRACE_RUN(MTBDD, mtbdd_uapply, dd, op, param)
+
+/**
+ * Run the recursive function <k> on <a> and <b> as a task, i.e., return k(a, b).
+ * This lets the compiled kernels of sylvan_mtbdd_ops.hpp spawn their recursive calls.
+ */
+LACE_TYPEDEF_CB(MTBDD, mtbdd_kernel_cb, MTBDD, MTBDD);
+TASK_DECL_3(MTBDD, mtbdd_kernel, mtbdd_kernel_cb, MTBDD, MTBDD);
+#define mtbdd_kernel(k, a, b) SYLVAN_TRACE_RUN(MTBDD, mtbdd_kernel, k, a, b)
+
+/**
+ * The operation cache for the compiled kernels: a new operation id (get one per kernel, not per
+ * call), and get/put of the result of the operation <opid> on <a> and <b>.
+ */
+uint64_t mtbdd_kernel_opid(void);
+int mtbdd_kernel_cache_get(uint64_t opid, MTBDD a, MTBDD b, MTBDD *result);
+int mtbdd_kernel_cache_put(uint64_t opid, MTBDD a, MTBDD b, MTBDD result);
 
 /**
  * Callback function types for abstraction.
@@ -433,7 +454,7 @@ LACE_TYPEDEF_CB(MTBDD, mtbdd_abstract_op, MTBDD, MTBDD, int);
  * Abstract the variables in <v> from <a> using the binary operation <op>.
  */
 TASK_DECL_3(MTBDD, mtbdd_abstract, MTBDD, MTBDD, mtbdd_abstract_op);
-#define mtbdd_abstract(a, v, op) RUN(mtbdd_abstract, a, v, op)
+#define mtbdd_abstract(a, v, op) SYLVAN_TRACE_RUN(MTBDD, mtbdd_abstract, a, v, op)
 
 /**
  * Unary operation Negate.
@@ -552,21 +573,21 @@ TASK_DECL_3(MTBDD, mtbdd_abstract_op_max, MTBDD, MTBDD, int);
  * <f> must be a Boolean MTBDD (or standard BDD).
  */
 TASK_DECL_3(MTBDD, mtbdd_ite, MTBDD, MTBDD, MTBDD);
-#define mtbdd_ite(f, g, h) RUN(mtbdd_ite, f, g, h);
+#define mtbdd_ite(f, g, h) RUN(mtbdd_ite, f, g, h)
 
 /**
  * Multiply <a> and <b>, and abstract variables <vars> using summation.
  * This is similar to the "and_exists" operation in BDDs.
  */
 TASK_DECL_3(MTBDD, mtbdd_and_abstract_plus, MTBDD, MTBDD, MTBDD);
-#define mtbdd_and_abstract_plus(a, b, vars) RUN(mtbdd_and_abstract_plus, a, b, vars)
+#define mtbdd_and_abstract_plus(a, b, vars) SYLVAN_TRACE_RUN(MTBDD, mtbdd_and_abstract_plus, a, b, vars)
 #define mtbdd_and_exists mtbdd_and_abstract_plus
 
 /**
  * Multiply <a> and <b>, and abstract variables <vars> by taking the maximum.
  */
 TASK_DECL_3(MTBDD, mtbdd_and_abstract_max, MTBDD, MTBDD, MTBDD);
-#define mtbdd_and_abstract_max(a, b, vars) RUN(mtbdd_and_abstract_max, a, b, vars)
+#define mtbdd_and_abstract_max(a, b, vars) SYLVAN_TRACE_RUN(MTBDD, mtbdd_and_abstract_max, a, b, vars)
 
 /**
  * Monad that converts double to a Boolean MTBDD, translate terminals >= value to 1 and to 0 otherwise;
@@ -645,7 +666,15 @@ TASK_DECL_1(MTBDD, mtbdd_support, MTBDD);
  * Each <value> in <map> must be a Boolean MTBDD.
  */
 TASK_DECL_2(MTBDD, mtbdd_compose, MTBDD, MTBDDMAP);
-#define mtbdd_compose(dd, map) RUN(mtbdd_compose, dd, map)
+#define mtbdd_compose(dd, map) SYLVAN_TRACE_RUN(MTBDD, mtbdd_compose, dd, map)
+
+/**
+ * Variable renaming, for each node with variable <key> which has a <key,value> pair in <map>,
+ * where <value> is mtbdd_ithvar(<var>), replace the variable of the node by <var>.
+ * Same result as mtbdd_compose, but nodes are rebuilt directly where the order is kept.
+ */
+TASK_DECL_2(MTBDD, mtbdd_rename, MTBDD, MTBDDMAP);
+#define mtbdd_rename(dd, map) SYLVAN_TRACE_RUN(MTBDD, mtbdd_rename, dd, map)
 
 /**
  * Compute minimal leaf in the MTBDD (for Integer, Double, Rational MTBDDs)
@@ -1036,6 +1065,13 @@ void mtbdd_protect(MTBDD* ptr);
  */
 void mtbdd_unprotect(MTBDD* ptr);
 
+/**
+ * Replace the pointer <from> by the pointer <to> in the pointers table, i.e., protect <to> and
+ * unprotect <from> (e.g. for C++ move constructors). This is cheap when <from> was protected
+ * recently by the same thread.
+ */
+void mtbdd_protect_move(MTBDD* from, MTBDD* to);
+
 /**
  * Compute the number of pointers in the pointers table.
  */
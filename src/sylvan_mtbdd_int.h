@@ -37,6 +37,12 @@ MTBDD_GETNODE(MTBDD dd)
     return (mtbddnode_t)llmsset_index_to_ptr(nodes, dd&0x000000ffffffffff);
 }
 
+static inline void __attribute__((unused))
+MTBDD_PREFETCH(MTBDD dd)
+{
+    llmsset_prefetch(nodes, dd&0x000000ffffffffff);
+}
+
 /**
  * Complement handling macros
  */
@@ -147,6 +153,12 @@ mtbddnode_makenode(mtbddnode_t n, uint32_t var, uint64_t low, uint64_t high)
     n->b = ((uint64_t)var)<<40 | low;
 }
 
+static inline void __attribute__((unused))
+mtbddnode_setvariable(mtbddnode_t n, uint32_t var)
+{
+    n->b = ((uint64_t)var)<<40 | (n->b & 0x000000ffffffffff);
+}
+
 static inline void __attribute__((unused))
 mtbddnode_makemapnode(mtbddnode_t n, uint32_t var, uint64_t low, uint64_t high)
 {
@@ -0,0 +1,525 @@
+/*
+ * Copyright 2011-2016 Formal Methods and Tools, University of Twente
+ * Copyright 2016-2017 Tom van Dijk, Johannes Kepler University Linz
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * MTBDDs with typed leaves and compiled operations.
+ *
+ * sylvan::mt::Mtbdd<T> is an MTBDD whose leaves hold values of type T. The operations
+ * are template parameters: MtbddOps<T>::apply<Op>, uapply<Op> and abstract<Op> generate a
+ * recursive kernel for the pair (T, Op), in which the leaf computation is inlined, instead of
+ * calling a mtbdd_apply_op callback for every pair of nodes. Every kernel gets its own
+ * operation id from mtbdd_kernel_opid when it is first used.
+ *
+ * Leaf types:
+ * - int64_t and double use the built-in leaf types of Sylvan (as mtbdd_int64, mtbdd_double);
+ * - other trivially copyable types of at most 8 bytes are stored in the leaf itself;
+ * - all other types are copied to the heap, with hash, equals, create and destroy callbacks
+ *   generated from std::hash<T> and operator==.
+ * The leaf types are registered when they are first used. Specialize sylvan::mt::Leaf<T> to
+ * change how a type is stored.
+ *
+ * An operation is a struct with a static member function apply, for example:
+ *
+ *     struct Plus {
+ *         static const bool commutative = true;
+ *         template <typename T> static T apply(const T& a, const T& b) { return a + b; }
+ *     };
+ *
+ * Binary operations with commutative set have their operands ordered for the cache.
+ * mtbdd_false is the empty function: wherever one of the operands is mtbdd_false, so is the
+ * result. Unary operations have apply(const T& a).
+ *
+ * The objects interoperate with the C handles (GetMTBDD and the MTBDD constructor) and with
+ * sylvan::Mtbdd. Like the other C++ objects, they are protected from garbage collection.
+ */
+
+#ifndef SYLVAN_MTBDD_OPS_H
+#define SYLVAN_MTBDD_OPS_H
+
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <sylvan_obj.hpp>
+#include <sylvan_hash.h>
+
+namespace sylvan {
+
+namespace mt {
+
+namespace detail {
+
+inline std::mutex&
+registry_lock()
+{
+    static std::mutex lock;
+    return lock;
+}
+
+/**
+ * A leaf type or operation id, created by Tag::create() when it is first used, and forgotten
+ * when Sylvan quits (so it is created again after the next sylvan_init_package).
+ */
+template <typename Tag>
+class Registered
+{
+public:
+    static uint64_t get()
+    {
+        const uint64_t v = value().load(std::memory_order_acquire);
+        return v != 0 ? v : create();
+    }
+
+private:
+    static std::atomic<uint64_t>& value()
+    {
+        static std::atomic<uint64_t> v(0);
+        return v;
+    }
+
+    static void reset()
+    {
+        value().store(0, std::memory_order_relaxed);
+    }
+
+    static uint64_t create()
+    {
+        std::lock_guard<std::mutex> guard(registry_lock());
+        uint64_t v = value().load(std::memory_order_relaxed);
+        if (v == 0) {
+            v = Tag::create();
+            sylvan_register_quit(reset);
+            value().store(v, std::memory_order_release);
+        }
+        return v;
+    }
+};
+
+/* Leaves that are stored in the 64-bit value of the leaf */
+template <typename T>
+struct InlineLeaf
+{
+    typedef T value_type;
+
+    static uint64_t encode(const T &value)
+    {
+        uint64_t v = 0;
+        std::memcpy(&v, &value, sizeof(T));
+        return v;
+    }
+
+    static T decode(uint64_t v)
+    {
+        T value;
+        std::memcpy(&value, &v, sizeof(T));
+        return value;
+    }
+
+    static uint64_t create() { return sylvan_mt_create_type(); }
+};
+
+/* Leaves that are stored on the heap; the leaf holds a pointer */
+template <typename T>
+struct HeapLeaf
+{
+    typedef const T& value_type;
+
+    static uint64_t encode(const T &value) { return (uint64_t)(size_t)&value; }
+    static const T& decode(uint64_t v) { return *(const T*)(size_t)v; }
+
+    static uint64_t hash(uint64_t v, uint64_t seed) { return sylvan_fnvhash8(std::hash<T>()(decode(v)), seed); }
+    static int equals(uint64_t a, uint64_t b) { return decode(a) == decode(b) ? 1 : 0; }
+    static void copy(uint64_t *v) { *v = (uint64_t)(size_t)new T(decode(*v)); }
+    static void destroy(uint64_t v) { delete (const T*)(size_t)v; }
+    static size_t size(uint64_t v) { (void)v; return sizeof(T); }
+
+    static uint64_t create()
+    {
+        const uint32_t type = sylvan_mt_create_type();
+        sylvan_mt_set_hash(type, hash);
+        sylvan_mt_set_equals(type, equals);
+        sylvan_mt_set_create(type, copy);
+        sylvan_mt_set_destroy(type, destroy);
+        sylvan_mt_set_size(type, size);
+        return type;
+    }
+};
+
+template <typename T>
+struct DefaultLeaf : std::conditional<(sizeof(T) <= 8 && std::is_trivially_copyable<T>::value), InlineLeaf<T>, HeapLeaf<T>>::type
+{
+    static uint32_t type() { return (uint32_t)Registered<DefaultLeaf<T>>::get(); }
+};
+
+} /* namespace detail */
+
+/**
+ * How values of type T are stored in leaves: the leaf type id (type), the 64-bit value of a
+ * leaf with a given value (encode) and the value of a leaf (decode, which returns value_type,
+ * either T or const T&).
+ */
+template <typename T>
+struct Leaf : detail::DefaultLeaf<T> {};
+
+template <>
+struct Leaf<int64_t>
+{
+    typedef int64_t value_type;
+    static uint32_t type() { return 0; }
+    static uint64_t encode(int64_t value) { return (uint64_t)value; }
+    static int64_t decode(uint64_t v) { return (int64_t)v; }
+};
+
+template <>
+struct Leaf<double>
+{
+    typedef double value_type;
+    static uint32_t type() { return 1; }
+    static uint64_t encode(double value) { uint64_t v; std::memcpy(&v, &value, 8); return v; }
+    static double decode(uint64_t v) { double value; std::memcpy(&value, &v, 8); return value; }
+};
+
+/**
+ * The built-in operations.
+ */
+struct Plus {
+    static const bool commutative = true;
+    template <typename T> static T apply(const T& a, const T& b) { return a + b; }
+};
+
+struct Minus {
+    static const bool commutative = false;
+    template <typename T> static T apply(const T& a, const T& b) { return a - b; }
+};
+
+struct Times {
+    static const bool commutative = true;
+    template <typename T> static T apply(const T& a, const T& b) { return a * b; }
+};
+
+struct Min {
+    static const bool commutative = true;
+    template <typename T> static T apply(const T& a, const T& b) { return b < a ? b : a; }
+};
+
+struct Max {
+    static const bool commutative = true;
+    template <typename T> static T apply(const T& a, const T& b) { return a < b ? b : a; }
+};
+
+struct Negate {
+    template <typename T> static T apply(const T& a) { return -a; }
+};
+
+/**
+ * The compiled kernels for leaves of type T.
+ * The kernels can be called directly from Lace tasks (with the hidden Lace parameters),
+ * or via the members apply, uapply and abstract, which run them from any thread.
+ */
+template <typename T>
+class MtbddOps
+{
+public:
+    typedef typename Leaf<T>::value_type value_type;
+
+    static MTBDD leaf(const T &value)
+    {
+        return mtbdd_makeleaf(Leaf<T>::type(), Leaf<T>::encode(value));
+    }
+
+    static value_type value(MTBDD leaf)
+    {
+        assert(mtbdd_isleaf(leaf) && mtbdd_gettype(leaf) == Leaf<T>::type());
+        return Leaf<T>::decode(mtbdd_getvalue(leaf));
+    }
+
+    template <class Op>
+    static MTBDD apply(MTBDD a, MTBDD b)
+    {
+        Leaf<T>::type(); // register the type before the workers need it
+        opid<Op, 0>();
+        return mtbdd_kernel(apply_kernel<Op>, a, b);
+    }
+
+    template <class Op>
+    static MTBDD uapply(MTBDD a)
+    {
+        Leaf<T>::type();
+        opid<Op, 1>();
+        return mtbdd_kernel(uapply_kernel<Op>, a, mtbdd_false);
+    }
+
+    /**
+     * Abstract the variables in the cube <variables> from <a> with the binary operation Op.
+     */
+    template <class Op>
+    static MTBDD abstract(MTBDD a, MTBDD variables)
+    {
+        Leaf<T>::type();
+        opid<Op, 0>();
+        opid<Op, 2>();
+        return mtbdd_kernel(abstract_kernel<Op>, a, variables);
+    }
+
+    template <class Op>
+    static MTBDD apply_kernel(WorkerP *__lace_worker, Task *__lace_dq_head, MTBDD a, MTBDD b)
+    {
+        /* Check terminal cases */
+        if (a == mtbdd_false || b == mtbdd_false) return mtbdd_false;
+        const int la = mtbdd_isleaf(a), lb = mtbdd_isleaf(b);
+        if (la && lb) return leaf(Op::apply(value(a), value(b)));
+        if (Op::commutative && a > b) return apply_kernel<Op>(__lace_worker, __lace_dq_head, b, a);
+
+        /* Maybe perform garbage collection */
+        sylvan_gc_test();
+
+        /* Count operation */
+        sylvan_stats_count(MTBDD_APPLY);
+
+        /* Check cache */
+        const uint64_t id = opid<Op, 0>();
+        MTBDD result;
+        if (mtbdd_kernel_cache_get(id, a, b, &result)) {
+            sylvan_stats_count(MTBDD_APPLY_CACHED);
+            return result;
+        }
+
+        /* Get top variable and cofactors */
+        const uint32_t va = la ? 0xffffffff : mtbdd_getvar(a);
+        const uint32_t vb = lb ? 0xffffffff : mtbdd_getvar(b);
+        const uint32_t v = va < vb ? va : vb;
+        const MTBDD alow = va == v ? mtbdd_getlow(a) : a;
+        const MTBDD ahigh = va == v ? mtbdd_gethigh(a) : a;
+        const MTBDD blow = vb == v ? mtbdd_getlow(b) : b;
+        const MTBDD bhigh = vb == v ? mtbdd_gethigh(b) : b;
+
+        /* Recursive */
+        MTBDD low, high;
+        if (v >= sylvan_get_seqcutoff()) {
+            high = mtbdd_refs_push(apply_kernel<Op>(__lace_worker, __lace_dq_head, ahigh, bhigh));
+            low = apply_kernel<Op>(__lace_worker, __lace_dq_head, alow, blow);
+            mtbdd_refs_pop(1);
+        } else {
+            mtbdd_refs_spawn(SPAWN(mtbdd_kernel, apply_kernel<Op>, ahigh, bhigh));
+            low = mtbdd_refs_push(apply_kernel<Op>(__lace_worker, __lace_dq_head, alow, blow));
+            high = mtbdd_refs_sync(SYNC(mtbdd_kernel));
+            mtbdd_refs_pop(1);
+        }
+        result = mtbdd_makenode(v, low, high);
+
+        /* Store in cache */
+        if (mtbdd_kernel_cache_put(id, a, b, result)) sylvan_stats_count(MTBDD_APPLY_CACHEDPUT);
+        return result;
+    }
+
+    template <class Op>
+    static MTBDD uapply_kernel(WorkerP *__lace_worker, Task *__lace_dq_head, MTBDD a, MTBDD unused)
+    {
+        (void)unused;
+        if (a == mtbdd_false) return mtbdd_false;
+        if (mtbdd_isleaf(a)) return leaf(Op::apply(value(a)));
+
+        sylvan_gc_test();
+        sylvan_stats_count(MTBDD_UAPPLY);
+
+        const uint64_t id = opid<Op, 1>();
+        MTBDD result;
+        if (mtbdd_kernel_cache_get(id, a, 0, &result)) {
+            sylvan_stats_count(MTBDD_UAPPLY_CACHED);
+            return result;
+        }
+
+        const uint32_t v = mtbdd_getvar(a);
+        MTBDD low, high;
+        if (v >= sylvan_get_seqcutoff()) {
+            high = mtbdd_refs_push(uapply_kernel<Op>(__lace_worker, __lace_dq_head, mtbdd_gethigh(a), mtbdd_false));
+            low = uapply_kernel<Op>(__lace_worker, __lace_dq_head, mtbdd_getlow(a), mtbdd_false);
+            mtbdd_refs_pop(1);
+        } else {
+            mtbdd_refs_spawn(SPAWN(mtbdd_kernel, uapply_kernel<Op>, mtbdd_gethigh(a), mtbdd_false));
+            low = mtbdd_refs_push(uapply_kernel<Op>(__lace_worker, __lace_dq_head, mtbdd_getlow(a), mtbdd_false));
+            high = mtbdd_refs_sync(SYNC(mtbdd_kernel));
+            mtbdd_refs_pop(1);
+        }
+        result = mtbdd_makenode(v, low, high);
+
+        if (mtbdd_kernel_cache_put(id, a, 0, result)) sylvan_stats_count(MTBDD_UAPPLY_CACHEDPUT);
+        return result;
+    }
+
+    template <class Op>
+    static MTBDD abstract_kernel(WorkerP *__lace_worker, Task *__lace_dq_head, MTBDD a, MTBDD v)
+    {
+        if (v == mtbdd_true || a == mtbdd_false) return a;
+        if (mtbdd_isleaf(a)) {
+            // every remaining variable combines two copies of the leaf
+            T x = value(a);
+            for (; v != mtbdd_true; v = mtbdd_gethigh(v)) x = Op::apply(x, x);
+            return leaf(x);
+        }
+
+        sylvan_gc_test();
+        sylvan_stats_count(MTBDD_ABSTRACT);
+
+        const uint64_t id = opid<Op, 2>();
+        MTBDD result;
+        if (mtbdd_kernel_cache_get(id, a, v, &result)) {
+            sylvan_stats_count(MTBDD_ABSTRACT_CACHED);
+            return result;
+        }
+
+        const uint32_t va = mtbdd_getvar(a), vv = mtbdd_getvar(v);
+        if (vv < va) {
+            // the variable does not occur in <a>: combine <a> without it with itself
+            MTBDD r = mtbdd_refs_push(abstract_kernel<Op>(__lace_worker, __lace_dq_head, a, mtbdd_gethigh(v)));
+            result = apply_kernel<Op>(__lace_worker, __lace_dq_head, r, r);
+            mtbdd_refs_pop(1);
+        } else {
+            const MTBDD vnext = vv == va ? mtbdd_gethigh(v) : v;
+            mtbdd_refs_spawn(SPAWN(mtbdd_kernel, abstract_kernel<Op>, mtbdd_gethigh(a), vnext));
+            MTBDD low = mtbdd_refs_push(abstract_kernel<Op>(__lace_worker, __lace_dq_head, mtbdd_getlow(a), vnext));
+            MTBDD high = mtbdd_refs_push(mtbdd_refs_sync(SYNC(mtbdd_kernel)));
+            if (vv == va) result = apply_kernel<Op>(__lace_worker, __lace_dq_head, low, high);
+            else result = mtbdd_makenode(va, low, high);
+            mtbdd_refs_pop(2);
+        }
+
+        if (mtbdd_kernel_cache_put(id, a, v, result)) sylvan_stats_count(MTBDD_ABSTRACT_CACHEDPUT);
+        return result;
+    }
+
+private:
+    /* The operation id of the kernel for (T, Op); kind 0 = apply, 1 = uapply, 2 = abstract */
+    template <class Op, int Kind>
+    struct OpTag
+    {
+        static uint64_t create() { return mtbdd_kernel_opid(); }
+    };
+
+    template <class Op, int Kind>
+    static uint64_t opid()
+    {
+        return detail::Registered<OpTag<Op, Kind>>::get();
+    }
+};
+
+/**
+ * An MTBDD with leaves of type T, protected from garbage collection like sylvan::Mtbdd.
+ */
+template <typename T>
+class Mtbdd
+{
+public:
+    typedef MtbddOps<T> Ops;
+
+    Mtbdd() : mtbdd(mtbdd_false) { mtbdd_protect(&mtbdd); }
+    explicit Mtbdd(const MTBDD from) : mtbdd(from) { mtbdd_protect(&mtbdd); }
+    explicit Mtbdd(const sylvan::Mtbdd &from) : mtbdd(from.GetMTBDD()) { mtbdd_protect(&mtbdd); }
+    Mtbdd(const Mtbdd &from) : mtbdd(from.mtbdd) { mtbdd_protect(&mtbdd); }
+    Mtbdd(Mtbdd &&from) noexcept : mtbdd(from.mtbdd) { mtbdd_protect_move(&from.mtbdd, &mtbdd); from.mtbdd = sylvan_obj_moved; }
+    ~Mtbdd() { if (mtbdd != sylvan_obj_moved) mtbdd_unprotect(&mtbdd); }
+
+    Mtbdd& operator=(const Mtbdd &right)
+    {
+        const bool moved = mtbdd == sylvan_obj_moved;
+        mtbdd = right.mtbdd;
+        if (moved) mtbdd_protect(&mtbdd);
+        return *this;
+    }
+
+    Mtbdd& operator=(Mtbdd &&right) noexcept
+    {
+        if (mtbdd == sylvan_obj_moved) {
+            mtbdd = right.mtbdd;
+            mtbdd_protect_move(&right.mtbdd, &mtbdd);
+            right.mtbdd = sylvan_obj_moved;
+        } else {
+            mtbdd = right.mtbdd;
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Creates a leaf with value <value>
+     */
+    static Mtbdd terminal(const T &value) { return Mtbdd(Ops::leaf(value)); }
+
+    /**
+     * @brief Returns <then> where <condition> holds and <otherwise> elsewhere
+     */
+    static Mtbdd ite(const Bdd &condition, const Mtbdd &then, const Mtbdd &otherwise)
+    {
+        return Mtbdd(RUN(mtbdd_ite, condition.GetBDD(), then.mtbdd, otherwise.mtbdd));
+    }
+
+    /**
+     * @brief Gets the MTBDD of this Mtbdd (for C functions)
+     */
+    MTBDD GetMTBDD() const { return mtbdd; }
+
+    /**
+     * @brief Returns this Mtbdd as an untyped sylvan::Mtbdd
+     */
+    sylvan::Mtbdd untyped() const { return sylvan::Mtbdd(mtbdd); }
+
+    bool isLeaf() const { return mtbdd_isleaf(mtbdd) ? true : false; }
+
+    /**
+     * @brief Returns the value of this leaf
+     */
+    typename Ops::value_type value() const { return Ops::value(mtbdd); }
+
+    bool operator==(const Mtbdd &other) const { return mtbdd == other.mtbdd; }
+    bool operator!=(const Mtbdd &other) const { return mtbdd != other.mtbdd; }
+
+    template <class Op> Mtbdd apply(const Mtbdd &other) const { return Mtbdd(Ops::template apply<Op>(mtbdd, other.mtbdd)); }
+    template <class Op> Mtbdd uapply() const { return Mtbdd(Ops::template uapply<Op>(mtbdd)); }
+
+    /**
+     * @brief Abstracts the variables in the cube <variables> with the operation Op
+     */
+    template <class Op> Mtbdd abstract(const Bdd &variables) const { return Mtbdd(Ops::template abstract<Op>(mtbdd, variables.GetBDD())); }
+
+    Mtbdd operator+(const Mtbdd &other) const { return apply<Plus>(other); }
+    Mtbdd operator-(const Mtbdd &other) const { return apply<Minus>(other); }
+    Mtbdd operator*(const Mtbdd &other) const { return apply<Times>(other); }
+    Mtbdd operator-() const { return uapply<Negate>(); }
+    Mtbdd Min(const Mtbdd &other) const { return apply<sylvan::mt::Min>(other); }
+    Mtbdd Max(const Mtbdd &other) const { return apply<sylvan::mt::Max>(other); }
+
+    Mtbdd& operator+=(const Mtbdd &other) { mtbdd = Ops::template apply<Plus>(mtbdd, other.mtbdd); return *this; }
+    Mtbdd& operator-=(const Mtbdd &other) { mtbdd = Ops::template apply<Minus>(mtbdd, other.mtbdd); return *this; }
+    Mtbdd& operator*=(const Mtbdd &other) { mtbdd = Ops::template apply<Times>(mtbdd, other.mtbdd); return *this; }
+
+    // the result reuses the root of the temporary <left>, e.g. in a + b + c
+    friend Mtbdd operator+(Mtbdd&& left, const Mtbdd& right) { left += right; return std::move(left); }
+    friend Mtbdd operator-(Mtbdd&& left, const Mtbdd& right) { left -= right; return std::move(left); }
+    friend Mtbdd operator*(Mtbdd&& left, const Mtbdd& right) { left *= right; return std::move(left); }
+
+private:
+    MTBDD mtbdd;
+};
+
+} /* namespace mt */
+
+} /* namespace sylvan */
+
+#endif
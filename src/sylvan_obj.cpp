@@ -19,6 +19,18 @@
 
 using namespace sylvan;
 
+/* Fulfill the promise of a submitted operation, see Bdd::submit and Mtbdd::submit */
+template <typename T>
+static void
+submit_done(sylvan_future_t *future, void *context)
+{
+    std::promise<T> *promise = (std::promise<T>*)context;
+    T result(sylvan_future_get(future));
+    sylvan_future_free(future);
+    promise->set_value(std::move(result));
+    delete promise;
+}
+
 /***
  * Implementation of class Bdd
  */
@@ -38,7 +50,22 @@ Bdd::operator!=(const Bdd& other) const
 Bdd&
 Bdd::operator=(const Bdd& right)
 {
+    const bool moved = bdd == sylvan_obj_moved;
     bdd = right.bdd;
+    if (moved) sylvan_protect(&bdd);
+    return *this;
+}
+
+Bdd&
+Bdd::operator=(Bdd&& right) noexcept
+{
+    if (bdd == sylvan_obj_moved) {
+        bdd = right.bdd;
+        sylvan_protect_move(&right.bdd, &bdd);
+        right.bdd = sylvan_obj_moved;
+    } else {
+        bdd = right.bdd;
+    }
     return *this;
 }
 
@@ -274,7 +301,7 @@ Bdd::Permute(const std::vector<uint32_t>& from, const std::vector<uint32_t>& to)
         map.put(from[i], Bdd::bddVar(to[i]));
     }
 
-    return sylvan_compose(bdd, map.bdd);
+    return sylvan_rename(bdd, map.bdd);
 }
 
 Bdd
@@ -415,6 +442,15 @@ Bdd::NodeCount() const
     return sylvan_nodecount(bdd);
 }
 
+std::future<Bdd>
+Bdd::submit(const sylvan_op_t &op)
+{
+    std::promise<Bdd> *promise = new std::promise<Bdd>();
+    std::future<Bdd> result = promise->get_future();
+    sylvan_submit_cb(&op, submit_done<Bdd>, promise);
+    return result;
+}
+
 Bdd
 Bdd::bddOne()
 {
@@ -498,6 +534,28 @@ BddMap::BddMap(uint32_t key_variable, const Bdd value)
 }
 
 
+BddMap&
+BddMap::operator=(const BddMap& right)
+{
+    const bool moved = bdd == sylvan_obj_moved;
+    bdd = right.bdd;
+    if (moved) sylvan_protect(&bdd);
+    return *this;
+}
+
+BddMap&
+BddMap::operator=(BddMap&& right) noexcept
+{
+    if (bdd == sylvan_obj_moved) {
+        bdd = right.bdd;
+        sylvan_protect_move(&right.bdd, &bdd);
+        right.bdd = sylvan_obj_moved;
+    } else {
+        bdd = right.bdd;
+    }
+    return *this;
+}
+
 BddMap
 BddMap::operator+(const Bdd& other) const
 {
@@ -749,7 +807,22 @@ Mtbdd::operator!=(const Mtbdd& other) const
 Mtbdd&
 Mtbdd::operator=(const Mtbdd& right)
 {
+    const bool moved = mtbdd == sylvan_obj_moved;
     mtbdd = right.mtbdd;
+    if (moved) mtbdd_protect(&mtbdd);
+    return *this;
+}
+
+Mtbdd&
+Mtbdd::operator=(Mtbdd&& right) noexcept
+{
+    if (mtbdd == sylvan_obj_moved) {
+        mtbdd = right.mtbdd;
+        mtbdd_protect_move(&right.mtbdd, &mtbdd);
+        right.mtbdd = sylvan_obj_moved;
+    } else {
+        mtbdd = right.mtbdd;
+    }
     return *this;
 }
 
@@ -855,7 +928,7 @@ Mtbdd::Permute(const std::vector<uint32_t>& from, const std::vector<uint32_t>& t
         map.put(from[i], Bdd::bddVar(to[i]));
     }
 
-    return mtbdd_compose(mtbdd, map.mtbdd);
+    return mtbdd_rename(mtbdd, map.mtbdd);
 }
 
 double
@@ -876,6 +949,15 @@ Mtbdd::NodeCount() const
     return mtbdd_nodecount(mtbdd);
 }
 
+std::future<Mtbdd>
+Mtbdd::submit(const sylvan_op_t &op)
+{
+    std::promise<Mtbdd> *promise = new std::promise<Mtbdd>();
+    std::future<Mtbdd> result = promise->get_future();
+    sylvan_submit_cb(&op, submit_done<Mtbdd>, promise);
+    return result;
+}
+
 
 /***
  * Implementation of class MtbddMap
@@ -886,6 +968,28 @@ MtbddMap::MtbddMap(uint32_t key_variable, Mtbdd value)
     mtbdd = mtbdd_map_add(mtbdd_map_empty(), key_variable, value.mtbdd);
 }
 
+MtbddMap&
+MtbddMap::operator=(const MtbddMap& right)
+{
+    const bool moved = mtbdd == sylvan_obj_moved;
+    mtbdd = right.mtbdd;
+    if (moved) mtbdd_protect(&mtbdd);
+    return *this;
+}
+
+MtbddMap&
+MtbddMap::operator=(MtbddMap&& right) noexcept
+{
+    if (mtbdd == sylvan_obj_moved) {
+        mtbdd = right.mtbdd;
+        mtbdd_protect_move(&right.mtbdd, &mtbdd);
+        right.mtbdd = sylvan_obj_moved;
+    } else {
+        mtbdd = right.mtbdd;
+    }
+    return *this;
+}
+
 MtbddMap
 MtbddMap::operator+(const Mtbdd& other) const
 {
@@ -960,6 +1064,18 @@ Sylvan::getGranularity()
     return sylvan_get_granularity();
 }
 
+void
+Sylvan::setSeqCutoff(uint32_t level)
+{
+    sylvan_set_seqcutoff(level);
+}
+
+uint32_t
+Sylvan::getSeqCutoff()
+{
+    return sylvan_get_seqcutoff();
+}
+
 void
 Sylvan::initBdd()
 {
@@ -17,7 +17,9 @@
 #ifndef SYLVAN_OBJ_H
 #define SYLVAN_OBJ_H
 
+#include <future>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <lace.h>
@@ -25,6 +27,12 @@
 
 namespace sylvan {
 
+/**
+ * The value of a Bdd, Mtbdd, BddMap or MtbddMap that has been moved from.
+ * Such an object is not protected, and may only be assigned to or destroyed.
+ */
+static const MTBDD sylvan_obj_moved = 0x7fffffffffffffffLL;
+
 class BddSet;
 class BddMap;
 
@@ -38,8 +46,9 @@ public:
     Bdd() { bdd = sylvan_false; sylvan_protect(&bdd); }
     Bdd(const BDD from) : bdd(from) { sylvan_protect(&bdd); }
     Bdd(const Bdd &from) : bdd(from.bdd) { sylvan_protect(&bdd); }
+    Bdd(Bdd &&from) noexcept : bdd(from.bdd) { sylvan_protect_move(&from.bdd, &bdd); from.bdd = sylvan_obj_moved; }
     Bdd(const uint32_t var) { bdd = sylvan_ithvar(var); sylvan_protect(&bdd); }
-    ~Bdd() { sylvan_unprotect(&bdd); }
+    ~Bdd() { if (bdd != sylvan_obj_moved) sylvan_unprotect(&bdd); }
 
     /**
      * @brief Creates a Bdd representing just the variable index in its positive form
@@ -82,6 +91,7 @@ public:
     bool operator==(const Bdd& other) const;
     bool operator!=(const Bdd& other) const;
     Bdd& operator=(const Bdd& right);
+    Bdd& operator=(Bdd&& right) noexcept;
     bool operator<=(const Bdd& other) const;
     bool operator>=(const Bdd& other) const;
     bool operator<(const Bdd& other) const;
@@ -101,6 +111,14 @@ public:
     Bdd operator-(const Bdd& other) const;
     Bdd& operator-=(const Bdd& other);
 
+    // the result reuses the root of the temporary <left>, e.g. in a & b & c
+    friend Bdd operator*(Bdd&& left, const Bdd& right) { left *= right; return std::move(left); }
+    friend Bdd operator&(Bdd&& left, const Bdd& right) { left &= right; return std::move(left); }
+    friend Bdd operator+(Bdd&& left, const Bdd& right) { left += right; return std::move(left); }
+    friend Bdd operator|(Bdd&& left, const Bdd& right) { left |= right; return std::move(left); }
+    friend Bdd operator^(Bdd&& left, const Bdd& right) { left ^= right; return std::move(left); }
+    friend Bdd operator-(Bdd&& left, const Bdd& right) { left -= right; return std::move(left); }
+
     /**
      * @brief Returns non-zero if this Bdd is bddOne() or bddZero()
      */
@@ -329,6 +347,12 @@ public:
      */
     size_t NodeCount() const;
 
+    /**
+     * @brief Submit an operation from any thread, see sylvan_submit.
+     * The future gets the result when the operation is done.
+     */
+    static std::future<Bdd> submit(const sylvan_op_t &op);
+
 private:
     BDD bdd;
 };
@@ -355,6 +379,10 @@ public:
      */
     BddSet(const BddSet &other) : set(other.set) {}
 
+    BddSet(BddSet &&other) noexcept = default;
+    BddSet& operator=(const BddSet &other) = default;
+    BddSet& operator=(BddSet &&other) noexcept = default;
+
     /**
      * @brief Add the variable <variable> to this set.
      */
@@ -491,16 +519,24 @@ class BddMap
     BddMap(const Bdd &from) : bdd(from.bdd) { sylvan_protect(&bdd); }
 public:
     BddMap(const BddMap& from) : bdd(from.bdd) { sylvan_protect(&bdd); }
+    BddMap(BddMap&& from) noexcept : bdd(from.bdd) { sylvan_protect_move(&from.bdd, &bdd); from.bdd = sylvan_obj_moved; }
     BddMap() : bdd(sylvan_map_empty()) { sylvan_protect(&bdd); }
-    ~BddMap() { sylvan_unprotect(&bdd); }
+    ~BddMap() { if (bdd != sylvan_obj_moved) sylvan_unprotect(&bdd); }
 
     BddMap(uint32_t key_variable, const Bdd value);
 
+    BddMap& operator=(const BddMap& right);
+    BddMap& operator=(BddMap&& right) noexcept;
+
     BddMap operator+(const Bdd& other) const;
     BddMap& operator+=(const Bdd& other);
     BddMap operator-(const Bdd& other) const;
     BddMap& operator-=(const Bdd& other);
 
+    // the result reuses the root of the temporary <left>
+    friend BddMap operator+(BddMap&& left, const Bdd& right) { left += right; return std::move(left); }
+    friend BddMap operator-(BddMap&& left, const Bdd& right) { left -= right; return std::move(left); }
+
     /**
      * @brief Adds a key-value pair to the map
      */
@@ -532,8 +568,10 @@ public:
     Mtbdd() { mtbdd = sylvan_false; mtbdd_protect(&mtbdd); }
     Mtbdd(const MTBDD from) : mtbdd(from) { mtbdd_protect(&mtbdd); }
     Mtbdd(const Mtbdd &from) : mtbdd(from.mtbdd) { mtbdd_protect(&mtbdd); }
+    Mtbdd(Mtbdd &&from) noexcept : mtbdd(from.mtbdd) { mtbdd_protect_move(&from.mtbdd, &mtbdd); from.mtbdd = sylvan_obj_moved; }
     Mtbdd(const Bdd &from) : mtbdd(from.bdd) { mtbdd_protect(&mtbdd); }
-    ~Mtbdd() { mtbdd_unprotect(&mtbdd); }
+    Mtbdd(Bdd &&from) noexcept : mtbdd(from.bdd) { mtbdd_protect_move(&from.bdd, &mtbdd); from.bdd = sylvan_obj_moved; }
+    ~Mtbdd() { if (mtbdd != sylvan_obj_moved) mtbdd_unprotect(&mtbdd); }
 
     /**
      * @brief Creates a Mtbdd leaf representing the int64 value <value>
@@ -600,6 +638,7 @@ public:
     bool operator==(const Mtbdd& other) const;
     bool operator!=(const Mtbdd& other) const;
     Mtbdd& operator=(const Mtbdd& right);
+    Mtbdd& operator=(Mtbdd&& right) noexcept;
     Mtbdd operator!() const;
     Mtbdd operator~() const;
     Mtbdd operator*(const Mtbdd& other) const;
@@ -609,6 +648,11 @@ public:
     Mtbdd operator-(const Mtbdd& other) const;
     Mtbdd& operator-=(const Mtbdd& other);
 
+    // the result reuses the root of the temporary <left>, e.g. in a + b + c
+    friend Mtbdd operator*(Mtbdd&& left, const Mtbdd& right) { left *= right; return std::move(left); }
+    friend Mtbdd operator+(Mtbdd&& left, const Mtbdd& right) { left += right; return std::move(left); }
+    friend Mtbdd operator-(Mtbdd&& left, const Mtbdd& right) { left -= right; return std::move(left); }
+
     // not implemented (compared to Bdd): <=, >=, <, >, &, &=, |, |=, ^, ^=
 
     /**
@@ -778,6 +822,12 @@ public:
      */
     size_t NodeCount() const;
 
+    /**
+     * @brief Submit an operation from any thread, see sylvan_submit.
+     * The future gets the result when the operation is done.
+     */
+    static std::future<Mtbdd> submit(const sylvan_op_t &op);
+
 private:
     MTBDD mtbdd;
 };
@@ -790,16 +840,24 @@ class MtbddMap
     MtbddMap(Mtbdd &from) : mtbdd(from.mtbdd) { mtbdd_protect(&mtbdd); }
 public:
     MtbddMap(const MtbddMap& from) : mtbdd(from.mtbdd) { mtbdd_protect(&mtbdd); }
+    MtbddMap(MtbddMap&& from) noexcept : mtbdd(from.mtbdd) { mtbdd_protect_move(&from.mtbdd, &mtbdd); from.mtbdd = sylvan_obj_moved; }
     MtbddMap() : mtbdd(mtbdd_map_empty()) { mtbdd_protect(&mtbdd); }
-    ~MtbddMap() { mtbdd_unprotect(&mtbdd); }
+    ~MtbddMap() { if (mtbdd != sylvan_obj_moved) mtbdd_unprotect(&mtbdd); }
 
     MtbddMap(uint32_t key_variable, Mtbdd value);
 
+    MtbddMap& operator=(const MtbddMap& right);
+    MtbddMap& operator=(MtbddMap&& right) noexcept;
+
     MtbddMap operator+(const Mtbdd& other) const;
     MtbddMap& operator+=(const Mtbdd& other);
     MtbddMap operator-(const Mtbdd& other) const;
     MtbddMap& operator-=(const Mtbdd& other);
 
+    // the result reuses the root of the temporary <left>
+    friend MtbddMap operator+(MtbddMap&& left, const Mtbdd& right) { left += right; return std::move(left); }
+    friend MtbddMap operator-(MtbddMap&& left, const Mtbdd& right) { left -= right; return std::move(left); }
+
     /**
      * @brief Adds a key-value pair to the map
      */
@@ -845,6 +903,18 @@ public:
      */
     static int getGranularity();
 
+    /**
+     * @brief Set the sequential cut-off level for the parallel operations.
+     * @param level subproblems whose top variable is at or below this level are computed without spawning tasks.
+     * The default value 0xffffffff means that operations always spawn.
+     */
+    static void setSeqCutoff(uint32_t level);
+
+    /**
+     * @brief Retrieve the sequential cut-off level for the parallel operations.
+     */
+    static uint32_t getSeqCutoff();
+
     /**
      * @brief Initializes the BDD module of the Sylvan framework.
      */
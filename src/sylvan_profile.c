@@ -0,0 +1,319 @@
+/*
+ * Copyright 2011-2016 Formal Methods and Tools, University of Twente
+ * Copyright 2016-2017 Tom van Dijk, Johannes Kepler University Linz
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sylvan_int.h>
+#include <sylvan_align.h>
+
+#include <errno.h>  // for errno
+#include <string.h> // for strerror
+#include <inttypes.h>
+#include <pthread.h>
+
+/**
+ * The profile of one worker, indexed by the operation counters (e.g. BDD_AND, BDD_AND_CACHED).
+ * Only the owning worker writes to it.
+ */
+typedef struct profile_worker
+{
+    size_t op;                      // the current operation (0 if none)
+    uint64_t calls;                 // totals over all operations
+    uint64_t cache_hits;
+    uint64_t nodes;
+    uint64_t counts[SYLVAN_GC_COUNT];
+    uint64_t op_nodes[SYLVAN_GC_COUNT];
+} __attribute__((aligned(64))) profile_worker_t;
+
+int sylvan_profile_active = 0;
+
+static profile_worker_t *profile_workers = NULL;
+static profile_worker_t profile_dummy;     // for threads that are not Lace workers
+static unsigned int profile_n_workers = 0;
+static int profile_quit_registered = 0;
+
+/**
+ * The top-level operations, found by name.
+ */
+static sylvan_profile_entry_t *profile_toplevel = NULL;
+static size_t profile_toplevel_count = 0;
+static size_t profile_toplevel_size = 0;
+static pthread_mutex_t profile_toplevel_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static inline profile_worker_t*
+profile_get_local(void)
+{
+    WorkerP *w = lace_get_worker();
+    if (w == NULL || (unsigned int)w->worker >= profile_n_workers) return &profile_dummy;
+    return profile_workers + w->worker;
+}
+
+static inline int
+is_node_counter(size_t counter)
+{
+    return counter == BDD_NODES_CREATED || counter == LDD_NODES_CREATED || counter == ZDD_NODES_CREATED;
+}
+
+/* Every operation has three counters: the call, the cache put and the cache hit */
+static inline int
+is_call_counter(size_t counter)
+{
+    return counter >= BDD_ITE && (counter - BDD_ITE) % 3 == 0;
+}
+
+static inline int
+is_hit_counter(size_t counter)
+{
+    return counter >= BDD_ITE && (counter - BDD_ITE) % 3 == 2;
+}
+
+void
+sylvan_profile_count(size_t counter)
+{
+    profile_worker_t *p = profile_get_local();
+    if (is_node_counter(counter)) {
+        p->op_nodes[p->op]++;
+        p->nodes++;
+    } else if (is_call_counter(counter)) {
+        p->counts[counter]++;
+        p->calls++;
+        p->op = counter;
+    } else if (is_hit_counter(counter)) {
+        p->counts[counter]++;
+        p->cache_hits++;
+    }
+}
+
+static void
+sylvan_profile_free()
+{
+    sylvan_profile_active = 0;
+    if (profile_workers != NULL) {
+        free_aligned(profile_workers, profile_n_workers * sizeof(profile_worker_t));
+        sylvan_memory_sub(SYLVAN_MEM_INSTRUMENTATION, profile_n_workers * sizeof(profile_worker_t));
+    }
+    profile_workers = NULL;
+    profile_n_workers = 0;
+    free(profile_toplevel);
+    profile_toplevel = NULL;
+    profile_toplevel_count = 0;
+    profile_toplevel_size = 0;
+}
+
+static void
+sylvan_profile_quit()
+{
+    sylvan_profile_free();
+    profile_quit_registered = 0;
+}
+
+void
+sylvan_profile_enable()
+{
+    sylvan_profile_free();
+
+    profile_n_workers = lace_workers();
+    profile_workers = (profile_worker_t*)alloc_aligned(profile_n_workers * sizeof(profile_worker_t));
+    if (profile_workers == 0) {
+        fprintf(stderr, "sylvan_profile: Unable to allocate memory: %s!\n", strerror(errno));
+        exit(1);
+    }
+    sylvan_memory_add(SYLVAN_MEM_INSTRUMENTATION, profile_n_workers * sizeof(profile_worker_t));
+    memset(&profile_dummy, 0, sizeof(profile_worker_t));
+
+    if (!profile_quit_registered) {
+        sylvan_register_quit(sylvan_profile_quit);
+        profile_quit_registered = 1;
+    }
+
+    sylvan_profile_active = 1;
+}
+
+void
+sylvan_profile_disable()
+{
+    sylvan_profile_active = 0;
+}
+
+void
+sylvan_profile_reset()
+{
+    if (profile_workers != NULL) memset(profile_workers, 0, profile_n_workers * sizeof(profile_worker_t));
+    memset(&profile_dummy, 0, sizeof(profile_worker_t));
+    pthread_mutex_lock(&profile_toplevel_lock);
+    profile_toplevel_count = 0;
+    pthread_mutex_unlock(&profile_toplevel_lock);
+}
+
+/**
+ * Sum the totals of all workers (without stopping them).
+ */
+static void
+profile_totals(sylvan_profile_scope_t *scope)
+{
+    scope->calls = profile_dummy.calls;
+    scope->cache_hits = profile_dummy.cache_hits;
+    scope->nodes = profile_dummy.nodes;
+    for (unsigned int i=0; i<profile_n_workers; i++) {
+        scope->calls += profile_workers[i].calls;
+        scope->cache_hits += profile_workers[i].cache_hits;
+        scope->nodes += profile_workers[i].nodes;
+    }
+}
+
+void
+sylvan_profile_begin(sylvan_profile_scope_t *scope)
+{
+    profile_totals(scope);
+    scope->start = getabstime();
+}
+
+void
+sylvan_profile_end(sylvan_profile_scope_t *scope, const char *name)
+{
+    if (scope->start == 0) return; // the profiler was enabled during the operation
+    uint64_t time = getabstime() - scope->start;
+    sylvan_profile_scope_t after;
+    profile_totals(&after);
+
+    pthread_mutex_lock(&profile_toplevel_lock);
+    sylvan_profile_entry_t *e = NULL;
+    for (size_t i=0; i<profile_toplevel_count; i++) {
+        if (strcmp(profile_toplevel[i].name, name) == 0) {
+            e = profile_toplevel + i;
+            break;
+        }
+    }
+    if (e == NULL) {
+        if (profile_toplevel_count == profile_toplevel_size) {
+            profile_toplevel_size += 16;
+            profile_toplevel = (sylvan_profile_entry_t*)realloc(profile_toplevel, sizeof(sylvan_profile_entry_t) * profile_toplevel_size);
+        }
+        e = profile_toplevel + profile_toplevel_count++;
+        memset(e, 0, sizeof(sylvan_profile_entry_t));
+        e->name = name;
+    }
+    e->calls += after.calls - scope->calls;
+    e->cache_hits += after.cache_hits - scope->cache_hits;
+    e->nodes += after.nodes - scope->nodes;
+    e->time += time;
+    pthread_mutex_unlock(&profile_toplevel_lock);
+}
+
+static int
+profile_compare(const void *a, const void *b)
+{
+    const sylvan_profile_entry_t *x = (const sylvan_profile_entry_t*)a;
+    const sylvan_profile_entry_t *y = (const sylvan_profile_entry_t*)b;
+    if (x->nodes != y->nodes) return x->nodes < y->nodes ? 1 : -1;
+    if (x->time != y->time) return x->time < y->time ? 1 : -1;
+    if (x->calls != y->calls) return x->calls < y->calls ? 1 : -1;
+    return strcmp(x->name, y->name);
+}
+
+size_t
+sylvan_profile_get(int toplevel, sylvan_profile_entry_t *entries, size_t max)
+{
+    sylvan_profile_entry_t *all;
+    size_t count = 0;
+
+    if (toplevel) {
+        pthread_mutex_lock(&profile_toplevel_lock);
+        all = (sylvan_profile_entry_t*)malloc(sizeof(sylvan_profile_entry_t) * (profile_toplevel_count + 1));
+        memcpy(all, profile_toplevel, sizeof(sylvan_profile_entry_t) * profile_toplevel_count);
+        count = profile_toplevel_count;
+        pthread_mutex_unlock(&profile_toplevel_lock);
+    } else {
+        all = (sylvan_profile_entry_t*)malloc(sizeof(sylvan_profile_entry_t) * SYLVAN_GC_COUNT);
+        for (size_t op=0; op<SYLVAN_GC_COUNT; op++) {
+            if (op != 0 && !is_call_counter(op)) continue;
+            sylvan_profile_entry_t e = { op == 0 ? "(no operation)" : sylvan_stats_counter_name(op), 0, 0, 0, 0 };
+            for (unsigned int i=0; i<=profile_n_workers; i++) {
+                profile_worker_t *p = i < profile_n_workers ? profile_workers + i : &profile_dummy;
+                if (op != 0) {
+                    e.calls += p->counts[op];
+                    e.cache_hits += p->counts[op+2];
+                }
+                e.nodes += p->op_nodes[op];
+            }
+            if (e.calls != 0 || e.nodes != 0) all[count++] = e;
+        }
+    }
+
+    qsort(all, count, sizeof(sylvan_profile_entry_t), profile_compare);
+    if (max > 0) memcpy(entries, all, sizeof(sylvan_profile_entry_t) * (count < max ? count : max));
+    free(all);
+    return count;
+}
+
+static void
+profile_report_table(FILE *target, int toplevel)
+{
+    size_t count = sylvan_profile_get(toplevel, NULL, 0);
+    sylvan_profile_entry_t *entries = (sylvan_profile_entry_t*)malloc(sizeof(sylvan_profile_entry_t) * (count + 1));
+    count = sylvan_profile_get(toplevel, entries, count);
+
+    uint64_t total = 0;
+    for (size_t i=0; i<count; i++) total += entries[i].nodes;
+
+    if (toplevel) fprintf(target, "%-28s %16s %7s %16s %16s %12s\n", "Top-level operation", "nodes", "%", "calls", "cache hits", "time (ms)");
+    else fprintf(target, "%-28s %16s %7s %16s %16s\n", "Operation", "nodes", "%", "calls", "cache hits");
+    for (size_t i=0; i<count; i++) {
+        sylvan_profile_entry_t *e = entries + i;
+        double pct = total == 0 ? 0.0 : 100.0 * e->nodes / total;
+        fprintf(target, "%-28s %'16" PRIu64 " %6.2f%% %'16" PRIu64 " %'16" PRIu64, e->name, e->nodes, pct, e->calls, e->cache_hits);
+        if (toplevel) fprintf(target, " %12.2f", e->time / 1000000.0);
+        fprintf(target, "\n");
+    }
+    free(entries);
+}
+
+void
+sylvan_profile_report(FILE *target)
+{
+    fprintf(target, "Sylvan operation profile\n");
+    profile_report_table(target, 1);
+    fprintf(target, "\n");
+    profile_report_table(target, 0);
+}
+
+static void
+profile_write_json_array(FILE *target, int toplevel)
+{
+    size_t count = sylvan_profile_get(toplevel, NULL, 0);
+    sylvan_profile_entry_t *entries = (sylvan_profile_entry_t*)malloc(sizeof(sylvan_profile_entry_t) * (count + 1));
+    count = sylvan_profile_get(toplevel, entries, count);
+
+    fprintf(target, "[");
+    for (size_t i=0; i<count; i++) {
+        sylvan_profile_entry_t *e = entries + i;
+        fprintf(target, "%s{\"name\":\"%s\",\"nodes\":%" PRIu64 ",\"calls\":%" PRIu64 ",\"cache_hits\":%" PRIu64,
+                i == 0 ? "" : ",", e->name, e->nodes, e->calls, e->cache_hits);
+        if (toplevel) fprintf(target, ",\"time\":%" PRIu64, e->time);
+        fprintf(target, "}");
+    }
+    fprintf(target, "]");
+    free(entries);
+}
+
+void
+sylvan_profile_write_json(FILE *target)
+{
+    fprintf(target, "{\"toplevel\":");
+    profile_write_json_array(target, 1);
+    fprintf(target, ",\"operations\":");
+    profile_write_json_array(target, 0);
+    fprintf(target, "}\n");
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2011-2016 Formal Methods and Tools, University of Twente
+ * Copyright 2016-2017 Tom van Dijk, Johannes Kepler University Linz
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Do not include this file directly. Instead, include sylvan.h */
+
+#ifndef SYLVAN_PROFILE_H
+#define SYLVAN_PROFILE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * Operation profiler.
+ *
+ * When the profiler is enabled, every worker keeps a "current operation" tag, which is set
+ * whenever an operation (e.g. bdd_and, ldd_relprod) is entered, i.e., where the operation
+ * counter of the statistics is counted. Nodes created by the worker are attributed to the
+ * operation in its tag, as well as the calls to the operation and the calls answered by the
+ * operation cache. The tag is not restored when a nested operation returns, so nodes that an
+ * operation creates after calling a different operation are attributed to the nested one.
+ *
+ * In addition, every top-level operation called via its public macro (e.g. sylvan_relnext,
+ * lddmc_relprod_union) is attributed the wall time of the call and the nodes created and
+ * operations called by all workers during the call. If several top-level operations run at
+ * the same time (e.g. from parallel tasks), each of them is attributed all of this work.
+ *
+ * The profiler is independent of the statistics (sylvan_stats_enable).
+ */
+
+/**
+ * Enable the profiler. Resets any earlier profile.
+ */
+void sylvan_profile_enable(void);
+
+/**
+ * Disable the profiler. The profile remains available for the report.
+ */
+void sylvan_profile_disable(void);
+
+/**
+ * Reset the profile.
+ */
+void sylvan_profile_reset(void);
+
+/**
+ * The profile of one operation.
+ */
+typedef struct sylvan_profile_entry
+{
+    const char *name;       // e.g. "bdd_and" (nested) or "sylvan_and" (top-level)
+    uint64_t calls;         // number of calls (each call does at most one cache lookup)
+    uint64_t cache_hits;    // number of calls answered by the operation cache
+    uint64_t nodes;         // number of nodes created
+    uint64_t time;          // wall time in ns (only for top-level operations)
+} sylvan_profile_entry_t;
+
+/**
+ * Get the profile of the top-level operations (if <toplevel> is set) or of the nested
+ * operations (otherwise), ranked by the number of created nodes and then by time.
+ * Writes at most <max> entries to <entries> and returns the total number of entries.
+ */
+size_t sylvan_profile_get(int toplevel, sylvan_profile_entry_t *entries, size_t max);
+
+/**
+ * Write a report of the top-level and nested operations, ranked by nodes created and time.
+ */
+void sylvan_profile_report(FILE *target);
+
+/**
+ * Write the profile as a single line of JSON.
+ */
+void sylvan_profile_write_json(FILE *target);
+
+/**
+ * Internal: the start and end of a top-level operation (see SYLVAN_TRACE_RUN).
+ */
+typedef struct sylvan_profile_scope
+{
+    uint64_t start;
+    uint64_t calls;
+    uint64_t cache_hits;
+    uint64_t nodes;
+} sylvan_profile_scope_t;
+
+void sylvan_profile_begin(sylvan_profile_scope_t *scope);
+void sylvan_profile_end(sylvan_profile_scope_t *scope, const char *name);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif
@@ -0,0 +1,542 @@
+/*
+ * Copyright 2011-2016 Formal Methods and Tools, University of Twente
+ * Copyright 2016-2017 Tom van Dijk, Johannes Kepler University Linz
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sylvan_int.h>
+
+#include <string.h>
+
+/**
+ * A search: the partitions (for SAT ordered by their first variable) and the options.
+ */
+typedef struct reach
+{
+    BDD *rels;
+    BDDSET *vars;
+    size_t n;
+    sylvan_reach_opts_t *opts;
+    uint64_t id;        // distinguishes the cache entries of the saturation of different searches
+    BDD enabled;        // the states with a successor, if deadlocks are checked
+} reach_t;
+
+static _Atomic(uint64_t) reach_next_id = 1;
+
+/**
+ * The states with a successor in partitions [from, from+len), computed in parallel.
+ */
+TASK_3(BDD, reach_enabled, reach_t*, r, size_t, from, size_t, len)
+{
+    if (len == 1) return sylvan_relprev(r->rels[from], sylvan_true, r->vars[from]);
+
+    bdd_refs_spawn(SPAWN(reach_enabled, r, from, (len+1)/2));
+    BDD right = bdd_refs_push(CALL(reach_enabled, r, from+(len+1)/2, len/2));
+    BDD left = bdd_refs_push(bdd_refs_sync(SYNC(reach_enabled)));
+    BDD result = sylvan_or(left, right);
+    bdd_refs_pop(2);
+    return result;
+}
+
+/**
+ * The successors of <cur> that are not in <visited>, with partitions [from, from+len),
+ * in parallel (PAR) or one after another (BFS).
+ */
+TASK_6(BDD, reach_level, reach_t*, r, BDD, cur, BDD, visited, size_t, from, size_t, len, int, par)
+{
+    if (len == 1) {
+        BDD succ = bdd_refs_push(sylvan_relnext(cur, r->rels[from], r->vars[from]));
+        BDD result = sylvan_diff(succ, visited);
+        bdd_refs_pop(1);
+        return result;
+    }
+
+    BDD left, right;
+    if (par) {
+        bdd_refs_spawn(SPAWN(reach_level, r, cur, visited, from, (len+1)/2, par));
+        right = bdd_refs_push(CALL(reach_level, r, cur, visited, from+(len+1)/2, len/2, par));
+        left = bdd_refs_push(bdd_refs_sync(SYNC(reach_level)));
+    } else {
+        left = bdd_refs_push(CALL(reach_level, r, cur, visited, from, (len+1)/2, par));
+        right = bdd_refs_push(CALL(reach_level, r, cur, visited, from+(len+1)/2, len/2, par));
+    }
+    BDD result = sylvan_or(left, right);
+    bdd_refs_pop(2);
+    return result;
+}
+
+/**
+ * The states reachable from <set> with partitions [idx, n), by saturation.
+ */
+TASK_3(BDD, reach_sat, reach_t*, r, BDD, set, size_t, idx)
+{
+    /* Terminal cases */
+    if (set == sylvan_false) return sylvan_false;
+    if (idx == r->n) return set;
+
+    /* Consult the cache */
+    BDD result;
+    const BDD _set = set;
+    if (cache_get3(CACHE_BDD_REACH_SAT, _set, idx, r->id, &result)) return result;
+    bdd_refs_pushptr(&_set);
+
+    /* Check if the partition should be applied */
+    const uint32_t var = sylvan_var(r->vars[idx]);
+    if (set == sylvan_true || var <= sylvan_var(set)) {
+        /* The partitions starting at this variable */
+        size_t count = idx+1;
+        while (count < r->n && var == sylvan_var(r->vars[count])) count++;
+        count -= idx;
+        /* Until fixpoint: saturate deeper, then apply every partition of this level once */
+        BDD prev = sylvan_false;
+        BDD step = sylvan_false;
+        bdd_refs_pushptr(&set);
+        bdd_refs_pushptr(&prev);
+        bdd_refs_pushptr(&step);
+        while (prev != set) {
+            prev = set;
+            set = CALL(reach_sat, r, set, idx+count);
+            for (size_t i=0; i<count; i++) {
+                step = sylvan_relnext(set, r->rels[idx+i], r->vars[idx+i]);
+                set = sylvan_or(set, step);
+                step = sylvan_false;
+            }
+        }
+        bdd_refs_popptr(3);
+        result = set;
+    } else {
+        /* Recursive computation */
+        bdd_refs_spawn(SPAWN(reach_sat, r, sylvan_low(set), idx));
+        BDD high = bdd_refs_push(CALL(reach_sat, r, sylvan_high(set), idx));
+        BDD low = bdd_refs_sync(SYNC(reach_sat));
+        bdd_refs_pop(1);
+        result = sylvan_makenode(sylvan_var(set), low, high);
+    }
+
+    /* Store in cache */
+    cache_put3(CACHE_BDD_REACH_SAT, _set, idx, r->id, result);
+    bdd_refs_popptr(1);
+    return result;
+}
+
+/**
+ * Add the deadlock states in <states> to the result.
+ */
+static void
+reach_deadlocks(reach_t *r, BDD states)
+{
+    if (!r->opts->check_deadlocks) return;
+    BDD dl = bdd_refs_push(sylvan_diff(states, r->enabled));
+    r->opts->deadlocks = sylvan_or(r->opts->deadlocks, dl);
+    bdd_refs_pop(1);
+}
+
+/**
+ * BFS, PAR and CHAINING: one level at a time, until no new states are found.
+ */
+TASK_2(BDD, reach_levels, reach_t*, r, BDD, initial)
+{
+    sylvan_reach_opts_t *opts = r->opts;
+    BDD visited = initial, frontier = initial, fresh = sylvan_false, succ = sylvan_false;
+    bdd_refs_pushptr(&visited);
+    bdd_refs_pushptr(&frontier);
+    bdd_refs_pushptr(&fresh);
+    bdd_refs_pushptr(&succ);
+
+    do {
+        reach_deadlocks(r, frontier);
+
+        if (opts->strategy == SYLVAN_REACH_CHAINING) {
+            fresh = frontier;
+            for (size_t i=0; i<r->n; i++) {
+                succ = sylvan_relnext(fresh, r->rels[i], r->vars[i]);
+                fresh = sylvan_or(fresh, succ);
+                succ = sylvan_false;
+            }
+            fresh = sylvan_diff(fresh, visited);
+        } else {
+            fresh = CALL(reach_level, r, frontier, visited, 0, r->n, opts->strategy == SYLVAN_REACH_PAR);
+        }
+
+        if (opts->simplify_frontier && fresh != sylvan_false) {
+            // any set between the new states and all states found so far will do
+            succ = sylvan_restrict(fresh, sylvan_not(visited));
+            frontier = sylvan_nodecount(succ) < sylvan_nodecount(fresh) ? succ : fresh;
+            succ = sylvan_false;
+        } else {
+            frontier = fresh;
+        }
+        visited = sylvan_or(visited, fresh);
+
+        opts->levels++;
+        if (opts->level_cb != NULL && WRAP(opts->level_cb, opts->levels, visited, fresh, opts->context)) break;
+    } while (fresh != sylvan_false);
+
+    bdd_refs_popptr(4);
+    return visited;
+}
+
+/* Gnome sort of the partitions on their first variable, which keeps the order of equal ones */
+static void
+reach_sort(reach_t *r)
+{
+    size_t i = 1, j = 2;
+    while (i < r->n) {
+        if (sylvan_var(r->vars[i-1]) > sylvan_var(r->vars[i])) {
+            BDD t = r->rels[i-1];
+            r->rels[i-1] = r->rels[i];
+            r->rels[i] = t;
+            t = r->vars[i-1];
+            r->vars[i-1] = r->vars[i];
+            r->vars[i] = t;
+            if (--i) continue;
+        }
+        i = j++;
+    }
+}
+
+TASK_IMPL_5(BDD, sylvan_reach, BDD, initial, const BDD*, rels, const BDDSET*, vars, size_t, n, sylvan_reach_opts_t*, opts)
+{
+    sylvan_reach_opts_t defaults = sylvan_reach_opts_make(SYLVAN_REACH_PAR);
+    if (opts == NULL) opts = &defaults;
+    opts->deadlocks = sylvan_false;
+    opts->levels = 0;
+
+    if (n == 0) {
+        // no transitions: every initial state is a deadlock
+        if (opts->check_deadlocks) opts->deadlocks = initial;
+        opts->levels = 1;
+        if (opts->level_cb != NULL) WRAP(opts->level_cb, 1, initial, sylvan_false, opts->context);
+        return initial;
+    }
+
+    reach_t r;
+    r.rels = (BDD*)malloc(sizeof(BDD) * n);
+    r.vars = (BDDSET*)malloc(sizeof(BDDSET) * n);
+    if (r.rels == NULL || r.vars == NULL) {
+        fprintf(stderr, "sylvan_reach: Unable to allocate memory!\n");
+        exit(1);
+    }
+    memcpy(r.rels, rels, sizeof(BDD) * n);
+    memcpy(r.vars, vars, sizeof(BDDSET) * n);
+    r.n = n;
+    r.opts = opts;
+    r.id = atomic_fetch_add(&reach_next_id, 1);
+    r.enabled = sylvan_false;
+
+    for (size_t i=0; i<n; i++) {
+        bdd_refs_pushptr(&r.rels[i]);
+        bdd_refs_pushptr(&r.vars[i]);
+    }
+    bdd_refs_pushptr(&r.enabled);
+    bdd_refs_pushptr(&opts->deadlocks);
+    bdd_refs_push(initial);
+
+    if (opts->check_deadlocks) r.enabled = CALL(reach_enabled, &r, 0, n);
+
+    BDD result;
+    if (opts->strategy == SYLVAN_REACH_SAT) {
+        reach_sort(&r);
+        result = bdd_refs_push(CALL(reach_sat, &r, initial, 0));
+        reach_deadlocks(&r, result);
+        opts->levels = 1;
+        if (opts->level_cb != NULL) {
+            BDD fresh = bdd_refs_push(sylvan_diff(result, initial));
+            WRAP(opts->level_cb, 1, result, fresh, opts->context);
+            bdd_refs_pop(1);
+        }
+        bdd_refs_pop(1);
+    } else {
+        result = CALL(reach_levels, &r, initial);
+    }
+
+    bdd_refs_pop(1);
+    bdd_refs_popptr(2 * n + 2);
+    free(r.rels);
+    free(r.vars);
+    return result;
+}
+
+/**
+ * The relation <rel> on the variables <vars>, extended with s=s' for every pair of state
+ * variables s, s' in <to> that are not in <vars>.
+ */
+TASK_3(BDD, reach_extend, BDD, rel, BDDSET, vars, BDDSET, to)
+{
+    size_t count = sylvan_set_count(to);
+    uint32_t *arr = (uint32_t*)malloc(sizeof(uint32_t) * (count == 0 ? 1 : count));
+    if (arr == NULL) {
+        fprintf(stderr, "sylvan_cluster_union: Unable to allocate memory!\n");
+        exit(1);
+    }
+    sylvan_set_toarray(to, arr);
+
+    BDD eq = sylvan_true;
+    bdd_refs_pushptr(&eq);
+    for (size_t i=count; i-- > 1;) {
+        const uint32_t s = arr[i-1], t = arr[i];
+        if ((s & 1) || t != s+1 || sylvan_set_in(vars, s)) continue;
+        BDD low = bdd_refs_push(sylvan_makenode(t, eq, sylvan_false));
+        BDD high = sylvan_makenode(t, sylvan_false, eq);
+        bdd_refs_pop(1);
+        eq = sylvan_makenode(s, low, high);
+    }
+    free(arr);
+
+    BDD result = sylvan_and(rel, eq);
+    bdd_refs_popptr(1);
+    return result;
+}
+
+TASK_IMPL_4(size_t, sylvan_cluster_union, BDD*, rels, BDDSET*, vars, size_t, n, size_t, threshold)
+{
+    if (n <= 1) return n;
+
+    for (size_t i=0; i<n; i++) {
+        bdd_refs_pushptr(&rels[i]);
+        bdd_refs_pushptr(&vars[i]);
+    }
+
+    BDDSET merged_vars = sylvan_set_empty();
+    BDD merged = sylvan_false, ext = sylvan_false;
+    bdd_refs_pushptr(&merged_vars);
+    bdd_refs_pushptr(&merged);
+    bdd_refs_pushptr(&ext);
+
+    size_t k = 0;
+    if (threshold == SIZE_MAX) {
+        // merge everything at once, with one n-ary disjunction
+        merged_vars = vars[0];
+        for (size_t i=1; i<n; i++) merged_vars = sylvan_set_addall(merged_vars, vars[i]);
+        for (size_t i=0; i<n; i++) {
+            rels[i] = CALL(reach_extend, rels[i], vars[i], merged_vars);
+            vars[i] = merged_vars;
+        }
+        rels[0] = CALL(sylvan_or_n, rels, n);
+    } else {
+        for (size_t i=1; i<n; i++) {
+            merged_vars = sylvan_set_addall(vars[k], vars[i]);
+            merged = CALL(reach_extend, rels[k], vars[k], merged_vars);
+            ext = CALL(reach_extend, rels[i], vars[i], merged_vars);
+            merged = sylvan_or(merged, ext);
+            if (sylvan_nodecount(merged) <= threshold) {
+                rels[k] = merged;
+                vars[k] = merged_vars;
+            } else {
+                k++;
+                rels[k] = rels[i];
+                vars[k] = vars[i];
+            }
+        }
+    }
+
+    bdd_refs_popptr(2 * n + 3);
+    return k+1;
+}
+
+/**
+ * Order the clusters of <img> by the greedy heuristic, and compute which state variables
+ * <vars> are quantified with which cluster.
+ */
+VOID_TASK_2(image_schedule, sylvan_image_t*, img, BDDSET, vars)
+{
+    const size_t n = img->n;
+
+    /* The supports of the clusters, and the number of variables */
+    BDDSET *supp = (BDDSET*)malloc(sizeof(BDDSET) * (n == 0 ? 1 : n));
+    if (supp == NULL) {
+        fprintf(stderr, "sylvan_image_make: Unable to allocate memory!\n");
+        exit(1);
+    }
+    uint32_t nvars = 0;
+    for (BDDSET s = vars; !sylvan_set_isempty(s); s = sylvan_set_next(s)) nvars = sylvan_set_first(s) + 1;
+    for (size_t i=0; i<n; i++) {
+        supp[i] = sylvan_false;
+        bdd_refs_pushptr(&supp[i]);
+        supp[i] = sylvan_support(img->clusters[i]);
+        for (BDDSET s = supp[i]; !sylvan_set_isempty(s); s = sylvan_set_next(s)) {
+            if (sylvan_set_first(s) >= nvars) nvars = sylvan_set_first(s) + 1;
+        }
+    }
+
+    /* in[i*nvars+v]: cluster i depends on v; remaining[v]: the unscheduled clusters that do */
+    uint8_t *in = (uint8_t*)calloc((size_t)nvars * (n == 0 ? 1 : n) + 1, 1);
+    uint8_t *state = (uint8_t*)calloc(nvars + 1, 1);
+    uint8_t *seen = (uint8_t*)calloc(nvars + 1, 1);
+    size_t *remaining = (size_t*)calloc(nvars + 1, sizeof(size_t));
+    size_t *order = (size_t*)malloc(sizeof(size_t) * (n == 0 ? 1 : n));
+    uint8_t *done = (uint8_t*)calloc(n + 1, 1);
+    if (in == NULL || state == NULL || seen == NULL || remaining == NULL || order == NULL || done == NULL) {
+        fprintf(stderr, "sylvan_image_make: Unable to allocate memory!\n");
+        exit(1);
+    }
+    for (BDDSET s = vars; !sylvan_set_isempty(s); s = sylvan_set_next(s)) {
+        state[sylvan_set_first(s)] = 1;
+        seen[sylvan_set_first(s)] = 1; // the set of states depends on the state variables
+    }
+    for (size_t i=0; i<n; i++) {
+        for (BDDSET s = supp[i]; !sylvan_set_isempty(s); s = sylvan_set_next(s)) {
+            in[i*nvars+sylvan_set_first(s)] = 1;
+            remaining[sylvan_set_first(s)]++;
+        }
+    }
+    bdd_refs_popptr(n);
+    free(supp);
+
+    /* Greedy: next is the cluster after which the most variables can be quantified, minus
+       the number of variables it adds to the product */
+    for (size_t k=0; k<n; k++) {
+        size_t best = n;
+        long best_score = 0;
+        for (size_t i=0; i<n; i++) {
+            if (done[i]) continue;
+            long score = 0;
+            for (uint32_t v=0; v<nvars; v++) {
+                if (!in[i*nvars+v]) continue;
+                if (state[v] && remaining[v] == 1) score++;
+                if (!seen[v]) score--;
+            }
+            if (best == n || score > best_score) {
+                best = i;
+                best_score = score;
+            }
+        }
+        done[best] = 1;
+        order[k] = best;
+        for (uint32_t v=0; v<nvars; v++) {
+            if (!in[best*nvars+v]) continue;
+            remaining[v]--;
+            seen[v] = 1;
+        }
+    }
+
+    /* Reorder the clusters (their slots are protected, so the BDDs stay protected) */
+    BDD *sorted = (BDD*)malloc(sizeof(BDD) * (n == 0 ? 1 : n));
+    uint32_t *qvars = (uint32_t*)malloc(sizeof(uint32_t) * (nvars + 1));
+    if (sorted == NULL || qvars == NULL) {
+        fprintf(stderr, "sylvan_image_make: Unable to allocate memory!\n");
+        exit(1);
+    }
+    for (size_t k=0; k<n; k++) sorted[k] = img->clusters[order[k]];
+    for (size_t k=0; k<n; k++) img->clusters[k] = sorted[k];
+
+    /* Every state variable is quantified with the last cluster that depends on it */
+    for (size_t k=n; k-- > 0;) {
+        size_t count = 0;
+        for (uint32_t v=0; v<nvars; v++) {
+            if (state[v] && in[order[k]*nvars+v]) {
+                qvars[count++] = v;
+                state[v] = 0;
+            }
+        }
+        img->quantify[k] = sylvan_set_fromarray(qvars, count);
+    }
+    size_t count = 0;
+    for (uint32_t v=0; v<nvars; v++) if (state[v]) qvars[count++] = v;
+    img->prequantify = sylvan_set_fromarray(qvars, count);
+
+    free(in);
+    free(state);
+    free(seen);
+    free(remaining);
+    free(order);
+    free(done);
+    free(sorted);
+    free(qvars);
+}
+
+TASK_IMPL_4(sylvan_image_t*, sylvan_image_make, const BDD*, rels, size_t, n, BDDSET, vars, size_t, threshold)
+{
+    sylvan_image_t *img = (sylvan_image_t*)malloc(sizeof(sylvan_image_t));
+    if (img != NULL) {
+        img->clusters = (BDD*)malloc(sizeof(BDD) * (n == 0 ? 1 : n));
+        img->quantify = (BDDSET*)malloc(sizeof(BDDSET) * (n == 0 ? 1 : n));
+    }
+    if (img == NULL || img->clusters == NULL || img->quantify == NULL) {
+        fprintf(stderr, "sylvan_image_make: Unable to allocate memory!\n");
+        exit(1);
+    }
+    img->n = n;
+    for (size_t i=0; i<n; i++) {
+        img->clusters[i] = rels[i];
+        img->quantify[i] = sylvan_set_empty();
+        sylvan_protect(&img->clusters[i]);
+        sylvan_protect(&img->quantify[i]);
+    }
+    img->prequantify = sylvan_set_empty();
+    img->rename = sylvan_map_empty();
+    sylvan_protect(&img->prequantify);
+    sylvan_protect(&img->rename);
+    bdd_refs_push(vars);
+
+    CALL(image_schedule, img, vars);
+
+    if (threshold != 0 && n > 1) {
+        /* Conjoin consecutive clusters of the schedule, then schedule the result */
+        BDD conj = sylvan_false;
+        bdd_refs_pushptr(&conj);
+        size_t k = 0;
+        for (size_t i=1; i<n; i++) {
+            conj = sylvan_and(img->clusters[k], img->clusters[i]);
+            if (sylvan_nodecount(conj) <= threshold) {
+                img->clusters[k] = conj;
+            } else {
+                img->clusters[++k] = img->clusters[i];
+            }
+        }
+        bdd_refs_popptr(1);
+        for (size_t i=k+1; i<n; i++) {
+            sylvan_unprotect(&img->clusters[i]);
+            sylvan_unprotect(&img->quantify[i]);
+        }
+        img->n = k+1;
+        CALL(image_schedule, img, vars);
+    }
+
+    for (BDDSET s = vars; !sylvan_set_isempty(s); s = sylvan_set_next(s)) {
+        const uint32_t v = sylvan_set_first(s);
+        BDD x = bdd_refs_push(sylvan_ithvar(v));
+        img->rename = sylvan_map_add(img->rename, v+1, x);
+        bdd_refs_pop(1);
+    }
+
+    bdd_refs_pop(1);
+    return img;
+}
+
+TASK_IMPL_2(BDD, sylvan_image_next, const sylvan_image_t*, img, BDD, set)
+{
+    BDD cur = sylvan_exists(set, img->prequantify);
+    bdd_refs_pushptr(&cur);
+    for (size_t i=0; i<img->n; i++) {
+        cur = sylvan_and_exists(cur, img->clusters[i], img->quantify[i]);
+    }
+    cur = sylvan_compose(cur, img->rename);
+    bdd_refs_popptr(1);
+    return cur;
+}
+
+void
+sylvan_image_free(sylvan_image_t *img)
+{
+    for (size_t i=0; i<img->n; i++) {
+        sylvan_unprotect(&img->clusters[i]);
+        sylvan_unprotect(&img->quantify[i]);
+    }
+    sylvan_unprotect(&img->prequantify);
+    sylvan_unprotect(&img->rename);
+    free(img->clusters);
+    free(img->quantify);
+    free(img);
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright 2011-2016 Formal Methods and Tools, University of Twente
+ * Copyright 2016-2017 Tom van Dijk, Johannes Kepler University Linz
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Do not include this file directly. Instead, include sylvan.h */
+
+#ifndef SYLVAN_REACH_H
+#define SYLVAN_REACH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * Symbolic reachability with a partitioned transition relation.
+ *
+ * The relation is given as <n> partitions rels[i] with their variable sets vars[i], as used by
+ * sylvan_relnext: rels[i] relates the (even) state variables in vars[i] to the (odd) next state
+ * variables in vars[i], and does not change the other state variables.
+ */
+
+typedef enum sylvan_reach_strategy
+{
+    SYLVAN_REACH_BFS,           // breadth-first, the partitions one after another
+    SYLVAN_REACH_PAR,           // breadth-first, the partitions in parallel
+    SYLVAN_REACH_SAT,           // saturation-like, the partitions ordered by their first variable
+    SYLVAN_REACH_CHAINING,      // breadth-first, every partition applied to the result of the previous one
+} sylvan_reach_strategy_t;
+
+/**
+ * Callback after every level, with the number of the level (starting at 1), the states found so
+ * far and the new states of this level. Return non-zero to stop the search.
+ * The saturation strategy has no levels, and calls the callback once, at the end.
+ */
+LACE_TYPEDEF_CB(int, sylvan_reach_cb, int, BDD, BDD, void*);
+
+typedef struct sylvan_reach_opts
+{
+    sylvan_reach_strategy_t strategy;
+    int check_deadlocks;        // compute the reachable states without successors into <deadlocks>
+    int simplify_frontier;      // BFS/PAR/CHAINING: continue from the smallest BDD (with restrict)
+                                // that contains the new states and only states found before
+    sylvan_reach_cb level_cb;   // called after every level, or NULL
+    void *context;              // passed to level_cb
+    BDD deadlocks;              // result: the deadlock states found so far (if check_deadlocks)
+    int levels;                 // result: the number of levels
+} sylvan_reach_opts_t;
+
+/**
+ * The default options for the given strategy: no deadlock checking, no frontier simplification
+ * and no callback.
+ */
+static inline sylvan_reach_opts_t
+sylvan_reach_opts_make(sylvan_reach_strategy_t strategy)
+{
+    sylvan_reach_opts_t opts;
+    opts.strategy = strategy;
+    opts.check_deadlocks = 0;
+    opts.simplify_frontier = 0;
+    opts.level_cb = NULL;
+    opts.context = NULL;
+    opts.deadlocks = sylvan_false;
+    opts.levels = 0;
+    return opts;
+}
+
+/**
+ * Compute the states reachable from <initial> with the partitioned relation <rels>/<vars> of
+ * <n> partitions, with the options <opts> (or NULL for the PAR strategy).
+ * The arguments are protected during the search. Protect opts->deadlocks afterwards, if needed.
+ */
+TASK_DECL_5(BDD, sylvan_reach, BDD, const BDD*, const BDDSET*, size_t, sylvan_reach_opts_t*);
+#define sylvan_reach(initial, rels, vars, n, opts) RUN(sylvan_reach, initial, rels, vars, n, opts)
+
+/**
+ * Clustering of a partitioned relation as used by sylvan_reach: merge consecutive partitions
+ * rels[i]/vars[i] into their union, as long as the merged relation has at most <threshold>
+ * nodes. The partitions are extended with s=s' for the variables of the other partitions.
+ * The result is written to the first entries of <rels> and <vars>; returns the new number of
+ * partitions. With threshold SIZE_MAX, all partitions are merged into one.
+ */
+TASK_DECL_4(size_t, sylvan_cluster_union, BDD*, BDDSET*, size_t, size_t);
+#define sylvan_cluster_union(rels, vars, n, threshold) RUN(sylvan_cluster_union, rels, vars, n, threshold)
+
+/**
+ * Image computation with a conjunctively partitioned relation.
+ *
+ * The transition relation is the conjunction of the clusters, on the (even) state variables
+ * and the (odd) next state variables. Instead of computing this conjunction, the image is
+ * computed with one sylvan_and_exists per cluster, in an order where every state variable is
+ * quantified as soon as no later cluster depends on it (an early quantification schedule).
+ *
+ * The order of the clusters is chosen greedily (as in IWLS95): the next cluster is the one
+ * that allows quantifying the most variables, minus the number of new variables it adds.
+ */
+typedef struct sylvan_image
+{
+    size_t n;                   // the number of clusters
+    BDD *clusters;              // the clusters, in the order of the schedule
+    BDDSET *quantify;           // quantify[i]: the state variables quantified with clusters[i]
+    BDDSET prequantify;         // the state variables on which no cluster depends
+    BDDMAP rename;              // from the next state variables to the state variables
+} sylvan_image_t;
+
+/**
+ * Compute the schedule for the image of the <n> clusters <rels> with the state variables <vars>.
+ * If <threshold> is not 0, consecutive clusters in the schedule are first conjoined as long as
+ * their conjunction has at most <threshold> nodes. The BDDs of the schedule are protected until
+ * it is freed with sylvan_image_free.
+ */
+TASK_DECL_4(sylvan_image_t*, sylvan_image_make, const BDD*, size_t, BDDSET, size_t);
+#define sylvan_image_make(rels, n, vars, threshold) RUN(sylvan_image_make, rels, n, vars, threshold)
+
+/**
+ * Compute the successors of the states <set> with the schedule <image>.
+ */
+TASK_DECL_2(BDD, sylvan_image_next, const sylvan_image_t*, BDD);
+#define sylvan_image_next(image, set) RUN(sylvan_image_next, image, set)
+
+/**
+ * Free the schedule <image>.
+ */
+void sylvan_image_free(sylvan_image_t *image);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif
@@ -0,0 +1,764 @@
+/*
+ * Copyright 2011-2016 Formal Methods and Tools, University of Twente
+ * Copyright 2016-2017 Tom van Dijk, Johannes Kepler University Linz
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sylvan_int.h>
+
+#include <errno.h>  // for errno
+#include <string.h> // for strerror, memcmp
+
+/**
+ * The recording starts with RECORD_MAGIC and the sizes of the nodes table and the operation
+ * cache (uint64_t size, max size of the table and of the cache) when recording started,
+ * followed by records that start with a uint32_t tag:
+ * - RECORD_DDS: uint32_t kind, uint32_t count, uint64_t ids[count], and then the diagrams
+ *   (MTBDDs as written by mtbdd_writer_tobinary, LDDs as written by ldd_write)
+ * - RECORD_CALL: uint32_t op, uint64_t args[arity], uint64_t result, uint64_t time (ns)
+ * - RECORD_GC: all ids assigned so far are no longer used
+ * - RECORD_PROTECT, RECORD_UNPROTECT: uint32_t kind, uint64_t slot
+ * Every diagram (input or result) gets a new id.
+ */
+#define RECORD_MAGIC "sylvrec1"
+
+enum { RECORD_DDS = 1, RECORD_CALL, RECORD_GC, RECORD_PROTECT, RECORD_UNPROTECT };
+enum { KIND_MTBDD = 0, KIND_LDD = 1 };
+
+static const struct
+{
+    const char *name;
+    int arity;
+    int kind;
+} record_ops[SYLVAN_RECORD_OP_COUNT] = {
+    { "sylvan_ite", 3, KIND_MTBDD },
+    { "sylvan_and", 2, KIND_MTBDD },
+    { "sylvan_xor", 2, KIND_MTBDD },
+    { "sylvan_exists", 2, KIND_MTBDD },
+    { "sylvan_and_exists", 3, KIND_MTBDD },
+    { "sylvan_relnext", 3, KIND_MTBDD },
+    { "sylvan_relprev", 3, KIND_MTBDD },
+    { "mtbdd_plus", 2, KIND_MTBDD },
+    { "mtbdd_minus", 2, KIND_MTBDD },
+    { "mtbdd_times", 2, KIND_MTBDD },
+    { "mtbdd_min", 2, KIND_MTBDD },
+    { "mtbdd_max", 2, KIND_MTBDD },
+    { "lddmc_union", 2, KIND_LDD },
+    { "lddmc_minus", 2, KIND_LDD },
+    { "lddmc_intersect", 2, KIND_LDD },
+    { "lddmc_relprod", 3, KIND_LDD },
+    { "lddmc_relprod_union", 4, KIND_LDD },
+};
+
+const char*
+sylvan_record_op_name(int op)
+{
+    if (op < 0 || op >= SYLVAN_RECORD_OP_COUNT) return NULL;
+    return record_ops[op].name;
+}
+
+int
+sylvan_record_apply_op(mtbdd_apply_op op)
+{
+    if (op == mtbdd_op_plus_CALL) return SYLVAN_RECORD_MTBDD_PLUS;
+    if (op == mtbdd_op_minus_CALL) return SYLVAN_RECORD_MTBDD_MINUS;
+    if (op == mtbdd_op_times_CALL) return SYLVAN_RECORD_MTBDD_TIMES;
+    if (op == mtbdd_op_min_CALL) return SYLVAN_RECORD_MTBDD_MIN;
+    if (op == mtbdd_op_max_CALL) return SYLVAN_RECORD_MTBDD_MAX;
+    return -1;
+}
+
+/**
+ * A small hash map from uint64_t to uint64_t with linear probing.
+ * The keys RECORD_MAP_EMPTY and RECORD_MAP_DELETED are reserved; they are never valid
+ * decision diagrams or pointers.
+ */
+#define RECORD_MAP_EMPTY   ((uint64_t)-1)
+#define RECORD_MAP_DELETED ((uint64_t)-2)
+
+typedef struct record_map
+{
+    uint64_t *keys;
+    uint64_t *values;
+    size_t size;        // power of 2, or 0
+    size_t used;        // keys that are not empty (including deleted)
+} record_map_t;
+
+static inline size_t
+record_map_hash(const record_map_t *map, uint64_t key)
+{
+    return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 17) & (map->size - 1);
+}
+
+static void
+record_map_alloc(record_map_t *map, size_t size)
+{
+    map->keys = (uint64_t*)malloc(size * sizeof(uint64_t));
+    map->values = (uint64_t*)malloc(size * sizeof(uint64_t));
+    if (map->keys == NULL || map->values == NULL) {
+        fprintf(stderr, "sylvan_record: Unable to allocate memory: %s!\n", strerror(errno));
+        exit(1);
+    }
+    for (size_t i=0; i<size; i++) map->keys[i] = RECORD_MAP_EMPTY;
+    map->size = size;
+    map->used = 0;
+    sylvan_memory_add(SYLVAN_MEM_INSTRUMENTATION, size * 2 * sizeof(uint64_t));
+}
+
+static void
+record_map_free(record_map_t *map)
+{
+    if (map->size != 0) {
+        free(map->keys);
+        free(map->values);
+        sylvan_memory_sub(SYLVAN_MEM_INSTRUMENTATION, map->size * 2 * sizeof(uint64_t));
+    }
+    map->keys = map->values = NULL;
+    map->size = map->used = 0;
+}
+
+static int
+record_map_get(const record_map_t *map, uint64_t key, uint64_t *value)
+{
+    if (map->size == 0) return 0;
+    for (size_t i=record_map_hash(map, key);; i=(i+1) & (map->size - 1)) {
+        if (map->keys[i] == RECORD_MAP_EMPTY) return 0;
+        if (map->keys[i] == key) {
+            *value = map->values[i];
+            return 1;
+        }
+    }
+}
+
+static void
+record_map_put(record_map_t *map, uint64_t key, uint64_t value)
+{
+    if (2 * (map->used + 1) > map->size) {
+        /* grow (or just clean up the deleted keys) */
+        record_map_t old = *map;
+        size_t count = 0;
+        for (size_t i=0; i<old.size; i++) {
+            if (old.keys[i] != RECORD_MAP_EMPTY && old.keys[i] != RECORD_MAP_DELETED) count++;
+        }
+        size_t size = 1024;
+        while (size < 4 * (count + 1)) size <<= 1;
+        record_map_alloc(map, size);
+        for (size_t i=0; i<old.size; i++) {
+            if (old.keys[i] != RECORD_MAP_EMPTY && old.keys[i] != RECORD_MAP_DELETED) {
+                record_map_put(map, old.keys[i], old.values[i]);
+            }
+        }
+        record_map_free(&old);
+    }
+    for (size_t i=record_map_hash(map, key);; i=(i+1) & (map->size - 1)) {
+        if (map->keys[i] == RECORD_MAP_EMPTY) {
+            map->keys[i] = key;
+            map->values[i] = value;
+            map->used++;
+            return;
+        }
+        if (map->keys[i] == key) {
+            map->values[i] = value;
+            return;
+        }
+    }
+}
+
+static void
+record_map_remove(record_map_t *map, uint64_t key)
+{
+    if (map->size == 0) return;
+    for (size_t i=record_map_hash(map, key);; i=(i+1) & (map->size - 1)) {
+        if (map->keys[i] == RECORD_MAP_EMPTY) return;
+        if (map->keys[i] == key) {
+            map->keys[i] = RECORD_MAP_DELETED;
+            return;
+        }
+    }
+}
+
+static void
+record_map_clear(record_map_t *map)
+{
+    for (size_t i=0; i<map->size; i++) map->keys[i] = RECORD_MAP_EMPTY;
+    map->used = 0;
+}
+
+/**
+ * Write LDDs <dds> to <out>: uint64_t nodecount, then every node as uint32_t value,
+ * uint32_t copy, uint64_t down and uint64_t right (nodes are written after their children;
+ * references are 0 for lddmc_false, 1 for lddmc_true and k+2 for the k-th node),
+ * then uint64_t roots[count].
+ */
+typedef struct ldd_nodes
+{
+    MDD *nodes;
+    size_t count;
+    size_t size;
+} ldd_nodes_t;
+
+static void
+ldd_nodes_push(ldd_nodes_t *arr, MDD dd)
+{
+    if (arr->count == arr->size) {
+        arr->size = arr->size == 0 ? 64 : arr->size * 2;
+        arr->nodes = (MDD*)realloc(arr->nodes, arr->size * sizeof(MDD));
+        if (arr->nodes == NULL) {
+            fprintf(stderr, "sylvan_record: Unable to allocate memory: %s!\n", strerror(errno));
+            exit(1);
+        }
+    }
+    arr->nodes[arr->count++] = dd;
+}
+
+static uint64_t
+ldd_ref(record_map_t *map, MDD dd)
+{
+    uint64_t ref = dd;
+    if (dd > lddmc_true) record_map_get(map, dd, &ref);
+    return ref;
+}
+
+static void
+ldd_collect(record_map_t *map, ldd_nodes_t *order, MDD dd)
+{
+    /* collect the chain of right siblings iteratively and recurse only on down */
+    ldd_nodes_t chain = { NULL, 0, 0 };
+    uint64_t ref;
+    while (dd > lddmc_true && !record_map_get(map, dd, &ref)) {
+        ldd_nodes_push(&chain, dd);
+        dd = mddnode_getright(LDD_GETNODE(dd));
+    }
+    for (size_t i=chain.count; i-- > 0;) {
+        ldd_collect(map, order, mddnode_getdown(LDD_GETNODE(chain.nodes[i])));
+        record_map_put(map, chain.nodes[i], order->count + 2);
+        ldd_nodes_push(order, chain.nodes[i]);
+    }
+    free(chain.nodes);
+}
+
+static void
+ldd_write(FILE *out, const MDD *dds, int count)
+{
+    record_map_t map = { NULL, NULL, 0, 0 };
+    ldd_nodes_t order = { NULL, 0, 0 };
+    for (int i=0; i<count; i++) ldd_collect(&map, &order, dds[i]);
+
+    uint64_t nodecount = order.count;
+    fwrite(&nodecount, sizeof(uint64_t), 1, out);
+    for (size_t i=0; i<order.count; i++) {
+        mddnode_t n = LDD_GETNODE(order.nodes[i]);
+        uint32_t value = mddnode_getvalue(n);
+        uint32_t copy = mddnode_getcopy(n);
+        uint64_t down = ldd_ref(&map, mddnode_getdown(n));
+        uint64_t right = ldd_ref(&map, mddnode_getright(n));
+        fwrite(&value, sizeof(uint32_t), 1, out);
+        fwrite(&copy, sizeof(uint32_t), 1, out);
+        fwrite(&down, sizeof(uint64_t), 1, out);
+        fwrite(&right, sizeof(uint64_t), 1, out);
+    }
+    for (int i=0; i<count; i++) {
+        uint64_t root = ldd_ref(&map, dds[i]);
+        fwrite(&root, sizeof(uint64_t), 1, out);
+    }
+
+    free(order.nodes);
+    record_map_free(&map);
+}
+
+/**
+ * Read LDDs written by ldd_write. Returns 0 on success, -1 on failure.
+ */
+static int
+ldd_read(FILE *in, MDD *dds, int count)
+{
+    uint64_t nodecount;
+    if (fread(&nodecount, sizeof(uint64_t), 1, in) != 1) return -1;
+    MDD *arr = (MDD*)malloc((nodecount + 2) * sizeof(MDD));
+    if (arr == NULL) return -1;
+    arr[0] = lddmc_false;
+    arr[1] = lddmc_true;
+    for (uint64_t i=0; i<nodecount; i++) {
+        uint32_t value, copy;
+        uint64_t down, right;
+        if (fread(&value, sizeof(uint32_t), 1, in) != 1 ||
+            fread(&copy, sizeof(uint32_t), 1, in) != 1 ||
+            fread(&down, sizeof(uint64_t), 1, in) != 1 ||
+            fread(&right, sizeof(uint64_t), 1, in) != 1 ||
+            down >= i+2 || right >= i+2) {
+            free(arr);
+            return -1;
+        }
+        if (copy) arr[i+2] = lddmc_make_copynode(arr[down], arr[right]);
+        else arr[i+2] = lddmc_makenode(value, arr[down], arr[right]);
+    }
+    for (int i=0; i<count; i++) {
+        uint64_t root;
+        if (fread(&root, sizeof(uint64_t), 1, in) != 1 || root >= nodecount+2) {
+            free(arr);
+            return -1;
+        }
+        dds[i] = arr[root];
+    }
+    free(arr);
+    return 0;
+}
+
+/**
+ * The state of the recorder.
+ * Only the thread that recorded the running call (that set record_busy) accesses the maps of
+ * diagrams and assigns ids; writing to the file and the map of protected pointers is guarded
+ * by record_lock.
+ */
+int sylvan_record_active = 0;
+
+static FILE *record_file = NULL;
+static pthread_mutex_t record_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Atomic(int) record_busy = 0;           // 1 while a call is being recorded
+static _Atomic(int) record_gc_pending = 0;     // set by garbage collection
+static record_map_t record_dds[2];             // diagram -> id (per kind), until the next gc
+static record_map_t record_slots;              // protected pointer -> slot
+static uint64_t record_next_id = 0;
+static uint64_t record_next_slot = 0;
+static int record_registered = 0;
+
+static void
+record_write(const void *data, size_t size)
+{
+    if (fwrite(data, size, 1, record_file) != 1) {
+        fprintf(stderr, "sylvan_record: Unable to write recording: %s!\n", strerror(errno));
+        exit(1);
+    }
+}
+
+static void
+record_write_u32(uint32_t value)
+{
+    record_write(&value, sizeof(uint32_t));
+}
+
+static void
+record_write_u64(uint64_t value)
+{
+    record_write(&value, sizeof(uint64_t));
+}
+
+/**
+ * Write the garbage collection that happened since the last record (if any).
+ * Call with record_busy set or while no call is recorded.
+ */
+static void
+record_flush_gc(void)
+{
+    if (!atomic_load_explicit(&record_gc_pending, memory_order_acquire)) return;
+    atomic_store_explicit(&record_gc_pending, 0, memory_order_relaxed);
+    pthread_mutex_lock(&record_lock);
+    record_write_u32(RECORD_GC);
+    pthread_mutex_unlock(&record_lock);
+    record_map_clear(&record_dds[KIND_MTBDD]);
+    record_map_clear(&record_dds[KIND_LDD]);
+}
+
+VOID_TASK_0(sylvan_record_gc)
+{
+    if (sylvan_record_active) atomic_store_explicit(&record_gc_pending, 1, memory_order_release);
+}
+
+/**
+ * The diagrams of the replay, by id. Ids below replay_first are no longer used (after gc).
+ */
+static MTBDD *replay_dds = NULL;
+static uint8_t *replay_kinds = NULL;
+static uint64_t replay_size = 0;
+static uint64_t replay_count = 0;
+static uint64_t replay_first = 0;
+
+VOID_TASK_0(sylvan_replay_mark)
+{
+    for (uint64_t i=replay_first; i<replay_count; i++) {
+        if (replay_dds[i] == mtbdd_invalid) continue;
+        if (replay_kinds[i] == KIND_LDD) CALL(lddmc_gc_mark_rec, replay_dds[i]);
+        else CALL(mtbdd_gc_mark_rec, replay_dds[i]);
+    }
+}
+
+static void
+sylvan_record_quit()
+{
+    sylvan_record_stop();
+    record_map_free(&record_dds[KIND_MTBDD]);
+    record_map_free(&record_dds[KIND_LDD]);
+    record_map_free(&record_slots);
+    record_registered = 0;
+}
+
+static void
+record_register(void)
+{
+    if (record_registered) return;
+    sylvan_gc_hook_postgc(sylvan_record_gc_CALL);
+    sylvan_gc_add_mark_named(sylvan_replay_mark_CALL, "sylvan_replay_mark");
+    sylvan_register_quit(sylvan_record_quit);
+    record_registered = 1;
+}
+
+void
+sylvan_record_start(FILE *out)
+{
+    record_register();
+    sylvan_record_stop();
+
+    record_map_free(&record_dds[KIND_MTBDD]);
+    record_map_free(&record_dds[KIND_LDD]);
+    record_map_free(&record_slots);
+    record_next_id = 0;
+    record_next_slot = 0;
+    atomic_store(&record_busy, 0);
+    atomic_store(&record_gc_pending, 0);
+
+    record_file = out;
+    record_write(RECORD_MAGIC, 8);
+    record_write_u64(llmsset_get_size(nodes));
+    record_write_u64(llmsset_get_max_size(nodes));
+    record_write_u64(cache_getsize());
+    record_write_u64(cache_getmaxsize());
+    sylvan_record_active = 1;
+}
+
+void
+sylvan_record_stop(void)
+{
+    if (!sylvan_record_active) return;
+    pthread_mutex_lock(&record_lock);
+    sylvan_record_active = 0;
+    pthread_mutex_unlock(&record_lock);
+    if (!atomic_load(&record_busy)) record_flush_gc();
+    fflush(record_file);
+    record_file = NULL;
+}
+
+void
+sylvan_record_begin(sylvan_record_scope_t *scope, int op, int count, const uint64_t *args)
+{
+    if (op < 0) return;
+    int expected = 0;
+    if (!atomic_compare_exchange_strong(&record_busy, &expected, 1)) return; // another call is recorded
+    if (!sylvan_record_active) {
+        atomic_store(&record_busy, 0);
+        return;
+    }
+
+    record_flush_gc();
+
+    /* find the inputs that are not yet known to the recording */
+    const int kind = record_ops[op].kind;
+    MTBDD todo[4];
+    int todo_index[4]; // for each argument, its index in <todo>, or -1 if known
+    int n_todo = 0;
+    for (int i=0; i<count; i++) {
+        todo_index[i] = -1;
+        if (record_map_get(&record_dds[kind], args[i], &scope->ids[i])) continue;
+        int j = 0;
+        while (j < n_todo && todo[j] != args[i]) j++;
+        if (j == n_todo) todo[n_todo++] = args[i];
+        todo_index[i] = j;
+    }
+
+    if (n_todo != 0) {
+        /* serialize without holding the lock, as the writer may run Lace tasks */
+        char *buf = NULL;
+        size_t len = 0;
+        FILE *mem = open_memstream(&buf, &len);
+        if (mem == NULL) {
+            fprintf(stderr, "sylvan_record: Unable to allocate memory: %s!\n", strerror(errno));
+            exit(1);
+        }
+        if (kind == KIND_LDD) ldd_write(mem, todo, n_todo);
+        else mtbdd_writer_tobinary(mem, todo, n_todo);
+        fclose(mem);
+
+        uint64_t first = record_next_id;
+        record_next_id += n_todo;
+        pthread_mutex_lock(&record_lock);
+        record_write_u32(RECORD_DDS);
+        record_write_u32(kind);
+        record_write_u32(n_todo);
+        for (int j=0; j<n_todo; j++) record_write_u64(first + j);
+        record_write(buf, len);
+        pthread_mutex_unlock(&record_lock);
+        free(buf);
+
+        for (int i=0; i<count; i++) {
+            if (todo_index[i] >= 0) scope->ids[i] = first + todo_index[i];
+        }
+        /* only if no garbage collection happened while serializing */
+        if (!atomic_load(&record_gc_pending)) {
+            for (int j=0; j<n_todo; j++) record_map_put(&record_dds[kind], todo[j], first + j);
+        }
+    }
+
+    scope->active = 1;
+    scope->op = op;
+    scope->start = getabstime();
+}
+
+void
+sylvan_record_end(sylvan_record_scope_t *scope, uint64_t result)
+{
+    uint64_t time = getabstime() - scope->start;
+    const int op = scope->op;
+    const int kind = record_ops[op].kind;
+
+    uint64_t id = record_next_id++;
+    /* the result may have been created before a garbage collection during the call */
+    if (!atomic_load(&record_gc_pending)) record_map_put(&record_dds[kind], result, id);
+
+    pthread_mutex_lock(&record_lock);
+    if (sylvan_record_active) {
+        record_write_u32(RECORD_CALL);
+        record_write_u32(op);
+        for (int i=0; i<record_ops[op].arity; i++) record_write_u64(scope->ids[i]);
+        record_write_u64(id);
+        record_write_u64(time);
+    }
+    pthread_mutex_unlock(&record_lock);
+
+    if (sylvan_record_active) record_flush_gc();
+    atomic_store(&record_busy, 0);
+}
+
+void
+sylvan_record_protect(void *ptr, int ldd, int protect)
+{
+    pthread_mutex_lock(&record_lock);
+    if (sylvan_record_active) {
+        uint64_t slot;
+        if (protect) {
+            if (!record_map_get(&record_slots, (uint64_t)ptr, &slot)) {
+                slot = record_next_slot++;
+                record_map_put(&record_slots, (uint64_t)ptr, slot);
+            }
+            record_write_u32(RECORD_PROTECT);
+            record_write_u32(ldd ? KIND_LDD : KIND_MTBDD);
+            record_write_u64(slot);
+        } else if (record_map_get(&record_slots, (uint64_t)ptr, &slot)) {
+            // pointers that were protected before recording started are ignored
+            record_map_remove(&record_slots, (uint64_t)ptr);
+            record_write_u32(RECORD_UNPROTECT);
+            record_write_u32(ldd ? KIND_LDD : KIND_MTBDD);
+            record_write_u64(slot);
+        }
+    }
+    pthread_mutex_unlock(&record_lock);
+}
+
+/**
+ * Replaying
+ */
+
+static void
+replay_set(uint64_t id, MTBDD dd, int kind)
+{
+    if (id >= replay_size) {
+        uint64_t size = replay_size == 0 ? 1024 : replay_size;
+        while (size <= id) size *= 2;
+        replay_dds = (MTBDD*)realloc(replay_dds, size * sizeof(MTBDD));
+        replay_kinds = (uint8_t*)realloc(replay_kinds, size);
+        if (replay_dds == NULL || replay_kinds == NULL) {
+            fprintf(stderr, "sylvan_replay: Unable to allocate memory: %s!\n", strerror(errno));
+            exit(1);
+        }
+        sylvan_memory_add(SYLVAN_MEM_INSTRUMENTATION, (size - replay_size) * (sizeof(MTBDD) + 1));
+        replay_size = size;
+    }
+    while (replay_count <= id) replay_dds[replay_count++] = mtbdd_invalid;
+    replay_dds[id] = dd;
+    replay_kinds[id] = (uint8_t)kind;
+}
+
+static int
+replay_get(uint64_t id, int kind, MTBDD *dd)
+{
+    if (id < replay_first || id >= replay_count) return 0;
+    if (replay_dds[id] == mtbdd_invalid || replay_kinds[id] != kind) return 0;
+    *dd = replay_dds[id];
+    return 1;
+}
+
+static MTBDD
+replay_call(int op, const MTBDD *a)
+{
+    switch (op) {
+        case SYLVAN_RECORD_BDD_ITE: return sylvan_ite(a[0], a[1], a[2]);
+        case SYLVAN_RECORD_BDD_AND: return sylvan_and(a[0], a[1]);
+        case SYLVAN_RECORD_BDD_XOR: return sylvan_xor(a[0], a[1]);
+        case SYLVAN_RECORD_BDD_EXISTS: return sylvan_exists(a[0], a[1]);
+        case SYLVAN_RECORD_BDD_AND_EXISTS: return sylvan_and_exists(a[0], a[1], a[2]);
+        case SYLVAN_RECORD_BDD_RELNEXT: return sylvan_relnext(a[0], a[1], a[2]);
+        case SYLVAN_RECORD_BDD_RELPREV: return sylvan_relprev(a[0], a[1], a[2]);
+        case SYLVAN_RECORD_MTBDD_PLUS: return mtbdd_plus(a[0], a[1]);
+        case SYLVAN_RECORD_MTBDD_MINUS: return mtbdd_minus(a[0], a[1]);
+        case SYLVAN_RECORD_MTBDD_TIMES: return mtbdd_times(a[0], a[1]);
+        case SYLVAN_RECORD_MTBDD_MIN: return mtbdd_min(a[0], a[1]);
+        case SYLVAN_RECORD_MTBDD_MAX: return mtbdd_max(a[0], a[1]);
+        case SYLVAN_RECORD_LDD_UNION: return lddmc_union(a[0], a[1]);
+        case SYLVAN_RECORD_LDD_MINUS: return lddmc_minus(a[0], a[1]);
+        case SYLVAN_RECORD_LDD_INTERSECT: return lddmc_intersect(a[0], a[1]);
+        case SYLVAN_RECORD_LDD_RELPROD: return lddmc_relprod(a[0], a[1], a[2]);
+        case SYLVAN_RECORD_LDD_RELPROD_UNION: return lddmc_relprod_union(a[0], a[1], a[2], a[3]);
+        default: return mtbdd_invalid;
+    }
+}
+
+/**
+ * Read a record of new diagrams. Garbage collection is disabled meanwhile, as the readers
+ * do not protect the nodes that they have read so far.
+ */
+static int
+replay_read_dds(FILE *in)
+{
+    uint32_t kind, count;
+    if (fread(&kind, sizeof(uint32_t), 1, in) != 1 || kind > KIND_LDD) return -1;
+    if (fread(&count, sizeof(uint32_t), 1, in) != 1 || count == 0 || count > 4) return -1;
+    uint64_t ids[4];
+    if (fread(ids, sizeof(uint64_t), count, in) != count) return -1;
+
+    MTBDD dds[4];
+    sylvan_gc_disable();
+    int res = kind == KIND_LDD ? ldd_read(in, dds, count) : mtbdd_reader_frombinary(in, dds, count);
+    sylvan_gc_enable();
+    if (res != 0) return -1;
+
+    for (uint32_t i=0; i<count; i++) replay_set(ids[i], dds[i], kind);
+    return 0;
+}
+
+static int
+replay_read_header(FILE *in, uint64_t sizes[4])
+{
+    char magic[8];
+    if (fread(magic, 8, 1, in) != 1 || memcmp(magic, RECORD_MAGIC, 8) != 0) return -1;
+    if (fread(sizes, sizeof(uint64_t), 4, in) != 4) return -1;
+    return 0;
+}
+
+int
+sylvan_replay_sizes(FILE *in, size_t *table_size, size_t *table_max, size_t *cache_size, size_t *cache_max)
+{
+    uint64_t sizes[4];
+    int res = replay_read_header(in, sizes);
+    rewind(in);
+    if (res != 0) return -1;
+    *table_size = sizes[0];
+    *table_max = sizes[1];
+    *cache_size = sizes[2];
+    *cache_max = sizes[3];
+    return 0;
+}
+
+int64_t
+sylvan_replay(FILE *in, int gc, sylvan_replay_cb cb, void *context)
+{
+    uint64_t sizes[4];
+    if (replay_read_header(in, sizes) != 0) return -1;
+
+    record_register();
+    replay_count = replay_first = 0;
+
+    /* the protected slots */
+    MTBDD **slots = NULL;
+    uint8_t *slot_kinds = NULL;
+    uint64_t slot_count = 0;
+
+    int64_t calls = 0;
+    int error = 0;
+    uint32_t tag;
+    while (!error && fread(&tag, sizeof(uint32_t), 1, in) == 1) {
+        if (tag == RECORD_DDS) {
+            error = replay_read_dds(in) != 0;
+        } else if (tag == RECORD_CALL) {
+            uint32_t op;
+            uint64_t ids[4], result, recorded_time;
+            MTBDD args[4];
+            if (fread(&op, sizeof(uint32_t), 1, in) != 1 || op >= SYLVAN_RECORD_OP_COUNT) { error = 1; break; }
+            const int arity = record_ops[op].arity, kind = record_ops[op].kind;
+            if (fread(ids, sizeof(uint64_t), arity, in) != (size_t)arity ||
+                fread(&result, sizeof(uint64_t), 1, in) != 1 ||
+                fread(&recorded_time, sizeof(uint64_t), 1, in) != 1) { error = 1; break; }
+            for (int i=0; i<arity; i++) {
+                if (!replay_get(ids[i], kind, &args[i])) error = 1;
+            }
+            if (error) break;
+
+            uint64_t t = getabstime();
+            MTBDD res = replay_call(op, args);
+            t = getabstime() - t;
+            replay_set(result, res, kind);
+            if (cb != NULL) cb(op, (uint64_t)calls, t, recorded_time, context);
+            calls++;
+        } else if (tag == RECORD_GC) {
+            replay_first = replay_count;
+            if (gc) sylvan_gc();
+        } else if (tag == RECORD_PROTECT || tag == RECORD_UNPROTECT) {
+            uint32_t kind;
+            uint64_t slot;
+            if (fread(&kind, sizeof(uint32_t), 1, in) != 1 || kind > KIND_LDD ||
+                fread(&slot, sizeof(uint64_t), 1, in) != 1) { error = 1; break; }
+            if (slot >= slot_count) {
+                uint64_t count = slot + 1;
+                slots = (MTBDD**)realloc(slots, count * sizeof(MTBDD*));
+                slot_kinds = (uint8_t*)realloc(slot_kinds, count);
+                if (slots == NULL || slot_kinds == NULL) {
+                    fprintf(stderr, "sylvan_replay: Unable to allocate memory: %s!\n", strerror(errno));
+                    exit(1);
+                }
+                while (slot_count < count) slots[slot_count++] = NULL;
+            }
+            if (tag == RECORD_PROTECT) {
+                if (slots[slot] == NULL) {
+                    slots[slot] = (MTBDD*)malloc(sizeof(MTBDD));
+                    *slots[slot] = kind == KIND_LDD ? lddmc_false : mtbdd_false;
+                }
+                slot_kinds[slot] = (uint8_t)kind;
+                if (kind == KIND_LDD) lddmc_protect(slots[slot]);
+                else mtbdd_protect(slots[slot]);
+            } else if (slots[slot] != NULL) {
+                if (kind == KIND_LDD) lddmc_unprotect(slots[slot]);
+                else mtbdd_unprotect(slots[slot]);
+                free(slots[slot]);
+                slots[slot] = NULL;
+            }
+        } else {
+            error = 1;
+        }
+    }
+
+    for (uint64_t i=0; i<slot_count; i++) {
+        if (slots[i] == NULL) continue;
+        if (slot_kinds[i] == KIND_LDD) lddmc_unprotect(slots[i]);
+        else mtbdd_unprotect(slots[i]);
+        free(slots[i]);
+    }
+    free(slots);
+    free(slot_kinds);
+
+    if (replay_size != 0) sylvan_memory_sub(SYLVAN_MEM_INSTRUMENTATION, replay_size * (sizeof(MTBDD) + 1));
+    free(replay_dds);
+    free(replay_kinds);
+    replay_dds = NULL;
+    replay_kinds = NULL;
+    replay_size = replay_count = replay_first = 0;
+
+    return error ? -1 : calls;
+}
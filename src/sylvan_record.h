@@ -0,0 +1,160 @@
+/*
+ * Copyright 2011-2016 Formal Methods and Tools, University of Twente
+ * Copyright 2016-2017 Tom van Dijk, Johannes Kepler University Linz
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Do not include this file directly. Instead, include sylvan.h */
+
+#ifndef SYLVAN_RECORD_H
+#define SYLVAN_RECORD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * Recording and replaying the calls of an application.
+ *
+ * When recording is enabled, the following are written to a file:
+ * - the top-level calls (via their public macros) of sylvan_ite, sylvan_and, sylvan_xor,
+ *   sylvan_exists, sylvan_and_exists, sylvan_relnext, sylvan_relprev, mtbdd_apply with the
+ *   built-in operations plus, minus, times, min and max, and lddmc_union, lddmc_minus,
+ *   lddmc_intersect, lddmc_relprod and lddmc_relprod_union, with the time of each call;
+ * - their input decision diagrams, when they are first used (MTBDDs are written with
+ *   mtbdd_writer_tobinary). Results of recorded calls are not written again when they are
+ *   used as input, until the next garbage collection;
+ * - garbage collections;
+ * - calls to mtbdd_protect, mtbdd_unprotect, lddmc_protect and lddmc_unprotect.
+ *
+ * One call is recorded at a time: calls that are made while a recorded call is running, from
+ * inside that operation or concurrently by other threads, are not recorded. Their results are
+ * written as diagrams when they are used as input of a recorded call.
+ *
+ * sylvan_replay re-executes a recording against any build of Sylvan with the same word size,
+ * one call at a time, and reports the time of every call. See bench/bench_replay.c.
+ * Protected pointers are replayed with pointers to mtbdd_false resp. lddmc_false.
+ */
+
+/**
+ * Start recording to <out>, which must be opened for writing in binary mode.
+ * Call this after sylvan_init_package and while no operations are running.
+ */
+void sylvan_record_start(FILE *out);
+
+/**
+ * Stop recording. Does not close the file.
+ */
+void sylvan_record_stop(void);
+
+/**
+ * The recorded operations.
+ */
+typedef enum sylvan_record_op
+{
+    SYLVAN_RECORD_BDD_ITE,
+    SYLVAN_RECORD_BDD_AND,
+    SYLVAN_RECORD_BDD_XOR,
+    SYLVAN_RECORD_BDD_EXISTS,
+    SYLVAN_RECORD_BDD_AND_EXISTS,
+    SYLVAN_RECORD_BDD_RELNEXT,
+    SYLVAN_RECORD_BDD_RELPREV,
+    SYLVAN_RECORD_MTBDD_PLUS,
+    SYLVAN_RECORD_MTBDD_MINUS,
+    SYLVAN_RECORD_MTBDD_TIMES,
+    SYLVAN_RECORD_MTBDD_MIN,
+    SYLVAN_RECORD_MTBDD_MAX,
+    SYLVAN_RECORD_LDD_UNION,
+    SYLVAN_RECORD_LDD_MINUS,
+    SYLVAN_RECORD_LDD_INTERSECT,
+    SYLVAN_RECORD_LDD_RELPROD,
+    SYLVAN_RECORD_LDD_RELPROD_UNION,
+    SYLVAN_RECORD_OP_COUNT
+} sylvan_record_op_t;
+
+/**
+ * Name of a recorded operation, e.g. "sylvan_relnext" or "mtbdd_plus".
+ */
+const char* sylvan_record_op_name(int op);
+
+/**
+ * Callback for sylvan_replay, called after every replayed call with the index of the call
+ * in the recording, the time it took now and the time it took when it was recorded (in ns).
+ */
+typedef void (*sylvan_replay_cb)(int op, uint64_t index, uint64_t time, uint64_t recorded_time, void *context);
+
+/**
+ * Read the sizes of the nodes table and the operation cache when recording started, from
+ * the start of the recording <in> (which is then rewound), e.g. for sylvan_set_sizes.
+ * Returns 0, or -1 if <in> is not a valid recording.
+ */
+int sylvan_replay_sizes(FILE *in, size_t *table_size, size_t *table_max, size_t *cache_size, size_t *cache_max);
+
+/**
+ * Replay the recording in <in>. If <gc> is set, garbage collection is performed where it
+ * happened while recording. Calls <cb> (if not NULL) after every call.
+ * Returns the number of replayed calls, or -1 if <in> is not a valid recording.
+ */
+int64_t sylvan_replay(FILE *in, int gc, sylvan_replay_cb cb, void *context);
+
+/**
+ * Internal: the runtime switch and the recording of a call (see SYLVAN_RECORD_RUN2).
+ */
+extern int sylvan_record_active;
+
+typedef struct sylvan_record_scope
+{
+    int active;         // whether this call is recorded
+    int op;
+    uint64_t ids[4];    // the ids of the inputs in the recording
+    uint64_t start;
+} sylvan_record_scope_t;
+
+void sylvan_record_begin(sylvan_record_scope_t *scope, int op, int count, const uint64_t *args);
+void sylvan_record_end(sylvan_record_scope_t *scope, uint64_t result);
+void sylvan_record_protect(void *ptr, int ldd, int protect);
+
+/* the recording id of a built-in operation for mtbdd_apply, or -1 */
+int sylvan_record_apply_op(mtbdd_apply_op op);
+
+/**
+ * Run a task like SYLVAN_TRACE_RUN, and record it if recording is enabled.
+ * The decision diagrams <a>, <b>, ... are evaluated once; any further arguments are
+ * passed as they are.
+ */
+#define SYLVAN_RECORD_RUN_N(op, n, type, call) __extension__ ({ \
+    sylvan_record_scope_t __sylvan_record_scope; \
+    __sylvan_record_scope.active = 0; \
+    if (__builtin_expect(sylvan_record_active, 0)) sylvan_record_begin(&__sylvan_record_scope, op, n, __sylvan_record_args); \
+    type __sylvan_record_result = call; \
+    if (__builtin_expect(__sylvan_record_scope.active, 0)) sylvan_record_end(&__sylvan_record_scope, __sylvan_record_result); \
+    __sylvan_record_result; })
+
+#define SYLVAN_RECORD_RUN2(op, type, f, a, b, ...) __extension__ ({ \
+    const uint64_t __sylvan_record_args[2] = {(uint64_t)(a), (uint64_t)(b)}; \
+    SYLVAN_RECORD_RUN_N(op, 2, type, SYLVAN_TRACE_RUN(type, f, __sylvan_record_args[0], __sylvan_record_args[1], ##__VA_ARGS__)); })
+
+#define SYLVAN_RECORD_RUN3(op, type, f, a, b, c, ...) __extension__ ({ \
+    const uint64_t __sylvan_record_args[3] = {(uint64_t)(a), (uint64_t)(b), (uint64_t)(c)}; \
+    SYLVAN_RECORD_RUN_N(op, 3, type, SYLVAN_TRACE_RUN(type, f, __sylvan_record_args[0], __sylvan_record_args[1], __sylvan_record_args[2], ##__VA_ARGS__)); })
+
+#define SYLVAN_RECORD_RUN4(op, type, f, a, b, c, d, ...) __extension__ ({ \
+    const uint64_t __sylvan_record_args[4] = {(uint64_t)(a), (uint64_t)(b), (uint64_t)(c), (uint64_t)(d)}; \
+    SYLVAN_RECORD_RUN_N(op, 4, type, SYLVAN_TRACE_RUN(type, f, __sylvan_record_args[0], __sylvan_record_args[1], __sylvan_record_args[2], __sylvan_record_args[3], ##__VA_ARGS__)); })
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif
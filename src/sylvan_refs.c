@@ -134,6 +134,8 @@ refs_resize(refs_table_t *tbl)
         exit(1);
     }
 
+    sylvan_memory_add(SYLVAN_MEM_REFS, new_size * sizeof(uint64_t));
+
     // set new data and go
     tbl->refs_table = new_table;
     tbl->refs_size = new_size;
@@ -149,6 +151,7 @@ refs_resize(refs_table_t *tbl)
 
     // unmap old table
     free_aligned(tbl->refs_resize_table, tbl->refs_resize_size * sizeof(uint64_t));
+    sylvan_memory_sub(SYLVAN_MEM_REFS, tbl->refs_resize_size * sizeof(uint64_t));
 }
 
 /* Enter refs_modify */
@@ -175,13 +178,22 @@ refs_leave(refs_table_t *tbl)
     }
 }
 
-static inline int
-refs_modify(refs_table_t *tbl, const uint64_t a, const int dir)
+/**
+ * Add <dir> (positive or negative) to the reference count of <a>.
+ * Returns how much of <dir> was applied (in absolute value): a decrement is only applied
+ * as far as <a> has references. Saturated reference counts (0x7fffff) never change.
+ */
+static inline int64_t
+refs_modify(refs_table_t *tbl, const uint64_t a, const int64_t dir)
 {
     _Atomic(uint64_t)* bucket;
     _Atomic(uint64_t)* ts_bucket;
     uint64_t v, new_v;
-    int res, i;
+    int64_t res;
+    int i;
+
+    // count of a new entry
+    const uint64_t new_count = dir < 0x7fffff ? (uint64_t)dir : 0x7fffff;
 
     refs_enter(tbl);
 
@@ -204,14 +216,23 @@ ref_restart:
                 ts_bucket = NULL;
                 v = refs_ts;
             }
-            new_v = a | (1ULL << 40);
+            res = dir;
+            new_v = a | (new_count << 40);
             goto ref_mod;
         } else if ((v & 0x000000ffffffffff) == a) {
             // found
-            res = 1;
             uint64_t count = v >> 40;
-            if (count == 0x7fffff) goto ref_exit;
-            count += dir;
+            if (count == 0x7fffff) {
+                res = dir < 0 ? -dir : dir;
+                goto ref_exit;
+            }
+            if (dir < 0) {
+                res = (int64_t)count < -dir ? (int64_t)count : -dir;
+                count -= res;
+            } else {
+                res = dir;
+                count = count + dir < 0x7fffff ? count + dir : 0x7fffff;
+            }
             if (count == 0) new_v = refs_ts;
             else new_v = a | (count << 40);
             goto ref_mod;
@@ -228,9 +249,9 @@ ref_restart:
         bucket = ts_bucket;
         ts_bucket = NULL;
         v = refs_ts;
-        new_v = a | (1ULL << 40);
+        new_v = a | (new_count << 40);
         if (!atomic_compare_exchange_weak(bucket, &v, new_v)) goto ref_retry;
-        res = 1;
+        res = dir;
         goto ref_exit;
     } else {
         // hash table full
@@ -247,23 +268,206 @@ ref_exit:
     return res;
 }
 
+/**
+ * Deferred updates: a small hash table per buffer from values to the net change of their
+ * reference count. Key 0 is an empty slot (the value 0 is never referenced).
+ */
+typedef struct refs_entry
+{
+    uint64_t key;
+    int64_t delta;
+} refs_entry_t;
+
+typedef struct refs_buffer
+{
+    refs_entry_t *entries;
+    size_t size;            // number of slots (power of 2)
+    size_t used;            // number of used slots
+    pthread_mutex_t lock;   // only used for the buffer of threads that are not Lace workers
+} __attribute__((aligned(64))) refs_buffer_t;
+
+#define REFS_BUFFER_SIZE 1024
+
+static void
+refs_buffer_alloc(refs_buffer_t *buf, size_t size)
+{
+    buf->entries = (refs_entry_t*)calloc(size, sizeof(refs_entry_t));
+    if (buf->entries == NULL) {
+        fprintf(stderr, "refs: Unable to allocate memory: %s!\n", strerror(errno));
+        exit(1);
+    }
+    buf->size = size;
+    buf->used = 0;
+    sylvan_memory_add(SYLVAN_MEM_REFS, size * sizeof(refs_entry_t));
+}
+
+static void
+refs_buffer_insert(refs_buffer_t *buf, uint64_t a, int64_t delta)
+{
+    const size_t mask = buf->size - 1;
+    size_t i = fnvhash8(a) & mask;
+    for (;;) {
+        refs_entry_t *e = buf->entries + i;
+        if (e->key == a) {
+            e->delta += delta;
+            return;
+        }
+        if (e->key == 0) {
+            e->key = a;
+            e->delta = delta;
+            buf->used++;
+            return;
+        }
+        i = (i + 1) & mask;
+    }
+}
+
+/* Apply the increments or the decrements of a buffer to the table */
+static void
+refs_buffer_apply(refs_table_t *tbl, refs_buffer_t *buf, int decrements)
+{
+    refs_entry_t *e = buf->entries, * const end = buf->entries + buf->size;
+    for (; e != end; e++) {
+        if (e->key == 0) continue;
+        if (!decrements && e->delta > 0) {
+            refs_modify(tbl, e->key, e->delta);
+            e->delta = 0;
+        } else if (decrements && e->delta < 0) {
+            e->delta += refs_modify(tbl, e->key, e->delta);
+        }
+    }
+}
+
+/* Remove the applied entries; grow the buffer if many decrements are waiting */
+static void
+refs_buffer_compact(refs_buffer_t *buf)
+{
+    size_t keep = 0;
+    for (size_t i=0; i<buf->size; i++) {
+        if (buf->entries[i].key != 0 && buf->entries[i].delta != 0) keep++;
+    }
+    if (keep == 0) {
+        memset(buf->entries, 0, buf->size * sizeof(refs_entry_t));
+        buf->used = 0;
+        return;
+    }
+    refs_entry_t *old = buf->entries;
+    size_t old_size = buf->size, size = buf->size;
+    while (keep * 4 > size) size *= 2;
+    refs_buffer_alloc(buf, size);
+    for (size_t i=0; i<old_size; i++) {
+        if (old[i].key != 0 && old[i].delta != 0) refs_buffer_insert(buf, old[i].key, old[i].delta);
+    }
+    free(old);
+    sylvan_memory_sub(SYLVAN_MEM_REFS, old_size * sizeof(refs_entry_t));
+}
+
+/* Return the buffer of the current thread, or NULL if updates are not deferred */
+static inline refs_buffer_t*
+refs_get_buffer(refs_table_t *tbl)
+{
+    if (tbl->refs_buffers == NULL) return NULL;
+    WorkerP *w = lace_get_worker();
+    if (w == NULL || (unsigned int)w->worker >= tbl->refs_buffer_count - 1) {
+        return tbl->refs_buffers + tbl->refs_buffer_count - 1;
+    }
+    return tbl->refs_buffers + w->worker;
+}
+
+static void
+refs_deferred_modify(refs_table_t *tbl, refs_buffer_t *buf, uint64_t a, int64_t delta)
+{
+    const int shared = buf == tbl->refs_buffers + tbl->refs_buffer_count - 1;
+    if (shared) pthread_mutex_lock(&buf->lock);
+    refs_buffer_insert(buf, a, delta);
+    if (buf->used * 2 > buf->size) {
+        // full: apply the net changes of this buffer
+        refs_buffer_apply(tbl, buf, 0);
+        refs_buffer_apply(tbl, buf, 1);
+        refs_buffer_compact(buf);
+    }
+    if (shared) pthread_mutex_unlock(&buf->lock);
+}
+
 void
 refs_up(refs_table_t *tbl, uint64_t a)
 {
-    refs_modify(tbl, a, 1);
+    refs_buffer_t *buf = refs_get_buffer(tbl);
+    if (buf != NULL) refs_deferred_modify(tbl, buf, a, 1);
+    else refs_modify(tbl, a, 1);
 }
 
 void
 refs_down(refs_table_t *tbl, uint64_t a)
 {
+    refs_buffer_t *buf = refs_get_buffer(tbl);
+    if (buf != NULL) {
+        refs_deferred_modify(tbl, buf, a, -1);
+        return;
+    }
 #ifdef NDEBUG
     refs_modify(tbl, a, -1);
 #else
-    int res = refs_modify(tbl, a, -1);
+    int64_t res = refs_modify(tbl, a, -1);
     assert(res != 0);
 #endif
 }
 
+void
+refs_defer(refs_table_t *tbl, unsigned int workers)
+{
+    if (tbl->refs_buffers != NULL) return;
+    const unsigned int count = workers + 1;
+    tbl->refs_buffers = (refs_buffer_t*)alloc_aligned(count * sizeof(refs_buffer_t));
+    if (tbl->refs_buffers == NULL) {
+        fprintf(stderr, "refs: Unable to allocate memory: %s!\n", strerror(errno));
+        exit(1);
+    }
+    sylvan_memory_add(SYLVAN_MEM_REFS, count * sizeof(refs_buffer_t));
+    for (unsigned int i=0; i<count; i++) {
+        refs_buffer_alloc(tbl->refs_buffers + i, REFS_BUFFER_SIZE);
+        pthread_mutex_init(&tbl->refs_buffers[i].lock, NULL);
+    }
+    tbl->refs_buffer_count = count;
+}
+
+void
+refs_flush(refs_table_t *tbl)
+{
+    if (tbl->refs_buffers == NULL) return;
+    refs_buffer_t *shared = tbl->refs_buffers + tbl->refs_buffer_count - 1;
+    pthread_mutex_lock(&shared->lock);
+    // first all increments, so every decrement finds its reference
+    for (unsigned int i=0; i<tbl->refs_buffer_count; i++) refs_buffer_apply(tbl, tbl->refs_buffers + i, 0);
+    for (unsigned int i=0; i<tbl->refs_buffer_count; i++) refs_buffer_apply(tbl, tbl->refs_buffers + i, 1);
+    for (unsigned int i=0; i<tbl->refs_buffer_count; i++) {
+        refs_buffer_t *buf = tbl->refs_buffers + i;
+#ifndef NDEBUG
+        // any remaining decrement is a refs_down without refs_up
+        for (size_t j=0; j<buf->size; j++) assert(buf->entries[j].key == 0 || buf->entries[j].delta == 0);
+#endif
+        memset(buf->entries, 0, buf->size * sizeof(refs_entry_t));
+        buf->used = 0;
+    }
+    pthread_mutex_unlock(&shared->lock);
+}
+
+static void
+refs_buffers_free(refs_table_t *tbl)
+{
+    if (tbl->refs_buffers == NULL) return;
+    for (unsigned int i=0; i<tbl->refs_buffer_count; i++) {
+        refs_buffer_t *buf = tbl->refs_buffers + i;
+        free(buf->entries);
+        sylvan_memory_sub(SYLVAN_MEM_REFS, buf->size * sizeof(refs_entry_t));
+        pthread_mutex_destroy(&buf->lock);
+    }
+    free_aligned(tbl->refs_buffers, tbl->refs_buffer_count * sizeof(refs_buffer_t));
+    sylvan_memory_sub(SYLVAN_MEM_REFS, tbl->refs_buffer_count * sizeof(refs_buffer_t));
+    tbl->refs_buffers = NULL;
+    tbl->refs_buffer_count = 0;
+}
+
 uint64_t*
 refs_iter(refs_table_t *tbl, size_t first, size_t end)
 {
@@ -308,17 +512,22 @@ refs_create(refs_table_t *tbl, size_t _refs_size)
     }
 
     tbl->refs_size = _refs_size;
+    tbl->refs_buffers = NULL;
+    tbl->refs_buffer_count = 0;
     tbl->refs_table = (_Atomic(uint64_t)*)alloc_aligned(tbl->refs_size * sizeof(uint64_t));
     if (tbl->refs_table == 0) {
         fprintf(stderr, "refs: Unable to allocate memory: %s!\n", strerror(errno));
         exit(1);
     }
+    sylvan_memory_add(SYLVAN_MEM_REFS, tbl->refs_size * sizeof(uint64_t));
 }
 
 void
 refs_free(refs_table_t *tbl)
 {
+    refs_buffers_free(tbl);
     free_aligned(tbl->refs_table, tbl->refs_size * sizeof(uint64_t));
+    sylvan_memory_sub(SYLVAN_MEM_REFS, tbl->refs_size * sizeof(uint64_t));
 }
 
 /**
@@ -417,6 +626,8 @@ protect_resize(refs_table_t *tbl)
         exit(1);
     }
 
+    sylvan_memory_add(SYLVAN_MEM_REFS, new_size * sizeof(uint64_t));
+
     // set new data and go
     tbl->refs_table = new_table;
     tbl->refs_size = new_size;
@@ -432,6 +643,7 @@ protect_resize(refs_table_t *tbl)
 
     // unmap old table
     free_aligned(tbl->refs_resize_table, tbl->refs_resize_size * sizeof(uint64_t));
+    sylvan_memory_sub(SYLVAN_MEM_REFS, tbl->refs_resize_size * sizeof(uint64_t));
 }
 
 static inline void
@@ -517,8 +729,8 @@ ref_restart:
     }
 }
 
-void
-protect_down(refs_table_t *tbl, uint64_t a)
+int
+protect_remove(refs_table_t *tbl, uint64_t a)
 {
     _Atomic(uint64_t)* bucket;
     protect_enter(tbl);
@@ -531,13 +743,25 @@ protect_down(refs_table_t *tbl, uint64_t a)
         if (d == a) {
             atomic_store_explicit(bucket, refs_ts, memory_order_relaxed);
             protect_leave(tbl);
-            return;
+            return 1;
         }
         if (++bucket == tbl->refs_table + tbl->refs_size) bucket = tbl->refs_table;
     }
 
     // not found after linear probing
-    assert(0);
+    protect_leave(tbl);
+    return 0;
+}
+
+void
+protect_down(refs_table_t *tbl, uint64_t a)
+{
+#ifdef NDEBUG
+    protect_remove(tbl, a);
+#else
+    int res = protect_remove(tbl, a);
+    assert(res != 0);
+#endif
 }
 
 uint64_t*
@@ -589,11 +813,13 @@ protect_create(refs_table_t *tbl, size_t _refs_size)
         fprintf(stderr, "refs: Unable to allocate memory: %s!\n", strerror(errno));
         exit(1);
     }
+    sylvan_memory_add(SYLVAN_MEM_REFS, tbl->refs_size * sizeof(uint64_t));
 }
 
 void
 protect_free(refs_table_t *tbl)
 {
     free_aligned(tbl->refs_table, tbl->refs_size * sizeof(uint64_t));
+    sylvan_memory_sub(SYLVAN_MEM_REFS, tbl->refs_size * sizeof(uint64_t));
     tbl->refs_table = 0;
 }
@@ -40,9 +40,14 @@ typedef struct
     size_t refs_resize_size;              // size of previous table
     _Atomic(size_t) refs_resize_part;     // which part is next
     _Atomic(size_t) refs_resize_done;     // how many parts are done
+
+    /* deferred updates (see refs_defer) */
+    struct refs_buffer *refs_buffers;     // one per Lace worker, the last one for other threads
+    unsigned int refs_buffer_count;       // number of buffers (0 if updates are not deferred)
 } refs_table_t;
 
 // Count number of unique entries (not number of references)
+// Does not include updates that are still deferred (see refs_flush)
 size_t refs_count(refs_table_t *tbl);
 
 // Increase or decrease reference to 40-bit value a
@@ -50,6 +55,16 @@ size_t refs_count(refs_table_t *tbl);
 void refs_up(refs_table_t *tbl, uint64_t a);
 void refs_down(refs_table_t *tbl, uint64_t a);
 
+// Defer refs_up and refs_down to a buffer per Lace worker (and one shared buffer for other
+// threads) that holds the net change per value. Only the net changes are applied to the table,
+// when a buffer fills up and by refs_flush. Decrements of values that are not (yet) in the
+// table, because the matching increment is still in another buffer, stay in the buffer.
+void refs_defer(refs_table_t *tbl, unsigned int workers);
+
+// Apply all deferred updates to the table, increments first
+// Only call this while no other thread updates references, e.g. during garbage collection
+void refs_flush(refs_table_t *tbl);
+
 // Return a bucket or NULL to start iterating
 uint64_t *refs_iter(refs_table_t *tbl, size_t first, size_t end);
 
@@ -64,6 +79,7 @@ void refs_free(refs_table_t *tbl);
 size_t protect_count(refs_table_t *tbl);
 void protect_up(refs_table_t *tbl, uint64_t a);
 void protect_down(refs_table_t *tbl, uint64_t a);
+int protect_remove(refs_table_t *tbl, uint64_t a); // protect_down that returns 0 if a is not found
 uint64_t *protect_iter(refs_table_t *tbl, size_t first, size_t end);
 uint64_t protect_next(refs_table_t *tbl, uint64_t **bucket, size_t end);
 void protect_create(refs_table_t *tbl, size_t _refs_size);
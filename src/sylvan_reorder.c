@@ -0,0 +1,785 @@
+/*
+ * Copyright 2011-2016 Formal Methods and Tools, University of Twente
+ * Copyright 2016-2017 Tom van Dijk, Johannes Kepler University Linz
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sylvan_int.h>
+
+#include <string.h> // for memset, memcpy
+
+/**
+ * The variable order of the levels that can be reordered.
+ */
+static uint32_t levels_n = 0;
+static uint32_t *level_to_var = NULL;
+static uint32_t *var_to_level = NULL;
+static uint32_t *var_group = NULL;      // the first variable of the group of every variable
+static uint8_t *swap_upper = NULL;      // during a pass: swap the variables at l and l+1
+
+/**
+ * Settings and automatic reordering
+ */
+static double reorder_maxgrowth = 1.2;
+static size_t reorder_maxswaps = 0;
+static sylvan_reorder_type_t auto_type = SYLVAN_REORDER_SIFT;
+static size_t auto_threshold = 0;
+static size_t auto_next = 0;            // 0 if automatic reordering is disabled
+static _Atomic(int) auto_requested = 0;
+static int reordering = 0;              // reordering runs garbage collection itself
+static int registered = 0;
+static const char *unsupported = NULL;  // the nodes table may have nodes that are not (MT)BDDs
+
+static void
+sylvan_reorder_quit(void)
+{
+    free(level_to_var);
+    free(var_to_level);
+    free(var_group);
+    free(swap_upper);
+    level_to_var = var_to_level = var_group = NULL;
+    swap_upper = NULL;
+    levels_n = 0;
+    auto_threshold = auto_next = 0;
+    auto_requested = 0;
+    registered = 0;
+    unsupported = NULL;
+}
+
+VOID_TASK_0(sylvan_reorder_postgc)
+{
+    if (auto_next == 0 || reordering) return;
+    sylvan_gc_info_t info;
+    sylvan_gc_get_info(&info);
+    if (info.nodes_after >= auto_next) auto_requested = 1;
+}
+
+static void
+sylvan_reorder_register(void)
+{
+    if (!registered) {
+        sylvan_register_quit(sylvan_reorder_quit);
+        sylvan_gc_hook_postgc(sylvan_reorder_postgc_CALL);
+        registered = 1;
+    }
+}
+
+void
+sylvan_reorder_unsupported(const char *module)
+{
+    sylvan_reorder_register();
+    unsupported = module;
+}
+
+/**
+ * Nodes of other types would be taken for BDD nodes and relabeled, so refuse to reorder.
+ */
+static int
+reorder_supported(const char *operation)
+{
+    if (unsupported == NULL) return 1;
+    fprintf(stderr, "%s: reordering is not supported with %s, not reordering!\n", operation, unsupported);
+    return 0;
+}
+
+void
+sylvan_levels_init(uint32_t n)
+{
+    if (n <= levels_n) return;
+    sylvan_reorder_register();
+
+    level_to_var = (uint32_t*)realloc(level_to_var, sizeof(uint32_t) * n);
+    var_to_level = (uint32_t*)realloc(var_to_level, sizeof(uint32_t) * n);
+    var_group = (uint32_t*)realloc(var_group, sizeof(uint32_t) * n);
+    swap_upper = (uint8_t*)realloc(swap_upper, n);
+    if (level_to_var == NULL || var_to_level == NULL || var_group == NULL || swap_upper == NULL) {
+        fprintf(stderr, "sylvan_levels_init: Unable to allocate memory!\n");
+        exit(1);
+    }
+
+    // the new levels were never reordered
+    for (uint32_t i=levels_n; i<n; i++) level_to_var[i] = var_to_level[i] = var_group[i] = i;
+    levels_n = n;
+}
+
+uint32_t
+sylvan_levels_count(void)
+{
+    return levels_n;
+}
+
+uint32_t
+sylvan_var_to_level(uint32_t var)
+{
+    return var < levels_n ? var_to_level[var] : var;
+}
+
+uint32_t
+sylvan_level_to_var(uint32_t level)
+{
+    return level < levels_n ? level_to_var[level] : level;
+}
+
+/**
+ * The first level of the group at <level>, and the first level after it.
+ */
+static uint32_t
+reorder_group_start(uint32_t level)
+{
+    const uint32_t g = var_group[level_to_var[level]];
+    while (level > 0 && var_group[level_to_var[level-1]] == g) level--;
+    return level;
+}
+
+static uint32_t
+reorder_group_end(uint32_t level)
+{
+    const uint32_t g = var_group[level_to_var[level]];
+    while (level < levels_n && var_group[level_to_var[level]] == g) level++;
+    return level;
+}
+
+void
+sylvan_levels_group(uint32_t level, uint32_t n)
+{
+    if (n == 0 || level >= levels_n || n > levels_n - level) {
+        fprintf(stderr, "sylvan_levels_group: levels %u to %u are not all reordered levels!\n", level, level+n-1);
+        exit(1);
+    }
+    for (uint32_t l=level; l<level+n; l++) {
+        if (reorder_group_start(l) != l || reorder_group_end(l) != l+1) {
+            fprintf(stderr, "sylvan_levels_group: level %u is already in a group!\n", l);
+            exit(1);
+        }
+    }
+    const uint32_t first = level_to_var[level];
+    for (uint32_t l=level; l<level+n; l++) var_group[level_to_var[l]] = first;
+}
+
+void
+sylvan_reorder_set_maxgrowth(double factor)
+{
+    reorder_maxgrowth = factor;
+}
+
+void
+sylvan_reorder_set_maxswaps(size_t swaps)
+{
+    reorder_maxswaps = swaps;
+}
+
+void
+sylvan_reorder_set_auto(sylvan_reorder_type_t type, size_t threshold)
+{
+    sylvan_reorder_register();
+    auto_type = type;
+    auto_threshold = auto_next = threshold;
+    auto_requested = 0;
+}
+
+/**
+ * Swapping adjacent levels in the nodes table.
+ *
+ * A pass swaps the variables at l and l+1 for a number of (disjoint) pairs of levels at once.
+ * Nodes keep their index and their function, so all BDDs remain valid:
+ * 1) Find the nodes at l that depend on the variable at l+1 (they are rewritten in step 4).
+ * 2) Relabel the other nodes at l to l+1, and the nodes at l+1 to l.
+ * 3) Clear the hash array and rehash all nodes, except the nodes of step 1.
+ * 4) Rewrite every node F of step 1: with the cofactors f00, f01, f10 and f11 of F on the
+ *    variables at l and l+1 (before the swap), F becomes node(l, node(l+1, f00, f10),
+ *    node(l+1, f01, f11)). Then rehash F.
+ * Nodes at l+1 that are no longer used are removed by the next garbage collection.
+ */
+
+/**
+ * Iterate over the set bits <index> of the bitmap <bitmap> between <first> and <first>+<count>.
+ */
+#define REORDER_FOREACH(bitmap, first, count, index)                                            \
+    for (size_t __k=(first); __k<(first)+(count); __k+=64)                                     \
+        for (uint64_t __word = reorder_bitmap_word(bitmap, __k, (first)+(count)), index = 0;   \
+             __word != 0 && (index = __k + __builtin_clzll(__word), __word &= ~(0x8000000000000000LL >> (index - __k)), 1); )
+
+static inline uint64_t
+reorder_bitmap_word(_Atomic(uint64_t)* bitmap, size_t k, size_t end)
+{
+    uint64_t word = atomic_load_explicit(bitmap + k/64, memory_order_relaxed);
+    if (k == 0) word &= 0x3fffffffffffffffLL; // the first two buckets are not used
+    if (end - k < 64) word &= ~(0xffffffffffffffffLL >> (end - k));
+    return word;
+}
+
+/**
+ * Split the buckets first..first+count-1 for parallel passes, at multiples of 64.
+ */
+#define REORDER_SPLIT(count) (((count) / 2) & ~(size_t)63)
+
+/**
+ * The level of the node <dd>, or UINT32_MAX for leaves.
+ */
+static inline uint32_t
+reorder_level(MTBDD dd)
+{
+    if ((dd & 0x000000ffffffffff) == 0) return UINT32_MAX;
+    mtbddnode_t n = MTBDD_GETNODE(dd);
+    return mtbddnode_isleaf(n) ? UINT32_MAX : mtbddnode_getvariable(n);
+}
+
+/**
+ * Get the node at <index> if it is a BDD node (not a leaf or map node) of a reordered level.
+ */
+static inline mtbddnode_t
+reorder_node(uint64_t index, uint32_t *level)
+{
+    mtbddnode_t n = MTBDD_GETNODE(index);
+    if (mtbddnode_isleaf(n) || mtbddnode_ismapnode(n)) return NULL;
+    *level = mtbddnode_getvariable(n);
+    return *level < levels_n ? n : NULL;
+}
+
+TASK_3(size_t, reorder_find_par, llmsset_visited_t, interact, size_t, first, size_t, count)
+{
+    if (count > 4096) {
+        size_t split = REORDER_SPLIT(count);
+        SPAWN(reorder_find_par, interact, first, split);
+        size_t result = CALL(reorder_find_par, interact, first + split, count - split);
+        return result + SYNC(reorder_find_par);
+    }
+
+    size_t result = 0;
+    REORDER_FOREACH(nodes->bitmap2, first, count, index) {
+        uint32_t level;
+        mtbddnode_t n = reorder_node(index, &level);
+        if (n == NULL || !swap_upper[level]) continue;
+        if (reorder_level(mtbddnode_getlow(n)) == level+1 || reorder_level(mtbddnode_gethigh(n)) == level+1) {
+            llmsset_visited_add(interact, index);
+            result++;
+        }
+    }
+    return result;
+}
+
+VOID_TASK_3(reorder_relabel_par, llmsset_visited_t, interact, size_t, first, size_t, count)
+{
+    if (count > 4096) {
+        size_t split = REORDER_SPLIT(count);
+        SPAWN(reorder_relabel_par, interact, first, split);
+        CALL(reorder_relabel_par, interact, first + split, count - split);
+        SYNC(reorder_relabel_par);
+        return;
+    }
+
+    REORDER_FOREACH(nodes->bitmap2, first, count, index) {
+        uint32_t level;
+        mtbddnode_t n = reorder_node(index, &level);
+        if (n == NULL) continue;
+        if (swap_upper[level]) {
+            if (!llmsset_visited_contains(interact, index)) mtbddnode_setvariable(n, level+1);
+        } else if (level > 0 && swap_upper[level-1]) {
+            mtbddnode_setvariable(n, level-1);
+        }
+    }
+}
+
+/**
+ * Create a node in the nodes table; the table has room for it (see reorder_swap_pass).
+ */
+static MTBDD
+reorder_makenode(uint32_t var, MTBDD low, MTBDD high)
+{
+    if (low == high) return low;
+
+    MTBDD result = low & mtbdd_complement;
+    low ^= result;
+    high ^= result;
+
+    struct mtbddnode n;
+    mtbddnode_makenode(&n, var, low, high);
+
+    int created;
+    uint64_t index = llmsset_lookup(nodes, n.a, n.b, &created);
+    if (index == 0) {
+        fprintf(stderr, "sylvan_reorder: Unique table full, %zu of %zu buckets filled!\n", llmsset_count_marked_seq(nodes), llmsset_get_size(nodes));
+        exit(1);
+    }
+
+    if (created) sylvan_stats_count(BDD_NODES_CREATED);
+    else sylvan_stats_count(BDD_NODES_REUSED);
+
+    return result | index;
+}
+
+/**
+ * The cofactors of <dd> on the variable that is now at <level> (after relabeling).
+ */
+static inline void
+reorder_cofactors(MTBDD dd, uint32_t level, MTBDD *low, MTBDD *high)
+{
+    if (reorder_level(dd) == level) {
+        mtbddnode_t n = MTBDD_GETNODE(dd);
+        *low = node_getlow(dd, n);
+        *high = node_gethigh(dd, n);
+    } else {
+        *low = *high = dd;
+    }
+}
+
+VOID_TASK_3(reorder_rewrite_par, llmsset_visited_t, interact, size_t, first, size_t, count)
+{
+    if (count > 4096) {
+        size_t split = REORDER_SPLIT(count);
+        SPAWN(reorder_rewrite_par, interact, first, split);
+        CALL(reorder_rewrite_par, interact, first + split, count - split);
+        SYNC(reorder_rewrite_par);
+        return;
+    }
+
+    REORDER_FOREACH(interact->bitmap, first, count, index) {
+        mtbddnode_t n = MTBDD_GETNODE(index);
+        const uint32_t level = mtbddnode_getvariable(n);
+        MTBDD f00, f01, f10, f11;
+        reorder_cofactors(mtbddnode_getlow(n), level, &f00, &f01);
+        reorder_cofactors(mtbddnode_gethigh(n), level, &f10, &f11);
+        // the low edge of F has no mark, so neither has the new low edge
+        MTBDD low = reorder_makenode(level+1, f00, f10);
+        MTBDD high = reorder_makenode(level+1, f01, f11);
+        mtbddnode_makenode(n, level, low, high);
+        if (llmsset_rehash_bucket(nodes, index) == 0) {
+            fprintf(stderr, "sylvan_reorder: Unable to rehash a node!\n");
+            exit(1);
+        }
+    }
+}
+
+/**
+ * Swap the variables at <pairs>[i] and <pairs>[i]+1 for all <n> pairs, which may not overlap.
+ * Returns 0 if the nodes table is too full.
+ */
+TASK_2(int, reorder_swap_pass, const uint32_t*, pairs, size_t, n)
+{
+    memset(swap_upper, 0, levels_n);
+    for (size_t i=0; i<n; i++) swap_upper[pairs[i]] = 1;
+
+    llmsset_visited_t interact;
+    for (int attempt=0;; attempt++) {
+        interact = llmsset_visited_create(nodes);
+        const size_t size = llmsset_get_size(nodes);
+        size_t count = CALL(reorder_find_par, interact, 0, size);
+        // every node that depends on both variables needs at most two new nodes
+        if (CALL(llmsset_count_marked, nodes) + 2 * count <= size / 4 * 3) break;
+        llmsset_visited_free(interact);
+
+        if (attempt == 0) {
+            CALL(sylvan_gc_go);
+        } else if (size < llmsset_get_max_size(nodes)) {
+            size_t new_size = size * 2;
+            if (new_size > llmsset_get_max_size(nodes)) new_size = llmsset_get_max_size(nodes);
+            llmsset_set_size(nodes, new_size);
+            CALL(sylvan_rehash_all);
+        } else {
+            return 0;
+        }
+    }
+
+    CALL(reorder_relabel_par, interact, 0, llmsset_get_size(nodes));
+
+    CALL(llmsset_clear_hashes, nodes);
+    if (CALL(llmsset_rehash_skip, nodes, interact) != 0) {
+        fprintf(stderr, "sylvan_reorder: not all nodes could be rehashed!\n");
+        exit(1);
+    }
+
+    CALL(reorder_rewrite_par, interact, 0, llmsset_get_size(nodes));
+    llmsset_visited_free(interact);
+
+    for (size_t i=0; i<n; i++) {
+        const uint32_t l = pairs[i];
+        const uint32_t a = level_to_var[l], b = level_to_var[l+1];
+        level_to_var[l] = b;
+        level_to_var[l+1] = a;
+        var_to_level[a] = l+1;
+        var_to_level[b] = l;
+    }
+    sylvan_stats_add(SYLVAN_REORDER_SWAPS, n);
+    return 1;
+}
+
+/**
+ * Move every variable v to the level <target>[v], with passes that swap all adjacent pairs
+ * of levels (first at even, then at odd levels) that are in the wrong order.
+ * Returns 0 if the nodes table is too full.
+ */
+TASK_1(int, reorder_to, const uint32_t*, target)
+{
+    uint32_t *pairs = (uint32_t*)malloc(sizeof(uint32_t) * (levels_n / 2 + 1));
+    if (pairs == NULL) {
+        fprintf(stderr, "sylvan_reorder: Unable to allocate memory!\n");
+        exit(1);
+    }
+
+    int result = 1, parity = 0, idle = 0;
+    while (idle < 2) {
+        size_t n = 0;
+        for (uint32_t l=parity; l+1<levels_n; l+=2) {
+            if (target[level_to_var[l]] > target[level_to_var[l+1]]) pairs[n++] = l;
+        }
+        if (n == 0) {
+            idle++;
+        } else if (CALL(reorder_swap_pass, pairs, n)) {
+            idle = 0;
+        } else {
+            result = 0;
+            break;
+        }
+        parity = 1 - parity;
+    }
+
+    free(pairs);
+    return result;
+}
+
+VOID_TASK_3(reorder_count_par, _Atomic(uint64_t)*, counts, size_t, first, size_t, count)
+{
+    if (count > 4096) {
+        size_t split = REORDER_SPLIT(count);
+        SPAWN(reorder_count_par, counts, first, split);
+        CALL(reorder_count_par, counts, first + split, count - split);
+        SYNC(reorder_count_par);
+        return;
+    }
+
+    uint32_t last = UINT32_MAX;
+    uint64_t run = 0;
+    REORDER_FOREACH(nodes->bitmap2, first, count, index) {
+        uint32_t level;
+        if (reorder_node(index, &level) == NULL) continue;
+        if (level != last) {
+            if (run != 0) atomic_fetch_add_explicit(counts + last, run, memory_order_relaxed);
+            last = level;
+            run = 0;
+        }
+        run++;
+    }
+    if (run != 0) atomic_fetch_add_explicit(counts + last, run, memory_order_relaxed);
+}
+
+/**
+ * Garbage collection, then count the nodes of every level in <counts> (unless NULL).
+ * Returns the number of nodes in the table.
+ */
+TASK_1(size_t, reorder_measure, _Atomic(uint64_t)*, counts)
+{
+    CALL(sylvan_gc_go);
+    if (counts != NULL) {
+        for (uint32_t l=0; l<levels_n; l++) atomic_store_explicit(counts + l, 0, memory_order_relaxed);
+        CALL(reorder_count_par, counts, 0, llmsset_get_size(nodes));
+    }
+    return CALL(llmsset_count_marked, nodes);
+}
+
+/**
+ * Groups in a variable order <order> (the variable at every level): <starts> has the first
+ * level of every group, followed by levels_n. Returns the number of groups.
+ */
+static uint32_t
+reorder_groups(uint32_t *starts)
+{
+    uint32_t n = 0;
+    for (uint32_t l=0; l<levels_n; l=reorder_group_end(l)) starts[n++] = l;
+    starts[n] = levels_n;
+    return n;
+}
+
+static void
+reorder_reverse(uint32_t *order, uint32_t from, uint32_t to)
+{
+    while (from + 1 < to) {
+        uint32_t tmp = order[from];
+        order[from++] = order[--to];
+        order[to] = tmp;
+    }
+}
+
+/**
+ * Move group <i> past group <i>+1 in <order> and <starts>.
+ */
+static void
+reorder_swap_groups(uint32_t *order, uint32_t *starts, uint32_t i)
+{
+    const uint32_t a = starts[i], b = starts[i+1], c = starts[i+2];
+    reorder_reverse(order, a, b);
+    reorder_reverse(order, b, c);
+    reorder_reverse(order, a, c);
+    starts[i+1] = a + (c - b);
+}
+
+/**
+ * Move the variables to the order <order> (which uses <target> for the levels).
+ */
+TASK_2(int, reorder_to_order, const uint32_t*, order, uint32_t*, target)
+{
+    for (uint32_t l=0; l<levels_n; l++) target[order[l]] = l;
+    return CALL(reorder_to, target);
+}
+
+typedef struct reorder_group
+{
+    uint64_t size;
+    uint32_t var;
+} reorder_group_t;
+
+static int
+reorder_group_cmp(const void *a, const void *b)
+{
+    const reorder_group_t *ga = (const reorder_group_t*)a, *gb = (const reorder_group_t*)b;
+    if (ga->size != gb->size) return ga->size > gb->size ? -1 : 1;
+    return ga->var < gb->var ? -1 : (ga->var > gb->var ? 1 : 0);
+}
+
+/**
+ * Sifting (Rudell): move every group, largest first, to every position (first towards the
+ * nearest end, as long as the size does not grow too much) and then to the best position.
+ */
+VOID_TASK_0(reorder_sift)
+{
+    uint32_t *starts = (uint32_t*)malloc(sizeof(uint32_t) * (levels_n + 1));
+    uint32_t *order = (uint32_t*)malloc(sizeof(uint32_t) * levels_n);
+    uint32_t *target = (uint32_t*)malloc(sizeof(uint32_t) * levels_n);
+    _Atomic(uint64_t) *counts = (_Atomic(uint64_t)*)malloc(sizeof(uint64_t) * levels_n);
+    reorder_group_t *groups = (reorder_group_t*)malloc(sizeof(reorder_group_t) * levels_n);
+    if (starts == NULL || order == NULL || target == NULL || counts == NULL || groups == NULL) {
+        fprintf(stderr, "sylvan_reorder: Unable to allocate memory!\n");
+        exit(1);
+    }
+
+    size_t size = CALL(reorder_measure, counts);
+    uint32_t n = reorder_groups(starts);
+    for (uint32_t i=0; i<n; i++) {
+        groups[i].var = var_group[level_to_var[starts[i]]];
+        groups[i].size = 0;
+        for (uint32_t l=starts[i]; l<starts[i+1]; l++) groups[i].size += counts[l];
+    }
+    qsort(groups, n, sizeof(reorder_group_t), reorder_group_cmp);
+
+    size_t swaps = 0;
+    int full = 0;
+    for (uint32_t g=0; g<n && !full; g++) {
+        if (reorder_maxswaps != 0 && swaps >= reorder_maxswaps) break;
+
+        memcpy(order, level_to_var, sizeof(uint32_t) * levels_n);
+        reorder_groups(starts);
+        uint32_t pos = 0;
+        while (var_group[order[starts[pos]]] != groups[g].var) pos++;
+
+        uint32_t best_pos = pos;
+        size_t best = size;
+        int down = n - 1 - pos < pos;
+        for (int dir=0; dir<2 && !full; dir++, down = !down) {
+            while (down ? pos + 1 < n : pos > 0) {
+                if (reorder_maxswaps != 0 && swaps >= reorder_maxswaps) break;
+                reorder_swap_groups(order, starts, down ? pos : pos - 1);
+                if (!CALL(reorder_to_order, order, target)) {
+                    full = 1;
+                    break;
+                }
+                swaps++;
+                pos = down ? pos + 1 : pos - 1;
+                size = CALL(reorder_measure, NULL);
+                if (size < best) {
+                    best = size;
+                    best_pos = pos;
+                }
+                if ((double)size > (double)best * reorder_maxgrowth) break;
+            }
+        }
+        if (full) break;
+
+        // move the group to the best position, in one go
+        while (pos < best_pos) reorder_swap_groups(order, starts, pos++);
+        while (pos > best_pos) reorder_swap_groups(order, starts, --pos);
+        if (!CALL(reorder_to_order, order, target)) break;
+        size = best;
+    }
+
+    free(starts);
+    free(order);
+    free(target);
+    free((void*)counts);
+    free(groups);
+}
+
+/**
+ * Window permutation: for windows of <width> adjacent groups, try all orders of the groups in the
+ * window and keep the best one. All windows (every <width> groups, from an offset) are done at the
+ * same time. Repeat for all offsets, until the size no longer improves.
+ */
+VOID_TASK_1(reorder_window, int, width)
+{
+    // sequences of swaps in a window that visit all orders and end with the original order
+    static const uint32_t seq2[2] = {0, 0};
+    static const uint32_t seq3[6] = {0, 1, 0, 1, 0, 1};
+    const uint32_t *seq = width == 2 ? seq2 : seq3;
+    const int steps = width == 2 ? 2 : 6;
+
+    uint32_t *starts = (uint32_t*)malloc(sizeof(uint32_t) * (levels_n + 1));
+    uint32_t *order = (uint32_t*)malloc(sizeof(uint32_t) * levels_n);
+    uint32_t *target = (uint32_t*)malloc(sizeof(uint32_t) * levels_n);
+    _Atomic(uint64_t) *counts = (_Atomic(uint64_t)*)malloc(sizeof(uint64_t) * levels_n);
+    uint64_t *best = (uint64_t*)malloc(sizeof(uint64_t) * levels_n);
+    int *best_step = (int*)malloc(sizeof(int) * levels_n);
+    if (starts == NULL || order == NULL || target == NULL || counts == NULL || best == NULL || best_step == NULL) {
+        fprintf(stderr, "sylvan_reorder: Unable to allocate memory!\n");
+        exit(1);
+    }
+
+    int improved = 1, full = 0;
+    while (improved && !full) {
+        improved = 0;
+        for (int offset=0; offset<width && !full; offset++) {
+            const uint32_t n = reorder_groups(starts);
+            if ((uint32_t)offset + width > n) continue;
+            const uint32_t windows = (n - offset) / width;
+
+            // the levels of window j are starts[offset+j*width] to starts[offset+(j+1)*width]
+            CALL(reorder_measure, counts);
+            for (uint32_t j=0; j<windows; j++) {
+                best[j] = 0;
+                for (uint32_t l=starts[offset+j*width]; l<starts[offset+(j+1)*width]; l++) best[j] += counts[l];
+                best_step[j] = 0;
+            }
+
+            memcpy(order, level_to_var, sizeof(uint32_t) * levels_n);
+            for (int t=0; t<steps; t++) {
+                for (uint32_t j=0; j<windows; j++) reorder_swap_groups(order, starts, offset + j*width + seq[t]);
+                if (!CALL(reorder_to_order, order, target)) {
+                    full = 1;
+                    break;
+                }
+                if (t + 1 == steps) break; // the original order
+                CALL(reorder_measure, counts);
+                for (uint32_t j=0; j<windows; j++) {
+                    uint64_t size = 0;
+                    for (uint32_t l=starts[offset+j*width]; l<starts[offset+(j+1)*width]; l++) size += counts[l];
+                    if (size < best[j]) {
+                        best[j] = size;
+                        best_step[j] = t + 1;
+                    }
+                }
+            }
+            if (full) break;
+
+            // move every window to its best order
+            int moved = 0;
+            for (int t=0; t<steps; t++) {
+                for (uint32_t j=0; j<windows; j++) {
+                    if (best_step[j] > t) {
+                        reorder_swap_groups(order, starts, offset + j*width + seq[t]);
+                        moved = 1;
+                    }
+                }
+            }
+            if (moved) {
+                improved = 1;
+                if (!CALL(reorder_to_order, order, target)) full = 1;
+            }
+        }
+    }
+
+    free(starts);
+    free(order);
+    free(target);
+    free((void*)counts);
+    free(best);
+    free(best_step);
+}
+
+typedef struct reorder_args
+{
+    sylvan_reorder_type_t type;
+    uint32_t level;
+    int result;
+} reorder_args_t;
+
+VOID_TASK_1(reorder_go, void*, context)
+{
+    reorder_args_t *args = (reorder_args_t*)context;
+    const uint64_t t = getabstime();
+    reordering = 1;
+    sylvan_stats_count(SYLVAN_REORDER_COUNT);
+
+    switch (args->type) {
+    case SYLVAN_REORDER_SIFT:
+        CALL(reorder_sift);
+        break;
+    case SYLVAN_REORDER_WINDOW2:
+        CALL(reorder_window, 2);
+        break;
+    case SYLVAN_REORDER_WINDOW3:
+        CALL(reorder_window, 3);
+        break;
+    default:
+        fprintf(stderr, "sylvan_reorder: unknown reordering type %d!\n", (int)args->type);
+        exit(1);
+    }
+
+    // remove the unused nodes, this also clears the operation cache
+    CALL(sylvan_gc_go);
+    reordering = 0;
+    args->result = 1;
+
+    const uint64_t now = getabstime();
+    sylvan_timer_add(SYLVAN_REORDER, now - t);
+    if (sylvan_trace_active) sylvan_trace_record('X', "sylvan_reorder", t, now - t);
+}
+
+TASK_IMPL_1(int, sylvan_reorder, sylvan_reorder_type_t, type)
+{
+    if (!reorder_supported("sylvan_reorder")) return 0;
+    reorder_args_t args = {type, 0, 0};
+    CALL(sylvan_gc_exclusive, reorder_go_CALL, &args);
+    return args.result;
+}
+
+VOID_TASK_1(reorder_varswap_go, void*, context)
+{
+    reorder_args_t *args = (reorder_args_t*)context;
+    reordering = 1;
+    // remove the dead nodes first, so the pass only rewrites live nodes
+    CALL(sylvan_gc_go);
+    args->result = CALL(reorder_swap_pass, &args->level, 1);
+    // remove the unused nodes, this also clears the operation cache
+    CALL(sylvan_gc_go);
+    reordering = 0;
+}
+
+TASK_IMPL_1(int, sylvan_varswap, uint32_t, level)
+{
+    if (level >= levels_n || level + 1 >= levels_n) {
+        fprintf(stderr, "sylvan_varswap: levels %u and %u are not both reordered levels!\n", level, level+1);
+        exit(1);
+    }
+    if (!reorder_supported("sylvan_varswap")) return 0;
+    reorder_args_t args = {SYLVAN_REORDER_SIFT, level, 0};
+    CALL(sylvan_gc_exclusive, reorder_varswap_go_CALL, &args);
+    return args.result;
+}
+
+TASK_IMPL_0(int, sylvan_reorder_test)
+{
+    if (!atomic_load_explicit(&auto_requested, memory_order_relaxed)) return 0;
+    auto_requested = 0;
+    if (!CALL(sylvan_reorder, auto_type)) return 0;
+    const size_t filled = CALL(llmsset_count_marked, nodes);
+    auto_next = 2 * filled > auto_threshold ? 2 * filled : auto_threshold;
+    return 1;
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2011-2016 Formal Methods and Tools, University of Twente
+ * Copyright 2016-2017 Tom van Dijk, Johannes Kepler University Linz
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Do not include this file directly. Instead, include sylvan.h */
+
+#ifndef SYLVAN_REORDER_H
+#define SYLVAN_REORDER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * Dynamic variable reordering for BDDs and MTBDDs.
+ *
+ * The nodes store the level of their variable, i.e., its position in the variable order, and
+ * all operations work with levels; for example, sylvan_ithvar(l) is the variable at level l.
+ * Reordering changes the order in place: every BDD keeps its index and still represents the same
+ * function, so BDDs that are protected or referenced remain valid. A variable is identified by
+ * the level at which it started, and sylvan_var_to_level and sylvan_level_to_var translate
+ * between variables and their current levels.
+ *
+ * Only the first <n> levels, set with sylvan_levels_init, are reordered. Furthermore:
+ * - Reordering only supports BDDs and MTBDDs. After sylvan_init_ldd or sylvan_init_zdd, as the
+ *   nodes table may then have LDD or ZDD nodes, sylvan_reorder and sylvan_varswap return 0.
+ * - BDDMAPs and MTBDDMAPs have levels as keys and are not changed; create maps after reordering,
+ *   using sylvan_var_to_level. Sets of variables (BDDSET) are cubes and remain valid.
+ * - Like sylvan_gc, reordering stops all operations, and may only be started where all BDDs
+ *   that are used afterwards are protected or referenced. It must not be started inside an
+ *   operation, as operations keep levels in local variables.
+ * - Operations that assume that the state and next state variables are interleaved, such as
+ *   sylvan_relnext, require groups of 2 (see sylvan_levels_group) at the even levels.
+ */
+
+/**
+ * Set the number of levels that can be reordered to <n>; initially, variable i is at level i.
+ * Calling it again with a larger <n> adds the levels, and keeps the current order of the others.
+ */
+void sylvan_levels_init(uint32_t n);
+
+/**
+ * The number of levels that can be reordered.
+ */
+uint32_t sylvan_levels_count(void);
+
+/**
+ * The current level of variable <var>, and the variable at <level>.
+ * Outside the reordered levels, variables and levels are the same.
+ */
+uint32_t sylvan_var_to_level(uint32_t var);
+uint32_t sylvan_level_to_var(uint32_t level);
+
+/**
+ * Keep the <n> variables at the levels <level> to <level>+<n>-1 together: reordering moves them
+ * as one group and keeps their order. Groups may not overlap.
+ */
+void sylvan_levels_group(uint32_t level, uint32_t n);
+
+/**
+ * Swap the variables at <level> and <level>+1, ignoring groups.
+ * Returns 1 if successful, or 0 if garbage collection is disabled, the nodes table is full, or
+ * reordering is not supported (see above).
+ */
+TASK_DECL_1(int, sylvan_varswap, uint32_t);
+#define sylvan_varswap(level) RUN(sylvan_varswap, level)
+
+typedef enum sylvan_reorder_type
+{
+    SYLVAN_REORDER_SIFT,        // sifting: move every group to its best position, largest first
+    SYLVAN_REORDER_WINDOW2,     // try both orders of every 2 adjacent groups, until no improvement
+    SYLVAN_REORDER_WINDOW3,     // try all orders of every 3 adjacent groups, until no improvement
+} sylvan_reorder_type_t;
+
+/**
+ * Reorder the variables to reduce the number of nodes.
+ *
+ * Every step swaps many pairs of adjacent levels at once, in one parallel pass over the nodes
+ * table, such as all pairs that move two groups past each other, or the pairs of all windows.
+ * The size is measured after garbage collection, so every step takes time proportional to the
+ * size of the nodes table.
+ *
+ * Returns 1 if successful, or 0 if garbage collection is disabled or reordering is not
+ * supported (see above).
+ */
+TASK_DECL_1(int, sylvan_reorder, sylvan_reorder_type_t);
+#define sylvan_reorder(type) RUN(sylvan_reorder, type)
+
+/**
+ * Sifting: stop moving a group in one direction when the number of nodes grows beyond
+ * <factor> times the smallest number so far (default 1.2).
+ */
+void sylvan_reorder_set_maxgrowth(double factor);
+
+/**
+ * Sifting: the maximum number of groups moved past each other in one reordering, or 0 for no
+ * limit (default 0).
+ */
+void sylvan_reorder_set_maxswaps(size_t swaps);
+
+/**
+ * Automatic reordering. After garbage collection, if the number of nodes is at least the
+ * threshold, reordering of the given type is requested, which is then done by the next call of
+ * sylvan_reorder_test. After reordering, the threshold becomes twice the number of nodes (but at
+ * least <threshold>). The threshold 0 disables automatic reordering (default).
+ */
+void sylvan_reorder_set_auto(sylvan_reorder_type_t type, size_t threshold);
+
+/**
+ * Reorder now, if automatic reordering has been requested. Call this where starting reordering
+ * is allowed (see above), for example between the steps of a fixed point computation.
+ * Returns 1 if reordering was done, 0 otherwise.
+ */
+TASK_DECL_0(int, sylvan_reorder_test);
+#define sylvan_reorder_test() RUN(sylvan_reorder_test)
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif
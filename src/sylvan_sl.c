@@ -48,6 +48,7 @@ sylvan_skiplist_alloc(size_t size)
         fprintf(stderr, "sylvan: Unable to allocate virtual memory (%'zu bytes) for the skiplist!\n", size*sizeof(sl_bucket));
         exit(1);
     }
+    sylvan_memory_add(SYLVAN_MEM_SKIPLIST, sizeof(sl_bucket) * size);
     l->size = size;
     l->next = 1;
     return l;
@@ -57,6 +58,7 @@ void
 sylvan_skiplist_free(sylvan_skiplist_t l)
 {
     free_aligned(l->buckets, sizeof(sl_bucket)*l->size);
+    sylvan_memory_sub(SYLVAN_MEM_SKIPLIST, sizeof(sl_bucket)*l->size);
     free(l);
 }
 
@@ -22,10 +22,19 @@
 #include <string.h> // memset
 #include <inttypes.h>
 
-#if SYLVAN_STATS
+/**
+ * The runtime switch (default set by SYLVAN_STATS) and the statistics of the workers.
+ * Threads that are not Lace workers (or before initialization) count into a dummy.
+ */
+int sylvan_stats_active = 0;
+sylvan_stats_t sylvan_stats_dummy;
+
+static sylvan_stats_t *sylvan_stats_workers = NULL;
+static unsigned int sylvan_stats_n_workers = 0;
+static int sylvan_stats_used = 0;
 
 #ifdef __ELF__
-__thread sylvan_stats_t sylvan_stats;
+__thread sylvan_stats_t *sylvan_stats_local = &sylvan_stats_dummy;
 #else
 pthread_key_t sylvan_stats_key;
 #endif
@@ -47,6 +56,18 @@ struct
     {1, LDD_NODES_CREATED, "LDD nodes created"},
     {1, LDD_NODES_REUSED, "LDD nodes reused"},
     {1, LLMSSET_LOOKUP, "Lookup iterations"},
+    {1, LLMSSET_PROBE_1, "Probes 1 line"},
+    {1, LLMSSET_PROBE_2, "Probes 2 lines"},
+    {1, LLMSSET_PROBE_4, "Probes 3-4 lines"},
+    {1, LLMSSET_PROBE_8, "Probes 5-8 lines"},
+    {1, LLMSSET_PROBE_16, "Probes 9-16 lines"},
+    {1, LLMSSET_PROBE_32, "Probes 17-32 lines"},
+    {1, LLMSSET_PROBE_64, "Probes 33-64 lines"},
+    {1, LLMSSET_PROBE_MORE, "Probes >64 lines"},
+    {1, LLMSSET_CAS_FAILED, "Failed CAS (table)"},
+    {1, LLMSSET_REGION_SWITCH, "Region switches"},
+    {1, LLMSSET_REGION_CAS_FAILED, "Failed CAS (region)"},
+    {1, LLMSSET_FULL_SCAN, "Table full (scans)"},
     {4, 0, NULL}, /* trigger to report unique nodes and operation cache */
 
     {0, 0, "Operation            Count            Cache get        Cache put"},
@@ -61,6 +82,7 @@ struct
     {2, BDD_RELPREV, "BDD relprev"},
     {2, BDD_CLOSURE, "BDD closure"},
     {2, BDD_COMPOSE, "BDD compose"},
+    {2, BDD_RENAME, "BDD rename"},
     {2, BDD_RESTRICT, "BDD restrict"},
     {2, BDD_CONSTRAIN, "BDD constrain"},
     {2, BDD_SUPPORT, "BDD support"},
@@ -68,6 +90,9 @@ struct
     {2, BDD_PATHCOUNT, "BDD pathcount"},
     {2, BDD_ISBDD, "BDD isbdd"},
     {2, BDD_DISJOINT, "BDD disjoint"},
+    {2, BDD_AND_N, "BDD and n-ary"},
+    {2, BDD_RELNEXT_MAP, "BDD relnext (map)"},
+    {2, BDD_RELPREV_MAP, "BDD relprev (map)"},
 
     {2, MTBDD_APPLY, "MTBDD binary apply"},
     {2, MTBDD_UAPPLY, "MTBDD unary apply"},
@@ -82,6 +107,7 @@ struct
     {2, MTBDD_AND_ABSTRACT_PLUS, "MTBDD and_abs_plus"},
     {2, MTBDD_AND_ABSTRACT_MAX, "MTBDD and_abs_max"},
     {2, MTBDD_COMPOSE, "MTBDD compose"},
+    {2, MTBDD_RENAME, "MTBDD rename"},
     {2, MTBDD_MINIMUM, "MTBDD minimum"},
     {2, MTBDD_MAXIMUM, "MTBDD maximum"},
     {2, MTBDD_EVAL_COMPOSE, "MTBDD eval_compose"},
@@ -119,44 +145,201 @@ struct
     {0, 0, "Garbage collection"},
     {1, SYLVAN_GC_COUNT, "GC executions"},
     {3, SYLVAN_GC, "Total time spent"},
+    {3, SYLVAN_GC_HOOKS, "Pre/post gc hooks"},
+    {3, SYLVAN_GC_CLEAR_CACHE, "Clear cache"},
+    {3, SYLVAN_GC_CLEAR_DATA, "Clear nodes"},
+    {3, SYLVAN_GC_MARK, "Mark nodes"},
+    {3, SYLVAN_GC_DESTROY, "Destroy leaves"},
+    {3, SYLVAN_GC_RESIZE, "Resize tables"},
+    {3, SYLVAN_GC_REHASH, "Rehash nodes"},
+
+    {0, 0, "Variable reordering"},
+    {1, SYLVAN_REORDER_COUNT, "Reorderings"},
+    {1, SYLVAN_REORDER_SWAPS, "Level swaps"},
+    {3, SYLVAN_REORDER, "Total time spent"},
 
     {-1, -1, NULL},
 };
 
-VOID_TASK_0(sylvan_stats_reset_perthread)
+/**
+ * Names of the counters and timers (for the structured export functions)
+ */
+#define OPNAMES(NAME, STR) [NAME] = STR, [NAME ## _CACHEDPUT] = STR "_cachedput", [NAME ## _CACHED] = STR "_cached"
+
+static const char* sylvan_counter_names[SYLVAN_COUNTER_COUNTER] = {
+    [BDD_NODES_CREATED] = "bdd_nodes_created",
+    [BDD_NODES_REUSED] = "bdd_nodes_reused",
+    [LDD_NODES_CREATED] = "ldd_nodes_created",
+    [LDD_NODES_REUSED] = "ldd_nodes_reused",
+    [ZDD_NODES_CREATED] = "zdd_nodes_created",
+    [ZDD_NODES_REUSED] = "zdd_nodes_reused",
+    OPNAMES(BDD_ITE, "bdd_ite"),
+    OPNAMES(BDD_AND, "bdd_and"),
+    OPNAMES(BDD_XOR, "bdd_xor"),
+    OPNAMES(BDD_EXISTS, "bdd_exists"),
+    OPNAMES(BDD_PROJECT, "bdd_project"),
+    OPNAMES(BDD_AND_EXISTS, "bdd_and_exists"),
+    OPNAMES(BDD_AND_PROJECT, "bdd_and_project"),
+    OPNAMES(BDD_RELNEXT, "bdd_relnext"),
+    OPNAMES(BDD_RELPREV, "bdd_relprev"),
+    OPNAMES(BDD_SATCOUNT, "bdd_satcount"),
+    OPNAMES(BDD_COMPOSE, "bdd_compose"),
+    OPNAMES(BDD_RENAME, "bdd_rename"),
+    OPNAMES(BDD_RESTRICT, "bdd_restrict"),
+    OPNAMES(BDD_CONSTRAIN, "bdd_constrain"),
+    OPNAMES(BDD_CLOSURE, "bdd_closure"),
+    OPNAMES(BDD_ISBDD, "bdd_isbdd"),
+    OPNAMES(BDD_SUPPORT, "bdd_support"),
+    OPNAMES(BDD_PATHCOUNT, "bdd_pathcount"),
+    OPNAMES(BDD_DISJOINT, "bdd_disjoint"),
+    OPNAMES(BDD_AND_N, "bdd_and_n"),
+    OPNAMES(BDD_RELNEXT_MAP, "bdd_relnext_map"),
+    OPNAMES(BDD_RELPREV_MAP, "bdd_relprev_map"),
+    OPNAMES(MTBDD_APPLY, "mtbdd_apply"),
+    OPNAMES(MTBDD_UAPPLY, "mtbdd_uapply"),
+    OPNAMES(MTBDD_ABSTRACT, "mtbdd_abstract"),
+    OPNAMES(MTBDD_ITE, "mtbdd_ite"),
+    OPNAMES(MTBDD_EQUAL_NORM, "mtbdd_equal_norm"),
+    OPNAMES(MTBDD_EQUAL_NORM_REL, "mtbdd_equal_norm_rel"),
+    OPNAMES(MTBDD_LEQ, "mtbdd_leq"),
+    OPNAMES(MTBDD_LESS, "mtbdd_less"),
+    OPNAMES(MTBDD_GEQ, "mtbdd_geq"),
+    OPNAMES(MTBDD_GREATER, "mtbdd_greater"),
+    OPNAMES(MTBDD_AND_ABSTRACT_PLUS, "mtbdd_and_abstract_plus"),
+    OPNAMES(MTBDD_AND_ABSTRACT_MAX, "mtbdd_and_abstract_max"),
+    OPNAMES(MTBDD_COMPOSE, "mtbdd_compose"),
+    OPNAMES(MTBDD_RENAME, "mtbdd_rename"),
+    OPNAMES(MTBDD_MINIMUM, "mtbdd_minimum"),
+    OPNAMES(MTBDD_MAXIMUM, "mtbdd_maximum"),
+    OPNAMES(MTBDD_EVAL_COMPOSE, "mtbdd_eval_compose"),
+    OPNAMES(LDD_UNION, "ldd_union"),
+    OPNAMES(LDD_MINUS, "ldd_minus"),
+    OPNAMES(LDD_INTERSECT, "ldd_intersect"),
+    OPNAMES(LDD_RELPROD, "ldd_relprod"),
+    OPNAMES(LDD_RELPREV, "ldd_relprev"),
+    OPNAMES(LDD_PROJECT, "ldd_project"),
+    OPNAMES(LDD_JOIN, "ldd_join"),
+    OPNAMES(LDD_MATCH, "ldd_match"),
+    OPNAMES(LDD_SATCOUNT, "ldd_satcount"),
+    OPNAMES(LDD_SATCOUNTL, "ldd_satcountl"),
+    OPNAMES(LDD_ZIP, "ldd_zip"),
+    OPNAMES(LDD_RELPROD_UNION, "ldd_relprod_union"),
+    OPNAMES(LDD_PROJECT_MINUS, "ldd_project_minus"),
+    OPNAMES(ZDD_FROM_MTBDD, "zdd_from_mtbdd"),
+    OPNAMES(ZDD_TO_MTBDD, "zdd_to_mtbdd"),
+    OPNAMES(ZDD_UNION_CUBE, "zdd_union_cube"),
+    OPNAMES(ZDD_EXTEND_DOMAIN, "zdd_extend_domain"),
+    OPNAMES(ZDD_SUPPORT, "zdd_support"),
+    OPNAMES(ZDD_PATHCOUNT, "zdd_pathcount"),
+    OPNAMES(ZDD_AND, "zdd_and"),
+    OPNAMES(ZDD_OR, "zdd_or"),
+    OPNAMES(ZDD_ITE, "zdd_ite"),
+    OPNAMES(ZDD_NOT, "zdd_not"),
+    OPNAMES(ZDD_DIFF, "zdd_diff"),
+    OPNAMES(ZDD_EXISTS, "zdd_exists"),
+    OPNAMES(ZDD_PROJECT, "zdd_project"),
+    OPNAMES(ZDD_ISOP, "zdd_isop"),
+    OPNAMES(ZDD_COVER_TO_BDD, "zdd_cover_to_bdd"),
+    [SYLVAN_GC_COUNT] = "gc_count",
+    [LLMSSET_LOOKUP] = "llmsset_lookup",
+    [LLMSSET_PROBE_1] = "llmsset_probe_1",
+    [LLMSSET_PROBE_2] = "llmsset_probe_2",
+    [LLMSSET_PROBE_4] = "llmsset_probe_4",
+    [LLMSSET_PROBE_8] = "llmsset_probe_8",
+    [LLMSSET_PROBE_16] = "llmsset_probe_16",
+    [LLMSSET_PROBE_32] = "llmsset_probe_32",
+    [LLMSSET_PROBE_64] = "llmsset_probe_64",
+    [LLMSSET_PROBE_MORE] = "llmsset_probe_more",
+    [LLMSSET_CAS_FAILED] = "llmsset_cas_failed",
+    [LLMSSET_REGION_SWITCH] = "llmsset_region_switch",
+    [LLMSSET_REGION_CAS_FAILED] = "llmsset_region_cas_failed",
+    [LLMSSET_FULL_SCAN] = "llmsset_full_scan",
+    [SYLVAN_REORDER_COUNT] = "reorder_count",
+    [SYLVAN_REORDER_SWAPS] = "reorder_swaps",
+};
+
+#undef OPNAMES
+
+static const char* sylvan_timer_names[SYLVAN_TIMER_COUNTER] = {
+    [SYLVAN_GC] = "gc",
+    [SYLVAN_GC_HOOKS] = "gc_hooks",
+    [SYLVAN_GC_CLEAR_CACHE] = "gc_clear_cache",
+    [SYLVAN_GC_CLEAR_DATA] = "gc_clear_data",
+    [SYLVAN_GC_MARK] = "gc_mark",
+    [SYLVAN_GC_DESTROY] = "gc_destroy",
+    [SYLVAN_GC_RESIZE] = "gc_resize",
+    [SYLVAN_GC_REHASH] = "gc_rehash",
+    [SYLVAN_REORDER] = "reorder",
+};
+
+const char*
+sylvan_stats_counter_name(int counter)
+{
+    if (counter < 0 || counter >= SYLVAN_COUNTER_COUNTER) return NULL;
+    return sylvan_counter_names[counter];
+}
+
+const char*
+sylvan_stats_timer_name(int timer)
+{
+    if (timer < 0 || timer >= SYLVAN_TIMER_COUNTER) return NULL;
+    return sylvan_timer_names[timer];
+}
+
+int
+sylvan_stats_counter_lookup(const char *name)
 {
-#ifdef __ELF__
     for (int i=0; i<SYLVAN_COUNTER_COUNTER; i++) {
-        sylvan_stats.counters[i] = 0;
+        if (strcmp(sylvan_counter_names[i], name) == 0) return i;
     }
+    return -1;
+}
+
+int
+sylvan_stats_timer_lookup(const char *name)
+{
     for (int i=0; i<SYLVAN_TIMER_COUNTER; i++) {
-        sylvan_stats.timers[i] = 0;
+        if (strcmp(sylvan_timer_names[i], name) == 0) return i;
     }
+    return -1;
+}
+
+VOID_TASK_0(sylvan_stats_setup_perthread)
+{
+    sylvan_stats_t *local = sylvan_stats_workers + lace_get_worker()->worker;
+#ifdef __ELF__
+    sylvan_stats_local = local;
 #else
-    sylvan_stats_t *sylvan_stats = pthread_getspecific(sylvan_stats_key);
-    if (sylvan_stats == NULL) {
-        sylvan_stats = alloc_aligned(sizeof(sylvan_stats_t));
-        if (sylvan_stats == 0) {
-            fprintf(stderr, "sylvan_stats: Unable to allocate memory: %s!\n", strerror(errno));
-            exit(1);
-        }
-    }
-    pthread_setspecific(sylvan_stats_key, sylvan_stats);
-    for (int i=0; i<SYLVAN_COUNTER_COUNTER; i++) {
-        sylvan_stats->counters[i] = 0;
-    }
-    for (int i=0; i<SYLVAN_TIMER_COUNTER; i++) {
-        sylvan_stats->timers[i] = 0;
-    }
+    pthread_setspecific(sylvan_stats_key, local);
 #endif
 }
 
-VOID_TASK_IMPL_0(sylvan_stats_init)
+VOID_TASK_0(sylvan_stats_unset_perthread)
 {
-#ifndef __ELF__
-    pthread_key_create(&sylvan_stats_key, NULL);
+#ifdef __ELF__
+    sylvan_stats_local = &sylvan_stats_dummy;
+#else
+    pthread_setspecific(sylvan_stats_key, NULL);
 #endif
-    TOGETHER(sylvan_stats_reset_perthread);
+}
+
+void
+sylvan_stats_enable()
+{
+    sylvan_stats_used = 1;
+    sylvan_stats_active = 1;
+}
+
+void
+sylvan_stats_disable()
+{
+    sylvan_stats_active = 0;
+}
+
+int
+sylvan_stats_is_enabled()
+{
+    return sylvan_stats_active;
 }
 
 /**
@@ -164,35 +347,257 @@ VOID_TASK_IMPL_0(sylvan_stats_init)
  */
 VOID_TASK_IMPL_0(sylvan_stats_reset)
 {
-    TOGETHER(sylvan_stats_reset_perthread);
+    for (unsigned int w=0; w<sylvan_stats_n_workers; w++) {
+        sylvan_stats_t *local = sylvan_stats_workers + w;
+        for (int i=0; i<SYLVAN_COUNTER_COUNTER; i++) local->counters[i] = 0;
+        for (int i=0; i<SYLVAN_TIMER_COUNTER; i++) local->timers[i] = 0;
+    }
 }
 
-VOID_TASK_1(sylvan_stats_sum, sylvan_stats_t*, target)
+/**
+ * Sum the statistics of all workers.
+ * This does not stop the world; counts of running workers may be slightly behind.
+ */
+static void
+sylvan_stats_sum(sylvan_stats_t *target)
 {
-#ifdef __ELF__
+    memset(target, 0, sizeof(sylvan_stats_t));
+    for (unsigned int w=0; w<sylvan_stats_n_workers; w++) {
+        sylvan_stats_t *local = sylvan_stats_workers + w;
+        for (int i=0; i<SYLVAN_COUNTER_COUNTER; i++) target->counters[i] += local->counters[i];
+        for (int i=0; i<SYLVAN_TIMER_COUNTER; i++) target->timers[i] += local->timers[i];
+    }
+}
+
+VOID_TASK_IMPL_1(sylvan_stats_snapshot, sylvan_stats_t*, target)
+{
+    sylvan_stats_sum(target);
+}
+
+void
+sylvan_stats_diff(sylvan_stats_t *result, const sylvan_stats_t *after, const sylvan_stats_t *before)
+{
+    for (int i=0; i<SYLVAN_COUNTER_COUNTER; i++) result->counters[i] = after->counters[i] - before->counters[i];
+    for (int i=0; i<SYLVAN_TIMER_COUNTER; i++) result->timers[i] = after->timers[i] - before->timers[i];
+    for (int i=0; i<SYLVAN_TIMER_COUNTER; i++) result->timers_startstop[i] = 0;
+}
+
+double
+sylvan_stats_hitrate(const sylvan_stats_t *stats, int op)
+{
+    /* the counters of an operation are NAME, NAME_CACHEDPUT, NAME_CACHED */
+    if (op == SYLVAN_STATS_ALL_OPS) {
+        uint64_t calls = 0, hits = 0;
+        for (int i=BDD_ITE; i<SYLVAN_GC_COUNT; i+=3) {
+            calls += stats->counters[i];
+            hits += stats->counters[i+2];
+        }
+        return calls == 0 ? 0.0 : (double)hits / (double)calls;
+    }
+    if (stats->counters[op] == 0) return 0.0;
+    return (double)stats->counters[op+2] / (double)stats->counters[op];
+}
+
+static void
+sylvan_stats_write_json_object(FILE *target, const sylvan_stats_t *stats)
+{
+    fprintf(target, "{\"counters\":{");
     for (int i=0; i<SYLVAN_COUNTER_COUNTER; i++) {
-        atomic_fetch_add((_Atomic(uint64_t)*)target->counters + i, sylvan_stats.counters[i]);
+        fprintf(target, "%s\"%s\":%"PRIu64, i ? "," : "", sylvan_counter_names[i], stats->counters[i]);
     }
+    fprintf(target, "},\"timers\":{");
     for (int i=0; i<SYLVAN_TIMER_COUNTER; i++) {
-        atomic_fetch_add((_Atomic(uint64_t)*)target->timers + i, sylvan_stats.timers[i]);
+        fprintf(target, "%s\"%s\":%"PRIu64, i ? "," : "", sylvan_timer_names[i], stats->timers[i]);
     }
-#else
-    sylvan_stats_t *sylvan_stats = pthread_getspecific(sylvan_stats_key);
-    if (sylvan_stats != NULL) {
-        for (int i=0; i<SYLVAN_COUNTER_COUNTER; i++) {
-            atomic_fetch_add((_Atomic(uint64_t)*)target->counters + i, sylvan_stats->counters[i]);
+    fprintf(target, "}}");
+}
+
+void
+sylvan_stats_write_json(FILE *target, const sylvan_stats_t *stats)
+{
+    sylvan_stats_write_json_object(target, stats);
+    fprintf(target, "\n");
+}
+
+void
+sylvan_stats_write_csv_header(FILE *target)
+{
+    for (int i=0; i<SYLVAN_COUNTER_COUNTER; i++) fprintf(target, "%s%s", i ? "," : "", sylvan_counter_names[i]);
+    for (int i=0; i<SYLVAN_TIMER_COUNTER; i++) fprintf(target, ",%s", sylvan_timer_names[i]);
+    fprintf(target, "\n");
+}
+
+void
+sylvan_stats_write_csv(FILE *target, const sylvan_stats_t *stats)
+{
+    for (int i=0; i<SYLVAN_COUNTER_COUNTER; i++) fprintf(target, "%s%"PRIu64, i ? "," : "", stats->counters[i]);
+    for (int i=0; i<SYLVAN_TIMER_COUNTER; i++) fprintf(target, ",%"PRIu64, stats->timers[i]);
+    fprintf(target, "\n");
+}
+
+void
+sylvan_stats_write_sample_json(FILE *target, const sylvan_stats_sample_t *sample)
+{
+    fprintf(target, "{\"time\":%"PRIu64",\"at_gc\":%d,\"gc_count\":%"PRIu64",", sample->time, sample->at_gc, sample->gc_count);
+    fprintf(target, "\"table_filled\":%zu,\"table_size\":%zu,", sample->table_filled, sample->table_size);
+    fprintf(target, "\"table_threshold\":%d,\"region_fill\":[", sample->table_threshold);
+    for (int i=0; i<LLMSSET_FILL_BUCKETS; i++) fprintf(target, "%s%"PRIu64, i ? "," : "", sample->region_fill[i]);
+    fprintf(target, "],");
+    fprintf(target, "\"cache_used\":%zu,\"cache_size\":%zu,\"stats\":", sample->cache_used, sample->cache_size);
+    sylvan_stats_write_json_object(target, &sample->stats);
+    fprintf(target, "}\n");
+    fflush(target);
+}
+
+void
+sylvan_stats_write_gc_json(FILE *target, const sylvan_gc_info_t *info)
+{
+    fprintf(target, "{\"count\":%"PRIu64",\"nodes_before\":%zu,\"nodes_after\":%zu,", info->count, info->nodes_before, info->nodes_after);
+    fprintf(target, "\"time\":{\"pregc\":%"PRIu64",\"clear_cache\":%"PRIu64",\"clear_data\":%"PRIu64",\"mark\":%"PRIu64",",
+            info->time_pregc, info->time_clear_cache, info->time_clear_data, info->time_mark);
+    fprintf(target, "\"destroy\":%"PRIu64",\"resize\":%"PRIu64",\"rehash\":%"PRIu64",\"postgc\":%"PRIu64",\"total\":%"PRIu64"},",
+            info->time_destroy, info->time_resize, info->time_rehash, info->time_postgc, info->time_total);
+    fprintf(target, "\"marks\":[");
+    for (int i=0; i<info->mark_count; i++) {
+        fprintf(target, "%s{\"name\":\"%s\",\"time\":%"PRIu64",\"total\":%"PRIu64"}", i ? "," : "",
+                info->marks[i].name ? info->marks[i].name : "", info->marks[i].time, info->marks[i].total);
+    }
+    fprintf(target, "],\"histogram_us_log2\":[");
+    for (int i=0; i<SYLVAN_GC_HISTOGRAM_SIZE; i++) fprintf(target, "%s%"PRIu64, i ? "," : "", info->histogram[i]);
+    fprintf(target, "]}\n");
+}
+
+/**
+ * The sampler. Periodic samples are taken by a separate thread, samples at the
+ * end of garbage collection by the postgc hook.
+ */
+static pthread_mutex_t sampler_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sampler_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t sampler_thread;
+static int sampler_thread_running = 0;
+static int sampler_stop = 0;
+static sylvan_stats_sample_cb sampler_cb = NULL;
+static void *sampler_context = NULL;
+static unsigned int sampler_interval = 0;
+static int sampler_at_gc = 0;
+static uint64_t sampler_start = 0;
+static _Atomic(uint64_t) sylvan_stats_gc_count = 0;
+
+static void
+sylvan_stats_fill_sample(sylvan_stats_sample_t *sample, int at_gc, size_t table_filled)
+{
+    sample->time = getabstime() - sampler_start;
+    sample->at_gc = at_gc;
+    sample->gc_count = atomic_load_explicit(&sylvan_stats_gc_count, memory_order_relaxed);
+    sample->table_filled = table_filled;
+    sample->table_size = llmsset_get_size(nodes);
+    sample->table_threshold = llmsset_get_threshold(nodes);
+    llmsset_region_fill(nodes, sample->region_fill);
+    sample->cache_used = cache_getused_approx();
+    sample->cache_size = cache_getsize();
+    sylvan_stats_sum(&sample->stats);
+}
+
+static void*
+sylvan_stats_sampler_thread(void *arg)
+{
+    pthread_mutex_lock(&sampler_lock);
+    while (!sampler_stop) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += sampler_interval / 1000;
+        deadline.tv_nsec += (long)(sampler_interval % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec += 1;
+            deadline.tv_nsec -= 1000000000L;
         }
-        for (int i=0; i<SYLVAN_TIMER_COUNTER; i++) {
-            atomic_fetch_add((_Atomic(uint64_t)*)target->timers + i, sylvan_stats->timers[i]);
+        while (!sampler_stop && pthread_cond_timedwait(&sampler_cond, &sampler_lock, &deadline) == 0) {}
+        if (sampler_stop) break;
+        pthread_mutex_unlock(&sampler_lock);
+        sylvan_stats_sample_t sample;
+        sylvan_stats_fill_sample(&sample, 0, llmsset_count_marked_seq(nodes));
+        sampler_cb(&sample, sampler_context);
+        pthread_mutex_lock(&sampler_lock);
+    }
+    pthread_mutex_unlock(&sampler_lock);
+    return arg;
+}
+
+static void
+sylvan_stats_stop_sampler()
+{
+    sampler_at_gc = 0;
+    if (sampler_thread_running) {
+        pthread_mutex_lock(&sampler_lock);
+        sampler_stop = 1;
+        pthread_cond_signal(&sampler_cond);
+        pthread_mutex_unlock(&sampler_lock);
+        pthread_join(sampler_thread, NULL);
+        sampler_thread_running = 0;
+    }
+    sampler_cb = NULL;
+    sampler_context = NULL;
+}
+
+void
+sylvan_stats_set_sampler(sylvan_stats_sample_cb cb, void *context, unsigned int interval_ms, int at_gc)
+{
+    sylvan_stats_stop_sampler();
+    if (cb == NULL) return;
+
+    sampler_cb = cb;
+    sampler_context = context;
+    sampler_interval = interval_ms;
+    sampler_start = getabstime();
+    sampler_stop = 0;
+    if (interval_ms > 0) {
+        if (pthread_create(&sampler_thread, NULL, sylvan_stats_sampler_thread, NULL) != 0) {
+            fprintf(stderr, "sylvan_stats_set_sampler: Unable to create thread: %s!\n", strerror(errno));
+            exit(1);
         }
+        sampler_thread_running = 1;
     }
-#endif
+    sampler_at_gc = at_gc;
 }
 
-VOID_TASK_IMPL_1(sylvan_stats_snapshot, sylvan_stats_t*, target)
+VOID_TASK_0(sylvan_stats_postgc)
 {
-    memset(target, 0, sizeof(sylvan_stats_t));
-    TOGETHER(sylvan_stats_sum, target);
+    atomic_fetch_add_explicit(&sylvan_stats_gc_count, 1, memory_order_relaxed);
+    if (sampler_at_gc) {
+        sylvan_stats_sample_t sample;
+        sylvan_stats_fill_sample(&sample, 1, llmsset_count_marked(nodes));
+        sampler_cb(&sample, sampler_context);
+    }
+}
+
+static void
+sylvan_stats_quit()
+{
+    sylvan_stats_stop_sampler();
+    sylvan_stats_active = 0;
+    TOGETHER(sylvan_stats_unset_perthread);
+    free_aligned(sylvan_stats_workers, sylvan_stats_n_workers * sizeof(sylvan_stats_t));
+    sylvan_memory_sub(SYLVAN_MEM_INSTRUMENTATION, sylvan_stats_n_workers * sizeof(sylvan_stats_t));
+    sylvan_stats_workers = NULL;
+    sylvan_stats_n_workers = 0;
+}
+
+VOID_TASK_IMPL_0(sylvan_stats_init)
+{
+#ifndef __ELF__
+    pthread_key_create(&sylvan_stats_key, NULL);
+#endif
+    sylvan_stats_n_workers = lace_workers();
+    sylvan_stats_workers = (sylvan_stats_t*)alloc_aligned(sylvan_stats_n_workers * sizeof(sylvan_stats_t));
+    if (sylvan_stats_workers == 0) {
+        fprintf(stderr, "sylvan_stats: Unable to allocate memory: %s!\n", strerror(errno));
+        exit(1);
+    }
+    sylvan_memory_add(SYLVAN_MEM_INSTRUMENTATION, sylvan_stats_n_workers * sizeof(sylvan_stats_t));
+    TOGETHER(sylvan_stats_setup_perthread);
+    sylvan_gc_hook_postgc(sylvan_stats_postgc_CALL);
+    sylvan_register_quit(sylvan_stats_quit);
+    if (SYLVAN_STATS) sylvan_stats_enable();
 }
 
 #define BLACK "\33[22;30m"
@@ -229,6 +634,8 @@ to_h(double size, char *buf)
 void
 sylvan_stats_report(FILE *target)
 {
+    if (!sylvan_stats_used) return;
+
     sylvan_stats_t totals;
     sylvan_stats_snapshot(&totals);
 
@@ -266,6 +673,9 @@ sylvan_stats_report(FILE *target)
             }
         } else if (type == 4) {
             fprintf(target, "%-20s %'zu of %'zu buckets filled.\n", "Unique nodes table", llmsset_count_marked(nodes), llmsset_get_size(nodes));
+            uint64_t fill[LLMSSET_FILL_BUCKETS];
+            size_t claimed = llmsset_region_fill(nodes, fill);
+            fprintf(target, "%-20s %'"PRIu64" full, %'zu claimed, probe limit %d lines.\n", "Table regions", fill[LLMSSET_FILL_BUCKETS-1], claimed, llmsset_get_threshold(nodes));
             fprintf(target, "%-20s %'zu of %'zu buckets filled.\n", "Operation cache", cache_getused(), cache_getsize());
             char buf[64], buf2[64];
             to_h(24ULL * llmsset_get_size(nodes), buf);
@@ -278,26 +688,3 @@ sylvan_stats_report(FILE *target)
         i++;
     }
 }
-
-#else
-
-VOID_TASK_IMPL_0(sylvan_stats_init)
-{
-}
-
-VOID_TASK_IMPL_0(sylvan_stats_reset)
-{
-}
-
-VOID_TASK_IMPL_1(sylvan_stats_snapshot, sylvan_stats_t*, target)
-{
-    memset(target, 0, sizeof(sylvan_stats_t));
-}
-
-void
-sylvan_stats_report(FILE* target)
-{
-    (void)target;
-}
-
-#endif
@@ -47,6 +47,7 @@ typedef enum {
     OPCOUNTER(BDD_RELPREV),
     OPCOUNTER(BDD_SATCOUNT),
     OPCOUNTER(BDD_COMPOSE),
+    OPCOUNTER(BDD_RENAME),
     OPCOUNTER(BDD_RESTRICT),
     OPCOUNTER(BDD_CONSTRAIN),
     OPCOUNTER(BDD_CLOSURE),
@@ -54,6 +55,9 @@ typedef enum {
     OPCOUNTER(BDD_SUPPORT),
     OPCOUNTER(BDD_PATHCOUNT),
     OPCOUNTER(BDD_DISJOINT),
+    OPCOUNTER(BDD_AND_N),
+    OPCOUNTER(BDD_RELNEXT_MAP),
+    OPCOUNTER(BDD_RELPREV_MAP),
 
     /* MTBDD operations */
     OPCOUNTER(MTBDD_APPLY),
@@ -69,6 +73,7 @@ typedef enum {
     OPCOUNTER(MTBDD_AND_ABSTRACT_PLUS),
     OPCOUNTER(MTBDD_AND_ABSTRACT_MAX),
     OPCOUNTER(MTBDD_COMPOSE),
+    OPCOUNTER(MTBDD_RENAME),
     OPCOUNTER(MTBDD_MINIMUM),
     OPCOUNTER(MTBDD_MAXIMUM),
     OPCOUNTER(MTBDD_EVAL_COMPOSE),
@@ -109,6 +114,26 @@ typedef enum {
     SYLVAN_GC_COUNT,
     LLMSSET_LOOKUP,
 
+    /* Unique table: number of cache lines probed per lookup (histogram) */
+    LLMSSET_PROBE_1,
+    LLMSSET_PROBE_2,
+    LLMSSET_PROBE_4,
+    LLMSSET_PROBE_8,
+    LLMSSET_PROBE_16,
+    LLMSSET_PROBE_32,
+    LLMSSET_PROBE_64,
+    LLMSSET_PROBE_MORE,
+
+    /* Unique table: contention and claiming regions of data buckets */
+    LLMSSET_CAS_FAILED,
+    LLMSSET_REGION_SWITCH,
+    LLMSSET_REGION_CAS_FAILED,
+    LLMSSET_FULL_SCAN,
+
+    /* Variable reordering */
+    SYLVAN_REORDER_COUNT,
+    SYLVAN_REORDER_SWAPS,
+
     SYLVAN_COUNTER_COUNTER
 } Sylvan_Counters;
 
@@ -117,9 +142,22 @@ typedef enum {
 typedef enum
 {
     SYLVAN_GC,
+    /* phases of garbage collection (see also sylvan_gc_get_info) */
+    SYLVAN_GC_HOOKS,
+    SYLVAN_GC_CLEAR_CACHE,
+    SYLVAN_GC_CLEAR_DATA,
+    SYLVAN_GC_MARK,
+    SYLVAN_GC_DESTROY,
+    SYLVAN_GC_RESIZE,
+    SYLVAN_GC_REHASH,
+    SYLVAN_REORDER,
     SYLVAN_TIMER_COUNTER
 } Sylvan_Timers;
 
+/**
+ * Statistics of one worker (or the totals of all workers).
+ * Aligned to cache lines, so the per-worker copies do not share cache lines.
+ */
 typedef struct
 {
     uint64_t counters[SYLVAN_COUNTER_COUNTER];
@@ -127,7 +165,7 @@ typedef struct
     uint64_t timers[SYLVAN_TIMER_COUNTER];
     /* startstop is for internal use */
     uint64_t timers_startstop[SYLVAN_TIMER_COUNTER];
-} sylvan_stats_t;
+} __attribute__((aligned(64))) sylvan_stats_t;
 
 /**
  * Initialize stats system (done by sylvan_init_package)
@@ -142,115 +180,191 @@ VOID_TASK_DECL_0(sylvan_stats_reset);
 #define sylvan_stats_reset() RUN(sylvan_stats_reset)
 
 /**
- * Obtain current counts (this stops the world during counting)
+ * Obtain current counts (the sum of the counts of all workers)
  */
 VOID_TASK_DECL_1(sylvan_stats_snapshot, sylvan_stats_t*);
 #define sylvan_stats_snapshot(target) RUN(sylvan_stats_snapshot, target)
 
 /**
  * Write statistic report to file (stdout, stderr, etc)
+ * Nothing is written if statistics were never enabled.
  */
 void sylvan_stats_report(FILE* target);
 
-#if SYLVAN_STATS
+/**
+ * Statistics are always compiled in, but only collected while they are enabled.
+ * The default (after sylvan_init_package) is set by SYLVAN_STATS at compile time.
+ * Enabling and disabling can be done at any time, also while operations are running.
+ */
+void sylvan_stats_enable(void);
+void sylvan_stats_disable(void);
+int sylvan_stats_is_enabled(void);
 
-#ifdef __MACH__
-#define getabstime() mach_absolute_time()
-#else
-static uint64_t
-getabstime(void)
+/**
+ * Names of counters and timers, for example "bdd_and", "bdd_and_cached" and "gc".
+ * Iterate over all ids from 0 to SYLVAN_COUNTER_COUNTER (or SYLVAN_TIMER_COUNTER).
+ * The lookup functions return -1 for unknown names.
+ */
+const char* sylvan_stats_counter_name(int counter);
+const char* sylvan_stats_timer_name(int timer);
+int sylvan_stats_counter_lookup(const char *name);
+int sylvan_stats_timer_lookup(const char *name);
+
+/**
+ * Compute <result> = <after> - <before>, for example the statistics of one phase
+ * of a computation given snapshots before and after. <result> may alias an argument.
+ */
+void sylvan_stats_diff(sylvan_stats_t *result, const sylvan_stats_t *after, const sylvan_stats_t *before);
+
+/**
+ * Fraction of the calls to operation <op> (e.g. BDD_AND) that were answered by the cache,
+ * or of the calls to all operations if <op> is SYLVAN_STATS_ALL_OPS.
+ * Returns 0 if the operation was not called.
+ */
+#define SYLVAN_STATS_ALL_OPS (-1)
+double sylvan_stats_hitrate(const sylvan_stats_t *stats, int op);
+
+/**
+ * Write statistics in a machine-readable format.
+ * JSON is written as a single line {"counters":{...},"timers":{...}}; the timers are in ns.
+ * CSV is written as one row with all counters and then all timers, in order of their id;
+ * use sylvan_stats_write_csv_header for the matching header row.
+ */
+void sylvan_stats_write_json(FILE *target, const sylvan_stats_t *stats);
+void sylvan_stats_write_csv_header(FILE *target);
+void sylvan_stats_write_csv(FILE *target, const sylvan_stats_t *stats);
+
+/**
+ * Write the garbage collection information (see sylvan_gc_get_info) as a single line of JSON.
+ */
+void sylvan_stats_write_gc_json(FILE *target, const sylvan_gc_info_t *info);
+
+/**
+ * A sample for monitoring a running computation.
+ */
+typedef struct sylvan_stats_sample
 {
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    uint64_t t = ts.tv_sec;
-    t *= 1000000000UL;
-    t += ts.tv_nsec;
-    return t;
-}
-#endif
+    uint64_t time;          // ns since the sampler was installed
+    int at_gc;              // 1 if taken at the end of garbage collection
+    uint64_t gc_count;      // number of garbage collections so far (also if statistics are disabled)
+    size_t table_filled;    // used buckets of the nodes table
+    size_t table_size;      // current size of the nodes table
+    int table_threshold;    // probe sequence limit of the nodes table (cache lines)
+    uint64_t region_fill[9]; // fill level of the regions of the nodes table (see llmsset_region_fill)
+    size_t cache_used;      // used buckets of the operation cache
+    size_t cache_size;      // current size of the operation cache
+    sylvan_stats_t stats;   // the statistics (see sylvan_stats_hitrate for per-operation hit rates)
+} sylvan_stats_sample_t;
+
+typedef void (*sylvan_stats_sample_cb)(const sylvan_stats_sample_t *sample, void *context);
+
+/**
+ * Install a sampler that calls <cb> every <interval_ms> milliseconds (if interval_ms > 0)
+ * and/or at the end of every garbage collection (if at_gc is set).
+ * Periodic samples are taken by a separate thread, without interrupting the workers,
+ * so the callback must not call Sylvan operations; the table and cache usage of these
+ * samples are approximate. Samples at garbage collection are taken by a Lace worker.
+ * Replaces any previously installed sampler; set <cb> to NULL to remove the sampler.
+ */
+void sylvan_stats_set_sampler(sylvan_stats_sample_cb cb, void *context, unsigned int interval_ms, int at_gc);
+
+/**
+ * Write a sample as a single line of JSON (useful as a sampler callback for logging).
+ */
+void sylvan_stats_write_sample_json(FILE *target, const sylvan_stats_sample_t *sample);
+
+/**
+ * Internal: the runtime switch and the statistics of the current worker.
+ */
+extern int sylvan_stats_active;
+extern sylvan_stats_t sylvan_stats_dummy;
 
 #ifdef __ELF__
-extern __thread sylvan_stats_t sylvan_stats;
+extern __thread sylvan_stats_t *sylvan_stats_local;
 #else
 extern pthread_key_t sylvan_stats_key;
 #endif
 
-static inline void
-sylvan_stats_count(size_t counter)
+static inline sylvan_stats_t*
+sylvan_stats_get_local(void)
 {
 #ifdef __ELF__
-    sylvan_stats.counters[counter]++;
+    return sylvan_stats_local;
 #else
-    sylvan_stats_t *sylvan_stats = (sylvan_stats_t*)pthread_getspecific(sylvan_stats_key);
-    sylvan_stats->counters[counter]++;
+    sylvan_stats_t *local = (sylvan_stats_t*)pthread_getspecific(sylvan_stats_key);
+    return local != NULL ? local : &sylvan_stats_dummy;
 #endif
 }
 
-static inline void
-sylvan_stats_add(size_t counter, size_t amount)
-{
-#ifdef __ELF__
-    sylvan_stats.counters[counter]+=amount;
+#ifdef __MACH__
+#define getabstime() mach_absolute_time()
 #else
-    sylvan_stats_t *sylvan_stats = (sylvan_stats_t*)pthread_getspecific(sylvan_stats_key);
-    sylvan_stats->counters[counter]+=amount;
-#endif
-}
-
-static inline void
-sylvan_timer_start(size_t timer)
+static inline uint64_t
+getabstime(void)
 {
-    uint64_t t = getabstime();
-
-#ifdef __ELF__
-    sylvan_stats.timers_startstop[timer] = t;
-#else
-    sylvan_stats_t *sylvan_stats = (sylvan_stats_t*)pthread_getspecific(sylvan_stats_key);
-    sylvan_stats->timers_startstop[timer] = t;
-#endif
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t t = ts.tv_sec;
+    t *= 1000000000UL;
+    t += ts.tv_nsec;
+    return t;
 }
-
-static inline void
-sylvan_timer_stop(size_t timer)
-{
-    uint64_t t = getabstime();
-
-#ifdef __ELF__
-    sylvan_stats.timers[timer] += (t - sylvan_stats.timers_startstop[timer]);
-#else
-    sylvan_stats_t *sylvan_stats = (sylvan_stats_t*)pthread_getspecific(sylvan_stats_key);
-    sylvan_stats->timers[timer] += (t - sylvan_stats->timers_startstop[timer]);
 #endif
-}
 
-#else
+/**
+ * Internal: the operation profiler (see sylvan_profile.h) hooks into the counters of
+ * created nodes and of operations, which are all counters before SYLVAN_GC_COUNT.
+ */
+extern int sylvan_profile_active;
+void sylvan_profile_count(size_t counter);
 
 static inline void
 sylvan_stats_count(size_t counter)
 {
-    (void)counter;
+    if (__builtin_expect(sylvan_stats_active, 0)) {
+        sylvan_stats_get_local()->counters[counter]++;
+    }
+    if (counter < SYLVAN_GC_COUNT && __builtin_expect(sylvan_profile_active, 0)) {
+        sylvan_profile_count(counter);
+    }
 }
 
 static inline void
 sylvan_stats_add(size_t counter, size_t amount)
 {
-    (void)counter;
-    (void)amount;
+    if (__builtin_expect(sylvan_stats_active, 0)) {
+        sylvan_stats_get_local()->counters[counter]+=amount;
+    }
 }
 
 static inline void
 sylvan_timer_start(size_t timer)
 {
-    (void)timer;
+    if (__builtin_expect(sylvan_stats_active, 0)) {
+        sylvan_stats_get_local()->timers_startstop[timer] = getabstime();
+    }
 }
 
 static inline void
 sylvan_timer_stop(size_t timer)
 {
-    (void)timer;
+    if (__builtin_expect(sylvan_stats_active, 0)) {
+        sylvan_stats_t *local = sylvan_stats_get_local();
+        /* the timer may have been started before the statistics were enabled */
+        if (local->timers_startstop[timer] != 0) {
+            local->timers[timer] += (getabstime() - local->timers_startstop[timer]);
+            local->timers_startstop[timer] = 0;
+        }
+    }
 }
 
-#endif
+static inline void
+sylvan_timer_add(size_t timer, uint64_t ns)
+{
+    if (__builtin_expect(sylvan_stats_active, 0)) {
+        sylvan_stats_get_local()->timers[timer] += ns;
+    }
+}
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,318 @@
+/*
+ * Copyright 2011-2016 Formal Methods and Tools, University of Twente
+ * Copyright 2016-2017 Tom van Dijk, Johannes Kepler University Linz
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sylvan_int.h>
+
+/**
+ * Executing an operation
+ */
+
+TASK_IMPL_1(MTBDD, sylvan_op_run, const sylvan_op_t*, op)
+{
+    switch (op->kind) {
+    case SYLVAN_OP_ITE:
+        return CALL(sylvan_ite, op->a, op->b, op->c, 0);
+    case SYLVAN_OP_AND:
+        return CALL(sylvan_and, op->a, op->b, 0);
+    case SYLVAN_OP_OR:
+        return sylvan_not(CALL(sylvan_and, sylvan_not(op->a), sylvan_not(op->b), 0));
+    case SYLVAN_OP_XOR:
+        return CALL(sylvan_xor, op->a, op->b, 0);
+    case SYLVAN_OP_EXISTS:
+        return CALL(sylvan_exists, op->a, op->b, 0);
+    case SYLVAN_OP_FORALL:
+        return sylvan_not(CALL(sylvan_exists, sylvan_not(op->a), op->b, 0));
+    case SYLVAN_OP_AND_EXISTS:
+        return CALL(sylvan_and_exists, op->a, op->b, op->c, 0);
+    case SYLVAN_OP_RELNEXT:
+        return CALL(sylvan_relnext, op->a, op->b, op->c, 0);
+    case SYLVAN_OP_RELPREV:
+        return CALL(sylvan_relprev, op->a, op->b, op->c, 0);
+    case SYLVAN_OP_MTBDD_ITE:
+        return CALL(mtbdd_ite, op->a, op->b, op->c);
+    case SYLVAN_OP_MTBDD_APPLY:
+        return CALL(mtbdd_apply, op->a, op->b, op->apply);
+    case SYLVAN_OP_MTBDD_ABSTRACT:
+        return CALL(mtbdd_abstract, op->a, op->b, op->abstract);
+    case SYLVAN_OP_TASK:
+        return WRAP(op->task, op->a, op->b, op->c, op->context);
+    default:
+        fprintf(stderr, "sylvan_op_run: unknown operation %d!\n", (int)op->kind);
+        exit(1);
+    }
+}
+
+/* The number of operands of an operation */
+static int
+sylvan_op_operands(sylvan_op_kind_t kind)
+{
+    switch (kind) {
+    case SYLVAN_OP_AND:
+    case SYLVAN_OP_OR:
+    case SYLVAN_OP_XOR:
+    case SYLVAN_OP_EXISTS:
+    case SYLVAN_OP_FORALL:
+    case SYLVAN_OP_MTBDD_APPLY:
+    case SYLVAN_OP_MTBDD_ABSTRACT:
+        return 2;
+    default:
+        return 3;
+    }
+}
+
+/**
+ * Batches of operations
+ */
+
+VOID_TASK_4(sylvan_batch_range, const sylvan_op_t*, ops, MTBDD*, results, size_t, from, size_t, to)
+{
+    if (to - from > 1) {
+        size_t mid = from + (to - from) / 2;
+        SPAWN(sylvan_batch_range, ops, results, mid, to);
+        CALL(sylvan_batch_range, ops, results, from, mid);
+        SYNC(sylvan_batch_range);
+    } else if (to > from) {
+        // the result slots are protected by sylvan_batch
+        results[from] = CALL(sylvan_op_run, &ops[from]);
+    }
+}
+
+VOID_TASK_IMPL_3(sylvan_batch, const sylvan_op_t*, ops, MTBDD*, results, size_t, n)
+{
+    size_t pushed = 0;
+    for (size_t i=0; i<n; i++) {
+        results[i] = mtbdd_false;
+        mtbdd_refs_pushptr(&results[i]);
+        mtbdd_refs_pushptr(&ops[i].a);
+        mtbdd_refs_pushptr(&ops[i].b);
+        pushed += 3;
+        if (sylvan_op_operands(ops[i].kind) == 3) {
+            mtbdd_refs_pushptr(&ops[i].c);
+            pushed++;
+        }
+    }
+    CALL(sylvan_batch_range, ops, results, 0, n);
+    mtbdd_refs_popptr(pushed);
+}
+
+VOID_TASK_IMPL_6(sylvan_batch_each, const sylvan_op_t*, op, const MTBDD*, a, const MTBDD*, b, const MTBDD*, c, MTBDD*, results, size_t, n)
+{
+    sylvan_op_t *ops = (sylvan_op_t*)malloc(sizeof(sylvan_op_t) * (n == 0 ? 1 : n));
+    if (ops == NULL) {
+        fprintf(stderr, "sylvan_batch_each: Unable to allocate memory!\n");
+        exit(1);
+    }
+    for (size_t i=0; i<n; i++) {
+        ops[i] = *op;
+        if (a != NULL) ops[i].a = a[i];
+        if (b != NULL) ops[i].b = b[i];
+        if (c != NULL) ops[i].c = c[i];
+    }
+    CALL(sylvan_batch, ops, results, n);
+    free(ops);
+}
+
+/**
+ * Submitted operations wait in a queue, until the dispatcher thread spawns them.
+ * The dispatcher runs one task that spawns every submitted operation and syncs them in
+ * LIFO order, taking new submissions between syncs, until the queue and the spawned
+ * operations are empty. The other workers steal the spawned operations.
+ * Every operation completes its future as soon as it is done, whoever runs it; the syncs
+ * only take the finished tasks off the deque of the dispatcher.
+ */
+
+struct sylvan_future
+{
+    sylvan_op_t op;                 // the operation, its operands are protected
+    MTBDD result;                   // protected
+    sylvan_future_cb cb;
+    void *context;
+    _Atomic(int) done;
+    struct sylvan_future *next;     // in the queue
+};
+
+/* At most this many submitted operations are spawned at a time */
+#define SYLVAN_SUBMIT_MAX_SPAWNED 4096
+
+static pthread_mutex_t submit_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t submit_cond = PTHREAD_COND_INITIALIZER;  // new submissions, or stop
+static pthread_cond_t submit_done = PTHREAD_COND_INITIALIZER;  // an operation is done
+static sylvan_future_t *submit_head = NULL;
+static sylvan_future_t *submit_tail = NULL;
+static pthread_t submit_thread;
+static int submit_running = 0;
+static int submit_stop = 0;
+
+static void
+sylvan_future_complete(sylvan_future_t *f)
+{
+    if (f->cb != NULL) {
+        // the callback owns the future
+        atomic_store_explicit(&f->done, 1, memory_order_release);
+        f->cb(f, f->context);
+    } else {
+        pthread_mutex_lock(&submit_lock);
+        atomic_store_explicit(&f->done, 1, memory_order_release);
+        pthread_cond_broadcast(&submit_done);
+        pthread_mutex_unlock(&submit_lock);
+    }
+}
+
+VOID_TASK_1(sylvan_future_run, sylvan_future_t*, f)
+{
+    f->result = CALL(sylvan_op_run, &f->op);
+    sylvan_future_complete(f);
+}
+
+VOID_TASK_0(sylvan_submit_drain)
+{
+    size_t count = 0;
+    for (;;) {
+        // take the new submissions, as many as fit
+        pthread_mutex_lock(&submit_lock);
+        sylvan_future_t *first = submit_head, *last = NULL;
+        size_t n = 0;
+        while (submit_head != NULL && count + n < SYLVAN_SUBMIT_MAX_SPAWNED) {
+            last = submit_head;
+            submit_head = submit_head->next;
+            n++;
+        }
+        if (submit_head == NULL) submit_tail = NULL;
+        pthread_mutex_unlock(&submit_lock);
+        if (last != NULL) last->next = NULL;
+
+        // and spawn them, in the order in which they were submitted
+        while (n-- > 0) {
+            sylvan_future_t *f = first;
+            first = first->next;
+            SPAWN(sylvan_future_run, f);
+            count++;
+        }
+        if (count == 0) return;
+
+        // reclaim the most recently spawned operation (which completed its own future)
+        count--;
+        SYNC(sylvan_future_run);
+    }
+}
+
+static void*
+sylvan_submit_dispatcher(void *arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&submit_lock);
+    while (!submit_stop) {
+        if (submit_head == NULL) {
+            pthread_cond_wait(&submit_cond, &submit_lock);
+        } else {
+            pthread_mutex_unlock(&submit_lock);
+            RUN(sylvan_submit_drain);
+            pthread_mutex_lock(&submit_lock);
+        }
+    }
+    pthread_mutex_unlock(&submit_lock);
+    return NULL;
+}
+
+static void
+sylvan_submit_quit(void)
+{
+    pthread_mutex_lock(&submit_lock);
+    submit_stop = 1;
+    pthread_cond_signal(&submit_cond);
+    pthread_mutex_unlock(&submit_lock);
+    pthread_join(submit_thread, NULL);
+    submit_running = 0;
+    submit_stop = 0;
+    submit_head = submit_tail = NULL;
+}
+
+sylvan_future_t *
+sylvan_submit_cb(const sylvan_op_t *op, sylvan_future_cb cb, void *context)
+{
+    sylvan_future_t *f = (sylvan_future_t*)malloc(sizeof(sylvan_future_t));
+    if (f == NULL) {
+        fprintf(stderr, "sylvan_submit: Unable to allocate memory!\n");
+        exit(1);
+    }
+    f->op = *op;
+    if (sylvan_op_operands(op->kind) < 3) f->op.c = mtbdd_false;
+    f->result = mtbdd_false;
+    f->cb = cb;
+    f->context = context;
+    atomic_init(&f->done, 0);
+    f->next = NULL;
+    mtbdd_protect(&f->op.a);
+    mtbdd_protect(&f->op.b);
+    mtbdd_protect(&f->op.c);
+    mtbdd_protect(&f->result);
+
+    pthread_mutex_lock(&submit_lock);
+    if (!submit_running) {
+        if (pthread_create(&submit_thread, NULL, sylvan_submit_dispatcher, NULL) != 0) {
+            fprintf(stderr, "sylvan_submit: Unable to start the dispatcher thread!\n");
+            exit(1);
+        }
+        submit_running = 1;
+        sylvan_register_quit(sylvan_submit_quit);
+    }
+    if (submit_tail == NULL) submit_head = f;
+    else submit_tail->next = f;
+    submit_tail = f;
+    pthread_cond_signal(&submit_cond);
+    pthread_mutex_unlock(&submit_lock);
+    return f;
+}
+
+sylvan_future_t *
+sylvan_submit(const sylvan_op_t *op)
+{
+    return sylvan_submit_cb(op, NULL, NULL);
+}
+
+int
+sylvan_future_done(sylvan_future_t *f)
+{
+    return atomic_load_explicit(&f->done, memory_order_acquire);
+}
+
+MTBDD
+sylvan_future_wait(sylvan_future_t *f)
+{
+    if (!sylvan_future_done(f)) {
+        pthread_mutex_lock(&submit_lock);
+        while (!sylvan_future_done(f)) pthread_cond_wait(&submit_done, &submit_lock);
+        pthread_mutex_unlock(&submit_lock);
+    }
+    return f->result;
+}
+
+MTBDD
+sylvan_future_get(sylvan_future_t *f)
+{
+    return f->result;
+}
+
+void
+sylvan_future_free(sylvan_future_t *f)
+{
+    mtbdd_unprotect(&f->op.a);
+    mtbdd_unprotect(&f->op.b);
+    mtbdd_unprotect(&f->op.c);
+    mtbdd_unprotect(&f->result);
+    free(f);
+}
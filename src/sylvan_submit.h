@@ -0,0 +1,170 @@
+/*
+ * Copyright 2011-2016 Formal Methods and Tools, University of Twente
+ * Copyright 2016-2017 Tom van Dijk, Johannes Kepler University Linz
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Do not include this file directly. Instead, include sylvan.h */
+
+#ifndef SYLVAN_SUBMIT_H
+#define SYLVAN_SUBMIT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * Submitting operations from threads that are not Lace workers.
+ *
+ * Every RUN from a thread that is not a Lace worker is a separate round trip to the Lace
+ * workers, and such calls are not executed concurrently. Instead, an operation can be
+ * submitted with sylvan_submit, from any thread. Submitted operations are spawned as
+ * independent tasks by one dispatcher thread, so they are executed concurrently by the Lace
+ * workers, and the result is collected with the returned future.
+ *
+ * The operands and the result of a submitted operation are protected from garbage collection
+ * until the future is freed, so the caller does not need to protect them. *
+ * From inside Lace tasks, many independent operations are executed in parallel with
+ * sylvan_batch, which spawns them as sibling tasks and waits until all are done.
+ */
+
+/**
+ * The operations that can be described by a sylvan_op_t.
+ */
+typedef enum sylvan_op_kind
+{
+    SYLVAN_OP_ITE,              // sylvan_ite(a, b, c)
+    SYLVAN_OP_AND,              // sylvan_and(a, b)
+    SYLVAN_OP_OR,               // sylvan_or(a, b)
+    SYLVAN_OP_XOR,              // sylvan_xor(a, b)
+    SYLVAN_OP_EXISTS,           // sylvan_exists(a, b)
+    SYLVAN_OP_FORALL,           // sylvan_forall(a, b)
+    SYLVAN_OP_AND_EXISTS,       // sylvan_and_exists(a, b, c)
+    SYLVAN_OP_RELNEXT,          // sylvan_relnext(a, b, c)
+    SYLVAN_OP_RELPREV,          // sylvan_relprev(a, b, c)
+    SYLVAN_OP_MTBDD_ITE,        // mtbdd_ite(a, b, c)
+    SYLVAN_OP_MTBDD_APPLY,      // mtbdd_apply(a, b, apply)
+    SYLVAN_OP_MTBDD_ABSTRACT,   // mtbdd_abstract(a, b, abstract)
+    SYLVAN_OP_TASK,             // task(a, b, c, context)
+} sylvan_op_kind_t;
+
+/**
+ * A user-defined operation: a Lace task MTBDD task(MTBDD a, MTBDD b, MTBDD c, void *context).
+ */
+LACE_TYPEDEF_CB(MTBDD, sylvan_op_task, MTBDD, MTBDD, MTBDD, void*);
+
+/**
+ * An operation: its kind, up to three operands and, depending on the kind, the operator of
+ * mtbdd_apply or mtbdd_abstract or the user-defined task and its context.
+ */
+typedef struct sylvan_op
+{
+    sylvan_op_kind_t kind;
+    MTBDD a, b, c;
+    mtbdd_apply_op apply;
+    mtbdd_abstract_op abstract;
+    sylvan_op_task task;
+    void *context;
+} sylvan_op_t;
+
+/**
+ * Describe the operation <kind> on <a>, <b> and <c> (unused operands are ignored).
+ */
+static inline sylvan_op_t
+sylvan_op_make(sylvan_op_kind_t kind, MTBDD a, MTBDD b, MTBDD c)
+{
+    sylvan_op_t op;
+    op.kind = kind;
+    op.a = a;
+    op.b = b;
+    op.c = c;
+    op.apply = NULL;
+    op.abstract = NULL;
+    op.task = NULL;
+    op.context = NULL;
+    return op;
+}
+
+/**
+ * Execute the operation <op> and return its result.
+ */
+TASK_DECL_1(MTBDD, sylvan_op_run, const sylvan_op_t*);
+#define sylvan_op_run(op) RUN(sylvan_op_run, op)
+
+/**
+ * Execute the <n> independent operations <ops> in parallel, and write the result of ops[i]
+ * to results[i]. The operations are spawned as sibling tasks, and the call returns when all
+ * operations are done. The operands and the results are protected during the batch.
+ */
+VOID_TASK_DECL_3(sylvan_batch, const sylvan_op_t*, MTBDD*, size_t);
+#define sylvan_batch(ops, results, n) RUN(sylvan_batch, ops, results, n)
+
+/**
+ * Execute the operation <op> for every i < <n> in parallel, with its operands replaced by a[i],
+ * b[i] and c[i], and write the results to results[i]. Arrays that are NULL are not replaced.
+ * For example, with op = sylvan_op_make(SYLVAN_OP_EXISTS, sylvan_false, vars, sylvan_false),
+ * sylvan_batch_each(&op, a, NULL, NULL, results, n) quantifies vars in every a[i].
+ */
+VOID_TASK_DECL_6(sylvan_batch_each, const sylvan_op_t*, const MTBDD*, const MTBDD*, const MTBDD*, MTBDD*, size_t);
+#define sylvan_batch_each(op, a, b, c, results, n) RUN(sylvan_batch_each, op, a, b, c, results, n)
+
+/**
+ * The result of a submitted operation.
+ */
+typedef struct sylvan_future sylvan_future_t;
+
+/**
+ * Callback for when a submitted operation is done, called by a Lace worker.
+ * The callback may call sylvan_future_get and sylvan_future_free, but must not wait.
+ */
+typedef void (*sylvan_future_cb)(sylvan_future_t *future, void *context);
+
+/**
+ * Submit the operation <op>, which is copied, and return its future.
+ * This can be called from any thread, also concurrently, after sylvan_init_package.
+ * All futures must be freed before sylvan_quit.
+ */
+sylvan_future_t *sylvan_submit(const sylvan_op_t *op);
+
+/**
+ * Submit the operation <op>, and call <cb> with the future and <context> when it is done.
+ */
+sylvan_future_t *sylvan_submit_cb(const sylvan_op_t *op, sylvan_future_cb cb, void *context);
+
+/**
+ * Returns 1 if the submitted operation is done, 0 otherwise.
+ */
+int sylvan_future_done(sylvan_future_t *future);
+
+/**
+ * Wait until the submitted operation is done, and return its result.
+ * Do not wait from inside a Lace task, as this blocks the worker.
+ */
+MTBDD sylvan_future_wait(sylvan_future_t *future);
+
+/**
+ * The result of a submitted operation that is done.
+ */
+MTBDD sylvan_future_get(sylvan_future_t *future);
+
+/**
+ * Free the future, after the operation is done. The result is no longer protected.
+ */
+void sylvan_future_free(sylvan_future_t *future);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif
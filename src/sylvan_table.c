@@ -57,7 +57,10 @@ claim_data_bucket(const llmsset_t dbs)
         uint64_t count = dbs->table_size/(64*8);
         for (;;) {
             // check if table maybe full
-            if (count-- == 0) return (uint64_t)-1;
+            if (count-- == 0) {
+                sylvan_stats_count(LLMSSET_FULL_SCAN);
+                return (uint64_t)-1;
+            }
 
             my_region += 1;
             if (my_region >= (dbs->table_size/(64*8))) my_region = 0;
@@ -70,8 +73,10 @@ restart:
             v = atomic_load_explicit(ptr, memory_order_relaxed);
             if (v & mask) continue; // taken
             if (atomic_compare_exchange_weak(ptr, &v, v|mask)) break;
-            else goto restart;
+            sylvan_stats_count(LLMSSET_REGION_CAS_FAILED);
+            goto restart;
         }
+        sylvan_stats_count(LLMSSET_REGION_SWITCH);
         SET_THREAD_LOCAL(my_region, my_region);
     }
 }
@@ -113,7 +118,23 @@ static const uint64_t CL_MASK_R   = ((SYLVAN_CACHE_LINE_SIZE) / 8) - 1;
 #define MASK_INDEX ((uint64_t)0x000000ffffffffff)
 #define MASK_HASH  ((uint64_t)0xffffff0000000000)
 
-static inline uint64_t
+/**
+ * Count the number of cache lines probed by a lookup (i+1) in the probe histogram, and the
+ * buckets it stepped over. Called once per lookup, so the probe loop itself does not test
+ * whether statistics are enabled.
+ */
+static inline void
+count_probes(int i, uint64_t steps)
+{
+    if (__builtin_expect(sylvan_stats_active, 0)) {
+        int bucket = i == 0 ? 0 : 64 - __builtin_clzll((uint64_t)i);
+        if (bucket > LLMSSET_PROBE_MORE - LLMSSET_PROBE_1) bucket = LLMSSET_PROBE_MORE - LLMSSET_PROBE_1;
+        sylvan_stats_count(LLMSSET_PROBE_1 + bucket);
+        sylvan_stats_add(LLMSSET_LOOKUP, steps);
+    }
+}
+
+static inline uint64_t __attribute__((always_inline))
 llmsset_lookup2(const llmsset_t dbs, uint64_t a, uint64_t b, int* created, const int custom)
 {
     uint64_t hash_rehash = 14695981039346656037LLU;
@@ -122,7 +143,7 @@ llmsset_lookup2(const llmsset_t dbs, uint64_t a, uint64_t b, int* created, const
 
     const uint64_t step = (((hash_rehash >> 20) | 1) << 3);
     const uint64_t hash = hash_rehash & MASK_HASH;
-    uint64_t idx, last, cidx = 0;
+    uint64_t idx, last, cidx = 0, steps = 0;
     int i=0;
 
 #if LLMSSET_MASK
@@ -139,7 +160,10 @@ llmsset_lookup2(const llmsset_t dbs, uint64_t a, uint64_t b, int* created, const
             if (cidx == 0) {
                 // Claim data bucket and write data
                 cidx = claim_data_bucket(dbs);
-                if (cidx == (uint64_t)-1) return 0; // failed to claim a data bucket
+                if (cidx == (uint64_t)-1) {
+                    count_probes(i, steps);
+                    return 0; // failed to claim a data bucket
+                }
                 if (custom) dbs->create_cb(&a, &b);
                 uint64_t *d_ptr = ((uint64_t*)dbs->data) + 2*cidx;
                 d_ptr[0] = a;
@@ -147,9 +171,11 @@ llmsset_lookup2(const llmsset_t dbs, uint64_t a, uint64_t b, int* created, const
             }
             if (atomic_compare_exchange_strong(bucket, &v, hash | cidx)) {
                 if (custom) set_custom_bucket(dbs, cidx, custom);
+                count_probes(i, steps);
                 *created = 1;
                 return cidx;
             }
+            sylvan_stats_count(LLMSSET_CAS_FAILED);
         }
 
         if (hash == (v & MASK_HASH)) {
@@ -161,24 +187,29 @@ llmsset_lookup2(const llmsset_t dbs, uint64_t a, uint64_t b, int* created, const
                         dbs->destroy_cb(a, b);
                         release_data_bucket(dbs, cidx);
                     }
+                    count_probes(i, steps);
                     *created = 0;
                     return d_idx;
                 }
             } else {
                 if (d_ptr[0] == a && d_ptr[1] == b) {
                     if (cidx != 0) release_data_bucket(dbs, cidx);
+                    count_probes(i, steps);
                     *created = 0;
                     return d_idx;
                 }
             }
         }
 
-        sylvan_stats_count(LLMSSET_LOOKUP);
+        steps++;
 
         // find next idx on probe sequence
         idx = (idx & CL_MASK) | ((idx+1) & CL_MASK_R);
         if (idx == last) {
-            if (++i == dbs->threshold) return 0; // failed to find empty spot in probe sequence
+            if (++i == dbs->threshold) {
+                count_probes(i, steps);
+                return 0; // failed to find empty spot in probe sequence
+            }
 
             // go to next cache line in probe sequence
             hash_rehash += step;
@@ -387,19 +418,23 @@ llmsset_mark(const llmsset_t dbs, uint64_t index)
     }
 }
 
-TASK_3(int, llmsset_rehash_par, llmsset_t, dbs, size_t, first, size_t, count)
+TASK_5(int, llmsset_rehash_par, llmsset_t, dbs, llmsset_visited_t, skip, _Atomic(size_t)*, kept, size_t, first, size_t, count)
 {
     if (count > 512) {
-        SPAWN(llmsset_rehash_par, dbs, first, count/2);
-        int bad = CALL(llmsset_rehash_par, dbs, first + count/2, count - count/2);
+        SPAWN(llmsset_rehash_par, dbs, skip, kept, first, count/2);
+        int bad = CALL(llmsset_rehash_par, dbs, skip, kept, first + count/2, count - count/2);
         return bad + SYNC(llmsset_rehash_par);
     } else {
         int bad = 0;
+        size_t rehashed = 0;
         _Atomic(uint64_t)* ptr = dbs->bitmap2 + (first / 64);
         uint64_t mask = 0x8000000000000000LL >> (first & 63);
         for (size_t k=0; k<count; k++) {
             if (atomic_load_explicit(ptr, memory_order_relaxed) & mask) {
-                if (llmsset_rehash_bucket(dbs, first+k) == 0) bad++;
+                if (skip == NULL || !llmsset_visited_contains(skip, first+k)) {
+                    if (llmsset_rehash_bucket(dbs, first+k) == 0) bad++;
+                    else rehashed++;
+                }
             }
             mask >>= 1;
             if (mask == 0) {
@@ -407,13 +442,27 @@ TASK_3(int, llmsset_rehash_par, llmsset_t, dbs, size_t, first, size_t, count)
                 mask = 0x8000000000000000LL;
             }
         }
+        if (kept != NULL && rehashed != 0) atomic_fetch_add_explicit(kept, rehashed, memory_order_relaxed);
         return bad;
     }
 }
 
 TASK_IMPL_1(int, llmsset_rehash, llmsset_t, dbs)
 {
-    return CALL(llmsset_rehash_par, dbs, 0, dbs->table_size);
+    return CALL(llmsset_rehash_par, dbs, NULL, NULL, 0, dbs->table_size);
+}
+
+TASK_IMPL_2(int, llmsset_rehash_count, llmsset_t, dbs, size_t*, kept)
+{
+    _Atomic(size_t) count = 0;
+    int bad = CALL(llmsset_rehash_par, dbs, NULL, &count, 0, dbs->table_size);
+    *kept = count;
+    return bad;
+}
+
+TASK_IMPL_2(int, llmsset_rehash_skip, llmsset_t, dbs, llmsset_visited_t, skip)
+{
+    return CALL(llmsset_rehash_par, dbs, skip, NULL, 0, dbs->table_size);
 }
 
 TASK_3(size_t, llmsset_count_marked_par, llmsset_t, dbs, size_t, first, size_t, count)
@@ -456,6 +505,34 @@ TASK_IMPL_1(size_t, llmsset_count_marked, llmsset_t, dbs)
     return CALL(llmsset_count_marked_par, dbs, 0, dbs->table_size);
 }
 
+size_t
+llmsset_region_fill(const llmsset_t dbs, uint64_t *histogram)
+{
+    for (int i=0; i<LLMSSET_FILL_BUCKETS; i++) histogram[i] = 0;
+    size_t claimed = 0;
+    const size_t regions = dbs->table_size / 512;
+    for (size_t r=0; r<regions; r++) {
+        if (atomic_load_explicit(dbs->bitmap1 + r/64, memory_order_relaxed) & (0x8000000000000000LL >> (r&63))) claimed++;
+        int used = 0;
+        for (int k=0; k<8; k++) {
+            used += __builtin_popcountll(atomic_load_explicit(dbs->bitmap2 + r*8 + k, memory_order_relaxed));
+        }
+        histogram[used * (LLMSSET_FILL_BUCKETS-1) / 512]++;
+    }
+    return claimed;
+}
+
+size_t
+llmsset_count_marked_seq(const llmsset_t dbs)
+{
+    size_t result = 0;
+    const size_t words = (dbs->table_size + 63) / 64;
+    for (size_t i=0; i<words; i++) {
+        result += __builtin_popcountll(atomic_load_explicit(dbs->bitmap2+i, memory_order_relaxed));
+    }
+    return result;
+}
+
 VOID_TASK_3(llmsset_destroy_par, llmsset_t, dbs, size_t, first, size_t, count)
 {
     if (count > 1024) {
@@ -495,3 +572,27 @@ void llmsset_set_custom(const llmsset_t dbs, llmsset_hash_cb hash_cb, llmsset_eq
     dbs->create_cb = create_cb;
     dbs->destroy_cb = destroy_cb;
 }
+
+llmsset_visited_t
+llmsset_visited_create(const llmsset_t dbs)
+{
+    llmsset_visited_t visited = (llmsset_visited_t)malloc(sizeof(struct llmsset_visited));
+    if (visited == NULL) {
+        fprintf(stderr, "llmsset_visited_create: Unable to allocate memory!\n");
+        exit(1);
+    }
+    visited->size = dbs->table_size;
+    visited->bitmap = (_Atomic(uint64_t)*)alloc_aligned((visited->size + 63) / 64 * 8);
+    if (visited->bitmap == 0) {
+        fprintf(stderr, "llmsset_visited_create: Unable to allocate memory: %s!\n", strerror(errno));
+        exit(1);
+    }
+    return visited;
+}
+
+void
+llmsset_visited_free(llmsset_visited_t visited)
+{
+    free_aligned(visited->bitmap, (visited->size + 63) / 64 * 8);
+    free(visited);
+}
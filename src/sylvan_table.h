@@ -78,6 +78,20 @@ llmsset_index_to_ptr(const llmsset_t dbs, size_t index)
     return dbs->data + index * 16;
 }
 
+/**
+ * Hint the processor that the bucket at <index> will be read soon.
+ */
+static inline void __attribute__((unused))
+llmsset_prefetch(const llmsset_t dbs, size_t index)
+{
+#if SYLVAN_PREFETCH
+    __builtin_prefetch(dbs->data + index * 16);
+#else
+    (void)dbs;
+    (void)index;
+#endif
+}
+
 /**
  * Create the set.
  * This will allocate a set of <max_size> buckets in virtual memory.
@@ -176,6 +190,14 @@ int llmsset_mark(const llmsset_t dbs, uint64_t index);
 TASK_DECL_1(int, llmsset_rehash, llmsset_t);
 #define llmsset_rehash(dbs) RUN(llmsset_rehash, dbs)
 
+/**
+ * Rehash all marked buckets, like llmsset_rehash, and store the number of rehashed
+ * buckets in <kept>, which saves a separate llmsset_count_marked afterwards.
+ * Returns 0 if successful, or the number of buckets not rehashed if not.
+ */
+TASK_DECL_2(int, llmsset_rehash_count, llmsset_t, size_t*);
+#define llmsset_rehash_count(dbs, kept) RUN(llmsset_rehash_count, dbs, kept)
+
 /**
  * Rehash a single bucket.
  * Returns 0 if successful, or 1 if not.
@@ -188,6 +210,32 @@ int llmsset_rehash_bucket(const llmsset_t dbs, uint64_t d_idx);
 TASK_DECL_1(size_t, llmsset_count_marked, llmsset_t);
 #define llmsset_count_marked(dbs) RUN(llmsset_count_marked, dbs)
 
+/**
+ * Retrieve number of marked buckets, sequentially.
+ * Unlike llmsset_count_marked, this can be called from any thread, also while
+ * operations are running (the result is then approximate).
+ */
+size_t llmsset_count_marked_seq(const llmsset_t dbs);
+
+/**
+ * Fill level of the regions of 512 buckets from which workers claim buckets for new nodes.
+ * Sets <histogram>[i] to the number of regions with between i/8 and (i+1)/8 of the buckets
+ * used; <histogram>[8] is the number of full regions. Returns the number of regions that
+ * are currently claimed by a worker. Sequential; can be called from any thread.
+ */
+#define LLMSSET_FILL_BUCKETS 9
+size_t llmsset_region_fill(const llmsset_t dbs, uint64_t *histogram);
+
+/**
+ * The current probe sequence limit (in cache lines); lookups that probe this many cache
+ * lines fail and trigger garbage collection.
+ */
+static inline int
+llmsset_get_threshold(const llmsset_t dbs)
+{
+    return atomic_load_explicit(&dbs->threshold, memory_order_relaxed);
+}
+
 /**
  * During garbage collection, this method calls the destroy callback
  * for all 'custom' data that is not kept.
@@ -200,6 +248,52 @@ VOID_TASK_DECL_1(llmsset_destroy_unmarked, llmsset_t);
  */
 void llmsset_set_custom(const llmsset_t dbs, llmsset_hash_cb hash_cb, llmsset_equals_cb equals_cb, llmsset_create_cb create_cb, llmsset_destroy_cb destroy_cb);
 
+/**
+ * Visited set: a concurrent bitmap with one bit per bucket, for parallel traversals that
+ * must not modify the data (unlike the mark bits in the nodes), e.g., to count nodes while
+ * other operations are running. It covers the buckets that exist when it is created.
+ */
+typedef struct llmsset_visited
+{
+    _Atomic(uint64_t)* bitmap;
+    size_t             size;         // number of buckets covered by the bitmap
+} *llmsset_visited_t;
+
+llmsset_visited_t llmsset_visited_create(const llmsset_t dbs);
+void llmsset_visited_free(llmsset_visited_t visited);
+
+/**
+ * Add bucket <index> to the visited set.
+ * Returns 1 if this call added it, or 0 if it was already in the set.
+ */
+static inline int __attribute__((unused))
+llmsset_visited_add(const llmsset_visited_t visited, uint64_t index)
+{
+    _Atomic(uint64_t)* ptr = visited->bitmap + (index/64);
+    const uint64_t mask = 0x8000000000000000LL >> (index&63);
+    if (atomic_load_explicit(ptr, memory_order_relaxed) & mask) return 0;
+    return (atomic_fetch_or_explicit(ptr, mask, memory_order_relaxed) & mask) ? 0 : 1;
+}
+
+/**
+ * Check if bucket <index> is in the visited set.
+ */
+static inline int __attribute__((unused))
+llmsset_visited_contains(const llmsset_visited_t visited, uint64_t index)
+{
+    const _Atomic(uint64_t)* ptr = visited->bitmap + (index/64);
+    const uint64_t mask = 0x8000000000000000LL >> (index&63);
+    return (atomic_load_explicit(ptr, memory_order_relaxed) & mask) ? 1 : 0;
+}
+
+/**
+ * Rehash all marked buckets that are not in <skip>, e.g., because their data will still
+ * change (they can be rehashed afterwards with llmsset_rehash_bucket).
+ * Returns 0 if successful, or the number of buckets not rehashed if not.
+ */
+TASK_DECL_2(int, llmsset_rehash_skip, llmsset_t, llmsset_visited_t);
+#define llmsset_rehash_skip(dbs, skip) RUN(llmsset_rehash_skip, dbs, skip)
+
 /**
  * Default hashing functions.
  */
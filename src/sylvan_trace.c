@@ -0,0 +1,230 @@
+/*
+ * Copyright 2011-2016 Formal Methods and Tools, University of Twente
+ * Copyright 2016-2017 Tom van Dijk, Johannes Kepler University Linz
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sylvan_int.h>
+#include <sylvan_align.h>
+
+#include <errno.h>  // for errno
+#include <string.h> // for strerror
+#include <inttypes.h>
+
+/**
+ * One recorded event.
+ * For 'X' events, value is the duration; for 'C' events, value is the new value.
+ */
+typedef struct trace_event
+{
+    uint64_t ts;
+    uint64_t value;
+    const char *name;
+    char type;
+} trace_event_t;
+
+/**
+ * The ring buffer of one worker. Only the owning worker writes to it.
+ * The buffers of the workers are followed by one for all other threads, protected by trace_lock.
+ */
+typedef struct trace_buffer
+{
+    trace_event_t *events;
+    _Atomic(uint64_t) head;     // number of events recorded so far
+} __attribute__((aligned(64))) trace_buffer_t;
+
+int sylvan_trace_active = 0;
+
+static trace_buffer_t *trace_buffers = NULL;
+static unsigned int trace_workers = 0;
+static size_t trace_capacity = 0;   // power of 2
+static uint64_t trace_start = 0;
+static int trace_quit_registered = 0;
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void
+sylvan_trace_free_buffers(trace_buffer_t *buffers, unsigned int workers, size_t capacity)
+{
+    if (buffers == NULL) return;
+    for (unsigned int i=0; i<=workers; i++) {
+        free_aligned(buffers[i].events, capacity * sizeof(trace_event_t));
+    }
+    free_aligned(buffers, (workers + 1) * sizeof(trace_buffer_t));
+    sylvan_memory_sub(SYLVAN_MEM_INSTRUMENTATION, (workers + 1) * (sizeof(trace_buffer_t) + capacity * sizeof(trace_event_t)));
+}
+
+static void
+sylvan_trace_free()
+{
+    sylvan_trace_active = 0;
+    sylvan_trace_free_buffers(trace_buffers, trace_workers, trace_capacity);
+    trace_buffers = NULL;
+    trace_workers = 0;
+    trace_capacity = 0;
+}
+
+static void
+sylvan_trace_quit()
+{
+    sylvan_trace_free();
+    trace_quit_registered = 0;
+}
+
+/**
+ * The buffers that sylvan_trace_enable installs, and afterwards the buffers that they replaced.
+ */
+static trace_buffer_t *trace_next_buffers;
+static unsigned int trace_next_workers;
+static size_t trace_next_capacity;
+
+/**
+ * Swap the buffers while no operations run (in a new frame) and no other thread records events.
+ */
+VOID_TASK_0(sylvan_trace_swap)
+{
+    pthread_mutex_lock(&trace_lock);
+    trace_buffer_t *buffers = trace_buffers;
+    unsigned int workers = trace_workers;
+    size_t capacity = trace_capacity;
+    trace_buffers = trace_next_buffers;
+    trace_workers = trace_next_workers;
+    trace_capacity = trace_next_capacity;
+    trace_next_buffers = buffers;
+    trace_next_workers = workers;
+    trace_next_capacity = capacity;
+    trace_start = getabstime();
+    sylvan_trace_active = 1;
+    pthread_mutex_unlock(&trace_lock);
+}
+
+VOID_TASK_0(sylvan_trace_swap_frame)
+{
+    NEWFRAME(sylvan_trace_swap);
+}
+
+void
+sylvan_trace_enable(size_t events_per_worker)
+{
+    size_t capacity = 64;
+    while (capacity < events_per_worker) capacity <<= 1;
+
+    unsigned int workers = lace_workers();
+    trace_buffer_t *buffers = (trace_buffer_t*)alloc_aligned((workers + 1) * sizeof(trace_buffer_t));
+    if (buffers == 0) {
+        fprintf(stderr, "sylvan_trace: Unable to allocate memory: %s!\n", strerror(errno));
+        exit(1);
+    }
+    for (unsigned int i=0; i<=workers; i++) {
+        buffers[i].events = (trace_event_t*)alloc_aligned(capacity * sizeof(trace_event_t));
+        if (buffers[i].events == 0) {
+            fprintf(stderr, "sylvan_trace: Unable to allocate memory: %s!\n", strerror(errno));
+            exit(1);
+        }
+        atomic_store_explicit(&buffers[i].head, 0, memory_order_relaxed);
+    }
+
+    sylvan_memory_add(SYLVAN_MEM_INSTRUMENTATION, (workers + 1) * (sizeof(trace_buffer_t) + capacity * sizeof(trace_event_t)));
+
+    if (!trace_quit_registered) {
+        sylvan_register_quit(sylvan_trace_quit);
+        trace_quit_registered = 1;
+    }
+
+    // workers may be recording events into the current buffers, so replace them in a new frame
+    trace_next_buffers = buffers;
+    trace_next_workers = workers;
+    trace_next_capacity = capacity;
+    RUN(sylvan_trace_swap_frame);
+    sylvan_trace_free_buffers(trace_next_buffers, trace_next_workers, trace_next_capacity);
+    trace_next_buffers = NULL;
+}
+
+void
+sylvan_trace_disable()
+{
+    sylvan_trace_active = 0;
+}
+
+void
+sylvan_trace_record(char type, const char *name, uint64_t ts, uint64_t value)
+{
+    WorkerP *w = lace_get_worker();
+    const int other = w == NULL || (unsigned int)w->worker >= trace_workers; // not a Lace worker
+    if (other) {
+        pthread_mutex_lock(&trace_lock);
+        if (trace_buffers == NULL) {
+            pthread_mutex_unlock(&trace_lock);
+            return;
+        }
+    }
+
+    trace_buffer_t *buf = trace_buffers + (other ? trace_workers : (unsigned int)w->worker);
+    uint64_t head = atomic_load_explicit(&buf->head, memory_order_relaxed);
+    trace_event_t *e = buf->events + (head & (trace_capacity - 1));
+    e->ts = ts;
+    e->value = value;
+    e->name = name;
+    e->type = type;
+    atomic_store_explicit(&buf->head, head + 1, memory_order_release);
+
+    if (other) pthread_mutex_unlock(&trace_lock);
+}
+
+void
+sylvan_trace_instant(const char *name)
+{
+    if (sylvan_trace_active) sylvan_trace_record('i', name, getabstime(), 0);
+}
+
+/**
+ * Timestamps in the Chrome trace format are in microseconds.
+ */
+static void
+write_us(FILE *target, const char *key, uint64_t ns)
+{
+    fprintf(target, ",\"%s\":%" PRIu64 ".%03" PRIu64, key, ns / 1000, ns % 1000);
+}
+
+void
+sylvan_trace_write(FILE *target)
+{
+    fprintf(target, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(target, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"sylvan\"}}");
+    for (unsigned int w=0; trace_buffers != NULL && w<=trace_workers; w++) {
+        if (w < trace_workers) {
+            fprintf(target, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"worker %u\"}}", w, w);
+        } else {
+            fprintf(target, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"other threads\"}}", w);
+        }
+
+        trace_buffer_t *buf = trace_buffers + w;
+        uint64_t head = atomic_load_explicit(&buf->head, memory_order_acquire);
+        uint64_t first = head > trace_capacity ? head - trace_capacity : 0;
+        for (uint64_t i=first; i<head; i++) {
+            trace_event_t *e = buf->events + (i & (trace_capacity - 1));
+            uint64_t ts = e->ts > trace_start ? e->ts - trace_start : 0;
+            fprintf(target, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"pid\":1,\"tid\":%u", e->name, e->type, w);
+            write_us(target, "ts", ts);
+            if (e->type == 'X') {
+                write_us(target, "dur", e->value);
+            } else if (e->type == 'C') {
+                fprintf(target, ",\"args\":{\"value\":%" PRIu64 "}", e->value);
+            } else if (e->type == 'i') {
+                fprintf(target, ",\"s\":\"t\"");
+            }
+            fprintf(target, "}");
+        }
+    }
+    fprintf(target, "\n]}\n");
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2011-2016 Formal Methods and Tools, University of Twente
+ * Copyright 2016-2017 Tom van Dijk, Johannes Kepler University Linz
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Do not include this file directly. Instead, include sylvan.h */
+
+#ifndef SYLVAN_TRACE_H
+#define SYLVAN_TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * Event tracing.
+ *
+ * When tracing is enabled, every worker records events in its own ring buffer:
+ * - the top-level operations (e.g. sylvan_relnext, lddmc_relprod_union) called via their
+ *   public macros, with their begin time and duration;
+ * - garbage collection and each of its phases;
+ * - resizing of the nodes table and operation cache, and clearing of the operation cache.
+ * Only the owning worker writes to its buffer, so recording needs no locks. When a buffer
+ * is full, the oldest events are overwritten.
+ *
+ * The events can be written in the Chrome trace event format (JSON), which can be
+ * opened in Perfetto (ui.perfetto.dev) or chrome://tracing. Every worker is one thread.
+ */
+
+/**
+ * Start tracing with room for <events_per_worker> events per worker (rounded up to a power of 2),
+ * and as many for all threads that are not Lace workers together. Any earlier trace is discarded.
+ * The buffers are replaced in a new Lace frame, so this may be called while operations run.
+ */
+void sylvan_trace_enable(size_t events_per_worker);
+
+/**
+ * Stop tracing. The recorded events remain available for sylvan_trace_write.
+ */
+void sylvan_trace_disable(void);
+
+/**
+ * Write all recorded events as Chrome trace JSON.
+ * Call this while tracing is disabled or no operations are running.
+ */
+void sylvan_trace_write(FILE *target);
+
+/**
+ * Record a custom instant event (e.g., "iteration") on the current worker or thread.
+ */
+void sylvan_trace_instant(const char *name);
+
+/**
+ * Internal: the runtime switch and the recording functions.
+ * The <name> must be a string with static lifetime.
+ */
+extern int sylvan_trace_active;
+
+void sylvan_trace_record(char type, const char *name, uint64_t ts, uint64_t value);
+
+static inline uint64_t
+sylvan_trace_now(void)
+{
+    return __builtin_expect(sylvan_trace_active, 0) ? getabstime() : 0;
+}
+
+/* record an event of <name> that started at <start> (obtained from sylvan_trace_now) */
+static inline void
+sylvan_trace_complete(const char *name, uint64_t start)
+{
+    if (__builtin_expect(sylvan_trace_active, 0) && start != 0) {
+        sylvan_trace_record('X', name, start, getabstime() - start);
+    }
+}
+
+/* record the new value of a counter, e.g., the size of the nodes table */
+static inline void
+sylvan_trace_counter(const char *name, uint64_t value)
+{
+    if (__builtin_expect(sylvan_trace_active, 0)) {
+        sylvan_trace_record('C', name, getabstime(), value);
+    }
+}
+
+/**
+ * Run a task (like RUN) and record it as an event and in the profile (see sylvan_profile.h),
+ * for the public macros of operations.
+ */
+static inline uint64_t
+sylvan_trace_begin(sylvan_profile_scope_t *scope)
+{
+    if (__builtin_expect(sylvan_profile_active, 0)) sylvan_profile_begin(scope);
+    else scope->start = 0;
+    return sylvan_trace_now();
+}
+
+static inline void
+sylvan_trace_end(const char *name, uint64_t start, sylvan_profile_scope_t *scope)
+{
+    sylvan_trace_complete(name, start);
+    if (__builtin_expect(sylvan_profile_active, 0)) sylvan_profile_end(scope, name);
+}
+
+#define SYLVAN_TRACE_RUN(type, f, ...) __extension__ ({ \
+    sylvan_profile_scope_t __sylvan_profile_scope; \
+    uint64_t __sylvan_trace_start = sylvan_trace_begin(&__sylvan_profile_scope); \
+    type __sylvan_trace_result = RUN(f, __VA_ARGS__); \
+    sylvan_trace_end(#f, __sylvan_trace_start, &__sylvan_profile_scope); \
+    __sylvan_trace_result; })
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif
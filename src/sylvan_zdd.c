@@ -268,6 +268,7 @@ VOID_TASK_0(zdd_refs_init_task)
     s->rend = s->rbegin + 1024;
     s->scur = s->sbegin = (zdd_refs_task_t)malloc(sizeof(struct zdd_refs_task) * 1024);
     s->send = s->sbegin + 1024;
+    sylvan_memory_add(SYLVAN_MEM_REFS_STACKS, sizeof(struct zdd_refs_internal) + (sizeof(ZDD*) + sizeof(ZDD) + sizeof(struct zdd_refs_task)) * 1024);
     SET_THREAD_LOCAL(zdd_refs_key, s);
 }
 
@@ -275,6 +276,10 @@ VOID_TASK_0(zdd_refs_free)
 {
     LOCALIZE_THREAD_LOCAL(zdd_refs_key, zdd_refs_internal_t);
     if (zdd_refs_key != NULL) {
+        sylvan_memory_sub(SYLVAN_MEM_REFS_STACKS, sizeof(struct zdd_refs_internal)
+                + sizeof(ZDD*) * (zdd_refs_key->pend - zdd_refs_key->pbegin)
+                + sizeof(ZDD) * (zdd_refs_key->rend - zdd_refs_key->rbegin)
+                + sizeof(struct zdd_refs_task) * (zdd_refs_key->send - zdd_refs_key->sbegin));
         free(zdd_refs_key->pbegin);
         free(zdd_refs_key->rbegin);
         free(zdd_refs_key->sbegin);
@@ -294,8 +299,9 @@ zdd_refs_ptrs_up(zdd_refs_internal_t zdd_refs_key)
 {
     size_t size = zdd_refs_key->pend - zdd_refs_key->pbegin;
     zdd_refs_key->pbegin = (ZDD**)realloc(zdd_refs_key->pbegin, sizeof(ZDD*) * size*2);
+    sylvan_memory_add(SYLVAN_MEM_REFS_STACKS, sizeof(ZDD*) * size);
     zdd_refs_key->pcur = zdd_refs_key->pbegin + size;
-    zdd_refs_key->pend = zdd_refs_key->pend + size * 2;
+    zdd_refs_key->pend = zdd_refs_key->pbegin + size * 2;
 }
 
 ZDD __attribute__((noinline))
@@ -303,6 +309,7 @@ zdd_refs_refs_up(zdd_refs_internal_t zdd_refs_key, ZDD res)
 {
     long size = zdd_refs_key->rend - zdd_refs_key->rbegin;
     zdd_refs_key->rbegin = (ZDD*)realloc(zdd_refs_key->rbegin, sizeof(ZDD) * size * 2);
+    sylvan_memory_add(SYLVAN_MEM_REFS_STACKS, sizeof(ZDD) * size);
     zdd_refs_key->rcur = zdd_refs_key->rbegin + size;
     zdd_refs_key->rend = zdd_refs_key->rbegin + (size * 2);
     return res;
@@ -313,6 +320,7 @@ zdd_refs_tasks_up(zdd_refs_internal_t zdd_refs_key)
 {
     long size = zdd_refs_key->send - zdd_refs_key->sbegin;
     zdd_refs_key->sbegin = (zdd_refs_task_t)realloc(zdd_refs_key->sbegin, sizeof(struct zdd_refs_task) * size * 2);
+    sylvan_memory_add(SYLVAN_MEM_REFS_STACKS, sizeof(struct zdd_refs_task) * size);
     zdd_refs_key->scur = zdd_refs_key->sbegin + size;
     zdd_refs_key->send = zdd_refs_key->sbegin + (size * 2);
 }
@@ -396,8 +404,9 @@ sylvan_init_zdd(void)
     zdd_initialized = 1;
 
     sylvan_register_quit(zdd_quit);
-    sylvan_gc_add_mark(zdd_gc_mark_protected_CALL);
-    sylvan_gc_add_mark(zdd_refs_mark_CALL);
+    sylvan_reorder_unsupported("ZDDs");
+    sylvan_gc_add_mark_named(zdd_gc_mark_protected_CALL, "zdd_gc_mark_protected");
+    sylvan_gc_add_mark_named(zdd_refs_mark_CALL, "zdd_refs_mark");
 
     if (!zdd_protected_created) {
         protect_create(&zdd_protected, 4096);
@@ -1091,32 +1100,45 @@ zdd_unmark_rec(ZDD zdd)
 }
 
 /**
- * Mark and count all nodes (internal & leaves) in the given ZDD.
- * Not thread-safe.
+ * Count all nodes (internal & leaves) in the given ZDD.
+ * Nodes are claimed in an external visited set, so the nodes themselves are not modified.
  */
-static size_t
-zdd_nodecount_mark(ZDD zdd)
+TASK_2(size_t, zdd_nodecount_par, ZDD, zdd, llmsset_visited_t, visited)
 {
-    // Note: the True/False leaf can be marked/unmarked, as buckets 0--1 are unused
+    if (!llmsset_visited_add(visited, ZDD_GETINDEX(zdd))) return 0;
+    if (ZDD_GETINDEX(zdd) <= 1) return 1; // the True/False leaf
     zddnode_t n = ZDD_GETNODE(zdd);
-    if (zddnode_getmark(n)) return 0;
-    zddnode_setmark(n, 1);
-    return 1 + zdd_nodecount_mark(zddnode_getlow(n)) + zdd_nodecount_mark(zddnode_gethigh(n));
+    if (zddnode_isleaf(n)) return 1;
+    SPAWN(zdd_nodecount_par, zddnode_getlow(n), visited);
+    size_t result = CALL(zdd_nodecount_par, zddnode_gethigh(n), visited);
+    return 1 + result + SYNC(zdd_nodecount_par);
 }
 
 /**
  * Count the number of nodes (internal nodes plus leaves) in ZDDs.
- * Not thread-safe.
  */
-size_t
-zdd_nodecount(const ZDD *zdds, size_t count)
+TASK_IMPL_2(size_t, zdd_nodecount, const ZDD*, zdds, size_t, count)
 {
+    llmsset_visited_t visited = llmsset_visited_create(nodes);
     size_t result = 0, i;
-    for (i=0; i<count; i++) result += zdd_nodecount_mark(zdds[i]);
-    for (i=0; i<count; i++) zdd_unmark_rec(zdds[i]);
+    for (i=0; i<count; i++) result += CALL(zdd_nodecount_par, zdds[i], visited);
+    llmsset_visited_free(visited);
     return result;
 }
 
+/**
+ * Prefetch the nodes and the cache bucket that the recursive call and(a,b) reads first.
+ */
+static inline void
+zdd_and_prefetch(ZDD a, ZDD b)
+{
+    if (a == zdd_false || b == zdd_false || a == b) return;
+    ZDD_PREFETCH(a);
+    ZDD_PREFETCH(b);
+    if (ZDD_GETINDEX(a) > ZDD_GETINDEX(b)) cache_prefetch3(CACHE_ZDD_AND, b, a, 0);
+    else cache_prefetch3(CACHE_ZDD_AND, a, b, 0);
+}
+
 /**
  * Implementation of the AND operator for Boolean ZDDs
  */
@@ -1182,6 +1204,12 @@ TASK_IMPL_2(ZDD, zdd_and, ZDD, a, ZDD, b)
         ZDD b0 = minvar < b_var ? b : zddnode_low(b, b_node);
         ZDD b1 = minvar < b_var ? zdd_false : zddnode_high(b, b_node);
 
+        /**
+         * Prefetch the nodes and cache buckets of the recursive calls
+         */
+        zdd_and_prefetch(a1, b1);
+        zdd_and_prefetch(a0, b0);
+
         /**
          * Now we call recursive tasks
          */
@@ -1317,6 +1345,18 @@ TASK_IMPL_4(ZDD, zdd_ite, ZDD, a, ZDD, b, ZDD, c, ZDD, dom)
     return result;
 }
 
+/**
+ * Prefetch the nodes and the cache bucket that the recursive call or(a,b) reads first.
+ */
+static inline void
+zdd_or_prefetch(ZDD a, ZDD b)
+{
+    if (a == zdd_false || b == zdd_false || a == b) return;
+    ZDD_PREFETCH(a);
+    ZDD_PREFETCH(b);
+    cache_prefetch3(CACHE_ZDD_OR, a, b, 0);
+}
+
 /**
  * Implementation of the OR operator for Boolean ZDDs
  */
@@ -1368,6 +1408,12 @@ TASK_IMPL_2(ZDD, zdd_or, ZDD, a, ZDD, b)
     ZDD b0 = minvar < b_var ? b : zddnode_low(b, b_node);
     ZDD b1 = minvar < b_var ? zdd_false : zddnode_high(b, b_node);
 
+    /**
+     * Prefetch the nodes and cache buckets of the recursive calls
+     */
+    zdd_or_prefetch(a1, b1);
+    zdd_or_prefetch(a0, b0);
+
     /**
      * Now we call recursive tasks
      */
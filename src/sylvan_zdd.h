@@ -129,13 +129,13 @@ ZDD zdd_nithvar(uint32_t var);
  * Convert an MTBDD to a ZDD.
  */
 TASK_DECL_2(ZDD, zdd_from_mtbdd, MTBDD, MTBDD);
-#define zdd_from_mtbdd(dd, domain) RUN(zdd_from_mtbdd, dd, domain)
+#define zdd_from_mtbdd(dd, domain) SYLVAN_TRACE_RUN(ZDD, zdd_from_mtbdd, dd, domain)
 
 /**
  * Convert a ZDD to an MTBDD.
  */
 TASK_DECL_2(MTBDD, zdd_to_mtbdd, ZDD, ZDD);
-#define zdd_to_mtbdd(dd, domain) RUN(zdd_to_mtbdd, dd, domain)
+#define zdd_to_mtbdd(dd, domain) SYLVAN_TRACE_RUN(MTBDD, zdd_to_mtbdd, dd, domain)
 
 /**
  * Create a variable set, represented as the function that evaluates
@@ -258,9 +258,10 @@ TASK_DECL_1(double, zdd_pathcount, ZDD);
 
 /**
  * Count the number of nodes (internal nodes plus leaves) in ZDDs.
- * Not thread-safe.
+ * Counting is done in parallel and does not modify the nodes, so it is safe while other operations run.
  */
-size_t zdd_nodecount(const ZDD *dds, size_t count);
+TASK_DECL_2(size_t, zdd_nodecount, const ZDD*, size_t);
+#define zdd_nodecount(dds, count) RUN(zdd_nodecount, dds, count)
 
 static inline size_t
 zdd_nodecount_one(const ZDD dd)
@@ -273,31 +274,31 @@ zdd_nodecount_one(const ZDD dd)
  * Assuming f, g, h are all Boolean and on the same domain <dom>.
  */
 TASK_DECL_4(ZDD, zdd_ite, ZDD, ZDD, ZDD, ZDD);
-#define zdd_ite(f, g, h, dom) RUN(zdd_ite, f, g, h, dom)
+#define zdd_ite(f, g, h, dom) SYLVAN_TRACE_RUN(ZDD, zdd_ite, f, g, h, dom)
 
 /**
  * Compute the negation of a ZDD w.r.t. the given domain.
  */
 TASK_DECL_2(ZDD, zdd_not, ZDD, ZDD);
-#define zdd_not(dd, domain) RUN(zdd_not, dd, domain)
+#define zdd_not(dd, domain) SYLVAN_TRACE_RUN(ZDD, zdd_not, dd, domain)
 
 /**
  * Compute logical AND of <a> and <b>.
  */
 TASK_DECL_2(ZDD, zdd_and, ZDD, ZDD);
-#define zdd_and(a, b) RUN(zdd_and, a, b)
+#define zdd_and(a, b) SYLVAN_TRACE_RUN(ZDD, zdd_and, a, b)
 
 /**
  * Compute logical OR of <a> and <b>.
  */
 TASK_DECL_2(ZDD, zdd_or, ZDD, ZDD);
-#define zdd_or(a, b) RUN(zdd_or, a, b)
+#define zdd_or(a, b) SYLVAN_TRACE_RUN(ZDD, zdd_or, a, b)
 
 /**
  * Compute logical DIFF of <a> and <b>. (set minus)
  */
 TASK_DECL_2(ZDD, zdd_diff, ZDD, ZDD);
-#define zdd_diff(a, b) RUN(zdd_diff, a, b)
+#define zdd_diff(a, b) SYLVAN_TRACE_RUN(ZDD, zdd_diff, a, b)
 
 /**
  * Compute logical XOR of <a> and <b>.
@@ -338,14 +339,14 @@ TASK_DECL_2(ZDD, zdd_diff, ZDD, ZDD);
  * (Stays in same variable domain.)
  */
 TASK_DECL_2(ZDD, zdd_exists, ZDD, ZDD);
-#define zdd_exists(dd, vars) RUN(zdd_exists, dd, vars)
+#define zdd_exists(dd, vars) SYLVAN_TRACE_RUN(ZDD, zdd_exists, dd, vars)
 
 /**
  * Project <dd> onto <domain>, existentially quantifying variables not in the domain.
  * (Changes to the new variable domain.)
  */
 TASK_DECL_2(ZDD, zdd_project, ZDD, ZDD);
-#define zdd_project(dd, domain) RUN(zdd_project, dd, domain)
+#define zdd_project(dd, domain) SYLVAN_TRACE_RUN(ZDD, zdd_project, dd, domain)
 
 /**
  * Compute \forall <vars>: <dd>.
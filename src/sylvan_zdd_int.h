@@ -77,6 +77,12 @@ ZDD_GETNODE(ZDD dd)
     return (zddnode_t)llmsset_index_to_ptr(nodes, dd & 0x000000ffffffffff);
 }
 
+static inline void __attribute__((unused))
+ZDD_PREFETCH(ZDD dd)
+{
+    llmsset_prefetch(nodes, dd & 0x000000ffffffffff);
+}
+
 static inline int
 ZDD_HASMARK(ZDD dd)
 {
@@ -12,6 +12,7 @@
 #include "sylvan.h"
 #include "test_assert.h"
 #include "sylvan_int.h"
+#include "sylvan_sl.h"
 
 __thread uint64_t seed = 1;
 
@@ -255,6 +256,166 @@ test_cube()
     return 0;
 }
 
+static int
+test_and_n()
+{
+    // clauses of 3 literals over 16 variables, with some duplicates
+    BDD clauses[80];
+    for (int i=0; i<80; i++) {
+        if (i > 0 && rng(0, 8) == 0) {
+            clauses[i] = clauses[rng(0, i)];
+            continue;
+        }
+        BDD c = sylvan_false;
+        for (int j=0; j<3; j++) c = sylvan_or(c, rng(0, 2) ? sylvan_ithvar(rng(0, 16)) : sylvan_nithvar(rng(0, 16)));
+        clauses[i] = c;
+    }
+
+    const size_t sizes[] = {0, 1, 2, 3, 10, 32, 33, 80};
+    for (int k=0; k<8; k++) {
+        size_t n = sizes[k];
+        BDD conj = sylvan_true, disj = sylvan_false;
+        for (size_t i=0; i<n; i++) {
+            conj = sylvan_and(conj, clauses[i]);
+            disj = sylvan_or(disj, sylvan_not(clauses[i]));
+        }
+        test_assert(sylvan_and_n(clauses, n) == conj);
+        BDD negated[80];
+        for (size_t i=0; i<n; i++) negated[i] = sylvan_not(clauses[i]);
+        test_assert(sylvan_or_n(negated, n) == disj);
+    }
+
+    // constants and complementary operands
+    BDD ops[4] = {sylvan_true, clauses[0], sylvan_true, clauses[1]};
+    test_assert(sylvan_and_n(ops, 4) == sylvan_and(clauses[0], clauses[1]));
+    ops[2] = sylvan_not(clauses[0]);
+    test_assert(sylvan_and_n(ops, 4) == sylvan_false);
+    test_assert(sylvan_or_n(ops, 4) == sylvan_true);
+    test_assert(sylvan_or_n(ops, 0) == sylvan_false);
+
+    return 0;
+}
+
+/* Counts the levels, and stops after <*context> levels if that is not 0 */
+TASK_4(int, test_reach_level, int, level, BDD, visited, BDD, fresh, void*, context)
+{
+    int *stop = (int*)context;
+    (void)visited;
+    (void)fresh;
+    return *stop != 0 && level >= *stop;
+}
+
+static int
+test_reach()
+{
+    // three bits on the variables 0, 2 and 4, that can each be set once
+    BDD rels[3];
+    BDDSET vars[3];
+    for (int i=0; i<3; i++) {
+        rels[i] = sylvan_and(sylvan_nithvar(2*i), sylvan_ithvar(2*i+1));
+        uint32_t v[2] = {2*i, 2*i+1};
+        vars[i] = sylvan_set_fromarray(v, 2);
+    }
+    uint32_t sv[3] = {0, 2, 4};
+    BDDSET statevars = sylvan_set_fromarray(sv, 3);
+    BDD initial = sylvan_and(sylvan_nithvar(0), sylvan_and(sylvan_nithvar(2), sylvan_nithvar(4)));
+    BDD all_set = sylvan_and(sylvan_ithvar(0), sylvan_and(sylvan_ithvar(2), sylvan_ithvar(4)));
+
+    const int expected_levels[4] = {4, 4, 1, 2};
+    for (int s=0; s<4; s++) {
+        sylvan_reach_opts_t opts = sylvan_reach_opts_make((sylvan_reach_strategy_t)s);
+        opts.check_deadlocks = 1;
+        test_assert(sylvan_reach(initial, rels, vars, 3, &opts) == sylvan_true);
+        test_assert(opts.deadlocks == all_set);
+        test_assert(opts.levels == expected_levels[s]);
+
+        opts = sylvan_reach_opts_make((sylvan_reach_strategy_t)s);
+        opts.simplify_frontier = 1;
+        test_assert(sylvan_reach(initial, rels, vars, 3, &opts) == sylvan_true);
+        test_assert(opts.deadlocks == sylvan_false);
+    }
+    test_assert(sylvan_reach(initial, rels, vars, 3, NULL) == sylvan_true);
+
+    // stopping after the first level: the states with at most one bit set
+    int stop = 1;
+    sylvan_reach_opts_t opts = sylvan_reach_opts_make(SYLVAN_REACH_BFS);
+    opts.level_cb = test_reach_level_CALL;
+    opts.context = &stop;
+    BDD first = sylvan_reach(initial, rels, vars, 3, &opts);
+    test_assert(opts.levels == 1);
+    test_assert(sylvan_satcount(first, statevars) == 4.0);
+    stop = 0;
+    test_assert(sylvan_reach(initial, rels, vars, 3, &opts) == sylvan_true);
+    test_assert(opts.levels == 4);
+
+    // without partitions, every initial state is a deadlock
+    opts = sylvan_reach_opts_make(SYLVAN_REACH_SAT);
+    opts.check_deadlocks = 1;
+    test_assert(sylvan_reach(initial, rels, vars, 0, &opts) == initial);
+    test_assert(opts.deadlocks == initial);
+
+    return 0;
+}
+
+static int
+test_image()
+{
+    // four bits x0..x3 on the variables 0, 2, 4, 6, with next state variables 1, 3, 5, 7
+    BDD x[4], y[4];
+    for (int i=0; i<4; i++) {
+        x[i] = sylvan_ithvar(2*i);
+        y[i] = sylvan_ithvar(2*i+1);
+    }
+    uint32_t sv[4] = {0, 2, 4, 6};
+    BDDSET statevars = sylvan_set_fromarray(sv, 4);
+
+    // the conjunctively partitioned relation and the monolithic one
+    BDD clusters[4];
+    clusters[0] = sylvan_equiv(y[1], x[0]);
+    clusters[1] = sylvan_equiv(y[2], x[1]);
+    clusters[2] = sylvan_equiv(y[3], sylvan_xor(x[2], x[3]));
+    clusters[3] = sylvan_equiv(y[0], sylvan_not(x[3]));
+    BDD rel = sylvan_and_n(clusters, 4);
+    BDDMAP rename = sylvan_map_empty();
+    for (int i=0; i<4; i++) rename = sylvan_map_add(rename, 2*i+1, x[i]);
+
+    const size_t thresholds[3] = {0, 1, 1000};
+    for (int t=0; t<3; t++) {
+        sylvan_image_t *img = sylvan_image_make(clusters, 4, statevars, thresholds[t]);
+        test_assert(img->n == (t == 2 ? 1 : 4));
+        for (int k=0; k<10; k++) {
+            // a random set of states
+            BDD set = sylvan_false;
+            for (int c=0; c<4; c++) {
+                BDD cube = sylvan_true;
+                for (int i=0; i<4; i++) cube = sylvan_and(cube, rng(0, 2) ? x[i] : sylvan_not(x[i]));
+                set = sylvan_or(set, cube);
+            }
+            BDD expected = sylvan_compose(sylvan_and_exists(set, rel, statevars), rename);
+            test_assert(sylvan_image_next(img, set) == expected);
+        }
+        sylvan_image_free(img);
+    }
+
+    // clustering the partitions of a disjunctively partitioned relation
+    BDD rels[3];
+    BDDSET vars[3];
+    for (int i=0; i<3; i++) {
+        rels[i] = sylvan_and(sylvan_not(x[i]), y[i]);
+        uint32_t v[2] = {2*i, 2*i+1};
+        vars[i] = sylvan_set_fromarray(v, 2);
+    }
+    BDD initial = sylvan_and(sylvan_not(x[0]), sylvan_and(sylvan_not(x[1]), sylvan_not(x[2])));
+    BDD succ = sylvan_false;
+    for (int i=0; i<3; i++) succ = sylvan_or(succ, sylvan_relnext(initial, rels[i], vars[i]));
+    test_assert(sylvan_cluster_union(rels, vars, 3, 0) == 3);
+    test_assert(sylvan_cluster_union(rels, vars, 3, SIZE_MAX) == 1);
+    test_assert(sylvan_relnext(initial, rels[0], vars[0]) == succ);
+    test_assert(sylvan_reach(initial, rels, vars, 1, NULL) == sylvan_true);
+
+    return 0;
+}
+
 static int
 test_operators()
 {
@@ -401,6 +562,60 @@ test_relprod()
     return 0;
 }
 
+static int
+test_relprod_map()
+{
+    // state variables s[i] and next state variables t[i], interleaved, in blocks and reversed
+    uint32_t s[4][6], t[4][6];
+    for (int i=0; i<6; i++) {
+        s[0][i] = 2*i; t[0][i] = 2*i+1;
+        s[1][i] = i; t[1][i] = 6+i;
+        s[2][i] = 6+i; t[2][i] = i;
+        s[3][i] = i; t[3][i] = 11-i;
+    }
+
+    for (int k=0; k<4; k++) {
+        BDDMAP map = sylvan_relmap_fromarrays(s[k], t[k], 6);
+        BDDMAP rename = sylvan_map_empty(), rename_back = sylvan_map_empty();
+        for (int i=0; i<6; i++) {
+            rename = sylvan_map_add(rename, s[k][i], sylvan_ithvar(t[k][i]));
+            rename_back = sylvan_map_add(rename_back, t[k][i], sylvan_ithvar(s[k][i]));
+        }
+        test_assert(sylvan_relmap_frommap(rename) == map);
+        uint32_t sorted_s[6], sorted_t[6];
+        for (int i=0; i<6; i++) {
+            sorted_s[i] = k == 2 ? 6+i : (k == 0 ? 2*i : i);
+            sorted_t[i] = k == 2 ? i : (k == 0 ? 2*i+1 : 6+i);
+        }
+        BDDSET svars = sylvan_set_fromarray(sorted_s, 6);
+        BDDSET tvars = sylvan_set_fromarray(sorted_t, 6);
+
+        // a random relation and a random set of states
+        BDD rel = make_random(0, 12);
+        BDD set = sylvan_false;
+        for (int c=0; c<6; c++) {
+            uint8_t cube[6];
+            for (int i=0; i<6; i++) cube[i] = rng(0, 3);
+            set = sylvan_union_cube(set, svars, cube);
+        }
+
+        BDD next = sylvan_compose(sylvan_and_exists(set, rel, svars), rename_back);
+        test_assert(sylvan_relnext_map(set, rel, map) == next);
+        if (k < 3) {
+            // relprev needs a map that keeps the order of the variables
+            BDD prev = sylvan_and_exists(rel, sylvan_compose(set, rename), tvars);
+            test_assert(sylvan_relprev_map(rel, set, map) == prev);
+        }
+        if (k == 0) {
+            BDDSET all = sylvan_set_addall(svars, tvars);
+            test_assert(sylvan_relnext_map(set, rel, map) == sylvan_relnext(set, rel, all));
+            test_assert(sylvan_relprev_map(rel, set, map) == sylvan_relprev(rel, set, all));
+        }
+    }
+
+    return 0;
+}
+
 int
 test_compose()
 {
@@ -446,9 +661,723 @@ test_compose()
     return 0;
 }
 
+int
+test_rename()
+{
+    BDD bdd = make_random(0, 16);
+    MTBDD mtbdd = mtbdd_ite(make_random(0, 16), mtbdd_int64(3), mtbdd_ite(bdd, mtbdd_int64(5), mtbdd_int64(7)));
+
+    // shift all variables (keeps the order)
+    BDDMAP map = sylvan_map_empty();
+    for (int i=0; i<16; i++) map = sylvan_map_add(map, i, sylvan_ithvar(i+16));
+    BDD result = sylvan_rename(bdd, map);
+    test_assert(testEqual(result, sylvan_compose(bdd, map)));
+    test_assert(sylvan_nodecount(result) == sylvan_nodecount(bdd));
+    test_assert(testEqual(sylvan_rename(sylvan_not(bdd), map), sylvan_not(result)));
+    test_assert(mtbdd_rename(mtbdd, map) == mtbdd_compose(mtbdd, map));
+
+    // a random permutation of the variables (does not keep the order)
+    uint32_t perm[16];
+    for (int i=0; i<16; i++) perm[i] = i;
+    for (int i=15; i>0; i--) {
+        int j = rng(0, i+1);
+        uint32_t tmp = perm[i];
+        perm[i] = perm[j];
+        perm[j] = tmp;
+    }
+    map = sylvan_map_empty();
+    for (int i=0; i<16; i++) map = sylvan_map_add(map, i, sylvan_ithvar(perm[i]));
+    test_assert(testEqual(sylvan_rename(bdd, map), sylvan_compose(bdd, map)));
+    test_assert(mtbdd_rename(mtbdd, map) == mtbdd_compose(mtbdd, map));
+
+    // renaming some variables
+    map = sylvan_map_add(sylvan_map_empty(), 3, sylvan_ithvar(12));
+    map = sylvan_map_add(map, 12, sylvan_ithvar(3));
+    test_assert(testEqual(sylvan_rename(bdd, map), sylvan_compose(bdd, map)));
+    test_assert(mtbdd_rename(mtbdd, map) == mtbdd_compose(mtbdd, map));
+
+    return 0;
+}
+
+static int
+test_refs()
+{
+    BDD vars = sylvan_set_fromarray((uint32_t[]){0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15}, 16);
+    sylvan_protect(&vars);
+    BDD a = make_random(0, 16); // referenced
+    double count = sylvan_satcount(a, vars);
+    size_t before = mtbdd_count_refs();
+
+    // more than fit in one buffer of deferred updates
+    for (uint32_t i=100; i<3100; i++) sylvan_ref(sylvan_ithvar(i));
+    test_assert(mtbdd_count_refs() == before + 3000);
+    for (uint32_t i=100; i<3100; i+=2) sylvan_deref(sylvan_ithvar(i));
+    test_assert(mtbdd_count_refs() == before + 1500);
+
+    // only the net change is applied
+    sylvan_ref(a);
+    sylvan_ref(a);
+    sylvan_deref(a);
+    sylvan_deref(a);
+
+    // deferred updates are applied before marking
+    sylvan_gc_enable();
+    sylvan_gc();
+    sylvan_gc_disable();
+    test_assert(sylvan_satcount(a, vars) == count);
+    test_assert(mtbdd_count_refs() == before + 1500);
+
+    sylvan_deref(a);
+    for (uint32_t i=101; i<3100; i+=2) sylvan_deref(sylvan_ithvar(i));
+    test_assert(mtbdd_count_refs() == before - (a != sylvan_true && a != sylvan_false));
+    sylvan_unprotect(&vars);
+    return 0;
+}
+
+static BDD protect_slots[1000];
+
+static void*
+protect_thread(void *arg)
+{
+    // the second half stays protected when the thread exits
+    for (int i=0; i<1000; i++) sylvan_protect(protect_slots + i);
+    for (int i=0; i<500; i++) sylvan_unprotect(protect_slots + i);
+    (void)arg;
+    return NULL;
+}
+
+static int
+test_protect()
+{
+    size_t before = mtbdd_count_protected();
+
+    // more than fit in a root segment, unprotected in FIFO order
+    for (int i=0; i<1000; i++) sylvan_protect(protect_slots + i);
+    test_assert(mtbdd_count_protected() == before + 1000);
+    for (int i=0; i<1000; i++) sylvan_unprotect(protect_slots + i);
+    test_assert(mtbdd_count_protected() == before);
+
+    // protected by another thread, unprotected here
+    pthread_t t;
+    test_assert(pthread_create(&t, NULL, protect_thread, NULL) == 0);
+    pthread_join(t, NULL);
+    test_assert(mtbdd_count_protected() == before + 500);
+    for (int i=500; i<1000; i++) sylvan_unprotect(protect_slots + i);
+    test_assert(mtbdd_count_protected() == before);
+
+    // protected nodes survive garbage collection
+    BDD vars = sylvan_set_fromarray((uint32_t[]){0,1,2,3,4,5,6,7}, 8);
+    sylvan_protect(&vars);
+    for (int i=0; i<8; i++) {
+        protect_slots[i] = sylvan_cube(vars, (uint8_t[]){i&1, (i>>1)&1, (i>>2)&1, 2, 2, 1, 0, 2});
+        sylvan_protect(protect_slots + i);
+    }
+    sylvan_gc_enable();
+    sylvan_gc();
+    sylvan_gc_disable();
+    for (int i=0; i<8; i++) {
+        test_assert(sylvan_satcount(protect_slots[i], vars) == 8.0);
+        test_assert(protect_slots[i] == sylvan_cube(vars, (uint8_t[]){i&1, (i>>1)&1, (i>>2)&1, 2, 2, 1, 0, 2}));
+        sylvan_unprotect(protect_slots + i);
+    }
+    sylvan_unprotect(&vars);
+    test_assert(mtbdd_count_protected() == before);
+    return 0;
+}
+
+static int
+test_nodecount()
+{
+    BDD a = sylvan_ithvar(1);
+    BDD b = sylvan_ithvar(2);
+    test_assert(sylvan_nodecount(a) == 2);
+    test_assert(sylvan_nodecount(sylvan_and(a, b)) == 3);
+    BDD arr[2] = {a, sylvan_or(a, b)};
+    test_assert(mtbdd_nodecount_more(arr, 2) == 4);
+
+    MTBDD leaves = mtbdd_ite(b, mtbdd_int64(2), mtbdd_int64(1));
+    leaves = mtbdd_ite(a, mtbdd_int64(1), leaves);
+    test_assert(mtbdd_leafcount(leaves) == 2);
+    test_assert(mtbdd_nodecount(leaves) == 4);
+
+    // counting does not leave marks behind: counting twice gives the same result
+    BDD one = make_random(0, 12);
+    size_t count = sylvan_nodecount(one);
+    test_assert(count >= 1);
+    test_assert(sylvan_nodecount(one) == count);
+
+    MDD m = lddmc_cube((uint32_t[]){1,2,3}, 3);
+    test_assert(lddmc_nodecount(m) == 3);
+    m = lddmc_union_cube(m, (uint32_t[]){1,2,4}, 3);
+    test_assert(lddmc_nodecount(m) == 4);
+
+    return 0;
+}
+
+static int
+test_seqcutoff()
+{
+    BDD one = make_random(0, 16);
+    BDD two = make_random(4, 20);
+    BDD three = make_random(2, 18);
+    MDD set1 = make_random_ldd_set(6, 10, 30);
+    MDD set2 = make_random_ldd_set(6, 10, 30);
+
+    BDD and_par = sylvan_and(one, two);
+    BDD xor_par = sylvan_xor(one, two);
+    BDD ite_par = sylvan_ite(one, two, three);
+    MDD union_par = lddmc_union(set1, set2);
+
+    // compute again, with the bottom levels computed without spawning
+    for (uint32_t level=0; level<20; level+=5) {
+        sylvan_clear_cache();
+        sylvan_set_seqcutoff(level);
+        test_assert(sylvan_get_seqcutoff() == level);
+        test_assert(testEqual(sylvan_and(one, two), and_par));
+        test_assert(testEqual(sylvan_xor(one, two), xor_par));
+        test_assert(testEqual(sylvan_ite(one, two, three), ite_par));
+        test_assert(lddmc_union(set1, set2) == union_par);
+    }
+
+    sylvan_set_seqcutoff(0xffffffff);
+    return 0;
+}
+
+static int
+test_stats()
+{
+    BDD one = make_random(0, 16);
+    BDD two = make_random(4, 20);
+    sylvan_stats_t stats;
+
+    int was_enabled = sylvan_stats_is_enabled();
+
+    // nothing is counted while statistics are disabled
+    sylvan_stats_disable();
+    sylvan_stats_reset();
+    sylvan_clear_cache();
+    sylvan_and(one, two);
+    sylvan_stats_snapshot(&stats);
+    test_assert(stats.counters[BDD_AND] == 0);
+
+    // counting resumes after enabling statistics
+    sylvan_stats_enable();
+    test_assert(sylvan_stats_is_enabled());
+    sylvan_clear_cache();
+    sylvan_and(one, two);
+    sylvan_stats_snapshot(&stats);
+    test_assert(stats.counters[BDD_AND] > 0);
+
+    sylvan_stats_reset();
+    sylvan_stats_snapshot(&stats);
+    test_assert(stats.counters[BDD_AND] == 0);
+
+    if (!was_enabled) sylvan_stats_disable();
+    return 0;
+}
+
+static void*
+trace_thread(void *arg)
+{
+    (void)arg;
+    sylvan_trace_instant("other");
+    return NULL;
+}
+
+static int
+test_trace()
+{
+    BDD one = make_random(0, 16);
+    BDD two = make_random(4, 20);
+
+    sylvan_trace_enable(64);
+    sylvan_clear_cache();
+    for (int i=0; i<100; i++) sylvan_and(one, two); // more events than fit in the ring buffer
+    sylvan_trace_instant("marker");
+    // events of threads that are not Lace workers are recorded too
+    pthread_t thread;
+    test_assert(pthread_create(&thread, NULL, trace_thread, NULL) == 0);
+    pthread_join(thread, NULL);
+    sylvan_trace_disable();
+    sylvan_and(one, two); // not recorded
+
+    char buf[65536];
+    FILE *f = tmpfile();
+    sylvan_trace_write(f);
+    rewind(f);
+    buf[fread(buf, 1, sizeof(buf)-1, f)] = 0;
+    fclose(f);
+
+    test_assert(strstr(buf, "\"traceEvents\"") != NULL);
+    test_assert(strstr(buf, "\"name\":\"marker\",\"ph\":\"i\"") != NULL);
+    test_assert(strstr(buf, "\"name\":\"other\",\"ph\":\"i\"") != NULL);
+    int count = 0;
+    for (char *p = strstr(buf, "\"sylvan_and\""); p != NULL; p = strstr(p+1, "\"sylvan_and\"")) count++;
+    test_assert(count == 63); // the ring buffer keeps the last 64 events
+    return 0;
+}
+
+static int
+test_table_telemetry()
+{
+    sylvan_stats_t stats;
+    sylvan_stats_enable();
+    sylvan_stats_reset();
+    BDD bdd = make_random(0, 16);
+    sylvan_stats_snapshot(&stats);
+    sylvan_stats_disable();
+
+    // every lookup is counted once in the probe histogram
+    uint64_t lookups = 0;
+    for (int i=LLMSSET_PROBE_1; i<=LLMSSET_PROBE_MORE; i++) lookups += stats.counters[i];
+    test_assert(lookups > 0);
+    test_assert(lookups >= stats.counters[BDD_NODES_CREATED] + stats.counters[BDD_NODES_REUSED]);
+
+    uint64_t fill[LLMSSET_FILL_BUCKETS];
+    size_t claimed = llmsset_region_fill(nodes, fill);
+    uint64_t regions = 0;
+    for (int i=0; i<LLMSSET_FILL_BUCKETS; i++) regions += fill[i];
+    test_assert(regions == llmsset_get_size(nodes) / 512);
+    test_assert(claimed > 0 && claimed <= regions);
+    test_assert(llmsset_get_threshold(nodes) > 0);
+
+    (void)bdd;
+    return 0;
+}
+
+static int
+test_memory()
+{
+    sylvan_memory_t before, mem;
+    sylvan_memory_usage(&before);
+    test_assert(before.committed[SYLVAN_MEM_NODES] > 0);
+    test_assert(before.committed[SYLVAN_MEM_NODES] <= before.reserved[SYLVAN_MEM_NODES]);
+    test_assert(before.committed[SYLVAN_MEM_CACHE] > 0);
+    test_assert(before.committed[SYLVAN_MEM_REFS] > 0);
+    test_assert(before.committed[SYLVAN_MEM_REFS_STACKS] > 0);
+    test_assert(before.committed[SYLVAN_MEM_INSTRUMENTATION] > 0);
+
+    // serialization sets are counted until they are reset
+    BDD bdd = make_random(0, 16);
+    sylvan_serialize_reset();
+    sylvan_serialize_add(bdd);
+    sylvan_memory_usage(&mem);
+    test_assert(mem.committed[SYLVAN_MEM_SERIALIZE] > before.committed[SYLVAN_MEM_SERIALIZE]);
+    sylvan_serialize_reset();
+    sylvan_memory_usage(&mem);
+    test_assert(mem.committed[SYLVAN_MEM_SERIALIZE] == 0);
+
+    // skiplists
+    sylvan_skiplist_t sl = sylvan_skiplist_alloc(1024);
+    sylvan_memory_usage(&mem);
+    test_assert(mem.committed[SYLVAN_MEM_SKIPLIST] >= before.committed[SYLVAN_MEM_SKIPLIST] + 1024);
+    sylvan_skiplist_free(sl);
+    sylvan_memory_usage(&mem);
+    test_assert(mem.committed[SYLVAN_MEM_SKIPLIST] == before.committed[SYLVAN_MEM_SKIPLIST]);
+
+    FILE *f = tmpfile();
+    sylvan_memory_write_json(f);
+    char buf[1024];
+    rewind(f);
+    size_t len = fread(buf, 1, sizeof(buf)-1, f);
+    buf[len] = 0;
+    fclose(f);
+    test_assert(strstr(buf, "\"nodes\":{\"committed\":") != NULL);
+    test_assert(strstr(buf, "\"leaf_types\":[") != NULL);
+
+    return 0;
+}
+
+static int
+test_profile()
+{
+    sylvan_profile_enable();
+    BDD a = make_random(0, 16);
+    sylvan_protect(&a);
+    BDD b = make_random(0, 16);
+    sylvan_protect(&b);
+    sylvan_clear_cache();
+    BDD c = sylvan_and(a, b);
+    sylvan_profile_disable();
+    sylvan_unprotect(&a);
+    sylvan_unprotect(&b);
+
+    sylvan_profile_entry_t entries[8];
+    size_t count = sylvan_profile_get(1, entries, 8);
+    test_assert(count >= 1 && count <= 8);
+    int found = 0;
+    for (size_t i=0; i<count; i++) {
+        if (strcmp(entries[i].name, "sylvan_and") == 0) {
+            test_assert(entries[i].calls > 0);
+            test_assert(entries[i].time > 0);
+            test_assert(c == sylvan_false || entries[i].nodes > 0);
+            found = 1;
+        }
+        if (i > 0) test_assert(entries[i-1].nodes >= entries[i].nodes);
+    }
+    test_assert(found);
+
+    count = sylvan_profile_get(0, entries, 8);
+    found = 0;
+    for (size_t i=0; i<count && i<8; i++) {
+        if (strcmp(entries[i].name, "bdd_and") == 0) {
+            test_assert(entries[i].calls >= entries[i].cache_hits);
+            found = 1;
+        }
+    }
+    test_assert(found);
+
+    sylvan_profile_reset();
+    test_assert(sylvan_profile_get(1, entries, 8) == 0);
+    return 0;
+}
+
+static int replayed_ops[SYLVAN_RECORD_OP_COUNT];
+
+static void
+count_replayed(int op, uint64_t index, uint64_t time, uint64_t recorded_time, void *context)
+{
+    replayed_ops[op]++;
+    (void)index; (void)time; (void)recorded_time; (void)context;
+}
+
+static int
+test_record()
+{
+    FILE *f = tmpfile();
+    test_assert(f != NULL);
+
+    BDD a = make_random(0, 16);
+    BDD b = make_random(0, 16);
+    sylvan_record_start(f);
+    BDD c = sylvan_and(a, b);
+    BDD d = sylvan_xor(c, a);
+    MDD x = lddmc_cube((uint32_t[]){1, 2}, 2);
+    MDD y = lddmc_cube((uint32_t[]){3, 4}, 2);
+    MDD z = lddmc_union(x, y);
+    sylvan_record_stop();
+    test_assert(d == sylvan_and(a, sylvan_not(b)));
+    test_assert(lddmc_satcount(z) == 2);
+
+    rewind(f);
+    size_t table_size, table_max, cache_size, cache_max;
+    test_assert(sylvan_replay_sizes(f, &table_size, &table_max, &cache_size, &cache_max) == 0);
+    test_assert(table_size == llmsset_get_size(nodes) && cache_max == cache_getmaxsize());
+    test_assert(ftell(f) == 0);
+
+    memset(replayed_ops, 0, sizeof(replayed_ops));
+    test_assert(sylvan_replay(f, 0, count_replayed, NULL) == 3);
+    test_assert(replayed_ops[SYLVAN_RECORD_BDD_AND] == 1);
+    test_assert(replayed_ops[SYLVAN_RECORD_BDD_XOR] == 1);
+    test_assert(replayed_ops[SYLVAN_RECORD_LDD_UNION] == 1);
+    fclose(f);
+
+    // not a recording
+    f = tmpfile();
+    fputs("not a recording", f);
+    rewind(f);
+    test_assert(sylvan_replay(f, 0, NULL, NULL) == -1);
+    fclose(f);
+    return 0;
+}
+
+static int sample_count[2];
+
+static void
+count_sample(const sylvan_stats_sample_t *sample, void *context)
+{
+    ((int*)context)[sample->at_gc]++;
+}
+
+static int
+test_stats_export()
+{
+    // names and ids
+    for (int i=0; i<SYLVAN_COUNTER_COUNTER; i++) {
+        test_assert(sylvan_stats_counter_name(i) != NULL);
+        test_assert(sylvan_stats_counter_lookup(sylvan_stats_counter_name(i)) == i);
+    }
+    test_assert(sylvan_stats_counter_lookup("bdd_and_cached") == BDD_AND_CACHED);
+    test_assert(sylvan_stats_timer_lookup("gc") == SYLVAN_GC);
+    test_assert(sylvan_stats_counter_lookup("no_such_counter") == -1);
+
+    // snapshots and differences
+    sylvan_stats_t before, after, diff;
+    sylvan_stats_enable();
+    sylvan_stats_snapshot(&before);
+    sylvan_clear_cache();
+    sylvan_and(make_random(0, 16), make_random(4, 20));
+    sylvan_stats_snapshot(&after);
+    sylvan_stats_diff(&diff, &after, &before);
+    test_assert(diff.counters[BDD_AND] > 0);
+    test_assert(diff.counters[BDD_AND] == after.counters[BDD_AND] - before.counters[BDD_AND]);
+    test_assert(sylvan_stats_hitrate(&diff, BDD_AND) <= 1.0);
+
+    // export
+    char buf[16384];
+    FILE *f = tmpfile();
+    sylvan_stats_write_json(f, &diff);
+    rewind(f);
+    buf[fread(buf, 1, sizeof(buf)-1, f)] = 0;
+    fclose(f);
+    test_assert(buf[0] == '{');
+    test_assert(strstr(buf, "\"bdd_and\":") != NULL);
+    test_assert(strstr(buf, "\"timers\":{\"gc\":") != NULL);
+
+    // sampling, both periodically and at garbage collection
+    sample_count[0] = sample_count[1] = 0;
+    sylvan_stats_set_sampler(count_sample, sample_count, 1, 1);
+    sylvan_gc_enable();
+    sylvan_gc();
+    sylvan_gc_disable();
+    usleep(50000);
+    sylvan_stats_set_sampler(NULL, NULL, 0, 0);
+    test_assert(sample_count[1] == 1);
+    test_assert(sample_count[0] > 0);
+
+    // garbage collection phases
+    sylvan_gc_info_t info;
+    sylvan_gc_get_info(&info);
+    test_assert(info.count >= 1);
+    test_assert(info.nodes_after <= info.nodes_before);
+    size_t filled, total;
+    sylvan_table_usage(&filled, &total);
+    test_assert(info.nodes_after == filled);
+    test_assert(info.mark_count > 0 && info.marks[0].name != NULL);
+    test_assert(info.time_total >= info.time_mark + info.time_rehash);
+    uint64_t pauses = 0;
+    for (int i=0; i<SYLVAN_GC_HISTOGRAM_SIZE; i++) pauses += info.histogram[i];
+    test_assert(pauses == info.count);
+
+    // without statistics, the nodes before are not counted
+    sylvan_stats_disable();
+    sylvan_gc_enable();
+    sylvan_gc();
+    sylvan_gc_disable();
+    sylvan_gc_get_info(&info);
+    test_assert(info.nodes_before == 0 && info.nodes_after > 0);
+    return 0;
+}
+
+/* Operands and futures of the submitting threads of test_submit */
+static BDD submit_vars[16];
+static sylvan_future_t *submit_futures[4][100];
+
+TASK_4(MTBDD, submit_custom, MTBDD, a, MTBDD, b, MTBDD, c, void*, context)
+{
+    (void)context;
+    return CALL(sylvan_ite, a, b, c, 0);
+}
+
+static sylvan_op_t
+submit_op(int k, int i)
+{
+    BDD a = submit_vars[(k + i) % 16], b = submit_vars[(3 * i + 1) % 16], c = submit_vars[(i * 7) % 16];
+    switch (i % 4) {
+    case 0: return sylvan_op_make(SYLVAN_OP_AND, a, sylvan_or(b, c), sylvan_false);
+    case 1: return sylvan_op_make(SYLVAN_OP_XOR, a, sylvan_and(b, c), sylvan_false);
+    case 2: return sylvan_op_make(SYLVAN_OP_EXISTS, sylvan_and(a, sylvan_or(b, c)), sylvan_and(b, c), sylvan_false);
+    default: {
+        sylvan_op_t op = sylvan_op_make(SYLVAN_OP_TASK, a, b, c);
+        op.task = submit_custom_CALL;
+        return op;
+    }
+    }
+}
+
+static void*
+submit_thread(void *arg)
+{
+    const int k = (int)(size_t)arg;
+    for (int i=0; i<100; i++) {
+        sylvan_op_t op = submit_op(k, i);
+        submit_futures[k][i] = sylvan_submit(&op);
+    }
+    for (int i=0; i<100; i++) sylvan_future_wait(submit_futures[k][i]);
+    return NULL;
+}
+
+/* Called from main, outside Lace workers */
+static int
+test_submit()
+{
+    size_t before = mtbdd_count_protected();
+    for (int i=0; i<16; i++) {
+        submit_vars[i] = sylvan_ithvar(i);
+        sylvan_protect(submit_vars + i);
+    }
+
+    // four threads submit at the same time
+    pthread_t t[4];
+    for (int k=0; k<4; k++) test_assert(pthread_create(t + k, NULL, submit_thread, (void*)(size_t)k) == 0);
+    for (int k=0; k<4; k++) pthread_join(t[k], NULL);
+
+    // the results are protected until the futures are freed
+    sylvan_gc();
+    for (int k=0; k<4; k++) {
+        for (int i=0; i<100; i++) {
+            sylvan_op_t op = submit_op(k, i);
+            test_assert(sylvan_future_done(submit_futures[k][i]));
+            test_assert(sylvan_future_get(submit_futures[k][i]) == sylvan_op_run(&op));
+            sylvan_future_free(submit_futures[k][i]);
+        }
+    }
+
+    for (int i=0; i<16; i++) sylvan_unprotect(submit_vars + i);
+    test_assert(mtbdd_count_protected() == before);
+    return 0;
+}
+
+TASK_4(MTBDD, batch_gc, MTBDD, a, MTBDD, b, MTBDD, c, void*, context)
+{
+    (void)b;
+    (void)c;
+    (void)context;
+    CALL(sylvan_gc);
+    return a;
+}
+
+/* Called from main, with garbage collection enabled */
+static int
+test_batch()
+{
+    BDD dd[40];
+    for (int i=0; i<40; i++) dd[i] = make_random(0, 10);
+    BDD vars = sylvan_ref(sylvan_and(sylvan_ithvar(2), sylvan_ithvar(5)));
+
+    sylvan_op_t ops[200];
+    BDD results[200];
+    for (int i=0; i<200; i++) {
+        BDD a = dd[i % 40], b = dd[(7 * i + 3) % 40];
+        switch (i % 5) {
+        case 0: ops[i] = sylvan_op_make(SYLVAN_OP_AND, a, b, sylvan_false); break;
+        case 1: ops[i] = sylvan_op_make(SYLVAN_OP_OR, a, b, sylvan_false); break;
+        case 2: ops[i] = sylvan_op_make(SYLVAN_OP_XOR, a, b, sylvan_false); break;
+        case 3: ops[i] = sylvan_op_make(SYLVAN_OP_EXISTS, a, vars, sylvan_false); break;
+        default: ops[i] = sylvan_op_make(SYLVAN_OP_ITE, a, b, dd[(i + 1) % 40]); break;
+        }
+    }
+    // a garbage collection during the batch
+    ops[0] = sylvan_op_make(SYLVAN_OP_TASK, dd[0], sylvan_false, sylvan_false);
+    ops[0].task = batch_gc_CALL;
+
+    sylvan_clear_cache();
+    sylvan_batch(ops, results, 200);
+    // the results of the other operations survived the garbage collection
+    test_assert(results[0] == dd[0]);
+    for (int i=1; i<200; i++) test_assert(results[i] == sylvan_op_run(&ops[i]));
+
+    // the same operation on every operand
+    sylvan_op_t op = sylvan_op_make(SYLVAN_OP_EXISTS, sylvan_false, vars, sylvan_false);
+    sylvan_batch_each(&op, dd, NULL, NULL, results, 40);
+    for (int i=0; i<40; i++) test_assert(results[i] == sylvan_exists(dd[i], vars));
+
+    for (int i=0; i<40; i++) sylvan_deref(dd[i]);
+    sylvan_deref(vars);
+    return 0;
+}
+
+/* Evaluate <dd> for the assignment <values> to the (reordered) variables */
+static MTBDD
+reorder_eval(MTBDD dd, uint32_t values)
+{
+    while (!mtbdd_isleaf(dd)) {
+        uint32_t var = sylvan_level_to_var(mtbdd_getvar(dd));
+        dd = (values >> var) & 1 ? mtbdd_gethigh(dd) : mtbdd_getlow(dd);
+    }
+    return dd;
+}
+
+static MTBDD reorder_table[2][1<<16];
+
+static int
+reorder_check(BDD eq, BDD rnd, MTBDD mt)
+{
+    for (uint32_t v=0; v<(1<<16); v++) {
+        test_assert(reorder_eval(eq, v) == (((v & 0xff) == (v >> 8)) ? sylvan_true : sylvan_false));
+        test_assert(reorder_eval(rnd, v) == reorder_table[0][v]);
+        test_assert(reorder_eval(mt, v) == reorder_table[1][v]);
+    }
+    return 0;
+}
+
+/* The first test, before LDDs are initialized, with only its own nodes in the table */
+static int
+test_reorder()
+{
+    // x_i = y_i for 8 pairs, with all x before all y: large in this order, small when interleaved
+    BDD eq = sylvan_true, rnd = make_random(0, 16);
+    MTBDD mt = mtbdd_false;
+    sylvan_protect(&eq);
+    sylvan_protect(&mt);
+    for (int i=7; i>=0; i--) eq = sylvan_and(eq, sylvan_not(sylvan_xor(sylvan_ithvar(i), sylvan_ithvar(8+i))));
+    mt = mtbdd_ite(rnd, mtbdd_int64(1), mtbdd_ite(sylvan_ithvar(12), mtbdd_int64(2), mtbdd_int64(3)));
+    for (uint32_t v=0; v<(1<<16); v++) {
+        reorder_table[0][v] = reorder_eval(rnd, v);
+        reorder_table[1][v] = reorder_eval(mt, v);
+    }
+    size_t before = sylvan_nodecount(eq);
+
+    sylvan_levels_init(16);
+    test_assert(sylvan_levels_count() == 16);
+    test_assert(sylvan_var_to_level(20) == 20);
+
+    // one swap, and back
+    test_assert(sylvan_varswap(7));
+    test_assert(sylvan_level_to_var(7) == 8 && sylvan_level_to_var(8) == 7);
+    test_assert(sylvan_var_to_level(7) == 8 && sylvan_var_to_level(8) == 7);
+    if (reorder_check(eq, rnd, mt)) return 1;
+    test_assert(sylvan_varswap(7));
+    test_assert(sylvan_nodecount(eq) == before);
+    if (reorder_check(eq, rnd, mt)) return 1;
+
+    // sifting finds a much better order
+    sylvan_gc();
+    size_t filled = llmsset_count_marked(nodes);
+    test_assert(sylvan_reorder(SYLVAN_REORDER_SIFT));
+    test_assert(llmsset_count_marked(nodes) < filled);
+    test_assert(sylvan_nodecount(eq) < before / 2);
+    if (reorder_check(eq, rnd, mt)) return 1;
+    for (uint32_t l=0; l<16; l++) test_assert(sylvan_var_to_level(sylvan_level_to_var(l)) == l);
+
+    // window permutation never increases the size, and keeps groups together
+    sylvan_levels_group(0, 2);
+    uint32_t first = sylvan_level_to_var(0), second = sylvan_level_to_var(1);
+    filled = llmsset_count_marked(nodes);
+    test_assert(sylvan_reorder(SYLVAN_REORDER_WINDOW2));
+    test_assert(llmsset_count_marked(nodes) <= filled);
+    if (reorder_check(eq, rnd, mt)) return 1;
+    filled = llmsset_count_marked(nodes);
+    test_assert(sylvan_reorder(SYLVAN_REORDER_WINDOW3));
+    test_assert(llmsset_count_marked(nodes) <= filled);
+    if (reorder_check(eq, rnd, mt)) return 1;
+    test_assert(sylvan_var_to_level(second) == sylvan_var_to_level(first) + 1);
+    test_assert(sylvan_reorder(SYLVAN_REORDER_SIFT));
+    test_assert(sylvan_var_to_level(second) == sylvan_var_to_level(first) + 1);
+    if (reorder_check(eq, rnd, mt)) return 1;
+
+    // automatic reordering, requested by garbage collection
+    sylvan_reorder_set_auto(SYLVAN_REORDER_SIFT, 1);
+    test_assert(sylvan_reorder_test() == 0);
+    sylvan_gc();
+    test_assert(sylvan_reorder_test() == 1);
+    test_assert(sylvan_reorder_test() == 0);
+    if (reorder_check(eq, rnd, mt)) return 1;
+    sylvan_reorder_set_auto(SYLVAN_REORDER_SIFT, 0);
+
+    sylvan_unprotect(&eq);
+    sylvan_unprotect(&mt);
+    sylvan_deref(rnd);
+    return 0;
+}
+
 int
 test_ldd()
 {
+    // LDD nodes would be taken for BDD nodes, so reordering is refused
+    test_assert(sylvan_varswap(0) == 0);
+    test_assert(sylvan_reorder(SYLVAN_REORDER_SIFT) == 0);
+
     // very basic testing of makenode
     for (int i=0; i<10; i++) {
         uint32_t value = rng(0, 100);
@@ -555,8 +1484,17 @@ TASK_0(int, runtests)
     for (int j=0;j<10;j++) if (test_cube()) return 1;
     printf("Testing relprod.\n");
     for (int j=0;j<10;j++) if (test_relprod()) return 1;
+    for (int j=0;j<10;j++) if (test_relprod_map()) return 1;
     printf("Testing compose.\n");
     for (int j=0;j<10;j++) if (test_compose()) return 1;
+    printf("Testing rename.\n");
+    for (int j=0;j<10;j++) if (test_rename()) return 1;
+    printf("Testing n-ary conjunction and disjunction.\n");
+    for (int j=0;j<10;j++) if (test_and_n()) return 1;
+    printf("Testing reachability.\n");
+    if (test_reach()) return 1;
+    printf("Testing image computation.\n");
+    if (test_image()) return 1;
     printf("Testing operators.\n");
     for (int j=0;j<10;j++) if (test_operators()) return 1;
     printf("Testing disjoint and subset.\n");
@@ -565,6 +1503,33 @@ TASK_0(int, runtests)
     printf("Testing ldd.\n");
     if (test_ldd()) return 1;
 
+    printf("Testing external references.\n");
+    if (test_refs()) return 1;
+    if (test_protect()) return 1;
+
+    printf("Testing node counting.\n");
+    for (int j=0;j<10;j++) if (test_nodecount()) return 1;
+
+    printf("Testing sequential cut-off.\n");
+    for (int j=0;j<10;j++) if (test_seqcutoff()) return 1;
+
+    printf("Testing statistics switch.\n");
+    if (test_stats()) return 1;
+    if (test_stats_export()) return 1;
+    if (test_table_telemetry()) return 1;
+
+    printf("Testing operation profiler.\n");
+    if (test_profile()) return 1;
+
+    printf("Testing memory accounting.\n");
+    if (test_memory()) return 1;
+
+    printf("Testing tracing.\n");
+    if (test_trace()) return 1;
+
+    printf("Testing recording and replaying.\n");
+    if (test_record()) return 1;
+
     return 0;
 }
 
@@ -578,11 +1543,27 @@ int main()
     sylvan_init_package();
     sylvan_init_bdd();
     sylvan_init_mtbdd();
-    sylvan_init_ldd();
 
     printf("Sylvan initialization complete.\n");
 
-    int res = RUN(runtests);
+    // reordering does not support LDDs, so test it before initializing them
+    printf("Testing dynamic variable reordering.\n");
+    int res = test_reorder();
+
+    if (res == 0) {
+        sylvan_init_ldd();
+        res = RUN(runtests);
+    }
+
+    if (res == 0) {
+        printf("Testing submitting from other threads.\n");
+        res = test_submit();
+    }
+
+    if (res == 0) {
+        printf("Testing batches of operations.\n");
+        res = test_batch();
+    }
 
     sylvan_quit();
     lace_stop();
@@ -3,8 +3,14 @@
  */
 
 #include <assert.h>
+#include <future>
+#include <thread>
+#include <utility>
+#include <vector>
 #include <sylvan.h>
 #include <sylvan_obj.hpp>
+#include <sylvan_mtbdd_ops.hpp>
+#include <string>
 
 #include "test_assert.h"
 
@@ -42,6 +48,132 @@ void test6()
     BddMap m2(m1);  // this triggers an assertion
 }
 
+TASK_0(int, test_move)
+{
+    const size_t protected_before = sylvan_count_protected();
+    {
+        Bdd a = Bdd::bddVar(1), b = Bdd::bddVar(2), c = Bdd::bddVar(3);
+
+        // chains reuse the temporaries
+        Bdd abc = a & b & c;
+        test_assert(abc == (a * (b * c)));
+        test_assert((a | b | c) == !((!a) & (!b) & (!c)));
+        test_assert((a - b - c) == (a & (!b) & (!c)));
+
+        // moved-from objects can be assigned to again
+        Bdd d = std::move(abc);
+        test_assert(d == (a & b & c));
+        abc = a;
+        test_assert(abc == a);
+        Bdd e = std::move(abc);
+        abc = std::move(e);
+        test_assert(abc == a);
+
+        // vectors move their elements when they grow
+        std::vector<Bdd> bdds;
+        for (uint32_t i=0; i<100; i++) bdds.push_back(Bdd::bddVar(i) ^ a);
+        sylvan_gc();
+        test_assert(bdds[42] == (Bdd::bddVar(42) ^ a));
+
+        Mtbdd m = Mtbdd::doubleTerminal(2.0) + Mtbdd::doubleTerminal(3.0) * Mtbdd(std::move(d));
+        Mtbdd n = std::move(m);
+        test_assert(n.isTerminal() == 0);
+
+        BddMap map(1, b);
+        map.put(2, c);
+        BddMap map2 = std::move(map);
+        test_assert(map2.size() == 2);
+        map = std::move(map2);
+        test_assert(map.size() == 2);
+    }
+    test_assert(sylvan_count_protected() == protected_before);
+    return 0;
+}
+
+/* A leaf type that is stored in the leaf itself */
+struct Pair
+{
+    int32_t a, b;
+    Pair operator+(const Pair &other) const { return Pair{a + other.a, b + other.b}; }
+};
+
+TASK_0(int, test_typed)
+{
+    const size_t protected_before = sylvan_count_protected();
+    {
+        Bdd x0 = Bdd::bddVar(0), x1 = Bdd::bddVar(1), x2 = Bdd::bddVar(2);
+
+        // the built-in leaf types give the same MTBDDs as the C operations
+        typedef mt::Mtbdd<double> D;
+        D a = D::ite(x0, D::terminal(1.5), D::ite(x2, D::terminal(2.0), D::terminal(-1.0)));
+        D b = D::ite(x1, D::terminal(0.5), D::terminal(3.0));
+        test_assert((a + b).GetMTBDD() == mtbdd_plus(a.GetMTBDD(), b.GetMTBDD()));
+        test_assert((a - b).GetMTBDD() == mtbdd_minus(a.GetMTBDD(), b.GetMTBDD()));
+        test_assert((a * b).GetMTBDD() == mtbdd_times(a.GetMTBDD(), b.GetMTBDD()));
+        test_assert(a.Min(b).GetMTBDD() == mtbdd_min(a.GetMTBDD(), b.GetMTBDD()));
+        test_assert(a.Max(b).GetMTBDD() == mtbdd_max(a.GetMTBDD(), b.GetMTBDD()));
+        test_assert((-a).GetMTBDD() == mtbdd_negate(a.GetMTBDD()));
+        test_assert(D(a.untyped()) == a);
+
+        typedef mt::Mtbdd<int64_t> I;
+        I c = I::ite(x0, I::terminal(3), I::ite(x1, I::terminal(5), I::terminal(7)));
+        Bdd vars = x0 * x1 * x2;
+        test_assert(c.abstract<mt::Plus>(vars).GetMTBDD() == mtbdd_abstract_plus(c.GetMTBDD(), vars.GetBDD()));
+        test_assert(c.abstract<mt::Max>(vars).GetMTBDD() == mtbdd_abstract_max(c.GetMTBDD(), vars.GetBDD()));
+        test_assert(c.abstract<mt::Plus>(x0) == I::ite(x1, I::terminal(8), I::terminal(10)));
+        test_assert(c.abstract<mt::Plus>(x0 * x1).value() == 18);
+
+        // custom leaf types, stored in the leaf and on the heap
+        typedef mt::Mtbdd<Pair> P;
+        P p = P::ite(x1, P::terminal(Pair{1, 2}), P::terminal(Pair{3, 4}));
+        P q = p + p + P::terminal(Pair{10, 20});
+        test_assert(q.isLeaf() == false);
+        test_assert(P::ite(x1, P::terminal(Pair{12, 24}), P::terminal(Pair{16, 28})) == q);
+
+        typedef mt::Mtbdd<std::string> S;
+        S s = S::ite(x0, S::terminal("ab"), S::terminal("c"));
+        S t = s + S::terminal("d");
+        sylvan_gc();
+        test_assert(S::ite(x0, S::terminal("abd"), S::terminal("cd")) == t);
+        test_assert(t.abstract<mt::Min>(x0).value() == "abd");
+        test_assert(t.abstract<mt::Plus>(x0).value() == "cdabd");
+    }
+    test_assert(sylvan_count_protected() == protected_before);
+    return 0;
+}
+
+/* Called from main, outside Lace workers */
+static int test_submit()
+{
+    const size_t protected_before = sylvan_count_protected();
+    {
+        std::vector<Bdd> vars;
+        for (uint32_t i=0; i<8; i++) vars.push_back(Bdd::bddVar(i));
+
+        // four threads submit at the same time
+        std::vector<std::future<Bdd>> results[4];
+        std::vector<std::thread> threads;
+        for (int k=0; k<4; k++) {
+            threads.push_back(std::thread([&vars, &results, k]() {
+                for (int i=0; i<8; i++) {
+                    const Bdd &a = vars[(i+k)%8], &b = vars[(i+1)%8];
+                    results[k].push_back(Bdd::submit(sylvan_op_make(SYLVAN_OP_XOR, a.GetBDD(), b.GetBDD(), sylvan_false)));
+                }
+            }));
+        }
+        for (std::thread &t : threads) t.join();
+        for (int k=0; k<4; k++) {
+            for (int i=0; i<8; i++) test_assert(results[k][i].get() == (vars[(i+k)%8] ^ vars[(i+1)%8]));
+        }
+
+        std::future<Mtbdd> m = Mtbdd::submit(sylvan_op_make(SYLVAN_OP_MTBDD_ITE, vars[0].GetBDD(),
+                Mtbdd::doubleTerminal(1.0).GetMTBDD(), Mtbdd::doubleTerminal(2.0).GetMTBDD()));
+        test_assert(m.get() == Mtbdd(vars[0]).Ite(Mtbdd::doubleTerminal(1.0), Mtbdd::doubleTerminal(2.0)));
+    }
+    test_assert(sylvan_count_protected() == protected_before);
+    return 0;
+}
+
 int main()
 {
     // Standard Lace initialization with 1 worker
@@ -55,6 +187,9 @@ int main()
     test6();
 
     int res = RUN(runtest);
+    if (res == 0) res = RUN(test_move);
+    if (res == 0) res = RUN(test_typed);
+    if (res == 0) res = test_submit();
 
     sylvan_quit();
     lace_stop();